@@ -26,6 +26,9 @@ class GameScene: SKScene {
     
     private var clockMHz: Int = 24
     private var samplingRate: Int = 22050
+    // MIDI bytes taken from the core each step, with their audio frame offsets
+    private var midiBytes = [UInt8](repeating: 0, count: 4096)
+    private var midiFrames = [UInt32](repeating: 0, count: 4096)
     private var vsync: Bool = true
     
     // Input mode management
@@ -1009,6 +1012,7 @@ class GameScene: SKScene {
             infoLog("GameScene: HDD ready after restore (scsi=\(scsiMounted) sasi=\(sasiMounted) scsiU=\(scsiUMounted)), issuing post-restore reset", category: .fileSystem)
             X68000_Reset()
         }
+        openFrameHashLogIfRequested()
         if let warmupRaw = ProcessInfo.processInfo.environment["X68_BOOT_WARMUP_STEPS"],
            let warmupSteps = Int(warmupRaw),
            warmupSteps > 0 {
@@ -1016,8 +1020,16 @@ class GameScene: SKScene {
             infoLog("GameScene: running boot warmup updates (\(steps) steps)", category: .emulation)
             for _ in 0..<steps {
                 X68000_Update(self.clockMHz, 0)
+                recordFrameHash()
+            }
+            // Headless regression batch: the warmup fields were the run.
+            if frameHashLog != nil {
+                frameHashLog?.closeFile()
+                infoLog("GameScene: frame hash run finished (\(frameHashCount) fields)", category: .emulation)
+                exit(0)
             }
         }
+        renderAudioIfRequested()
 
         guard let joyCardSprite = self.childNode(withName: "//JoyCard") as? SKSpriteNode else {
             fatalError("JoyCard sprite node not found in scene")
@@ -1490,6 +1502,57 @@ class GameScene: SKScene {
         fileSystem?.saveSRAM()
     }
     
+    // X68_FRAME_HASH_LOG=<path> writes "<field> <hash>" for every emulated
+    // field (X68000_GetFrameHash). Together with X68_BOOT_WARMUP_STEPS=<n>
+    // this is a headless regression run: n fields are hashed without any
+    // RGBA conversion and the app exits.
+    private var frameHashLog: FileHandle?
+    private var frameHashCount: UInt = 0
+
+    private func openFrameHashLogIfRequested() {
+        guard frameHashLog == nil,
+              let path = ProcessInfo.processInfo.environment["X68_FRAME_HASH_LOG"],
+              !path.isEmpty else { return }
+        FileManager.default.createFile(atPath: path, contents: nil)
+        guard let handle = FileHandle(forWritingAtPath: path) else {
+            warningLog("GameScene: cannot open frame hash log \(path)", category: .emulation)
+            return
+        }
+        frameHashLog = handle
+        frameHashCount = 0
+        X68000_SetFrameHashing(1)
+    }
+
+    private func recordFrameHash() {
+        guard let log = frameHashLog else { return }
+        var hash: UInt64 = 0
+        let count = X68000_GetFrameHash(&hash)
+        guard count != frameHashCount else { return }
+        frameHashCount = count
+        log.write(Data(String(format: "%lu %016llx\n", count, hash).utf8))
+    }
+
+    // X68_AUDIO_RENDER=<path> renders X68_AUDIO_RENDER_FIELDS=<n> fields
+    // (default 600) of sound offline through X68000_RenderAudio, after any
+    // X68_BOOT_WARMUP_STEPS, and the app exits. X68_AUDIO_RENDER_STEMS=1
+    // also writes the OPM and ADPCM stems next to it. The same disks and
+    // settings give the same file on every run.
+    private func renderAudioIfRequested() {
+        let env = ProcessInfo.processInfo.environment
+        guard let path = env["X68_AUDIO_RENDER"], !path.isEmpty else { return }
+        let requested = env["X68_AUDIO_RENDER_FIELDS"].flatMap { Int($0) } ?? 600
+        let fields = min(max(requested, 1), 500_000)
+        let stems: Int32 = env["X68_AUDIO_RENDER_STEMS"] == "1" ? 1 : 0
+        infoLog("GameScene: rendering \(fields) fields of audio to \(path)", category: .audio)
+        let rendered = X68000_RenderAudio(path, self.clockMHz, fields, stems)
+        if rendered < 0 {
+            errorLog("GameScene: audio render to \(path) failed", category: .audio)
+            exit(1)
+        }
+        infoLog("GameScene: audio render finished (\(rendered) fields)", category: .audio)
+        exit(0)
+    }
+
     var d = [UInt8](repeating: 0xff, count: 768 * 512 * 4)
     private var frameBufferByteCount: Int = 768 * 512 * 4
     var w: Int = 1
@@ -1535,10 +1598,10 @@ class GameScene: SKScene {
             // Drive core timing from SpriteKit fixed-step; avoid internal timer gating.
             if X68000_Monitor_IsPaused() == 0 {
                 X68000_Update(self.clockMHz, 0)
+                recordFrameHash()
             }
 
             flushMIDIBuffer()
-            midiController.flushDelayedEvents()
             
             fixedStepAccumulator -= targetFrameTime
             newFrameReady = true
@@ -1589,10 +1652,9 @@ class GameScene: SKScene {
     }
 
     private func flushMIDIBuffer() {
-        let size = X68000_GetMIDIBufferSize()
-        guard size > 0 else { return }
-        guard let buffer = X68000_GetMIDIBuffer() else { return }
-        midiController.Send(buffer, Int(size))
+        let count = X68000_GetMIDIEvents(&midiBytes, &midiFrames, midiBytes.count)
+        guard count > 0 else { return }
+        midiController.Send(midiBytes, midiFrames, Int(count), sampleRate: samplingRate)
     }
 
     #if os(macOS)
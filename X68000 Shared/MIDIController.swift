@@ -13,9 +13,8 @@ import CoreMIDI
 public typealias MidiEvent = [UInt8]
 
 extension MIDIPacketList {
-    init(midiEvents: [MidiEvent]) {
+    init(midiEvents: [MidiEvent], timestamp: MIDITimeStamp = 0) {
         
-        let timestamp = MIDITimeStamp(0)
         let totalBytesInAllEvents = midiEvents.reduce(0) { total, event in
             return total + event.count
         }
@@ -60,12 +59,13 @@ class MIDIController {
     private var midiDests: [MIDIEndpointRef] = []
     private var outputDelayMs: Double = 0.0
 
-    private struct PendingEvent {
-        let dueTime: CFTimeInterval
-        let data: [UInt8]
-    }
-    private var pendingEvents: [PendingEvent] = []
-    private var pendingIndex: Int = 0
+    // Host time the message being parsed is due at; 0 sends it now.
+    private var sendTime: MIDITimeStamp = 0
+    private lazy var hostTicksPerSecond: Double = {
+        var info = mach_timebase_info_data_t()
+        mach_timebase_info(&info)
+        return 1e9 * Double(info.denom) / Double(info.numer)
+    }()
 
     private var runningStatus: UInt8? = nil
     private var pendingStatus: UInt8? = nil
@@ -151,15 +151,18 @@ class MIDIController {
         self.GetSource()
     }
     
-    func Send(_ buffer: UnsafeMutablePointer<UInt8>?, _ count: Int) {
-        sendStream(buffer, count)
-    }
-
-    func sendStream(_ buffer: UnsafePointer<UInt8>?, _ count: Int) {
-        guard let buffer, count > 0 else { return }
+    /// Sends count bytes of the guest's MIDI stream. frames[i] is how many
+    /// audio frames after the one being played now bytes[i] was written, so
+    /// each message is stamped to leave with the sound emulated next to it.
+    func Send(_ bytes: [UInt8], _ frames: [UInt32], _ count: Int, sampleRate: Int) {
+        guard count > 0, sampleRate > 0 else { return }
+        let now = mach_absolute_time()
         for i in 0..<count {
-            handleIncomingByte(buffer[i])
+            let seconds = Double(frames[i]) / Double(sampleRate) + outputDelayMs / 1000.0
+            sendTime = seconds > 0.0 ? now + MIDITimeStamp(seconds * hostTicksPerSecond) : 0
+            handleIncomingByte(bytes[i])
         }
+        sendTime = 0
     }
 
     private func handleIncomingByte(_ byte: UInt8) {
@@ -256,14 +259,8 @@ class MIDIController {
     private func sendEvent(_ event: [UInt8]) {
         guard !event.isEmpty else { return }
 
-        if outputDelayMs > 0.0 {
-            let due = CFAbsoluteTimeGetCurrent() + (outputDelayMs / 1000.0)
-            pendingEvents.append(PendingEvent(dueTime: due, data: event))
-            return
-        }
-
         if event.count <= 255 {
-            var packets = MIDIPacketList(midiEvents: [event])
+            var packets = MIDIPacketList(midiEvents: [event], timestamp: sendTime)
             sendPackets(&packets)
             return
         }
@@ -272,7 +269,7 @@ class MIDIController {
         while offset < event.count {
             let end = min(offset + 255, event.count)
             let slice = Array(event[offset..<end])
-            var packets = MIDIPacketList(midiEvents: [slice])
+            var packets = MIDIPacketList(midiEvents: [slice], timestamp: sendTime)
             sendPackets(&packets)
             offset = end
         }
@@ -297,38 +294,6 @@ class MIDIController {
         outputDelayMs = max(0.0, ms)
     }
 
-    func flushDelayedEvents(_ now: CFTimeInterval = CFAbsoluteTimeGetCurrent()) {
-        guard pendingIndex < pendingEvents.count else { return }
-        while pendingIndex < pendingEvents.count {
-            let item = pendingEvents[pendingIndex]
-            if item.dueTime > now {
-                break
-            }
-            sendEventImmediate(item.data)
-            pendingIndex += 1
-        }
-        if pendingIndex > 256 {
-            pendingEvents.removeFirst(pendingIndex)
-            pendingIndex = 0
-        }
-    }
-
-    private func sendEventImmediate(_ event: [UInt8]) {
-        guard !event.isEmpty else { return }
-        if event.count <= 255 {
-            var packets = MIDIPacketList(midiEvents: [event])
-            sendPackets(&packets)
-            return
-        }
-        var offset = 0
-        while offset < event.count {
-            let end = min(offset + 255, event.count)
-            let slice = Array(event[offset..<end])
-            var packets = MIDIPacketList(midiEvents: [slice])
-            sendPackets(&packets)
-            offset = end
-        }
-    }
     
     func MIDINotifyBlock(midiNotification: UnsafePointer<MIDINotification>) {
         debugLog("\(#function) \(midiNotification.pointee.messageID.rawValue)", category: .network)
@@ -4,6 +4,12 @@
 
 void X68000_Init( const long samplingrate);
 void X68000_Update(const long clockMHz, const long vsync );
+// Runs fields fields unthrottled and writes their audio to a WAV file
+// (plus path.adpcm.wav/path.opm.wav with stems). Returns fields, or -1.
+long X68000_RenderAudio(const char* path, const long clockMHz, const long fields, const int stems);
+// Logs OPM register writes to path for tests/core/test_opm_replay; NULL
+// stops. Returns 0 on failure.
+int X68000_LogOPM(const char* path);
 void X68000_LoadFDD( const long drive, const char* filename );
 void X68000_LoadHDD( const char* filename );
 unsigned char* X68000_GetDiskImageBufferPointer( const long drive, const long size );
@@ -27,6 +33,9 @@ typedef struct {
 } X68FrameInfo;
 void X68000_GetFrameInfo(X68FrameInfo *out);
 int X68000_GetImageInto(unsigned char* data, unsigned long capacityBytes);
+// Per-field 64-bit hash of the visible ScrBuf region (see scrbuf.h).
+void X68000_SetFrameHashing(int enable);
+unsigned long X68000_GetFrameHash(unsigned long long *hash);
 
 const int X68000_IsFrameDirty(void);
 void X68000_AudioCallBack(void* buffer, const unsigned int sample);
@@ -75,8 +84,7 @@ const char* X68000_SCSIU_GetStatus(void);
 void Memory_SetSCSIMode(void);
 void Memory_ClearSCSIMode(void);
 
-const long X68000_GetMIDIBufferSize();
-unsigned char* X68000_GetMIDIBuffer();
+long X68000_GetMIDIEvents(unsigned char* data, unsigned int* frames, long max);
 
 // PPI (JoyportU) functions
 void PPI_SetJoyportUMode(int mode);
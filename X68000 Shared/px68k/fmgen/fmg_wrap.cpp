@@ -5,6 +5,8 @@
 //  - opna.cppYMF288ѤΥ饹ɲäƤޤOPNAΤޤޤɤ͡ʤۤȤʤޤ
 //  - ¿ʬ¾ϮäƤʤϤġ
 
+#include <stdio.h>
+
 extern "C" {
 
 #include "common.h"
@@ -14,10 +16,11 @@ extern "C" {
 #include "mfp.h"
 #include "adpcm.h"
 #include "fdc.h"
+#include "resample.h"
 #include "fmg_wrap.h"
+};
 
 #include "opm.h"
-};
 
 class MyOPM : public FM::OPM
 {
@@ -38,6 +41,21 @@ MyOPM::MyOPM()
 	CurReg = 0;
 }
 
+// OPM_StartLog εϿ
+static FILE* opm_log = NULL;
+static DWORD opm_log_clock;		// OPM_Timer ǿʤ 10MHz å
+static DWORD opm_log_last;		// ǸΥ쥳ɤ opm_log_clock
+static int opm_log_error;
+
+static void OPM_LogWrite(BYTE reg, BYTE data)
+{
+	DWORD d = opm_log_clock-opm_log_last;
+	BYTE rec[OPMLOG_RECORD] = { (BYTE)d, (BYTE)(d>>8), (BYTE)(d>>16), (BYTE)(d>>24), reg, data };
+
+	opm_log_last = opm_log_clock;
+	if ( fwrite(rec, sizeof(rec), 1, opm_log)!=1 ) opm_log_error = 1;
+}
+
 #define FM_MIDI_OUT (0)
 
 #if FM_MIDI_OUT
@@ -71,7 +89,9 @@ void MyOPM::WriteIO(DWORD adr, BYTE data)
 			::ADPCM_SetClock((data>>5)&4);
 			::FDC_SetForceReady((data>>6)&1);
 		}
-		SetReg((int)CurReg, (int)data);
+		if ( opm_log ) OPM_LogWrite((BYTE)CurReg, data);
+		// ѥ᡼ϼιˤޤȤȿǤ
+		WriteReg((uint)CurReg, (uint)data);
 #if FM_MIDI_OUT
         if ( CurReg >= 0x08 ) {
             int ch = data & 0x07;
@@ -149,22 +169,49 @@ void MyOPM::Count2(DWORD clock)
 
 
 static MyOPM* opm = NULL;
+static DWORD opm_clock;
+
+// OPM Υ졼ȡclock/644MHz ʤ 62.5kHzˤǹơ
+// ۥȤΥ졼Ȥؤ resample.c Ѵ
+#define OPM_RSBLOCK	1024		// ٤˻ĥͥƥ֥졼ȤΥե졼
+
+static Resampler opm_rs;
+static DWORD opm_rs_step;		// 1ץ뤢 (16.16)
+static DWORD opm_rs_t;			// νϤΰ (16.16, opm_rs_in Ƭ)
+static int opm_rs_avail;		// ѤߤΥե졼
+static int opm_rs_zero;			// opm_rs_in ³̵Υե졼 (ޤ)
+static short opm_rs_in[2][RESAMPLE_TAPS-1+OPM_RSBLOCK];
+
+static void OPM_SetupResampler(int clock, int rate)
+{
+	DWORD native = (DWORD)clock/64;
+
+	Resample_Init(&opm_rs, native, (DWORD)rate);
+	opm_rs_step = (DWORD)((((unsigned long long)native<<16) + rate/2) / rate);
+	opm_rs_t = 0;
+	opm_rs_avail = 0;
+	opm_rs_zero = RESAMPLE_TAPS-1;
+	memset(opm_rs_in, 0, sizeof(opm_rs_in));
+}
 
 int OPM_Init(int clock, int rate)
 {
 	opm = new MyOPM();
 	if ( !opm ) return FALSE;
-	if ( !opm->Init(clock, rate, TRUE) ) {
+	if ( !opm->Init(clock, clock/64, TRUE) ) {
 		delete opm;
 		opm = NULL;
 		return FALSE;
 	}
+	opm_clock = (DWORD)clock;
+	OPM_SetupResampler(clock, rate);
 	return TRUE;
 }
 
 
 void OPM_Cleanup(void)
 {
+	OPM_StopLog();
     delete opm;
 	opm = NULL;
 }
@@ -172,7 +219,11 @@ void OPM_Cleanup(void)
 
 void OPM_SetRate(int clock, int rate)
 {
-	if ( opm ) opm->SetRate(clock, rate, TRUE);
+	if ( opm ) {
+		opm->SetRate(clock, clock/64, TRUE);
+		opm_clock = (DWORD)clock;
+		OPM_SetupResampler(clock, rate);
+	}
 }
 
 
@@ -199,18 +250,127 @@ void FASTCALL OPM_Write(DWORD adr, BYTE data)
 }
 
 
+// buffer ˤϲû˽񤭹ʥߥå mixer.c ǹԤ
 void OPM_Update(short *buffer, int length, int rate, BYTE *pbsp, BYTE *pbep)
 {
-    if ( opm ) opm->Mix((FM::Sample*)buffer, length, rate, pbsp, pbep);
+	static FM::Sample mix[OPM_RSBLOCK*2];
+	static short outs[2][OPM_RSBLOCK];
+	int copies = (rate==11025) ? 4 : (rate==22050) ? 2 : 1;	// PSPʳrate=0
+
+	if ( !opm ) return;
+
+	while ( length>0 ) {
+		int i, c, n, last, quiet;
+		int d = (int)(opm_rs_t>>16);
+
+		// ɤˤפʤʤäʬΤƤ
+		if ( d>opm_rs_avail ) d = opm_rs_avail;
+		if ( d ) {
+			for (c=0; c<2; c++)
+				memmove(opm_rs_in[c], opm_rs_in[c]+d, (RESAMPLE_TAPS-1+opm_rs_avail-d)*sizeof(short));
+			opm_rs_avail -= d;
+			opm_rs_t -= (DWORD)d<<16;
+			if ( opm_rs_zero>RESAMPLE_TAPS-1+opm_rs_avail ) opm_rs_zero = RESAMPLE_TAPS-1+opm_rs_avail;
+		}
+
+		// ν꤬ OPM_RSBLOCK ˼ޤʬϤ
+		n = (int)((((DWORD)OPM_RSBLOCK<<16) - 1 - opm_rs_t) / opm_rs_step) + 1;
+		if ( n>length ) n = length;
+		last = (int)((opm_rs_t + (DWORD)(n-1)*opm_rs_step)>>16);
+
+		// ­ʤʬ
+		if ( last>=opm_rs_avail ) {
+			int g = last+1-opm_rs_avail;
+			short *dl = opm_rs_in[0]+RESAMPLE_TAPS-1+opm_rs_avail;
+			short *dr = opm_rs_in[1]+RESAMPLE_TAPS-1+opm_rs_avail;
+			if ( opm->IsSilent() ) {
+				// ĤäƤͥ뤬̵ Mix  0 Фǡ֤ʤʤ
+				memset(dl, 0, g*sizeof(short));
+				memset(dr, 0, g*sizeof(short));
+				opm_rs_zero += g;
+			} else {
+				memset(mix, 0, g*2*sizeof(FM::Sample));
+				opm->Mix(mix, g, 0, (BYTE*)mix, (BYTE*)(mix+OPM_RSBLOCK*2));
+				for (i=0; i<g; i++) {
+					dl[i] = mix[i*2];
+					dr[i] = mix[i*2+1];
+				}
+				for (i=g; (i>0)&&!dl[i-1]&&!dr[i-1]; i--) ;
+				opm_rs_zero = (i) ? g-i : opm_rs_zero+g;
+			}
+			opm_rs_avail += g;
+		}
+
+		// ָŤޤ̵ʤ顢ե륿̤Ƥ 0
+		quiet = ( (int)(opm_rs_t>>16) >= RESAMPLE_TAPS-1+opm_rs_avail-opm_rs_zero );
+		if ( quiet ) {
+			int cnt = n*copies*2;
+			opm_rs_t += (DWORD)n*opm_rs_step;
+			while ( cnt>0 ) {
+				int run;
+				if ( (BYTE*)buffer>=pbep ) buffer = (short*)pbsp;
+				run = (int)((short*)pbep-buffer);
+				if ( run>cnt ) run = cnt;
+				memset(buffer, 0, run*sizeof(short));
+				buffer += run;
+				cnt -= run;
+			}
+		} else {
+			Resample_Step(&opm_rs, opm_rs_in[0]+RESAMPLE_TAPS-1, opm_rs_t, opm_rs_step, outs[0], n);
+			opm_rs_t = Resample_Step(&opm_rs, opm_rs_in[1]+RESAMPLE_TAPS-1, opm_rs_t, opm_rs_step, outs[1], n);
+
+			for (i=0; i<n; i++) {
+				for (c=0; c<copies; c++) {
+					if ( (BYTE*)buffer>=pbep ) buffer = (short*)pbsp;
+					buffer[0] = outs[0][i];
+					buffer[1] = outs[1][i];
+					buffer += 2;
+				}
+			}
+		}
+		length -= n;
+	}
 }
 
 
 void FASTCALL OPM_Timer(DWORD step)
 {
+	opm_log_clock += step;
 	if ( opm ) opm->Count2(step);
 }
 
 
+int OPM_StartLog(const char *path)
+{
+	BYTE head[OPMLOG_HEADER];
+
+	OPM_StopLog();
+	opm_log = fopen(path, "wb");
+	if ( !opm_log ) return FALSE;
+	opm_log_error = 0;
+	opm_log_last = opm_log_clock;
+	memcpy(head, OPMLOG_MAGIC, 8);
+	head[8] = (BYTE)opm_clock;
+	head[9] = (BYTE)(opm_clock>>8);
+	head[10] = (BYTE)(opm_clock>>16);
+	head[11] = (BYTE)(opm_clock>>24);
+	if ( fwrite(head, sizeof(head), 1, opm_log)!=1 ) opm_log_error = 1;
+	return TRUE;
+}
+
+
+int OPM_StopLog(void)
+{
+	int ok;
+
+	if ( !opm_log ) return TRUE;
+	ok = !opm_log_error;
+	if ( fclose(opm_log)!=0 ) ok = FALSE;
+	opm_log = NULL;
+	return ok;
+}
+
+
 void OPM_SetVolume(BYTE vol)
 {
 	int v = (vol)?((16-vol)*4):192;		// Τ餤ʤ
@@ -11,4 +11,15 @@ void FASTCALL OPM_Timer(DWORD step);
 void OPM_SetVolume(BYTE vol);
 void OPM_SetRate(int clock, int rate);
 
+// OPM へのレジスタ書き込みを path に記録する (tests/core/test_opm_replay で再生する)
+//   ヘッダ    "OPMLOG01" と OPM のクロック (Hz)
+//   レコード  前のレコードからの経過時間 (OPM_Timer に渡された 10MHz クロック),
+//             レジスタ番号, データ
+// 数値は 32bit リトルエンディアン。StopLog は書き込みに失敗していれば FALSE
+#define OPMLOG_MAGIC	"OPMLOG01"
+#define OPMLOG_HEADER	12
+#define OPMLOG_RECORD	6
+int OPM_StartLog(const char *path);
+int OPM_StopLog(void);
+
 #endif //_win68_opm_fmgen
@@ -166,74 +166,13 @@ namespace FM
 		1,-1,  2, 0,  2, 0,		// 15 60~
 	};
 
-	// fixed equasion-based tables
-	int		pmtable[2][8][FM_LFOENTS];
-	uint	amtable[2][4][FM_LFOENTS];
-
-	static bool tablemade = false;
+	// fixed equasion-based tables (tools/gentables)
+#include "fmgen_tables.inc"
 }
 
 namespace FM
 {
 
-// ---------------------------------------------------------------------------
-//	�ơ��֥����
-//
-void MakeLFOTable()
-{
-	if (tablemade)
-		return;
-
-	tablemade = true;
-	
-	int i;
-
-	static const double pms[2][8] = 
-	{ 
-		{ 0, 1/360., 2/360., 3/360.,  4/360.,  6/360., 12/360.,  24/360., },	// OPNA
-//		{ 0, 1/240., 2/240., 4/240., 10/240., 20/240., 80/240., 140/240., },	// OPM
-		{ 0, 1/480., 2/480., 4/480., 10/480., 20/480., 80/480., 140/480., },	// OPM
-//		{ 0, 1/960., 2/960., 4/960., 10/960., 20/960., 80/960., 140/960., },	// OPM
-	};
-	//		 3		 6,      12      30       60       240      420		/ 720
-	//	1.000963
-	//	lfofref[level * max * wave];
-	//	pre = lfofref[level][pms * wave >> 8];
-	static const uint8 amt[2][4] = 
-	{
-		{ 31, 6, 4, 3 }, // OPNA
-		{ 31, 2, 1, 0 }, //	OPM
-	};
-	
-	for (int type = 0; type < 2; type++)
-	{
-		for (i=0; i<8; i++)
-		{
-			double pmb = pms[type][i];
-			for (int j=0; j<FM_LFOENTS; j++)
-			{
-				//double v = pow(2.0, pmb * (2 * j - FM_LFOENTS+1) / (FM_LFOENTS-1));
-				double w = 0.6 * pmb * sin(2 * j * 3.14159265358979323846 / FM_LFOENTS) + 1;
-//				pmtable[type][i][j] = int(0x10000 * (v - 1));
-//				if (type == 0)
-					pmtable[type][i][j] = int(0x10000 * (w - 1));
-//				else
-//					pmtable[type][i][j] = int(0x10000 * (v - 1));
-
-//				printf("pmtable[%d][%d][%.2x] = %5d  %7.5f %7.5f\n", type, i, j, pmtable[type][i][j], v, w);
-			}
-		}
-		for (i=0; i<4; i++)
-		{
-			for (int j=0; j<FM_LFOENTS; j++)
-			{
-				amtable[type][i][j] = (((j * 4) >> amt[type][i]) * 2) << 2;
-			}
-		}
-	}
-}
-
-
 // ---------------------------------------------------------------------------
 //	���å���Ƕ��̤���ʬ
 //
@@ -274,17 +213,10 @@ void Chip::MakeTable()
 // ---------------------------------------------------------------------------
 //	Operator
 //
-bool FM::Operator::tablehasmade = false;
-uint FM::Operator::sinetable[1024];
-int32 FM::Operator::cltable[FM_CLENTS];
-
 //	����
 FM::Operator::Operator()
 : chip_(0)
 {
-	if (!tablehasmade)
-		MakeTable();
-
 	// EG Part
 	ar_ = dr_ = sr_ = rr_ = key_scale_rate_ = 0;
 	ams_ = amtable[0][0];
@@ -324,48 +256,6 @@ void FM::Operator::Reset()
 	PARAMCHANGE(0);
 }
 
-void Operator::MakeTable()
-{
-	// �п��ơ��֥�κ���
-	assert(FM_CLENTS >= 256);
-
-	int* p = cltable;
-	int i;
-	for (i=0; i<256; i++)
-	{
-		int v = int(floor(pow(2., 13. - i / 256.)));
-		v = (v + 2) & ~3;
-		*p++ = v;
-		*p++ = -v;
-	}
-	while (p < cltable + FM_CLENTS)
-	{
-		*p = p[-512] / 2;
-		p++;
-	}
-
-//	for (i=0; i<13*256; i++)
-//		printf("%4d, %d, %d\n", i, cltable[i*2], cltable[i*2+1]);
-
-	// ������ơ��֥�κ���
-	double log2 = log(2.);
-	for (i=0; i<FM_OPSINENTS/2; i++)
-	{
-		double r = (i * 2 + 1) * FM_PI / FM_OPSINENTS;
-		double q = -256 * log(sin(r)) / log2;
-		uint s = (int) (floor(q + 0.5)) + 1;
-//		printf("%d, %d\n", s, cltable[s * 2] / 8);
-		sinetable[i]                  = s * 2 ;
-		sinetable[FM_OPSINENTS / 2 + i] = s * 2 + 1;
-	}
-
-	::FM::MakeLFOTable();
-
-	tablehasmade = true;
-}
-
-
-
 inline void FM::Operator::SetDPBN(uint dp, uint bn)
 {
     dp_ = dp;
@@ -709,29 +599,13 @@ inline FM::ISample FM::Operator::CalcFBL(uint fb)
 //	4-op Channel
 //
 const uint8 Channel4::fbtable[8] = { 31, 7, 6, 5, 4, 3, 2, 1 };
-int Channel4::kftable[64];
-
-bool Channel4::tablehasmade = false;
-
 
 Channel4::Channel4()
 {
-	if (!tablehasmade)
-		MakeTable();
-
 	SetAlgorithm(0);
 	pms = pmtable[0][0];
 }
 
-void Channel4::MakeTable()
-{
-	// 100/64 cent =  2^(i*100/64*1200)
-	for (int i=0; i<64; i++)
-	{
-		kftable[i] = int(0x10000 * pow(2., i / 768.) );
-	}
-}
-
 // �ꥻ�å�
 void Channel4::Reset()
 {
@@ -44,6 +44,10 @@ namespace FM
 
 	class Chip;
 
+	//	LFO tables [OPNA/OPM][PMS/AMS][phase] (fmgen_tables.inc)
+	extern const int	pmtable[2][8][FM_LFOENTS];
+	extern const uint	amtable[2][4][FM_LFOENTS];
+
 	//	Operator -------------------------------------------------------------
 	class Operator
 	{
@@ -142,7 +146,7 @@ namespace FM
 
 		uint	key_scale_rate_;		// key scale rate
 		EGPhase	eg_phase_;
-		uint*	ams_;
+		const uint*	ams_;
 		uint	ms_;
 		
 		uint	tl_;			// Total Level	 (0-127)
@@ -171,16 +175,14 @@ namespace FM
 		static const int8 attacktable[64][8];
 		static const int ssgenvtable[8][2][3][2];
 
-		static uint	sinetable[1024];
-		static int32 cltable[FM_CLENTS];
-
-		static bool tablehasmade;
-		static void MakeTable();
+		static const uint	sinetable[1024];
+		static const int32 cltable[FM_CLENTS];
 
 
 
 	//	friends --------------------------------------------------------------
 		friend class Channel4;
+		friend class Channel4x8;
 		friend void __stdcall FM_NextPhase(Operator* op);
 
 	public:
@@ -221,14 +223,13 @@ namespace FM
 		int		buf[4];
 		int*	in[3];			//  OP ϥݥ
 		int*	out[3];			//  OP νϥݥ
-		int*	pms;
+		const int*	pms;
 		int		algo_;
 		Chip*	chip_;
 
-		static void MakeTable();
+		static const int	kftable[64];
 
-		static bool tablehasmade;
-		static int 	kftable[64];
+		friend class Channel4x8;
 
 
 	public:
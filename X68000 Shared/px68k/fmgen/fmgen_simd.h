@@ -30,16 +30,6 @@ inline int32 branchless_add_if(int32 base, int32 addend, int32 condition) {
 #ifdef FMGEN_USE_NEON
 // ARM NEON optimizations for Apple Silicon
 
-// Process 4 channels at once
-inline void calc_4_channels_neon(int32* results, void** channels, int32 activech_mask) {
-    // We'll implement the actual channel calculation here
-    int32x4_t mask = vdupq_n_s32(0);
-    int32x4_t result = vdupq_n_s32(0);
-    
-    // Store results
-    vst1q_s32(results, result);
-}
-
 // Prefetch next cache line
 inline void prefetch_next(const void* addr) {
     __builtin_prefetch(addr, 0, 3);
@@ -48,13 +38,6 @@ inline void prefetch_next(const void* addr) {
 #elif defined(FMGEN_USE_SSE)
 // x86 SSE optimizations for Intel Macs
 
-inline void calc_4_channels_sse(__m128i* results, void** channels, int32 activech_mask) {
-    __m128i mask = _mm_setzero_si128();
-    __m128i result = _mm_setzero_si128();
-    
-    _mm_store_si128(results, result);
-}
-
 inline void prefetch_next(const void* addr) {
     _mm_prefetch((const char*)addr, _MM_HINT_T0);
 }
@@ -69,6 +52,175 @@ inline void prefetch_next(const void* addr) {
 
 #endif
 
+#ifdef __cplusplus
+// ---------------------------------------------------------------------------
+// 8 x int32 lane vector used by the SoA channel block (fmgen_soa.cpp).
+//
+// AVX2 holds all eight lanes in one register and gathers table lookups.
+// SSE4.1 and NEON split them in two 128-bit halves and gather through a
+// scalar loop. Anything else gets a plain array so the block still builds.
+// All operations wrap like the scalar int32 code they replace. Loads and
+// stores are unaligned so an OPM allocated with plain new is fine.
+
+#if defined(FMGEN_USE_NEON)
+    #define FMGEN_V8_NEON 1
+#elif defined(__AVX2__)
+    #define FMGEN_V8_AVX2 1
+#elif defined(__SSE4_1__)
+    #define FMGEN_V8_SSE41 1
+#else
+    #define FMGEN_V8_SCALAR 1
+#endif
+
+#define FMGEN_V8_ALIGN __attribute__((aligned(32)))
+
+namespace FM
+{
+#if defined(FMGEN_V8_AVX2)
+
+    struct V8 { __m256i v; };
+
+    inline V8 v8_load(const int32* p) { V8 r = { _mm256_loadu_si256((const __m256i*)p) }; return r; }
+    inline void v8_store(int32* p, V8 a) { _mm256_storeu_si256((__m256i*)p, a.v); }
+    inline V8 v8_set1(int32 x) { V8 r = { _mm256_set1_epi32(x) }; return r; }
+    inline V8 v8_add(V8 a, V8 b) { V8 r = { _mm256_add_epi32(a.v, b.v) }; return r; }
+    inline V8 v8_sub(V8 a, V8 b) { V8 r = { _mm256_sub_epi32(a.v, b.v) }; return r; }
+    inline V8 v8_and(V8 a, V8 b) { V8 r = { _mm256_and_si256(a.v, b.v) }; return r; }
+    inline V8 v8_mullo(V8 a, V8 b) { V8 r = { _mm256_mullo_epi32(a.v, b.v) }; return r; }
+    template <int N> inline V8 v8_srai(V8 a) { V8 r = { _mm256_srai_epi32(a.v, N) }; return r; }
+    template <int N> inline V8 v8_srli(V8 a) { V8 r = { _mm256_srli_epi32(a.v, N) }; return r; }
+    template <int N> inline V8 v8_slli(V8 a) { V8 r = { _mm256_slli_epi32(a.v, N) }; return r; }
+    inline V8 v8_srav(V8 a, V8 n) { V8 r = { _mm256_srav_epi32(a.v, n.v) }; return r; }
+    // all ones where the lane is zero
+    inline V8 v8_eqz(V8 a) { V8 r = { _mm256_cmpeq_epi32(a.v, _mm256_setzero_si256()) }; return r; }
+    // bit i set where lane i <= 0
+    inline uint v8_lezmask(V8 a)
+    {
+        return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(1), a.v)));
+    }
+    // base[idx[i]] for each lane
+    inline V8 v8_gather(const int32* base, V8 idx)
+    {
+        V8 r = { _mm256_i32gather_epi32((const int*)base, idx.v, 4) }; return r;
+    }
+
+#elif defined(FMGEN_V8_SSE41)
+
+    struct V8 { __m128i lo, hi; };
+
+    inline V8 v8_load(const int32* p) { V8 r = { _mm_loadu_si128((const __m128i*)p), _mm_loadu_si128((const __m128i*)(p + 4)) }; return r; }
+    inline void v8_store(int32* p, V8 a) { _mm_storeu_si128((__m128i*)p, a.lo); _mm_storeu_si128((__m128i*)(p + 4), a.hi); }
+    inline V8 v8_set1(int32 x) { V8 r = { _mm_set1_epi32(x), _mm_set1_epi32(x) }; return r; }
+    inline V8 v8_add(V8 a, V8 b) { V8 r = { _mm_add_epi32(a.lo, b.lo), _mm_add_epi32(a.hi, b.hi) }; return r; }
+    inline V8 v8_sub(V8 a, V8 b) { V8 r = { _mm_sub_epi32(a.lo, b.lo), _mm_sub_epi32(a.hi, b.hi) }; return r; }
+    inline V8 v8_and(V8 a, V8 b) { V8 r = { _mm_and_si128(a.lo, b.lo), _mm_and_si128(a.hi, b.hi) }; return r; }
+    inline V8 v8_mullo(V8 a, V8 b) { V8 r = { _mm_mullo_epi32(a.lo, b.lo), _mm_mullo_epi32(a.hi, b.hi) }; return r; }
+    template <int N> inline V8 v8_srai(V8 a) { V8 r = { _mm_srai_epi32(a.lo, N), _mm_srai_epi32(a.hi, N) }; return r; }
+    template <int N> inline V8 v8_srli(V8 a) { V8 r = { _mm_srli_epi32(a.lo, N), _mm_srli_epi32(a.hi, N) }; return r; }
+    template <int N> inline V8 v8_slli(V8 a) { V8 r = { _mm_slli_epi32(a.lo, N), _mm_slli_epi32(a.hi, N) }; return r; }
+    inline V8 v8_srav(V8 a, V8 n)
+    {
+        int32 FMGEN_V8_ALIGN x[8], c[8];
+        v8_store(x, a), v8_store(c, n);
+        for (int i=0; i<8; i++)
+            x[i] >>= c[i];
+        return v8_load(x);
+    }
+    inline V8 v8_eqz(V8 a)
+    {
+        V8 r = { _mm_cmpeq_epi32(a.lo, _mm_setzero_si128()), _mm_cmpeq_epi32(a.hi, _mm_setzero_si128()) }; return r;
+    }
+    inline uint v8_lezmask(V8 a)
+    {
+        __m128i one = _mm_set1_epi32(1);
+        return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(one, a.lo)))
+            | (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(one, a.hi))) << 4);
+    }
+    inline __m128i v4_gather(const int32* base, __m128i i)
+    {
+        return _mm_setr_epi32(base[_mm_cvtsi128_si32(i)], base[_mm_extract_epi32(i, 1)],
+                              base[_mm_extract_epi32(i, 2)], base[_mm_extract_epi32(i, 3)]);
+    }
+    inline V8 v8_gather(const int32* base, V8 idx)
+    {
+        V8 r = { v4_gather(base, idx.lo), v4_gather(base, idx.hi) }; return r;
+    }
+
+#elif defined(FMGEN_V8_NEON)
+
+    struct V8 { int32x4_t lo, hi; };
+
+    inline V8 v8_load(const int32* p) { V8 r = { vld1q_s32(p), vld1q_s32(p + 4) }; return r; }
+    inline void v8_store(int32* p, V8 a) { vst1q_s32(p, a.lo); vst1q_s32(p + 4, a.hi); }
+    inline V8 v8_set1(int32 x) { V8 r = { vdupq_n_s32(x), vdupq_n_s32(x) }; return r; }
+    inline V8 v8_add(V8 a, V8 b) { V8 r = { vaddq_s32(a.lo, b.lo), vaddq_s32(a.hi, b.hi) }; return r; }
+    inline V8 v8_sub(V8 a, V8 b) { V8 r = { vsubq_s32(a.lo, b.lo), vsubq_s32(a.hi, b.hi) }; return r; }
+    inline V8 v8_and(V8 a, V8 b) { V8 r = { vandq_s32(a.lo, b.lo), vandq_s32(a.hi, b.hi) }; return r; }
+    inline V8 v8_mullo(V8 a, V8 b) { V8 r = { vmulq_s32(a.lo, b.lo), vmulq_s32(a.hi, b.hi) }; return r; }
+    template <int N> inline V8 v8_srai(V8 a) { V8 r = { vshrq_n_s32(a.lo, N), vshrq_n_s32(a.hi, N) }; return r; }
+    template <int N> inline V8 v8_srli(V8 a)
+    {
+        V8 r = { vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a.lo), N)),
+                 vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a.hi), N)) };
+        return r;
+    }
+    template <int N> inline V8 v8_slli(V8 a) { V8 r = { vshlq_n_s32(a.lo, N), vshlq_n_s32(a.hi, N) }; return r; }
+    // signed shift by a negative count is an arithmetic right shift
+    inline V8 v8_srav(V8 a, V8 n) { V8 r = { vshlq_s32(a.lo, vnegq_s32(n.lo)), vshlq_s32(a.hi, vnegq_s32(n.hi)) }; return r; }
+    inline V8 v8_eqz(V8 a)
+    {
+        V8 r = { vreinterpretq_s32_u32(vceqq_s32(a.lo, vdupq_n_s32(0))),
+                 vreinterpretq_s32_u32(vceqq_s32(a.hi, vdupq_n_s32(0))) };
+        return r;
+    }
+    inline uint v8_lezmask(V8 a)
+    {
+        static const uint32 FMGEN_V8_ALIGN bits[4] = { 1, 2, 4, 8 };
+        uint32x4_t b = vld1q_u32(bits);
+        uint32x4_t l = vandq_u32(vcleq_s32(a.lo, vdupq_n_s32(0)), b);
+        uint32x4_t h = vandq_u32(vcleq_s32(a.hi, vdupq_n_s32(0)), b);
+        return vaddvq_u32(l) | (vaddvq_u32(h) << 4);
+    }
+    inline V8 v8_gather(const int32* base, V8 idx)
+    {
+        int32 FMGEN_V8_ALIGN i[8], r[8];
+        v8_store(i, idx);
+        for (int k=0; k<8; k++)
+            r[k] = base[i[k]];
+        return v8_load(r);
+    }
+
+#else // FMGEN_V8_SCALAR
+
+    struct V8 { int32 v[8]; };
+
+    #define FMGEN_V8_MAP(expr) V8 r; for (int i=0; i<8; i++) r.v[i] = (expr); return r
+    inline V8 v8_load(const int32* p) { FMGEN_V8_MAP(p[i]); }
+    inline void v8_store(int32* p, V8 a) { for (int i=0; i<8; i++) p[i] = a.v[i]; }
+    inline V8 v8_set1(int32 x) { FMGEN_V8_MAP(x); }
+    inline V8 v8_add(V8 a, V8 b) { FMGEN_V8_MAP(int32(uint32(a.v[i]) + uint32(b.v[i]))); }
+    inline V8 v8_sub(V8 a, V8 b) { FMGEN_V8_MAP(int32(uint32(a.v[i]) - uint32(b.v[i]))); }
+    inline V8 v8_and(V8 a, V8 b) { FMGEN_V8_MAP(a.v[i] & b.v[i]); }
+    inline V8 v8_mullo(V8 a, V8 b) { FMGEN_V8_MAP(int32(uint32(a.v[i]) * uint32(b.v[i]))); }
+    template <int N> inline V8 v8_srai(V8 a) { FMGEN_V8_MAP(a.v[i] >> N); }
+    template <int N> inline V8 v8_srli(V8 a) { FMGEN_V8_MAP(int32(uint32(a.v[i]) >> N)); }
+    template <int N> inline V8 v8_slli(V8 a) { FMGEN_V8_MAP(int32(uint32(a.v[i]) << N)); }
+    inline V8 v8_srav(V8 a, V8 n) { FMGEN_V8_MAP(a.v[i] >> n.v[i]); }
+    inline V8 v8_eqz(V8 a) { FMGEN_V8_MAP(a.v[i] ? 0 : -1); }
+    inline uint v8_lezmask(V8 a)
+    {
+        uint m = 0;
+        for (int i=0; i<8; i++)
+            m |= uint(a.v[i] <= 0) << i;
+        return m;
+    }
+    inline V8 v8_gather(const int32* base, V8 idx) { FMGEN_V8_MAP(base[idx.v[i]]); }
+    #undef FMGEN_V8_MAP
+
+#endif
+}
+#endif // __cplusplus
+
 // Cache-optimized data alignment
 #define CACHE_LINE_SIZE 64
 #define ALIGN_CACHE __attribute__((aligned(CACHE_LINE_SIZE)))
@@ -0,0 +1,262 @@
+// ---------------------------------------------------------------------------
+//	FM Sound Generator - 8 channel SoA block
+// ---------------------------------------------------------------------------
+
+#include "headers.h"
+#include "misc.h"
+#include "fmgen.h"
+#include "fmgeninl.h"
+#include "fmgen_soa.h"
+
+// same as fmgen.cpp
+#define IS2EC_SHIFT		((20 + FM_PGBITS) - 13)
+
+namespace FM
+{
+	enum
+	{
+		PG_SHIFT = 20 + FM_PGBITS - FM_OPSINBITS,		// pg_count -> sine index
+		IN_SHIFT = PG_SHIFT - (2 + IS2EC_SHIFT),		// modulator input -> sine index
+		FB_SHIFT = 1 + IS2EC_SHIFT,
+	};
+
+	//	route_ bits per algorithm, see Channel4::Calc
+	static const uint16 algoroutes[8] =
+	{
+		// 0: op2 <- op1, op1 <- op0, op3 <- op2, out = op3
+		(1 << 1) | (1 << 2) | (1 << 5) | (1 << 9),
+		// 1: op2 <- op0 + op1, op3 <- op2, out = op3
+		(1 << 0) | (1 << 1) | (1 << 5) | (1 << 9),
+		// 2: op2 <- op1, op3 <- op0 + op2, out = op3
+		(1 << 1) | (1 << 3) | (1 << 5) | (1 << 9),
+		// 3: op1 <- op0, op3 <- op1 + op2, out = op3
+		(1 << 2) | (1 << 4) | (1 << 5) | (1 << 9),
+		// 4: op1 <- op0, op3 <- op2, out = op1 + op3
+		(1 << 2) | (1 << 5) | (1 << 7) | (1 << 9),
+		// 5: op1, op2, op3 <- op0, out = op1 + op2 + op3
+		(1 << 0) | (1 << 2) | (1 << 3) | (1 << 7) | (1 << 8) | (1 << 9),
+		// 6: op1 <- op0, out = op1 + op2 + op3
+		(1 << 2) | (1 << 7) | (1 << 8) | (1 << 9),
+		// 7: out = op0 + op1 + op2 + op3
+		(1 << 6) | (1 << 7) | (1 << 8) | (1 << 9),
+	};
+
+// ---------------------------------------------------------------------------
+//	Channel4 -> lanes
+//
+void Channel4x8::Load(Channel4* const* ch, int n)
+{
+	lanes_ = n;
+	live_ = (1 << n) - 1;
+	mode_ = 0;
+	aml_ = pml_ = ~0;
+
+	for (int l=0; l<LANES; l++)
+	{
+		Channel4* c = l < n ? ch[l] : 0;
+		for (int s=0; s<4; s++)
+		{
+			Operator* op = c ? &c->op[s] : 0;
+			op_[s][l] = op;
+			if (op)
+			{
+				pg_count_[s][l]		= op->pg_count_;
+				pg_diff_[s][l]		= op->pg_diff_;
+				pg_diff_lfo_[s][l]	= op->pg_diff_lfo_;
+				pg_last_[s][l]		= op->dbgpgout_;
+				eg_count_[s][l]		= op->eg_count_;
+				eg_count_diff_[s][l] = op->eg_count_diff_;
+				eg_out_[s][l]		= op->eg_out_;
+				out_[s][l]			= op->out_;
+				out2_[s][l]			= op->out2_;
+				ams_[s][l]			= int32(op->ams_ - &amtable[0][0][0]);
+			}
+			else
+			{
+				// idle lane: never reaches an envelope step, output discarded
+				pg_count_[s][l] = pg_diff_[s][l] = pg_diff_lfo_[s][l] = pg_last_[s][l] = 0;
+				eg_count_[s][l] = 0x7fffffff;
+				eg_count_diff_[s][l] = 0;
+				eg_out_[s][l] = out_[s][l] = out2_[s][l] = ams_[s][l] = 0;
+			}
+		}
+		fb_[l]		= c ? c->fb : 31;
+		fbmask_[l]	= fb_[l] < 31 ? ~0 : 0;
+		pms_[l]		= c ? int32(c->pms - &pmtable[0][0][0]) : 0;
+
+		uint bits = c ? algoroutes[c->algo_] : 0;
+		for (int r=0; r<routes; r++)
+			route_[r][l] = (bits >> r) & 1 ? ~0 : 0;
+	}
+}
+
+// ---------------------------------------------------------------------------
+//	lanes -> Channel4
+//
+void Channel4x8::Store()
+{
+	for (int l=0; l<lanes_; l++)
+	{
+		for (int s=0; s<4; s++)
+		{
+			Operator* op = op_[s][l];
+			op->pg_count_ = pg_count_[s][l];
+			op->eg_count_ = eg_count_[s][l];
+			op->out_ = out_[s][l];
+			op->out2_ = out2_[s][l];
+			if (mode_)
+				op->dbgpgout_ = pg_last_[s][l];
+		}
+	}
+	// dbgopout_ as the scalar path leaves it
+	if (mode_)
+	{
+		for (int l=0; l<lanes_; l++)
+		{
+			for (int s=1; s<4; s++)
+				op_[s][l]->dbgopout_ = out_[s][l];
+			op_[0][l]->dbgopout_ = mode_ == 2 ? out_[0][l] : out2_[0][l];
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------
+//	EG
+//
+inline void Channel4x8::EGFixup(int s, int l)
+{
+	Operator* op = op_[s][l];
+	op->eg_count_ = eg_count_[s][l];
+	op->EGCalc();
+	eg_count_[s][l] = op->eg_count_;
+	eg_count_diff_[s][l] = op->eg_count_diff_;
+	eg_out_[s][l] = op->eg_out_;
+}
+
+inline void Channel4x8::EGStep(int s)
+{
+	V8 c = v8_sub(v8_load(eg_count_[s]), v8_load(eg_count_diff_[s]));
+	v8_store(eg_count_[s], c);
+
+	for (uint m = v8_lezmask(c) & live_; m; m &= m - 1)
+		EGFixup(s, __builtin_ctz(m));
+}
+
+// ---------------------------------------------------------------------------
+//	OP
+//
+inline V8 Channel4x8::LogToLin(V8 a)
+{
+	// (uint) a < FM_CLENTS ? cltable[a] : 0, without reading past the table
+	V8 inrange = v8_eqz(v8_and(a, v8_set1(~(FM_CLENTS - 1))));
+	return v8_and(v8_gather(Operator::cltable, v8_and(a, v8_set1(FM_CLENTS - 1))), inrange);
+}
+
+template <bool LFO>
+inline V8 Channel4x8::OpCalc(int s, V8 in, V8 pmv)
+{
+	EGStep(s);
+
+	V8 pg = v8_load(pg_count_[s]);
+	v8_store(pg_last_[s], pg);
+	V8 d = v8_load(pg_diff_[s]);
+	if (LFO)
+		d = v8_add(d, v8_srai<5>(v8_mullo(v8_load(pg_diff_lfo_[s]), pmv)));
+	v8_store(pg_count_[s], v8_add(pg, d));
+
+	V8 pgin = v8_add(v8_srli<PG_SHIFT>(pg), v8_srai<IN_SHIFT>(in));
+	V8 a = v8_add(v8_load(eg_out_[s]),
+				  v8_gather((const int32*) Operator::sinetable, v8_and(pgin, v8_set1(FM_OPSINENTS - 1))));
+	if (LFO)
+		a = v8_add(a, v8_load(am_[s]));
+	else
+		v8_store(out2_[s], v8_load(out_[s]));
+
+	V8 o = LogToLin(a);
+	v8_store(out_[s], o);
+	return o;
+}
+
+//	op0 with self feedback. Returns what Channel4 would add for algorithm 7:
+//	the previous output (CalcFB) or the new one (CalcFBL).
+template <bool LFO>
+inline V8 Channel4x8::OpCalcFB(V8 pmv)
+{
+	EGStep(0);
+
+	V8 o = v8_load(out_[0]);
+	V8 in = v8_add(o, v8_load(out2_[0]));
+	v8_store(out2_[0], o);
+
+	V8 pg = v8_load(pg_count_[0]);
+	v8_store(pg_last_[0], pg);
+	V8 d = v8_load(pg_diff_[0]);
+	if (LFO)
+		d = v8_add(d, v8_srai<5>(v8_mullo(v8_load(pg_diff_lfo_[0]), pmv)));
+	v8_store(pg_count_[0], v8_add(pg, d));
+
+	V8 fb = v8_srai<PG_SHIFT>(v8_srav(v8_slli<FB_SHIFT>(in), v8_load(fb_)));
+	V8 pgin = v8_add(v8_srli<PG_SHIFT>(pg), v8_and(fb, v8_load(fbmask_)));
+	V8 a = v8_add(v8_load(eg_out_[0]),
+				  v8_gather((const int32*) Operator::sinetable, v8_and(pgin, v8_set1(FM_OPSINENTS - 1))));
+	if (LFO)
+		a = v8_add(a, v8_load(am_[0]));
+
+	V8 n = LogToLin(a);
+	v8_store(out_[0], n);
+	return LFO ? n : o;
+}
+
+// ---------------------------------------------------------------------------
+//	1 sample, operators in the order Channel4::Calc runs them
+//
+template <bool LFO>
+inline void Channel4x8::Step(ISample* dest, uint aml, uint pml)
+{
+	// AML/PML move every few samples at most; the looked-up values are
+	// kept until they do
+	if (LFO && aml != aml_)
+	{
+		aml_ = aml;
+		for (int s=0; s<4; s++)
+			v8_store(am_[s], v8_gather((const int32*) &amtable[0][0][0], v8_add(v8_load(ams_[s]), v8_set1(aml))));
+	}
+	if (LFO && pml != pml_)
+	{
+		pml_ = pml;
+		v8_store(pmv_, v8_gather(&pmtable[0][0][0], v8_add(v8_load(pms_), v8_set1(pml))));
+	}
+	V8 pmv = LFO ? v8_load(pmv_) : v8_set1(0);
+
+	V8 o0 = v8_load(out_[0]);
+	V8 o1 = v8_load(out_[1]);
+
+	V8 in = v8_add(v8_and(o0, v8_load(route_[in2_0])), v8_and(o1, v8_load(route_[in2_1])));
+	V8 o2 = OpCalc<LFO>(2, in, pmv);
+
+	o1 = OpCalc<LFO>(1, v8_and(o0, v8_load(route_[in1_0])), pmv);
+
+	in = v8_add(v8_and(o0, v8_load(route_[in3_0])),
+		 v8_add(v8_and(o1, v8_load(route_[in3_1])), v8_and(o2, v8_load(route_[in3_2]))));
+	V8 o3 = OpCalc<LFO>(3, in, pmv);
+
+	V8 r0 = OpCalcFB<LFO>(pmv);
+
+	V8 r = v8_add(v8_add(v8_and(o1, v8_load(route_[out_1])), v8_and(o2, v8_load(route_[out_2]))),
+				  v8_add(v8_and(o3, v8_load(route_[out_3])), v8_and(r0, v8_load(route_[out_0]))));
+	v8_store(dest, r);
+}
+
+void Channel4x8::Calc(ISample* dest)
+{
+	Step<false>(dest, 0, 0);
+	mode_ = 1;
+}
+
+void Channel4x8::CalcL(ISample* dest, uint aml, uint pml)
+{
+	Step<true>(dest, aml, pml);
+	mode_ = 2;
+}
+
+}	// namespace FM
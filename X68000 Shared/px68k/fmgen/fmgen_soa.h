@@ -0,0 +1,92 @@
+// ---------------------------------------------------------------------------
+//	FM Sound Generator - 8 channel SoA block
+// ---------------------------------------------------------------------------
+//
+//	Runs up to eight Channel4 side by side, one sample at a time.
+//	Per-operator phase, envelope counter, output history, feedback and
+//	algorithm routing are copied out of the channels into structure-of-
+//	arrays form (one lane per channel) so that the same operator of every
+//	channel is advanced by one vector instruction stream.
+//
+//	The result is bit-identical to Channel4::Calc / CalcL: the lanes use
+//	the same integer operations and table lookups, and the rare envelope
+//	phase step (Operator::EGCalc) is run on the original Operator for the
+//	lane that needs it, after which that lane is reloaded.
+//
+//	Usage, once per OPM::Mix:
+//		Load()   after Channel4::Prepare()
+//		Calc() or CalcL() per sample
+//		Store()  before anything else looks at the channels again
+//
+
+#ifndef FM_GEN_SOA_H
+#define FM_GEN_SOA_H
+
+#include "fmgen.h"
+#include "fmgen_simd.h"
+
+namespace FM
+{
+	class Channel4x8
+	{
+	public:
+		enum { LANES = 8 };
+
+		Channel4x8() : lanes_(0), mode_(0) {}
+
+		// ch[0..n-1] become lanes 0..n-1 (n <= LANES)
+		void	Load(Channel4* const* ch, int n);
+		// dest[lane] = channel output for one sample
+		void	Calc(ISample* dest);
+		void	CalcL(ISample* dest, uint aml, uint pml);
+		void	Store();
+
+		int		Lanes() const { return lanes_; }
+
+	private:
+		template <bool LFO> void Step(ISample* dest, uint aml, uint pml);
+		template <bool LFO> V8 OpCalc(int s, V8 in, V8 pmv);
+		template <bool LFO> V8 OpCalcFB(V8 pmv);
+		void	EGStep(int s);
+		void	EGFixup(int s, int lane);
+		static V8 LogToLin(V8 a);
+
+		// operator state, [slot][lane]
+		int32	pg_count_[4][LANES] FMGEN_V8_ALIGN;
+		int32	pg_diff_[4][LANES] FMGEN_V8_ALIGN;
+		int32	pg_diff_lfo_[4][LANES] FMGEN_V8_ALIGN;
+		int32	pg_last_[4][LANES] FMGEN_V8_ALIGN;
+		int32	eg_count_[4][LANES] FMGEN_V8_ALIGN;
+		int32	eg_count_diff_[4][LANES] FMGEN_V8_ALIGN;
+		int32	eg_out_[4][LANES] FMGEN_V8_ALIGN;
+		int32	out_[4][LANES] FMGEN_V8_ALIGN;
+		int32	out2_[4][LANES] FMGEN_V8_ALIGN;
+		int32	ams_[4][LANES] FMGEN_V8_ALIGN;		// index into amtable
+		int32	am_[4][LANES] FMGEN_V8_ALIGN;		// amtable value at aml_
+
+		// channel state, [lane]
+		int32	fb_[LANES] FMGEN_V8_ALIGN;
+		int32	fbmask_[LANES] FMGEN_V8_ALIGN;		// ~0 unless fb == 31 (no feedback)
+		int32	pms_[LANES] FMGEN_V8_ALIGN;			// index into pmtable
+		int32	pmv_[LANES] FMGEN_V8_ALIGN;			// pmtable value at pml_
+		uint	aml_, pml_;
+
+		// algorithm routing masks, [route][lane]
+		enum
+		{
+			in2_0, in2_1,				// op2 input
+			in1_0,						// op1 input
+			in3_0, in3_1, in3_2,		// op3 input
+			out_0, out_1, out_2, out_3,	// channel output
+			routes
+		};
+		int32	route_[routes][LANES] FMGEN_V8_ALIGN;
+
+		Operator* op_[4][LANES];
+		int		lanes_;
+		uint	live_;					// lanes that map to a channel
+		int		mode_;					// since Load: 0 not run, 1 Calc, 2 CalcL
+	};
+}
+
+#endif // FM_GEN_SOA_H
@@ -13,8 +13,8 @@
 namespace FM
 {
 
-int OPM::amtable[4][OPM_LFOENTS] = { -1, };
-int OPM::pmtable[4][OPM_LFOENTS];
+// LFO waveforms (tools/gentables)
+#include "opm_tables.inc"
 
 // ---------------------------------------------------------------------------
 //	����
@@ -23,7 +23,16 @@ OPM::OPM()
 {
 	lfo_count_ = 0;
 	lfo_count_prev_ = ~0;
-	BuildLFOTable();
+	lfo_step_ = 0;
+	pending = false;
+	memset(pendmask, 0, sizeof(pendmask));
+#if defined(FMGEN_V8_SCALAR) || defined(FMGEN_V8_NEON)
+	// ベクトル命令なしでは Channel4 の方が速い
+	// NEON 版は arm64 で検証していないので既定では使わない
+	usesimd = false;
+#else
+	usesimd = true;
+#endif
 	for (int i=0; i<8; i++)
 	{
 		ch[i].SetChip(&chip);
@@ -75,6 +84,9 @@ void OPM::SetChannelMask(uint mask)
 void OPM::Reset()
 {
 	int i;
+	// 保留中の書き込みはリセットで消える
+	pending = false;
+	memset(pendmask, 0, sizeof(pendmask));
 	for (i=0x0; i<0x100; i++) SetReg(i, 0);
 	SetReg(0x19, 0x80);
 	Timer::Reset();
@@ -82,6 +94,7 @@ void OPM::Reset()
 	status = 0;
 	noise = 12345;
 	noisecount = 0;
+	lfonoise = 1;
 	
 	for (i=0; i<8; i++)
 		ch[i].Reset();
@@ -115,6 +128,7 @@ void OPM::TimerA()
 {
 	if (regtc & 0x80)
 	{
+		FlushRegs();		// キーオン時の AR などは書き込み済みの値で
 		for (int i=0; i<8; i++)
 		{
 			ch[i].KeyControl(0);
@@ -265,6 +279,63 @@ void OPM::SetReg(uint addr, uint data)
 }
 
 
+// ---------------------------------------------------------------------------
+//	レジスタへの書き込み (まとめて反映)
+//
+void OPM::WriteReg(uint addr, uint data)
+{
+	if (addr >= 0x100)
+		return;
+
+	if (addr < 0x20)
+	{
+		// キーオン・タイマー・LFO は書き込み順に意味があるので，
+		// それまでの書き込みを反映してからすぐに書く
+		FlushRegs();
+		SetReg(addr, data);
+		return;
+	}
+	pendreg[addr] = data;
+	pendmask[addr >> 5] |= 1 << (addr & 31);
+	pending = true;
+}
+
+// ---------------------------------------------------------------------------
+//	保留中の書き込みを反映
+//	パラメータから導く値 (EG レート・位相増分など) は Operator::Prepare が
+//	まとめて計算し直すので，ここではレジスタごとに最後の値を一度だけ書く．
+//	KC/KF はチャンネルごとに一度だけ SetKCKF する．
+//
+void OPM::FlushRegs()
+{
+	if (!pending)
+		return;
+	pending = false;
+
+	uint kckf = 0;
+	for (uint w=1; w<8; w++)
+	{
+		uint32 m = pendmask[w];
+		pendmask[w] = 0;
+		for (uint addr = w * 32; m; addr++, m >>= 1)
+		{
+			if (!(m & 1))
+				continue;
+			if (addr >= 0x28 && addr < 0x30)
+				kc[addr & 7] = pendreg[addr], kckf |= 1 << (addr & 7);
+			else if (addr >= 0x30 && addr < 0x38)
+				kf[addr & 7] = pendreg[addr] >> 2, kckf |= 1 << (addr & 7);
+			else
+				SetReg(addr, pendreg[addr]);
+		}
+	}
+	for (int c=0; kckf; c++, kckf >>= 1)
+	{
+		if (kckf & 1)
+			ch[c].SetKCKF(kc[c], kf[c]);
+	}
+}
+
 // ---------------------------------------------------------------------------
 //	�ѥ�᡼�����å�
 //
@@ -313,59 +384,6 @@ void OPM::SetParameter(uint addr, uint data)
 	}
 }
 
-// ---------------------------------------------------------------------------
-//
-//
-void OPM::BuildLFOTable()
-{
-	if (amtable[0][0] != -1)
-		return;
-
-	for (int type=0; type<4; type++)
-	{
-		int r = 0;
-		for (int c=0; c<OPM_LFOENTS; c++)
-		{
-			int a, p;
-			
-			switch (type)
-			{
-			case 0:
-				p = (((c + 0x100) & 0x1ff) / 2) - 0x80;
-				a = 0xff - c / 2;
-				break;
-
-			case 1:
-				a = c < 0x100 ? 0xff : 0;
-				p = c < 0x100 ? 0x7f : -0x80;
-				break;
-
-			case 2:
-				p = (c + 0x80) & 0x1ff;
-				p = p < 0x100 ? p - 0x80 : 0x17f - p;
-				a = c < 0x100 ? 0xff - c : c - 0x100;
-				break;
-
-			case 3:
-				if (!(c & 3))
-					r = (rand() / 17) & 0xff;
-				a = r;
-				p = r - 0x80;
-				break;
-
-			default:	// XXX
-				a = 0;
-				p = 0;
-				break;
-			}
-
-			amtable[type][c] = a;
-			pmtable[type][c] = -p-1;
-//			printf("%d ", p);
-		}
-	}
-}
-
 // ---------------------------------------------------------------------------
 
 inline void OPM::LFO()
@@ -384,7 +402,10 @@ inline void OPM::LFO()
 	{
 		if ((lfo_count_ ^ lfo_count_prev_) & ~((1 << 17) - 1))
 		{
-			int c = (rand() / 17) & 0xff;
+			// rand() と同じ線形合同法をチップごとに回す。
+			// 共有の rand() ではオフライン出力が実行ごとに変わる
+			lfonoise = lfonoise * 1103515245 + 12345;
+			int c = (((lfonoise >> 16) & 0x7fff) / 17) & 0xff;
 			chip.SetPML((c - 0x80) * pmd / 128 + 0x80);
 			chip.SetAML(c * amd / 128);
 		}
@@ -454,6 +475,40 @@ inline void OPM::MixSubL(int activech, ISample** idest)
 }
 
 
+// ---------------------------------------------------------------------------
+//	合成 (8ch 同時計算)
+//	ノイズ付きの ch7 だけは block に入れずに Channel4 で計算する
+//
+inline void OPM::MixSubV(int activech, ISample** idest, bool lfo)
+{
+	int n = block.Lanes();
+	if (n)
+	{
+		ISample r[Channel4x8::LANES];
+		if (lfo)
+			block.CalcL(r, chip.GetAML(), chip.GetPML());
+		else
+			block.Calc(r);
+		for (int j=0; j<n; j++)
+			*idest[blockch[j]] += r[j];
+	}
+	if ((activech & 0x0001) && (noisedelta & 0x80))
+		*idest[7] += lfo ? ch[7].CalcLN(Noise()) : ch[7].CalcN(Noise());
+}
+
+// ---------------------------------------------------------------------------
+//	無音判定
+//
+bool OPM::IsSilent()
+{
+	FlushRegs();
+	// Prepare() は何度呼んでも同じ結果になる
+	for (int i=0; i<8; i++)
+		if (ch[i].Prepare() & 1)
+			return false;
+	return true;
+}
+
 // ---------------------------------------------------------------------------
 //	���� (stereo)
 //
@@ -468,6 +523,8 @@ void OPM::Mix(Sample* buffer, int nsamples, int rate, BYTE* pbsp, BYTE* pbep)
 	Sample dval0, dval1;
 	int i;
 	
+	FlushRegs();
+
 	// odd bits - active, even bits - lfo
 	uint activech=0;
 	for (i=0; i<8; i++)
@@ -490,12 +547,26 @@ void OPM::Mix(Sample* buffer, int nsamples, int rate, BYTE* pbsp, BYTE* pbep)
 		idest[5] = &ibuf[pan[5]];
 		idest[6] = &ibuf[pan[6]];
 		idest[7] = &ibuf[pan[7]];
+
+		if (usesimd)
+		{
+			Channel4* bc[8];
+			int n = 0;
+			for (i=0; i<8; i++)
+			{
+				if ((activech & (0x4000 >> (i * 2))) && !(i == 7 && (noisedelta & 0x80)))
+					bc[n] = &ch[i], blockch[n++] = i;
+			}
+			block.Load(bc, n);
+		}
 		
 		for (i = 0, dest = buffer; i < nsamples; i++) {
 			CHECK_BUF_END();
 			// Fix: Initialize all buffer channels to prevent noise from old data
 			ibuf[0] = ibuf[1] = ibuf[2] = ibuf[3] = 0;
-			if (activech & 0xaaaa)
+			if (usesimd)
+				LFO(), MixSubV(activech, idest, (activech & 0xaaaa) != 0);
+			else if (activech & 0xaaaa)
 				LFO(), MixSubL(activech, idest);
 			else
 				LFO(), MixSub(activech, idest);
@@ -526,35 +597,21 @@ void OPM::Mix(Sample* buffer, int nsamples, int rate, BYTE* pbsp, BYTE* pbep)
 				dest += 2;
 			}
 		}
+		if (usesimd)
+			block.Store();
 	}
 	else
 	{
 		// Fix: When no channels are active, output silence instead of uninitialized data
-		for (i = 0, dest = buffer; i < nsamples; i++) {
+		// LFO も止まっているので、リングの終わりで折り返しつつまとめて 0 で埋める
+		int n = nsamples * 2 * ((rate == 11025) ? 4 : (rate == 22050) ? 2 : 1);
+		dest = buffer;
+		while (n > 0) {
 			CHECK_BUF_END();
-			dest[0] = 0;
-			dest[1] = 0;
-			// PSP以外はrateは0
-			switch (rate) {
-			case 11025:
-				dest += 2;
-				CHECK_BUF_END();
-				dest[0] = 0;
-				dest[1] = 0;
-				dest += 2;
-				CHECK_BUF_END();
-				dest[0] = 0;
-				dest[1] = 0;
-				// no break...
-			case 22050:
-				dest += 2;
-				CHECK_BUF_END();
-				dest[0] = 0;
-				dest[1] = 0;
-			case 44100:
-			case 0:
-				dest += 2;
-			}
+			int run = Min(n, (int)((Sample*)pbep - dest));
+			memset(dest, 0, run * sizeof(Sample));
+			dest += run;
+			n -= run;
 		}
 	}
 #undef IStoSample
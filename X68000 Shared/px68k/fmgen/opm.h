@@ -8,6 +8,7 @@
 
 #include "fmgen.h"
 #include "fmtimer.h"
+#include "fmgen_soa.h"
 
 // ---------------------------------------------------------------------------
 //	class OPM
@@ -45,6 +46,15 @@
 //	void SetReg(uint reg, uint data)
 //		Υ쥸 reg  data 񤭹
 //	
+//	void WriteReg(uint reg, uint data)
+//		SetReg Ʊ0x20 ʹߤΥͥ롦ڥ졼Υѥ᡼
+//		αƤ Mix/IsSilent ( CSM Υ) ľ˥쥸
+//		Ȥ˺ǸͤޤȤȿǤ롥0x20 ̤ (󡤥ޡ
+//		LFO ʤ) αʬȿǤƤ餹˽񤯡̤ SetReg Ʊ
+//	
+//	void FlushRegs()
+//		WriteReg αν񤭹ߤȿǤ
+//	
 //	uint ReadStatus()
 //		Υơ쥸ɤ߽Ф
 //		busy ե饰Ͼ 0
@@ -63,6 +73,10 @@
 //		Ʋβ̤ܡĴ᤹롥ɸͤ 0.
 //		ñ̤ 1/2 dBͭϰϤξ¤ 20 (10dB)
 //
+//	void UseSIMD(bool f)
+//		ͥι 8ch Ʊ׻ (Channel4x8) Ȥɤ
+//		SSE4.1/AVX2 ǥӥɤδ trueɤǤϤƱ
+//
 //	۴ؿ:
 //	virtual void Intr(bool irq)
 //		IRQ ϤѲäƤФ롥
@@ -84,13 +98,17 @@ namespace FM
 		void	Reset();
 		
 		void 	SetReg(uint addr, uint data);
+		void	WriteReg(uint addr, uint data);
+		void	FlushRegs();
 		uint	GetReg(uint addr);
 		uint	ReadStatus() { return status & 0x03; }
 		
 		void 	Mix(Sample* buffer, int nsamples, int rate, BYTE* pbsp, BYTE* pbep);
+		bool	IsSilent();		// ͥΥ٥פ off (Mix  0 Ф)
 		
 		void	SetVolume(int db);
 		void	SetChannelMask(uint mask);
+		void	UseSIMD(bool f) { usesimd = f; }
 		
 	private:
 		virtual void Intr(bool) {}
@@ -108,6 +126,7 @@ namespace FM
 		void	RebuildTimeTable();
 		void	MixSub(int activech, ISample**);
 		void	MixSubL(int activech, ISample**);
+		void	MixSubV(int activech, ISample**, bool lfo);
 		void	LFO();
 		uint	Noise();
 		
@@ -131,9 +150,11 @@ namespace FM
 		uint	rateratio;
 		uint	noise;
 		int32	noisecount;
+		uint	lfonoise;		// LFO ȷ 3  (Reset ǽ)
 		uint32	noisedelta;
 		
 		bool	interpolation;
+		bool	usesimd;
 		uint8	lfofreq;
 		uint8	status;
 		uint8	reg01;
@@ -142,12 +163,18 @@ namespace FM
 		uint8	kf[8];
 		uint8	pan[8];
 
+		bool	pending;			// WriteReg α
+		uint32	pendmask[8];		// αΥ쥸 (1 bit/reg)
+		uint8	pendreg[0x100];		// α
+
 		Channel4 ch[8];
 		Chip	chip;
 
-		static void	BuildLFOTable();
-		static int amtable[4][OPM_LFOENTS];
-		static int pmtable[4][OPM_LFOENTS];
+		Channel4x8 block;
+		int		blockch[8];		// block  lane -> ch ֹ
+
+		static const int amtable[4][OPM_LFOENTS];
+		static const int pmtable[4][OPM_LFOENTS];
 
 	public:
 		int		dbgGetOpOut(int c, int s) { return ch[c].op[s].dbgopout_; }
@@ -26,6 +26,9 @@
 #include    "windows.h"
 #include    "common.h"
 #include    "dswin.h"
+#include    "pcmring.h"
+#include    "mixer.h"
+#include    "wavout.h"
 #include    "prop.h"
 #include    "adpcm.h"
 //#include    "mercury.h"
@@ -35,43 +38,90 @@
 // instead of the legacy DSound ring buffer.
 #define DSOUND_USE_DIRECT_CALLBACK 0
 
-// Safety limit for temporary buffers (frames)
-#define DSOUND_MAX_FRAMES 4096
+#define FRAME_BYTES (sizeof(short) * 2)
 
-#define PCMBUF_SIZE 2*2*48000
-BYTE pcmbuffer[PCMBUF_SIZE];
-BYTE *pcmbufp = pcmbuffer;
-BYTE *pbsp = pcmbuffer;
-BYTE *pbrp = pcmbuffer, *pbwp = pcmbuffer;
-BYTE *pbep = &pcmbuffer[PCMBUF_SIZE];
+// Ring capacity (frames, power of two): about 1.4s at 48kHz, well above
+// anything Config.BufferSize asks for.
+#define PCMRING_FRAMES 65536
+
+static short pcmbuffer[PCMRING_FRAMES * 2];
+static PCMRing pcmring;
 DWORD ratebase = 44100;
 long DSound_PreCounter = 0;
-BYTE rsndbuf[PCMBUF_SIZE];
-static volatile unsigned int s_dsound_last_callback_bytes = 0;
-static volatile unsigned int s_dsound_refill_count = 0;
+// Frames DSound_Send0 has produced: the emulated audio clock. Stored by
+// the emulation thread, read by the host for MIDI timing.
+static _Atomic DWORD s_dsound_frames = 0;
+
+// Queue depth the consumer waits for before it starts (and restarts after
+// an underrun) reading: Config.BufferSize milliseconds of frames.
+static unsigned int s_dsound_target_frames = 0;
+// Consumer side only.
+static int s_dsound_primed = 0;
+
+static _Atomic unsigned int s_dsound_last_callback_bytes = 0;
+static _Atomic unsigned int s_dsound_underrun_count = 0;
+static _Atomic unsigned int s_dsound_dropped_frames = 0;
+
+// Offline render (DSound_StartCapture): sound_send writes the mix, and
+// optionally every source on its own, to WAV files instead of the ring.
+// The emulation thread owns the files; the host callback only checks the
+// flag and plays silence meanwhile.
+static _Atomic int s_dsound_capture = 0;
+static WavOut s_capture_mix;
+static WavOut s_capture_stem[MIXER_MAX_SOURCES];
 
 
 void audio_callback(void *buffer, int len);
 
+// Mixer sources. PSP以外はrate=0が元仕様
+static void mix_adpcm(short *buf, int frames)
+{
+    ADPCM_Update(buf, frames, 0, (BYTE *)buf, (BYTE *)(buf + frames * 2));
+}
+
+static void mix_opm(short *buf, int frames)
+{
+    OPM_Update(buf, frames, 0, (BYTE *)buf, (BYTE *)(buf + frames * 2));
+}
+
+// Mixer ids follow this order; name is the stem file suffix.
+static const struct {
+    MixerRender render;
+    const char *name;
+} dsound_sources[] = {
+    { mix_adpcm, "adpcm" },
+    { mix_opm,   "opm"   },
+};
+#define DSOUND_SOURCES  (int)(sizeof(dsound_sources) / sizeof(dsound_sources[0]))
+
 
 int DSound_Init(unsigned long rate, unsigned long buflen)
 {
-//    DWORD samples;
-    
+    unsigned long target;
+    int i;
+
     printf("Sound Init Sampling Rate:%luHz buflen:%lu\n", rate, buflen );
 
     // Fix: Initialize audio buffers to silence to prevent noise
-    memset(pcmbuffer, 0, PCMBUF_SIZE);
-    memset(rsndbuf, 0, PCMBUF_SIZE);
-    
-    // Reset buffer pointers
-    pbsp = pcmbuffer;
-    pbrp = pcmbuffer;
-    pbwp = pcmbuffer;
-    pbep = &pcmbuffer[PCMBUF_SIZE];
+    memset(pcmbuffer, 0, sizeof(pcmbuffer));
+    PCMRing_Init(&pcmring, pcmbuffer, PCMRING_FRAMES);
+
+    Mixer_Init();
+    for (i = 0; i < DSOUND_SOURCES; i++)
+        Mixer_AddSource(dsound_sources[i].render, MIXER_UNITY);
 
     ratebase = (DWORD)rate;
 
+    target = rate * buflen / 1000;
+    if (target < 256)
+        target = 256;
+    if (target > PCMRING_FRAMES / 4)
+        target = PCMRING_FRAMES / 4;
+    s_dsound_target_frames = (unsigned int)target;
+    s_dsound_primed = 0;
+    atomic_store(&s_dsound_underrun_count, 0);
+    atomic_store(&s_dsound_dropped_frames, 0);
+
     return TRUE;
 }
 
@@ -95,60 +145,81 @@ DSound_Cleanup(void)
     return TRUE;
 }
 
+// Frames the producer may still queue. Beyond twice the target plus one
+// host callback the emulation is running ahead of the host clock, and
+// queuing more would only add latency.
+static unsigned int sound_room(void)
+{
+    unsigned int cb = atomic_load_explicit(&s_dsound_last_callback_bytes,
+                                           memory_order_relaxed) / FRAME_BYTES;
+    unsigned int limit = s_dsound_target_frames * 2 + cb;
+    unsigned int fill = PCMRing_Fill(&pcmring);
+
+    if (limit > PCMRING_FRAMES)
+        limit = PCMRING_FRAMES;
+    return (fill < limit) ? limit - fill : 0;
+}
+
+// One block at a time, like the ring path, so the files get exactly the
+// samples the ring would have.
+static void capture_send(int length)
+{
+    static short mix[MIXER_BLOCK * 2];
+
+    while (length > 0) {
+        int frames = (length > MIXER_BLOCK) ? MIXER_BLOCK : length;
+        int i;
+
+        Mixer_Render(frames);
+        Mixer_Output(mix, 0, frames);
+        WavOut_Write(&s_capture_mix, mix, frames);
+        for (i = 0; i < DSOUND_SOURCES; i++)
+            WavOut_Write(&s_capture_stem[i], Mixer_Buffer(i), frames);
+        length -= frames;
+    }
+}
+
 static void sound_send(int length)
 {
+    if (atomic_load_explicit(&s_dsound_capture, memory_order_relaxed)) {
+        capture_send(length);
+        return;
+    }
+
     // In direct-callback mode, we generate audio
     // exclusively from X68000_AudioCallBack().
 #if DSOUND_USE_DIRECT_CALLBACK
     (void)length;
     return;
 #else
-    // PSP以外はrate=0が元仕様
-    int rate = (ratebase == 22050) ? 0 : 0;
-
     int remain = length;
     while (remain > 0) {
-        int frames = (remain > DSOUND_MAX_FRAMES) ? DSOUND_MAX_FRAMES : remain;
-        unsigned int bytesPerFrame = sizeof(short) * 2; // stereo
-        unsigned int bufBytes = frames * bytesPerFrame;
-
-        static short adpcmBuf[DSOUND_MAX_FRAMES * 2];
-        static short opmBuf[DSOUND_MAX_FRAMES * 2];
-
-        memset(adpcmBuf, 0, bufBytes);
-        memset(opmBuf, 0, bufBytes);
-
-        ADPCM_Update(adpcmBuf, frames, rate,
-                     (BYTE *)adpcmBuf, ((BYTE *)adpcmBuf) + bufBytes);
-        OPM_Update(opmBuf, frames, rate,
-                   (BYTE *)opmBuf, ((BYTE *)opmBuf) + bufBytes);
-
-        // Mix into ring buffer with wrap handling
-        int samples = frames * 2; // stereo samples
-        int writtenSamples = 0;
-        while (writtenSamples < samples) {
-            BYTE *writePtr = pbwp;
-            int bytesToEnd = (int)(pbep - writePtr);
-            int samplesToEnd = bytesToEnd / sizeof(short);
-            int chunkSamples = samples - writtenSamples;
-            if (chunkSamples > samplesToEnd) {
-                chunkSamples = samplesToEnd;
-            }
+        unsigned int frames = (remain > MIXER_BLOCK) ? MIXER_BLOCK : remain;
+        unsigned int room = sound_room();
+        unsigned int done = 0;
 
-            short *out = (short *)writePtr;
-            int mixStart = writtenSamples;
-            for (int i = 0; i < chunkSamples; i++) {
-                int v = (int)adpcmBuf[mixStart + i] + (int)opmBuf[mixStart + i];
-                if (v > 32767) v = 32767; else if (v < -32768) v = -32768;
-                out[i] = (short)v;
-            }
+        // Always rendered: ADPCM/OPM state has to advance with the
+        // emulated clock even when the result does not fit in the ring.
+        Mixer_Render(frames);
 
-            int bytesWritten = chunkSamples * (int)sizeof(short);
-            pbwp += bytesWritten;
-            if (pbwp >= pbep) {
-                pbwp = pbsp + (pbwp - pbep);
+        // Mix straight into the ring, one contiguous span per pass
+        if (room > frames) {
+            room = frames;
+        }
+        while (done < room) {
+            unsigned int n;
+            short *out = PCMRing_Reserve(&pcmring, room - done, &n);
+            if (!n) {
+                break;
             }
-            writtenSamples += chunkSamples;
+            Mixer_Output(out, done, n);
+            PCMRing_Commit(&pcmring, n);
+            done += n;
+        }
+        if (done < frames) {
+            atomic_fetch_add_explicit(&s_dsound_dropped_frames,
+                                      frames - done,
+                                      memory_order_relaxed);
         }
 
         remain -= frames;
@@ -156,33 +227,80 @@ static void sound_send(int length)
  #endif
 }
 
-static long DSound_BufferDataBytes(void)
-{
-    if (pbrp <= pbwp) {
-        return (long)(pbwp - pbrp);
-    }
-    return (long)((pbep - pbrp) + (pbwp - pbsp));
-}
-
 void DSound_GetMonitorState(DSoundMonitorState* state)
 {
     if (!state) return;
+    unsigned int head = atomic_load_explicit(&pcmring.head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&pcmring.tail, memory_order_relaxed);
+
     state->ratebase = ratebase;
     state->preCounter = DSound_PreCounter;
-    state->bufferBytes = (long)(pbep - pbsp);
-    state->dataBytes = DSound_BufferDataBytes();
+    state->bufferBytes = (long)(PCMRING_FRAMES * FRAME_BYTES);
+    state->targetBytes = (long)(s_dsound_target_frames * FRAME_BYTES);
+    state->dataBytes = (long)(PCMRing_Fill(&pcmring) * FRAME_BYTES);
     state->freeBytes = state->bufferBytes - state->dataBytes;
-    state->readOffset = (long)(pbrp - pbsp);
-    state->writeOffset = (long)(pbwp - pbsp);
-    state->lastCallbackBytes = s_dsound_last_callback_bytes;
-    state->refillCount = s_dsound_refill_count;
+    state->readOffset = (long)((tail & (PCMRING_FRAMES - 1)) * FRAME_BYTES);
+    state->writeOffset = (long)((head & (PCMRING_FRAMES - 1)) * FRAME_BYTES);
+    state->lastCallbackBytes = atomic_load(&s_dsound_last_callback_bytes);
+    state->underrunCount = atomic_load(&s_dsound_underrun_count);
+    state->droppedFrames = atomic_load(&s_dsound_dropped_frames);
     state->directCallback = DSOUND_USE_DIRECT_CALLBACK;
 }
 
+// "out.wav" -> "out.opm.wav"; any other name just gets ".opm.wav" appended.
+static void stem_path(char *buf, size_t size, const char *path, const char *name)
+{
+    size_t len = strlen(path);
+
+    if (len >= 4 && !strcasecmp(path + len - 4, ".wav"))
+        len -= 4;
+    snprintf(buf, size, "%.*s.%s.wav", (int)len, path, name);
+}
+
+int DSound_StartCapture(const char *path, int stems)
+{
+    char name[MAX_PATH];
+    int i;
+
+    if (atomic_load(&s_dsound_capture) || !path)
+        return FALSE;
+    if (!WavOut_Open(&s_capture_mix, path, ratebase))
+        return FALSE;
+    for (i = 0; i < DSOUND_SOURCES; i++) {
+        s_capture_stem[i].fp = NULL;
+        if (!stems)
+            continue;
+        stem_path(name, sizeof(name), path, dsound_sources[i].name);
+        if (!WavOut_Open(&s_capture_stem[i], name, ratebase)) {
+            while (i--)
+                WavOut_Close(&s_capture_stem[i]);
+            WavOut_Close(&s_capture_mix);
+            return FALSE;
+        }
+    }
+    // Start on a frame boundary so the file length depends only on the
+    // emulated clocks that follow.
+    DSound_PreCounter = 0;
+    atomic_store(&s_dsound_capture, 1);
+    return TRUE;
+}
+
+int DSound_StopCapture(void)
+{
+    int ok, i;
+
+    if (!atomic_load(&s_dsound_capture))
+        return FALSE;
+    atomic_store(&s_dsound_capture, 0);
+    ok = WavOut_Close(&s_capture_mix);
+    for (i = 0; i < DSOUND_SOURCES; i++)
+        ok &= WavOut_Close(&s_capture_stem[i]);
+    return ok;
+}
+
 void FASTCALL DSound_Send0(long clock)
 {
     int length = 0;
-    int rate;
 
 
 #if 1
@@ -197,64 +315,55 @@ void FASTCALL DSound_Send0(long clock)
         return;
 #else
 #endif
+    atomic_store_explicit(&s_dsound_frames,
+                          atomic_load_explicit(&s_dsound_frames, memory_order_relaxed) + length,
+                          memory_order_release);
 //	printf("%d %d\n", length, DSound_PreCounter);
     sound_send(length);
 }
 
-static void FASTCALL DSound_Send(int length)
+DWORD DSound_SamplePos(long clock)
 {
-    sound_send(length);
+    long long pending = DSound_PreCounter + (long long)ratebase * clock;
+
+    return atomic_load_explicit(&s_dsound_frames, memory_order_relaxed)
+           + (DWORD)(pending / 10000000L);
+}
+
+DWORD DSound_PlayPos(void)
+{
+    DWORD frames = atomic_load_explicit(&s_dsound_frames, memory_order_acquire);
+
+    // Without a host draining the ring (offline render, no audio device,
+    // direct callback) the emulated clock is all there is.
+    if (DSOUND_USE_DIRECT_CALLBACK
+        || atomic_load_explicit(&s_dsound_capture, memory_order_relaxed)
+        || !atomic_load_explicit(&s_dsound_last_callback_bytes, memory_order_relaxed))
+        return frames;
+    return frames - PCMRing_Fill(&pcmring);
 }
 
 void X68000_AudioCallBack(void* buffer, const unsigned int sample)
 {
 #if DSOUND_USE_DIRECT_CALLBACK
-    // Direct mixing path: generate ADPCM and OPM into separate
-    // temporary buffers, then mix into the host buffer. This
-    // prevents OPM_Update() from overwriting ADPCM-only regions.
-
-    // Safety limit for temporary buffers
-    enum { DSOUND_MAX_FRAMES = 4096 };
-    static short adpcmBuf[DSOUND_MAX_FRAMES * 2];
-    static short opmBuf[DSOUND_MAX_FRAMES * 2];
-
-    unsigned int frames = sample;
-    if (frames > DSOUND_MAX_FRAMES) {
-        frames = DSOUND_MAX_FRAMES;
-    }
-
-    unsigned int bytesPerFrame = sizeof(short) * 2; // stereo
-    unsigned int bufBytes = frames * bytesPerFrame;
-
-    // Clear temporary buffers
-    memset(adpcmBuf, 0x00, bufBytes);
-    memset(opmBuf, 0x00, bufBytes);
-
-    // PSP 以外は rate == 0 を渡すのが元の実装
-    int rate = 0;
-
-    // Generate ADPCM into temporary buffer
-    ADPCM_Update(adpcmBuf, frames, rate,
-                 (BYTE *)adpcmBuf, ((BYTE *)adpcmBuf) + bufBytes);
-
-    // Generate OPM into temporary buffer
-    OPM_Update(opmBuf, frames, rate,
-               (BYTE *)opmBuf, ((BYTE *)opmBuf) + bufBytes);
-
-    // Mix into host buffer with 16-bit clipping
+    // Direct mixing path: render and mix straight into the host buffer.
     short *out = (short *)buffer;
-    unsigned int totalSamples = frames * 2; // stereo samples
-    for (unsigned int i = 0; i < totalSamples; i++) {
-        int v = (int)adpcmBuf[i] + (int)opmBuf[i];
-        if (v > 32767) v = 32767;
-        else if (v < -32768) v = -32768;
-        out[i] = (short)v;
+    unsigned int done = 0;
+
+    // The sources belong to the offline render while it runs.
+    if (atomic_load_explicit(&s_dsound_capture, memory_order_relaxed)) {
+        memset(out, 0, sample * FRAME_BYTES);
+        return;
     }
 
-    // If sample > frames (rare), zero the tail to avoid garbage
-    if (sample > frames) {
-        unsigned int tailSamples = (sample - frames) * 2;
-        memset(out + totalSamples, 0x00, tailSamples * sizeof(short));
+    while (done < sample) {
+        unsigned int frames = sample - done;
+        if (frames > MIXER_BLOCK) {
+            frames = MIXER_BLOCK;
+        }
+        Mixer_Render(frames);
+        Mixer_Output(out + done * 2, 0, frames);
+        done += frames;
     }
 #else
     int size = sample * sizeof(unsigned short) * 2;
@@ -263,91 +372,30 @@ void X68000_AudioCallBack(void* buffer, const unsigned int sample)
 }
 
 
+// Host audio thread: the only consumer of pcmring. It never generates
+// sound itself; when the emulation has not produced enough, the rest of
+// the buffer is silence and reading resumes once the queue is back at the
+// target depth.
 void audio_callback(void *buffer, int len)
 {
-   int lena, lenb, datalen, rate;
-   BYTE *buf;
-   s_dsound_last_callback_bytes = (unsigned int)len;
+   unsigned int frames = (unsigned int)len / FRAME_BYTES;
+   unsigned int fill = PCMRing_Fill(&pcmring);
+   unsigned int got = 0;
 
-cb_start:
-   if (pbrp <= pbwp)
-   {
-      // pcmbuffer
-      // +---------+-------------+----------+
-      // |         |/////////////|          |
-      // +---------+-------------+----------+
-      // A         A<--datalen-->A          A
-      // |         |             |          |
-      // pbsp     pbrp          pbwp       pbep
-
-      datalen = (int)(pbwp - pbrp);  // pcmbufferサイズ(192k)内なのでintへ明示キャスト
-
-      // needs more data - generate extra to prevent underruns
-	   if (datalen < len) {
-		   int extra_samples = ((len - datalen) / 4) + 512; // Generate extra samples
-		   s_dsound_refill_count++;
-		   DSound_Send(extra_samples);
-//		   printf("MORE!");
-	   }
-
-#if 0
-      datalen = (int)(pbwp - pbrp);  // pcmbufferサイズ(192k)内なのでintへ明示キャスト
-//	   printf("%d\n",datalen);
-	   if (datalen < len) {
-         printf("xxxxx not enough sound data: %5d/%5d xxxxx\n",datalen, len);
-	   }
-#endif
+   atomic_store_explicit(&s_dsound_last_callback_bytes, (unsigned int)len,
+                         memory_order_relaxed);
 
-      // change to TYPEC or TYPED
-	   if (pbrp > pbwp) {
-         goto cb_start;
-	   }
-	   
-      buf = pbrp;
-      pbrp += len;
-      //printf("TYPEA: ");
+   if (!s_dsound_primed
+       && fill >= s_dsound_target_frames && fill >= frames) {
+      s_dsound_primed = 1;
    }
-   else
-   {
-      // pcmbuffer
-      // +---------+-------------+----------+
-      // |/////////|             |//////////|
-      // +------+--+-------------+----------+
-      // <-lenb->  A             <---lena--->
-      // A         |             A          A
-      // |         |             |          |
-      // pbsp     pbwp          pbrp       pbep
-
-      lena = (int)(pbep - pbrp);
-      if (lena >= len)
-      {
-         buf = pbrp;
-         pbrp += len;
-         //printf("TYPEC: ");
-      }
-      else
-      {
-         lenb = len - lena;
-
-         int available = (int)(pbwp - pbsp);
-         if (available < lenb) {
-            int needed_samples = ((lenb - available) / 4) + 256; // Generate extra samples  
-            s_dsound_refill_count++;
-            DSound_Send(needed_samples);
-         }
-#if 0
-         if (available < lenb)
-            printf("xxxxx not enough sound data xxxxx\n");
-#endif
-         memcpy(rsndbuf, pbrp, lena);
-         memcpy(&rsndbuf[lena], pbsp, lenb);
-         buf = rsndbuf;
-         pbrp = pbsp + lenb;
-         //printf("TYPED: ");
+   if (s_dsound_primed) {
+      got = PCMRing_Read(&pcmring, (short *)buffer, frames);
+      if (got < frames) {
+         atomic_fetch_add_explicit(&s_dsound_underrun_count, 1,
+                                   memory_order_relaxed);
+         s_dsound_primed = 0;
       }
    }
-//    printf("SND:%p %p %d\n", buffer, buf, len);
-   
-   // Copy audio data to output buffer (no additional silence gating)
-   memcpy(buffer, buf, len);
+   memset((short *)buffer + got * 2, 0, (frames - got) * FRAME_BYTES);
 }
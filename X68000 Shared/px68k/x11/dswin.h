@@ -7,12 +7,14 @@ typedef struct {
 	unsigned long ratebase;
 	long preCounter;
 	long bufferBytes;
+	long targetBytes;	/* queue depth the host side waits for (Config.BufferSize) */
 	long dataBytes;
 	long freeBytes;
 	long readOffset;
 	long writeOffset;
 	unsigned int lastCallbackBytes;
-	unsigned int refillCount;
+	unsigned int underrunCount;	/* host callbacks that found too little data */
+	unsigned int droppedFrames;	/* frames the emulation produced with the queue full */
 	unsigned int directCallback;
 } DSoundMonitorState;
 
@@ -23,6 +25,20 @@ void DSound_Play(void);
 void DSound_Stop(void);
 void FASTCALL DSound_Send0(long clock);
 
+// Offline render: until DSound_StopCapture, the sound produced by
+// DSound_Send0 goes to a WAV file at the DSound_Init rate instead of the
+// host. With stems, every source is also written to its own file next to
+// path ("out.wav" -> "out.adpcm.wav", "out.opm.wav"), before mixer gain.
+// Both return FALSE on a file error.
+int DSound_StartCapture(const char *path, int stems);
+int DSound_StopCapture(void);
+
+// Audio clock, in frames since start-up (free-running). SamplePos is the
+// frame the emulation is at clock 10MHz clocks past the last
+// DSound_Send0; PlayPos the frame the host is about to play.
+DWORD DSound_SamplePos(long clock);
+DWORD DSound_PlayPos(void);
+
 void DS_SetVolumeOPM(long vol);
 void DS_SetVolumeADPCM(long vol);
 void DS_SetVolumeMercury(long vol);
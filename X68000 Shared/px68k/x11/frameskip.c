@@ -0,0 +1,72 @@
+// ---------------------------------------------------------------------------------------
+//  FRAMESKIP.C - Auto frame skip (Config.FrameRate == 7)
+// ---------------------------------------------------------------------------------------
+
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "frameskip.h"
+
+DWORD FrameSkip_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (DWORD)ts.tv_sec * 1000000u + (DWORD)(ts.tv_nsec / 1000);
+}
+
+void FrameSkip_Reset(FrameSkipState *fs)
+{
+    memset(fs, 0, sizeof(*fs));
+}
+
+int FrameSkip_Decide(FrameSkipState *fs)
+{
+    // Nothing to catch up, or the guaranteed drawn field is due.
+    if (!fs->lag_us || fs->run >= FRAMESKIP_MAX_RUN) {
+        fs->run = 0;
+        return 0;
+    }
+    // Emulation alone overruns the field, or there has been no compositing
+    // work to drop: skipping cannot make up the lag, so keep drawing.
+    if (fs->cpu_us >= fs->budget_us || !fs->draw_us) {
+        fs->run = 0;
+        return 0;
+    }
+    fs->run++;
+    return 1;
+}
+
+void FrameSkip_Account(FrameSkipState *fs, DWORD field_us, DWORD draw_us,
+                       DWORD budget_us, int drawn, int paced)
+{
+    DWORD cpu_us = field_us > draw_us ? field_us - draw_us : 0;
+
+    // Averages over roughly four fields smooth out single-field spikes
+    // (disk access, a mode change) without lagging behind scene changes.
+    // The first field after a reset seeds them directly.
+    if (!fs->budget_us) {
+        fs->cpu_us = cpu_us;
+        fs->draw_us = drawn ? draw_us : 0;
+    } else {
+        fs->cpu_us = (fs->cpu_us * 3 + cpu_us) / 4;
+        if (drawn)
+            fs->draw_us = (fs->draw_us * 3 + draw_us) / 4;
+    }
+    fs->budget_us = budget_us;
+
+    if (!paced) {
+        fs->lag_us = 0;
+        return;
+    }
+    if (field_us > budget_us) {
+        fs->lag_us += field_us - budget_us;
+        if (fs->lag_us > FRAMESKIP_MAX_LAG)
+            fs->lag_us = FRAMESKIP_MAX_LAG;
+    } else if (fs->lag_us > budget_us - field_us) {
+        fs->lag_us -= budget_us - field_us;
+    } else {
+        fs->lag_us = 0;
+    }
+}
@@ -0,0 +1,56 @@
+// ---------------------------------------------------------------------------------------
+//  FRAMESKIP.H - Auto frame skip (Config.FrameRate == 7)
+// ---------------------------------------------------------------------------------------
+//
+// The old policy queued skipped fields from the whole-field wall time in
+// milliseconds, so a field that was slow because of the 68000 emulation was
+// answered with skipped compositing that could not make it any faster.
+// The main loop now reports the emulation and compositing parts of each
+// field separately (microsecond clock) and skipping is only chosen while
+// the emulation alone fits in the field budget.
+//
+// Skipping only drops WinDraw_QueueLine calls. Raster copy, scan latching
+// and everything else the guest can observe still run on every raster, and
+// the undrawn lines keep their TextDirtyLine flags for the next drawn field.
+
+#ifndef PX68K_FRAMESKIP_H
+#define PX68K_FRAMESKIP_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Draw at least one field out of FRAMESKIP_MAX_RUN + 1, as before.
+#define FRAMESKIP_MAX_RUN   15
+// Lag beyond this is not worth catching up on (about 100 fields).
+#define FRAMESKIP_MAX_LAG   1600000
+
+typedef struct {
+    DWORD cpu_us;       // running average of emulation time per field
+    DWORD draw_us;      // running average of compositing time per drawn field
+    DWORD budget_us;    // host time available per field
+    DWORD lag_us;       // how far the paced host clock is ahead of us
+    int   run;          // fields skipped in a row
+} FrameSkipState;
+
+// Monotonic microsecond clock; differences are valid across wraparound.
+DWORD FrameSkip_Now(void);
+
+void FrameSkip_Reset(FrameSkipState *fs);
+
+// 1 when compositing should be skipped for the field about to run.
+int  FrameSkip_Decide(FrameSkipState *fs);
+
+// Account one finished field: field_us is the whole field, draw_us the part
+// spent compositing (WinDraw_DrawUs). paced is 0 when the host does not wait
+// for vsync; lag is then meaningless and is dropped.
+void FrameSkip_Account(FrameSkipState *fs, DWORD field_us, DWORD draw_us,
+                       DWORD budget_us, int drawn, int paced);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
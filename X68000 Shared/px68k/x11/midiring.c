@@ -0,0 +1,79 @@
+// ---------------------------------------------------------------------------------------
+//  MIDIRING.C - Single-producer/single-consumer ring of timestamped MIDI bytes
+// ---------------------------------------------------------------------------------------
+
+#include "midiring.h"
+
+void MIDIRing_Init(MIDIRing *r, MIDIEvent *ev, unsigned int size)
+{
+    r->ev = ev;
+    r->size = size;
+    atomic_store_explicit(&r->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, 0, memory_order_relaxed);
+    atomic_store_explicit(&r->dropped, 0, memory_order_relaxed);
+}
+
+unsigned int MIDIRing_Fill(MIDIRing *r)
+{
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned int fill = head - tail;
+
+    return fill > r->size ? r->size : fill;
+}
+
+int MIDIRing_Push(MIDIRing *r, const MIDIEvent *ev)
+{
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (head - tail >= r->size) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return FALSE;
+    }
+    r->ev[head & (r->size - 1)] = *ev;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return TRUE;
+}
+
+unsigned int MIDIRing_Dispatch(MIDIRing *r, DWORD until, unsigned int max,
+                               MIDIRingSink sink, void *ctx)
+{
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned int n = 0;
+
+    // Stamps only grow, so the first event that is not due ends the run.
+    while (tail != head && n < max) {
+        const MIDIEvent *ev = &r->ev[tail & (r->size - 1)];
+
+        if ((int)(ev->sample - until) > 0)
+            break;
+        sink(ev, ctx);
+        tail++;
+        n++;
+    }
+    // The sink is done with the slots before the producer may reuse them.
+    atomic_store_explicit(&r->tail, tail, memory_order_release);
+    return n;
+}
+
+unsigned int MIDIRing_Take(MIDIRing *r, DWORD now, BYTE *data, DWORD *frames,
+                           unsigned int max)
+{
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned int n = 0;
+
+    while (tail != head && n < max) {
+        const MIDIEvent *ev = &r->ev[tail & (r->size - 1)];
+        int ahead = (int)(ev->sample - now);
+
+        data[n] = ev->data;
+        frames[n] = ahead > 0 ? (DWORD)ahead : 0;
+        tail++;
+        n++;
+    }
+    atomic_store_explicit(&r->tail, tail, memory_order_release);
+    return n;
+}
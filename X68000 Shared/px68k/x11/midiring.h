@@ -0,0 +1,64 @@
+// ---------------------------------------------------------------------------------------
+//  MIDIRING.H - Single-producer/single-consumer ring of timestamped MIDI bytes
+// ---------------------------------------------------------------------------------------
+//
+// The emulation thread pushes every byte the guest sends, stamped with the
+// emulated clock and the audio frame it falls on (DSound_SamplePos). The
+// host side either takes the bytes out in order once the audio it plays has
+// reached their frame (MIDIRing_Dispatch), or takes them all with their
+// distance from the frame it is playing and schedules them itself
+// (MIDIRing_Take), so MIDI stays in step with OPM/ADPCM however the
+// emulation is scheduled. Same publishing scheme as PCMRing: one
+// free-running index per side, release stores, acquire loads, no locks.
+//
+// C only: midi.h keeps this header (and <stdatomic.h>) away from the C++
+// translation units that include it.
+//
+// Both stamps are free-running 32-bit counters; compare them by signed
+// difference.
+
+#ifndef PX68K_MIDIRING_H
+#define PX68K_MIDIRING_H
+
+#include <stdatomic.h>
+
+#include "common.h"
+
+typedef struct MIDIEvent {
+    DWORD cycle;        // emulated 10MHz clock
+    DWORD sample;       // audio frame position
+    BYTE data;          // one byte of the MIDI stream
+} MIDIEvent;
+
+typedef struct {
+    MIDIEvent *ev;
+    unsigned int size;                  // power of two
+    _Atomic unsigned int head;          // events pushed; stored by the producer
+    _Atomic unsigned int tail;          // events taken; stored by the consumer
+    _Atomic unsigned int dropped;       // pushes that found the ring full
+} MIDIRing;
+
+typedef void (*MIDIRingSink)(const MIDIEvent *ev, void *ctx);
+
+// ev must hold size events and size must be a power of two. A ring with
+// all-zero indices is empty, so a static { .ev = buf, .size = size } works too.
+void MIDIRing_Init(MIDIRing *r, MIDIEvent *ev, unsigned int size);
+
+// Events queued; callable from either thread.
+unsigned int MIDIRing_Fill(MIDIRing *r);
+
+// Producer: FALSE (and counted in dropped) when the ring is full.
+int MIDIRing_Push(MIDIRing *r, const MIDIEvent *ev);
+
+// Consumer: hands the queued events with sample at or before until to
+// sink, oldest first and at most max of them. Returns how many.
+unsigned int MIDIRing_Dispatch(MIDIRing *r, DWORD until, unsigned int max,
+                               MIDIRingSink sink, void *ctx);
+
+// Consumer: takes the queued events, oldest first and at most max of them.
+// data gets each byte and frames how many audio frames after now it falls,
+// 0 for a byte that is already due. Returns how many.
+unsigned int MIDIRing_Take(MIDIRing *r, DWORD now, BYTE *data, DWORD *frames,
+                           unsigned int max);
+
+#endif
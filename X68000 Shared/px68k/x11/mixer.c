@@ -0,0 +1,116 @@
+// ---------------------------------------------------------------------------------------
+//  MIXER.C - Block mixer for the sound sources (ADPCM, OPM, ...)
+// ---------------------------------------------------------------------------------------
+
+#include "simd.h"
+#include "mixer.h"
+
+typedef struct {
+    MixerRender render;
+    int gain;
+} MixerSource;
+
+static MixerSource Mixer_Src[MIXER_MAX_SOURCES];
+static int Mixer_Count = 0;
+static short Mixer_Buf[MIXER_MAX_SOURCES][MIXER_BLOCK * 2];
+
+static int Mixer_ClampGain(int gain)
+{
+    if (gain < 0) return 0;
+    if (gain > MIXER_MAX_GAIN) return MIXER_MAX_GAIN;
+    return gain;
+}
+
+void Mixer_Init(void)
+{
+    Mixer_Count = 0;
+}
+
+int Mixer_AddSource(MixerRender render, int gain)
+{
+    if (Mixer_Count >= MIXER_MAX_SOURCES)
+        return -1;
+    Mixer_Src[Mixer_Count].render = render;
+    Mixer_Src[Mixer_Count].gain = Mixer_ClampGain(gain);
+    return Mixer_Count++;
+}
+
+void Mixer_SetGain(int id, int gain)
+{
+    if (id >= 0 && id < Mixer_Count)
+        Mixer_Src[id].gain = Mixer_ClampGain(gain);
+}
+
+void Mixer_Render(int frames)
+{
+    int s;
+
+    if (frames > MIXER_BLOCK)
+        frames = MIXER_BLOCK;
+    for (s = 0; s < Mixer_Count; s++)
+        Mixer_Src[s].render(Mixer_Buf[s], frames);
+}
+
+void Mixer_Output(short *dst, int offset, int frames)
+{
+    const short *src[MIXER_MAX_SOURCES];
+    int gain[MIXER_MAX_SOURCES];
+    int s;
+
+    for (s = 0; s < Mixer_Count; s++) {
+        src[s] = Mixer_Buf[s] + offset * 2;
+        gain[s] = Mixer_Src[s].gain;
+    }
+    Mixer_Mix(dst, src, gain, Mixer_Count, frames * 2);
+}
+
+const short *Mixer_Buffer(int id)
+{
+    if (id < 0 || id >= Mixer_Count)
+        return NULL;
+    return Mixer_Buf[id];
+}
+
+void Mixer_Mix(short *dst, const short *const *src, const int *gain,
+               int nsrc, int samples)
+{
+    int i = 0, s;
+
+#if defined(PX68K_SIMD_SSE2)
+    // Two sources per step: interleave their samples and let pmaddwd do
+    // a*ga + b*gb in one 32-bit lane.
+    for (; i + 8 <= samples; i += 8) {
+        __m128i lo = _mm_set1_epi32(MIXER_UNITY / 2);
+        __m128i hi = lo;
+        for (s = 0; s < nsrc; s += 2) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(src[s] + i));
+            __m128i b = (s + 1 < nsrc) ? _mm_loadu_si128((const __m128i *)(src[s + 1] + i)) : _mm_setzero_si128();
+            __m128i g = _mm_set1_epi32((int)(((unsigned)((s + 1 < nsrc) ? gain[s + 1] : 0) << 16) | (unsigned)gain[s]));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), g));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), g));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_packs_epi32(_mm_srai_epi32(lo, 12), _mm_srai_epi32(hi, 12)));
+    }
+#elif defined(PX68K_SIMD_NEON)
+    for (; i + 8 <= samples; i += 8) {
+        int32x4_t lo = vdupq_n_s32(MIXER_UNITY / 2);
+        int32x4_t hi = lo;
+        for (s = 0; s < nsrc; s++) {
+            int16x8_t a = vld1q_s16(src[s] + i);
+            lo = vmlal_n_s16(lo, vget_low_s16(a), (short)gain[s]);
+            hi = vmlal_n_s16(hi, vget_high_s16(a), (short)gain[s]);
+        }
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 12)),
+                                        vqmovn_s32(vshrq_n_s32(hi, 12))));
+    }
+#endif
+    for (; i < samples; i++) {
+        int acc = MIXER_UNITY / 2;
+        for (s = 0; s < nsrc; s++)
+            acc += src[s][i] * gain[s];
+        acc >>= 12;
+        if (acc > 32767) acc = 32767; else if (acc < -32768) acc = -32768;
+        dst[i] = (short)acc;
+    }
+}
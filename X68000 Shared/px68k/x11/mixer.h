@@ -0,0 +1,49 @@
+// ---------------------------------------------------------------------------------------
+//  MIXER.H - Block mixer for the sound sources (ADPCM, OPM, ...)
+// ---------------------------------------------------------------------------------------
+//
+// Every source renders a whole block of stereo 16-bit frames into its own
+// scratch buffer (Mixer_Render). Mixer_Output then sums any span of that
+// block with per-source gains in 32 bits, saturates to 16 bits and stores
+// the result; the caller passes the contiguous spans it got from
+// PCMRing_Reserve, so there is no wrap handling per sample.
+//
+// Sources overwrite their scratch buffer, so nothing is cleared between
+// blocks. Adding a source costs one more render call and one more
+// multiply-add per sample.
+
+#ifndef PX68K_MIXER_H
+#define PX68K_MIXER_H
+
+#include "common.h"
+
+#define MIXER_MAX_SOURCES   4
+#define MIXER_BLOCK         1024        // frames per Mixer_Render
+// Gains are Q12. Capped at twice unity so four full-scale sources cannot
+// overflow the 32-bit sum.
+#define MIXER_UNITY         (1 << 12)
+#define MIXER_MAX_GAIN      (MIXER_UNITY * 2)
+
+// Must write all frames * 2 samples of buf.
+typedef void (*MixerRender)(short *buf, int frames);
+
+// Drops every source.
+void Mixer_Init(void);
+
+// Returns the source id, or -1 when all slots are taken.
+int  Mixer_AddSource(MixerRender render, int gain);
+void Mixer_SetGain(int id, int gain);
+
+// Runs every source for frames (at most MIXER_BLOCK) frames.
+void Mixer_Render(int frames);
+// Mixes frames [offset, offset + frames) of the last rendered block into dst.
+void Mixer_Output(short *dst, int offset, int frames);
+// The last rendered block of one source as it came out of its render
+// callback (before gain), or NULL for an unknown id.
+const short *Mixer_Buffer(int id);
+
+// The mixing kernel: dst[i] = sat16(sum(src[s][i] * gain[s]) >> 12), rounded.
+void Mixer_Mix(short *dst, const short *const *src, const int *gain,
+               int nsrc, int samples);
+
+#endif
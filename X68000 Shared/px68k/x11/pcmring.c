@@ -0,0 +1,94 @@
+// ---------------------------------------------------------------------------------------
+//  PCMRING.C - Single-producer/single-consumer PCM ring (stereo 16-bit frames)
+// ---------------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "pcmring.h"
+
+#define FRAME_BYTES (sizeof(short) * 2)
+
+void PCMRing_Init(PCMRing *r, short *buf, unsigned int frames)
+{
+    r->buf = buf;
+    r->frames = frames;
+    PCMRing_Reset(r);
+}
+
+void PCMRing_Reset(PCMRing *r)
+{
+    atomic_store_explicit(&r->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, 0, memory_order_relaxed);
+}
+
+unsigned int PCMRing_Fill(PCMRing *r)
+{
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned int fill = head - tail;
+
+    // tail is loaded first, so head is at least as new and the difference
+    // cannot go negative. It can overshoot when both sides moved between
+    // the loads.
+    return fill > r->frames ? r->frames : fill;
+}
+
+short *PCMRing_Reserve(PCMRing *r, unsigned int max, unsigned int *frames)
+{
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    unsigned int pos = head & (r->frames - 1);
+    unsigned int n = r->frames - (head - tail);
+
+    if (n > r->frames - pos)
+        n = r->frames - pos;
+    if (n > max)
+        n = max;
+    *frames = n;
+    return r->buf + pos * 2;
+}
+
+void PCMRing_Commit(PCMRing *r, unsigned int frames)
+{
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+    atomic_store_explicit(&r->head, head + frames, memory_order_release);
+}
+
+unsigned int PCMRing_Write(PCMRing *r, const short *src, unsigned int frames)
+{
+    unsigned int done = 0;
+
+    while (done < frames) {
+        unsigned int n;
+        short *dst = PCMRing_Reserve(r, frames - done, &n);
+
+        if (!n)
+            break;
+        memcpy(dst, src + done * 2, n * FRAME_BYTES);
+        PCMRing_Commit(r, n);
+        done += n;
+    }
+    return done;
+}
+
+unsigned int PCMRing_Read(PCMRing *r, short *dst, unsigned int frames)
+{
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned int pos = tail & (r->frames - 1);
+    unsigned int n = head - tail;
+    unsigned int first;
+
+    if (n > frames)
+        n = frames;
+    first = r->frames - pos;
+    if (first > n)
+        first = n;
+    memcpy(dst, r->buf + pos * 2, first * FRAME_BYTES);
+    memcpy(dst + first * 2, r->buf, (n - first) * FRAME_BYTES);
+
+    // The copies above must finish before the producer may reuse the space.
+    atomic_store_explicit(&r->tail, tail + n, memory_order_release);
+    return n;
+}
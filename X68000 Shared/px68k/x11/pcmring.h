@@ -0,0 +1,48 @@
+// ---------------------------------------------------------------------------------------
+//  PCMRING.H - Single-producer/single-consumer PCM ring (stereo 16-bit frames)
+// ---------------------------------------------------------------------------------------
+//
+// The emulation thread is the only writer (DSound_Send0) and the host audio
+// thread the only reader (audio_callback). Each side owns one free-running
+// frame index and publishes it with a release store; the other side reads it
+// with an acquire load, so the frames written before a publish are visible
+// to the reader once it sees the new index. No locks, no shared pointers.
+//
+// Fill level is head - tail of two single-word indices, so it never tears;
+// seen from the other thread it is merely slightly stale.
+
+#ifndef PX68K_PCMRING_H
+#define PX68K_PCMRING_H
+
+#include <stdatomic.h>
+
+#include "common.h"
+
+typedef struct {
+    short *buf;                     // frames * 2 samples (L, R)
+    unsigned int frames;            // power of two
+    _Atomic unsigned int head;      // frames written; stored by the producer
+    _Atomic unsigned int tail;      // frames read; stored by the consumer
+} PCMRing;
+
+// buf must hold frames * 2 shorts and frames must be a power of two.
+void PCMRing_Init(PCMRing *r, short *buf, unsigned int frames);
+
+// Empties the ring. Only while neither side is running.
+void PCMRing_Reset(PCMRing *r);
+
+// Frames queued; callable from either thread.
+unsigned int PCMRing_Fill(PCMRing *r);
+
+// Producer: contiguous free space at the write position, up to max frames
+// (stops at the wrap point; call again after PCMRing_Commit for the rest).
+short *PCMRing_Reserve(PCMRing *r, unsigned int max, unsigned int *frames);
+// Producer: publish frames written into the span from PCMRing_Reserve.
+void PCMRing_Commit(PCMRing *r, unsigned int frames);
+// Producer: copy in up to frames; returns how many fitted.
+unsigned int PCMRing_Write(PCMRing *r, const short *src, unsigned int frames);
+
+// Consumer: copy out up to frames; returns how many were queued.
+unsigned int PCMRing_Read(PCMRing *r, short *dst, unsigned int frames);
+
+#endif
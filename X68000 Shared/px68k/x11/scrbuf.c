@@ -17,13 +17,26 @@ static unsigned int s_generation = 0;
 static DWORD s_noted_width = 0;
 static DWORD s_noted_height = 0;
 
+// Bounding box of the rows written since the last clear (empty when
+// s_dirty_bottom < s_dirty_top); columns always start at 0.
+static DWORD s_dirty_top = SCRBUF_LINES;
+static DWORD s_dirty_bottom = 0;
+static DWORD s_dirty_width = 0;
+
+static int s_hashing = 0;
+static unsigned long s_hash_count = 0;
+static unsigned long long s_hash = 0;
+
 int Scrbuf_Init(void)
 {
     if (!ScrBuf)
         ScrBuf = (WORD *)malloc(SCRBUF_ALLOC_WORDS * sizeof(WORD));
     if (!ScrBuf)
         return FALSE;
-    Scrbuf_Clear();
+    memset(ScrBuf, 0, SCRBUF_ALLOC_WORDS * sizeof(WORD));
+    s_dirty_top = SCRBUF_LINES;
+    s_dirty_bottom = 0;
+    s_dirty_width = 0;
     return TRUE;
 }
 
@@ -35,8 +48,39 @@ void Scrbuf_Cleanup(void)
 
 void Scrbuf_Clear(void)
 {
-    if (ScrBuf)
-        memset(ScrBuf, 0, SCRBUF_ALLOC_WORDS * sizeof(WORD));
+    DWORD y;
+
+    if (!ScrBuf)
+        return;
+
+    if (s_dirty_top <= s_dirty_bottom) {
+        if (s_dirty_width >= SCRBUF_STRIDE) {
+            memset(ScrBuf + s_dirty_top * SCRBUF_STRIDE, 0,
+                   (s_dirty_bottom - s_dirty_top + 1) * SCRBUF_STRIDE * sizeof(WORD));
+        } else {
+            for (y = s_dirty_top; y <= s_dirty_bottom; y++)
+                memset(ScrBuf + y * SCRBUF_STRIDE, 0, s_dirty_width * sizeof(WORD));
+        }
+    }
+    // The guard rows are never reported; clearing them is cheap.
+    memset(ScrBuf + SCRBUF_LINES * SCRBUF_STRIDE, 0,
+           SCRBUF_GUARD_LINES * SCRBUF_STRIDE * sizeof(WORD));
+
+    s_dirty_top = SCRBUF_LINES;
+    s_dirty_bottom = 0;
+    s_dirty_width = 0;
+}
+
+void Scrbuf_NoteLine(DWORD y, DWORD width)
+{
+    if (y >= SCRBUF_LINES)
+        return;
+    if (y < s_dirty_top)
+        s_dirty_top = y;
+    if (y > s_dirty_bottom)
+        s_dirty_bottom = y;
+    if (width > s_dirty_width)
+        s_dirty_width = width > SCRBUF_STRIDE ? SCRBUF_STRIDE : width;
 }
 
 void Scrbuf_NoteGeometry(void)
@@ -77,3 +121,135 @@ void X68000_GetFrameInfo(X68FrameInfo *out)
     out->timing_valid = t.valid;
     out->generation = s_generation;
 }
+
+// ---------------------------------------------------------------------------------------
+//  Frame hash (XXH64)
+// ---------------------------------------------------------------------------------------
+
+#define XXH_P1 0x9E3779B185EBCA87ULL
+#define XXH_P2 0xC2B2AE3D27D4EB4FULL
+#define XXH_P3 0x165667B19E3779F9ULL
+#define XXH_P4 0x85EBCA77C2B2AE63ULL
+#define XXH_P5 0x27D4EB2F165667C5ULL
+
+typedef unsigned long long U64;
+
+static U64 xxh_rotl(U64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static U64 xxh_read64(const BYTE *p)
+{
+    U64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static DWORD xxh_read32(const BYTE *p)
+{
+    DWORD v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static U64 xxh_round(U64 acc, U64 in)
+{
+    acc += in * XXH_P2;
+    acc = xxh_rotl(acc, 31);
+    return acc * XXH_P1;
+}
+
+static U64 xxh_merge(U64 acc, U64 v)
+{
+    acc ^= xxh_round(0, v);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+static U64 xxh64(const void *data, size_t len, U64 seed)
+{
+    const BYTE *p = (const BYTE *)data, *end = p + len;
+    U64 h;
+
+    if (len >= 32) {
+        U64 v1 = seed + XXH_P1 + XXH_P2, v2 = seed + XXH_P2;
+        U64 v3 = seed, v4 = seed - XXH_P1;
+        const BYTE *limit = end - 32;
+
+        do {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = xxh_rotl(v1, 1) + xxh_rotl(v2, 7) + xxh_rotl(v3, 12) + xxh_rotl(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = seed + XXH_P5;
+    }
+    h += (U64)len;
+
+    for (; p + 8 <= end; p += 8)
+        h = xxh_rotl(h ^ xxh_round(0, xxh_read64(p)), 27) * XXH_P1 + XXH_P4;
+    if (p + 4 <= end) {
+        h = xxh_rotl(h ^ ((U64)xxh_read32(p) * XXH_P1), 23) * XXH_P2 + XXH_P3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = xxh_rotl(h ^ (*p * XXH_P5), 11) * XXH_P1;
+
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Rows are hashed one at a time, each seeded with the running value, so
+// the stride padding right of the visible width never enters the hash.
+unsigned long long Scrbuf_HashFrame(void)
+{
+    X68FrameInfo info;
+    DWORD geo[4];
+    U64 h;
+    int y;
+
+    X68000_GetFrameInfo(&info);
+    geo[0] = (DWORD)info.width;
+    geo[1] = (DWORD)info.height;
+    geo[2] = (DWORD)info.scan_mode;
+    geo[3] = (DWORD)info.field_parity;
+    h = xxh64(geo, sizeof(geo), 0);
+    if (!ScrBuf)
+        return h;
+    for (y = 0; y < info.height; y++)
+        h = xxh64(ScrBuf + y * SCRBUF_STRIDE, info.width * sizeof(WORD), h);
+    return h;
+}
+
+void X68000_SetFrameHashing(int enable)
+{
+    s_hashing = enable ? 1 : 0;
+    s_hash_count = 0;
+    s_hash = 0;
+}
+
+unsigned long X68000_GetFrameHash(unsigned long long *hash)
+{
+    if (hash)
+        *hash = s_hash;
+    return s_hash_count;
+}
+
+void Scrbuf_EndField(void)
+{
+    if (!s_hashing)
+        return;
+    s_hash = Scrbuf_HashFrame();
+    s_hash_count++;
+}
@@ -34,7 +34,14 @@ extern WORD *ScrBuf;
 
 int  Scrbuf_Init(void);
 void Scrbuf_Cleanup(void);
+
+// Zero everything drawn since the previous clear, plus the guard rows.
+// The renderer reports each row it writes through Scrbuf_NoteLine; the
+// clear only touches the bounding box of those rows and their widest
+// span, so scan-mode toggles no longer wipe the full 2MB allocation.
+// Anything writing ScrBuf outside WinDraw_DrawLine must report it too.
 void Scrbuf_Clear(void);
+void Scrbuf_NoteLine(DWORD y, DWORD width);
 
 // Record the current TextDotX/TextDotY; bumps the geometry generation
 // when they changed. Called whenever the CRTC recomputes the screen size.
@@ -64,6 +71,19 @@ typedef struct {
 // consistent (the emulator only mutates them inside the step).
 void X68000_GetFrameInfo(X68FrameInfo *out);
 
+// Per-field fingerprint for regression runs that only need to know whether
+// the picture changed. While enabled, Scrbuf_EndField (called by the main
+// loop right after CRTC_EndField) hashes the geometry above and the
+// visible width x height words of ScrBuf with a 64-bit xxHash; no RGBA
+// conversion is involved. The value is stable across runs and hosts of
+// the same byte order.
+void X68000_SetFrameHashing(int enable);
+// Hash of the latest hashed field; returns how many fields were hashed
+// since hashing was enabled (0: *hash is not valid yet).
+unsigned long X68000_GetFrameHash(unsigned long long *hash);
+void Scrbuf_EndField(void);
+unsigned long long Scrbuf_HashFrame(void);
+
 #ifdef __cplusplus
 }
 #endif
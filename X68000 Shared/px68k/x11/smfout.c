@@ -0,0 +1,159 @@
+// ---------------------------------------------------------------------------------------
+//  SMFOUT.C - Standard MIDI File writer fed from the MIDI event ring
+// ---------------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "smfout.h"
+
+#define SMFOUT_TRACKLEN_POS 18          // MTrk length field
+
+static void smf_put(SMFOut *s, const BYTE *p, int n)
+{
+    if (fwrite(p, 1, n, s->fp) != (size_t)n)
+        s->error = 1;
+    s->track += n;
+}
+
+static void smf_putvlq(SMFOut *s, DWORD v)
+{
+    BYTE buf[5];
+    int n = 4;
+
+    buf[n] = (BYTE)(v & 0x7f);
+    while (v >>= 7)
+        buf[--n] = (BYTE)(0x80 | (v & 0x7f));
+    smf_put(s, buf + n, 5 - n);
+}
+
+static void smf_delta(SMFOut *s, DWORD sample)
+{
+    int frames = (int)(sample - s->start);
+    DWORD tick;
+
+    if (frames < 0)
+        frames = 0;
+    if (s->division * 25 == s->rate)
+        tick = (DWORD)frames;
+    else
+        tick = (DWORD)((unsigned long long)frames * 1000 / s->rate);
+    if ((int)(tick - s->last) < 0)
+        tick = s->last;
+    smf_putvlq(s, tick - s->last);
+    s->last = tick;
+}
+
+int SMFOut_Open(SMFOut *s, const char *path, DWORD rate, DWORD start)
+{
+    BYTE h[22 + 7];
+    DWORD tempo;
+
+    memset(s, 0, sizeof(*s));
+    s->rate = rate;
+    s->start = start;
+    // One tick per frame: rate/25 ticks per quarter note at 40ms per
+    // quarter note. Otherwise 1000 ticks per second-long quarter note.
+    if (rate && rate % 25 == 0 && rate / 25 <= 0x7fff) {
+        s->division = rate / 25;
+        tempo = 40000;
+    } else {
+        s->division = 1000;
+        tempo = 1000000;
+    }
+    s->fp = fopen(path, "wb");
+    if (!s->fp)
+        return FALSE;
+
+    memcpy(h, "MThd\0\0\0\6\0\0\0\1", 12);     // format 0, one track
+    h[12] = (BYTE)(s->division >> 8);
+    h[13] = (BYTE)s->division;
+    memcpy(h + 14, "MTrk\0\0\0\0", 8);          // length patched on close
+    h[22] = 0x00;                               // delta 0: set tempo
+    h[23] = 0xff;
+    h[24] = 0x51;
+    h[25] = 0x03;
+    h[26] = (BYTE)(tempo >> 16);
+    h[27] = (BYTE)(tempo >> 8);
+    h[28] = (BYTE)tempo;
+    if (fwrite(h, sizeof(h), 1, s->fp) != 1)
+        s->error = 1;
+    s->track = 7;
+    return TRUE;
+}
+
+void SMFOut_Event(const MIDIEvent *ev, void *ctx)
+{
+    SMFOut *s = (SMFOut *)ctx;
+    BYTE b = ev->data;
+
+    if (!s->fp || b >= 0xf8)                    // real-time: no SMF form
+        return;
+
+    if (b & 0x80) {
+        // Any status ends a system exclusive; only F7 completes it.
+        if (s->sysex && b == 0xf7 && s->sysexlen <= SMFOUT_SYSEX_MAX - 1) {
+            BYTE f0 = 0xf0;
+            s->sysexbuf[s->sysexlen++] = 0xf7;
+            smf_delta(s, ev->sample);
+            smf_put(s, &f0, 1);
+            smf_putvlq(s, (DWORD)s->sysexlen);
+            smf_put(s, s->sysexbuf, s->sysexlen);
+        }
+        s->sysex = 0;
+        s->skip = 0;
+        s->have = 0;
+        if (b < 0xf0) {
+            s->status = b;
+            s->need = ((b & 0xe0) == 0xc0) ? 1 : 2;
+        } else {
+            // System messages cancel running status.
+            s->status = 0;
+            if (b == 0xf0) {
+                s->sysex = 1;
+                s->sysexlen = 0;
+            } else if (b == 0xf2) {
+                s->skip = 2;
+            } else if (b == 0xf1 || b == 0xf3) {
+                s->skip = 1;
+            }
+        }
+        return;
+    }
+
+    if (s->sysex) {
+        // An oversized message is dropped whole at its F7.
+        if (s->sysexlen < SMFOUT_SYSEX_MAX)
+            s->sysexbuf[s->sysexlen] = b;
+        s->sysexlen++;
+    } else if (s->skip) {
+        s->skip--;
+    } else if (s->status) {
+        s->msg[s->have++] = b;
+        if (s->have == s->need) {
+            smf_delta(s, ev->sample);
+            smf_put(s, &s->status, 1);
+            smf_put(s, s->msg, s->need);
+            s->have = 0;
+        }
+    }
+}
+
+int SMFOut_Close(SMFOut *s)
+{
+    static const BYTE eot[4] = { 0x00, 0xff, 0x2f, 0x00 };
+    BYTE len[4];
+
+    if (!s->fp)
+        return TRUE;
+    smf_put(s, eot, 4);
+    len[0] = (BYTE)(s->track >> 24);
+    len[1] = (BYTE)(s->track >> 16);
+    len[2] = (BYTE)(s->track >> 8);
+    len[3] = (BYTE)s->track;
+    if (fseek(s->fp, SMFOUT_TRACKLEN_POS, SEEK_SET) != 0 || fwrite(len, 4, 1, s->fp) != 1)
+        s->error = 1;
+    if (fclose(s->fp) != 0)
+        s->error = 1;
+    s->fp = NULL;
+    return !s->error;
+}
@@ -0,0 +1,51 @@
+// ---------------------------------------------------------------------------------------
+//  SMFOUT.H - Standard MIDI File writer fed from the MIDI event ring
+// ---------------------------------------------------------------------------------------
+//
+// A file stand-in for the host MIDI port: SMFOut_Event is a MIDIRingSink,
+// so the bytes MIDIRing_Dispatch hands over end up in a format 0 file with
+// their audio frame stamps as timing. When the rate is a multiple of 25 one
+// tick is one audio frame; otherwise one tick is a millisecond.
+//
+// The byte stream is parsed as a MIDI port would: running status is
+// honoured, every channel message is written with its status byte and
+// timed by its last byte, system exclusive goes out as one F0 event.
+// Real-time and system common messages have no SMF form and are skipped.
+
+#ifndef PX68K_SMFOUT_H
+#define PX68K_SMFOUT_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "midiring.h"
+
+#define SMFOUT_SYSEX_MAX    4096
+
+typedef struct {
+    FILE *fp;
+    DWORD rate;
+    DWORD start;            // audio frame of tick 0
+    DWORD division;         // ticks per quarter note
+    DWORD last;             // tick of the last event written
+    DWORD track;            // MTrk data bytes written so far
+    BYTE status;            // running status, 0 when none
+    BYTE skip;              // data bytes of a skipped system common message
+    int need, have;
+    BYTE msg[2];
+    int sysex;              // inside F0 ... F7
+    int sysexlen;
+    BYTE sysexbuf[SMFOUT_SYSEX_MAX];
+    int error;
+} SMFOut;
+
+// Creates (truncates) path; frames are counted from audio frame start.
+// Returns FALSE when the file cannot be created.
+int  SMFOut_Open(SMFOut *s, const char *path, DWORD rate, DWORD start);
+// MIDIRingSink: ctx is the SMFOut.
+void SMFOut_Event(const MIDIEvent *ev, void *ctx);
+// Ends the track, patches its length and closes the file. Returns FALSE if
+// any write failed. Does nothing for a writer that is not open.
+int  SMFOut_Close(SMFOut *s);
+
+#endif
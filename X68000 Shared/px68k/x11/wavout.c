@@ -0,0 +1,92 @@
+// ---------------------------------------------------------------------------------------
+//  WAVOUT.C - 16-bit stereo PCM WAV file writer
+// ---------------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "wavout.h"
+
+#define WAVOUT_CHUNK    1024        // frames converted per fwrite
+
+static void put16(BYTE *p, unsigned int v)
+{
+    p[0] = (BYTE)v;
+    p[1] = (BYTE)(v >> 8);
+}
+
+static void put32(BYTE *p, DWORD v)
+{
+    p[0] = (BYTE)v;
+    p[1] = (BYTE)(v >> 8);
+    p[2] = (BYTE)(v >> 16);
+    p[3] = (BYTE)(v >> 24);
+}
+
+static void wavout_header(BYTE *h, DWORD rate, DWORD frames)
+{
+    DWORD data = frames * 4;
+
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 36 + data);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);              // fmt chunk size
+    put16(h + 20, 1);               // PCM
+    put16(h + 22, 2);               // channels
+    put32(h + 24, rate);
+    put32(h + 28, rate * 4);        // bytes per second
+    put16(h + 32, 4);               // bytes per frame
+    put16(h + 34, 16);              // bits per sample
+    memcpy(h + 36, "data", 4);
+    put32(h + 40, data);
+}
+
+int WavOut_Open(WavOut *w, const char *path, DWORD rate)
+{
+    BYTE h[WAVOUT_HEADER_BYTES];
+
+    w->rate = rate;
+    w->frames = 0;
+    w->error = 0;
+    w->fp = fopen(path, "wb");
+    if (!w->fp)
+        return FALSE;
+    wavout_header(h, rate, 0);
+    if (fwrite(h, sizeof(h), 1, w->fp) != 1)
+        w->error = 1;
+    return TRUE;
+}
+
+void WavOut_Write(WavOut *w, const short *pcm, int frames)
+{
+    BYTE buf[WAVOUT_CHUNK * 4];
+
+    if (!w->fp)
+        return;
+    while (frames > 0) {
+        int n = (frames > WAVOUT_CHUNK) ? WAVOUT_CHUNK : frames;
+        int i;
+
+        for (i = 0; i < n * 2; i++)
+            put16(buf + i * 2, (WORD)pcm[i]);
+        if (fwrite(buf, 4, n, w->fp) != (size_t)n)
+            w->error = 1;
+        w->frames += n;
+        pcm += n * 2;
+        frames -= n;
+    }
+}
+
+int WavOut_Close(WavOut *w)
+{
+    BYTE h[WAVOUT_HEADER_BYTES];
+
+    if (!w->fp)
+        return TRUE;
+    wavout_header(h, w->rate, w->frames);
+    if (fseek(w->fp, 0, SEEK_SET) != 0 || fwrite(h, sizeof(h), 1, w->fp) != 1)
+        w->error = 1;
+    if (fclose(w->fp) != 0)
+        w->error = 1;
+    w->fp = NULL;
+    return !w->error;
+}
@@ -0,0 +1,34 @@
+// ---------------------------------------------------------------------------------------
+//  WAVOUT.H - 16-bit stereo PCM WAV file writer
+// ---------------------------------------------------------------------------------------
+//
+// Used by the offline audio render (DSound_StartCapture). The RIFF and data
+// chunk sizes are written as zero on open and patched on close, so a file
+// that was never closed still has a valid header up to its data chunk.
+// Samples are stored little-endian whatever the host byte order.
+
+#ifndef PX68K_WAVOUT_H
+#define PX68K_WAVOUT_H
+
+#include <stdio.h>
+
+#include "common.h"
+
+#define WAVOUT_HEADER_BYTES 44
+
+typedef struct {
+    FILE *fp;
+    DWORD rate;
+    DWORD frames;       // frames written so far
+    int error;          // a write failed; Close reports it
+} WavOut;
+
+// Creates (truncates) path. Returns FALSE when the file cannot be created.
+int  WavOut_Open(WavOut *w, const char *path, DWORD rate);
+// Appends frames stereo frames (frames * 2 samples, L then R).
+void WavOut_Write(WavOut *w, const short *pcm, int frames);
+// Patches the chunk sizes and closes the file. Returns FALSE if any write
+// failed. Does nothing for a writer that is not open.
+int  WavOut_Close(WavOut *w);
+
+#endif
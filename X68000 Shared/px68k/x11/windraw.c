@@ -38,6 +38,7 @@
 #include "joystick.h"
 #include "keyboard.h"
 #include "scrbuf.h"
+#include "frameskip.h"
 
 
 BYTE    Debug_Text=1, Debug_Grp=1, Debug_Sp=1;
@@ -519,21 +520,88 @@ INLINE void WinDraw_DrawPriLine(void)
 	WD_LOOP(0, TextDotX, _DPL_SUB);
 }
 
-void WinDraw_DrawLine(void)
+INLINE void WinDraw_DrawHalfLine(void)
 {
-	int opaq, ton=0, gon=0, bgon=0, tron=0, pron=0, tdrawed=0;
-//@    printf("%d\n", VLINE);
-    if((signed int)VLINE<0 )return; //@GOROman
-    // Never scan outside the buffer: lines past the row count and lines
-    // wider than the stride are dropped (the timing model flags such
-    // register settings as invalid).
-    if (VLINE >= SCRBUF_LINES) return;
-    if (TextDotX > SCRBUF_STRIDE) return;
+#define _DL_SUB(SUFFIX) \
+{								\
+	w = (Grp_DoubleBuffer ? Grp_LineBufSP_Active[i] : Grp_LineBufSP[i]);					\
+	if (w != 0 && (ScrBuf##SUFFIX[adr] & 0xffff) == 0)	\
+		ScrBuf##SUFFIX[adr] = (w & Pal_HalfMask) >> 1;	\
+}
 
-	if (!TextDirtyLine[VLINE]) return;
-	TextDirtyLine[VLINE] = 0;
-	Draw_DrawFlag = 1;
+	DWORD adr = VLINE*SCRBUF_STRIDE;
+	WORD w;
+	int i;
 
+	WD_LOOP(0, TextDotX, _DL_SUB);
+}
+
+INLINE void WinDraw_FillBGLine(WORD c)
+{
+	WORD *p = BG_DoubleBuffer ? BG_LineBuf_Draw : BG_LineBuf;	// 次フレーム用描画バッファをクリア
+	int i;
+
+	for (i = 16; i < TextDotX + 16; ++i)
+		p[i] = c;
+}
+
+
+// -----------------------------------------------------------------------
+//   合成パイプライン
+//   VC/BGレジスタとDebug_*の組み合わせごとに、どのプレーンをどの順で
+//   どのopaq/tdで描くかを一度だけ手順列に展開してキャッシュしておき、
+//   各ラインではその手順列を実行するだけにする。
+//   手順の組み立ては元のWinDraw_DrawLineの判定をそのまま移したもの。
+// -----------------------------------------------------------------------
+enum {
+	WDP_END = 0,
+	WDP_GRP16, WDP_GRP16SP, WDP_GRP8, WDP_GRP8SP, WDP_GRP8TR,
+	WDP_GRP4, WDP_GRP4SP, WDP_GRP4TR, WDP_GRP4H, WDP_GRP4HSP,
+	WDP_TEXT,		// Text_DrawLine_C(a)
+	WDP_BG,			// BG_DrawLineCached(a, b, palonly)＋バッファスワップ
+	WDP_BGFILL,		// BGラインバッファをTextPal[0](a=1)か0で埋める
+	WDP_CLRTR,		// Text_TrFlagクリア
+	WDP_GRPLINE, WDP_GRPNSP, WDP_TEXTLINE, WDP_TEXTTR, WDP_BGLINE, WDP_BGTR,
+	WDP_PRI,		// 特殊プライオリティ時のグラフィック
+	WDP_HALF,		// 半透明時の透明ドットをハーフカラーで埋める
+	WDP_FALLBACK,		// テキスト無効時のブートテキスト
+	WDP_BLANK		// 何も描かれなかったラインを0で埋める
+};
+
+#define WDP_MAXSTEP	32
+#define WDP_CACHE	16		// 2^n
+
+typedef struct {
+	BYTE op, a, b;
+} WDP_STEP;
+
+typedef struct {
+	BYTE key[8];
+	BYTE valid;
+	WDP_STEP step[WDP_MAXSTEP];
+} WDP_PIPE;
+
+static WDP_PIPE WinDraw_Pipes[WDP_CACHE];
+static WDP_PIPE *WinDraw_Pipe = NULL;
+
+static void WinDraw_PipeKey(BYTE *key)
+{
+	key[0] = VCReg0[1]&7;
+	key[1] = VCReg1[0];
+	key[2] = VCReg1[1];
+	key[3] = VCReg2[0];
+	key[4] = VCReg2[1];
+	key[5] = (BG_Regs[8]&2)|((BG_Regs[0x11]&2)<<1);
+	key[6] = (Debug_Text?1:0)|(Debug_Grp?2:0)|(Debug_Sp?4:0);
+	key[7] = 0;
+}
+
+#define WDP_EMIT(o, x, y)	do { s->op = (o); s->a = (BYTE)(x); s->b = (BYTE)(y); s++; } while (0)
+
+static void WinDraw_BuildPipe(WDP_PIPE *pp)
+{
+	WDP_STEP *s = pp->step;
+	int opaq, ton=0, gon=0, bgon=0, tron=0, pron=0, tdrawed=0;
 
 	if (Debug_Grp)
 	{
@@ -546,12 +614,12 @@ void WinDraw_DrawLine(void)
 			{
 				if ( (VCReg2[0]&0x14)==0x14 )
 				{
-					Grp_DrawLine4hSP();
+					WDP_EMIT(WDP_GRP4HSP, 0, 0);
 					pron = tron = 1;
 				}
 				else
 				{
-					Grp_DrawLine4h();
+					WDP_EMIT(WDP_GRP4H, 0, 0);
 					gon=1;
 				}
 			}
@@ -560,28 +628,28 @@ void WinDraw_DrawLine(void)
 		{
 			if ( (VCReg2[0]&0x10)&&(VCReg2[1]&1) )
 			{
-				Grp_DrawLine4SP((VCReg1[1]   )&3/*, 1*/);			// È¾Æ©ÌÀ¤Î²¼½àÈ÷
+				WDP_EMIT(WDP_GRP4SP, (VCReg1[1]   )&3, 0);			// È¾Æ©ÌÀ¤Î²¼½àÈ÷
 				pron = tron = 1;
 			}
 			opaq = 1;
 			if (VCReg2[1]&8)
 			{
-				Grp_DrawLine4((VCReg1[1]>>6)&3, 1);
+				WDP_EMIT(WDP_GRP4, (VCReg1[1]>>6)&3, 1);
 				opaq = 0;
 				gon=1;
 			}
 			if (VCReg2[1]&4)
 			{
-				Grp_DrawLine4((VCReg1[1]>>4)&3, opaq);
+				WDP_EMIT(WDP_GRP4, (VCReg1[1]>>4)&3, opaq);
 				opaq = 0;
 				gon=1;
 			}
 			if (VCReg2[1]&2)
 			{
 				if ( ((VCReg2[0]&0x1e)==0x1e)&&(tron) )
-					Grp_DrawLine4TR((VCReg1[1]>>2)&3, opaq);
+					WDP_EMIT(WDP_GRP4TR, (VCReg1[1]>>2)&3, opaq);
 				else
-					Grp_DrawLine4((VCReg1[1]>>2)&3, opaq);
+					WDP_EMIT(WDP_GRP4, (VCReg1[1]>>2)&3, opaq);
 				opaq = 0;
 				gon=1;
 			}
@@ -595,7 +663,7 @@ void WinDraw_DrawLine(void)
 //				else
 				if ( (VCReg2[0]&0x14)!=0x14 )
 				{
-					Grp_DrawLine4((VCReg1[1]   )&3, opaq);
+					WDP_EMIT(WDP_GRP4, (VCReg1[1]   )&3, opaq);
 					gon=1;
 				}
 			}
@@ -608,15 +676,15 @@ void WinDraw_DrawLine(void)
 		{
 			if ( (VCReg2[0]&0x10)&&(VCReg2[1]&1) )
 			{
-				Grp_DrawLine8SP(0);			// È¾Æ©ÌÀ¤Î²¼½àÈ÷
+				WDP_EMIT(WDP_GRP8SP, 0, 0);			// È¾Æ©ÌÀ¤Î²¼½àÈ÷
 				tron = pron = 1;
 			}
 			if (VCReg2[1]&4)
 			{
 				if ( ((VCReg2[0]&0x1e)==0x1e)&&(tron) )
-					Grp_DrawLine8TR(1, 1);
+					WDP_EMIT(WDP_GRP8TR, 1, 1);
 				else
-					Grp_DrawLine8(1, 1);
+					WDP_EMIT(WDP_GRP8, 1, 1);
 				opaq = 0;
 				gon=1;
 			}
@@ -624,7 +692,7 @@ void WinDraw_DrawLine(void)
 			{
 				if ( (VCReg2[0]&0x14)!=0x14 )
 				{
-					Grp_DrawLine8(0, opaq);
+					WDP_EMIT(WDP_GRP8, 0, opaq);
 					gon=1;
 				}
 			}
@@ -633,15 +701,15 @@ void WinDraw_DrawLine(void)
 		{
 			if ( (VCReg2[0]&0x10)&&(VCReg2[1]&1) )
 			{
-				Grp_DrawLine8SP(1);			// È¾Æ©ÌÀ¤Î²¼½àÈ÷
+				WDP_EMIT(WDP_GRP8SP, 1, 0);			// È¾Æ©ÌÀ¤Î²¼½àÈ÷
 				tron = pron = 1;
 			}
 			if (VCReg2[1]&4)
 			{
 				if ( ((VCReg2[0]&0x1e)==0x1e)&&(tron) )
-					Grp_DrawLine8TR(0, 1);
+					WDP_EMIT(WDP_GRP8TR, 0, 1);
 				else
-					Grp_DrawLine8(0, 1);
+					WDP_EMIT(WDP_GRP8, 0, 1);
 				opaq = 0;
 				gon=1;
 			}
@@ -649,7 +717,7 @@ void WinDraw_DrawLine(void)
 			{
 				if ( (VCReg2[0]&0x14)!=0x14 )
 				{
-					Grp_DrawLine8(1, opaq);
+					WDP_EMIT(WDP_GRP8, 1, opaq);
 					gon=1;
 				}
 			}
@@ -660,12 +728,12 @@ void WinDraw_DrawLine(void)
 		{
 			if ( (VCReg2[0]&0x14)==0x14 )
 			{
-				Grp_DrawLine16SP();
+				WDP_EMIT(WDP_GRP16SP, 0, 0);
 				tron = pron = 1;
 			}
 			else
 			{
-				Grp_DrawLine16();
+				WDP_EMIT(WDP_GRP16, 0, 0);
 				gon=1;
 			}
 		}
@@ -681,24 +749,15 @@ void WinDraw_DrawLine(void)
 	{						// BG¤ÎÊý¤¬¾å
 		if ((VCReg2[1]&0x20)&&(Debug_Text))
 		{
-			Text_DrawLine_C(1);
+			WDP_EMIT(WDP_TEXT, 1, 0);
 			ton = 1;
 		}
 		else
-			ZeroMemory(Text_TrFlag, TextDotX+16);
+			WDP_EMIT(WDP_CLRTR, 0, 0);
 
 		if ((VCReg2[1]&0x40)&&(BG_Regs[8]&2)&&(!(BG_Regs[0x11]&2))&&(Debug_Sp))
 		{
-			int s1, s2;
-			s1 = (((BG_Regs[0x11]  &4)?2:1)-((BG_Regs[0x11]  &16)?1:0));
-			s2 = (((CRTC_Regs[0x29]&4)?2:1)-((CRTC_Regs[0x29]&16)?1:0));
-			VLINEBG = VLINE;
-			VLINEBG <<= s1;
-			VLINEBG >>= s2;
-			if ( !(BG_Regs[0x11]&16) ) VLINEBG -= ((BG_Regs[0x0f]>>s1)-(CRTC_Regs[0x0d]>>s2));
-			BG_DrawLine(!ton, 0);
-			BG_SwapBuffers(); // フレーム描画完了後にバッファスワップ
-			Grp_SwapBuffers(); // グラフィックプレーン用バッファスワップ
+			WDP_EMIT(WDP_BG, !ton, 0);
 			bgon = 1;
 		}
 	}
@@ -706,45 +765,23 @@ void WinDraw_DrawLine(void)
 	{						// Text¤ÎÊý¤¬¾å
 		if ((VCReg2[1]&0x40)&&(BG_Regs[8]&2)&&(!(BG_Regs[0x11]&2))&&(Debug_Sp))
 		{
-			int s1, s2;
-			s1 = (((BG_Regs[0x11]  &4)?2:1)-((BG_Regs[0x11]  &16)?1:0));
-			s2 = (((CRTC_Regs[0x29]&4)?2:1)-((CRTC_Regs[0x29]&16)?1:0));
-			VLINEBG = VLINE;
-			VLINEBG <<= s1;
-			VLINEBG >>= s2;
-			if ( !(BG_Regs[0x11]&16) ) VLINEBG -= ((BG_Regs[0x0f]>>s1)-(CRTC_Regs[0x0d]>>s2));
-			ZeroMemory(Text_TrFlag, TextDotX+16);
-			BG_DrawLine(1, 1);
-			BG_SwapBuffers(); // フレーム描画完了後にバッファスワップ
-			Grp_SwapBuffers(); // グラフィックプレーン用バッファスワップ
+			WDP_EMIT(WDP_CLRTR, 0, 0);
+			WDP_EMIT(WDP_BG, 1, 1);
 			bgon = 1;
 		}
 		else
 		{
 			if ((VCReg2[1]&0x20)&&(Debug_Text))
-			{
-				int i;
-				for (i = 16; i < TextDotX + 16; ++i) {
-					if (BG_DoubleBuffer) {
-						BG_LineBuf_Draw[i] = TextPal[0];  // 次フレーム用描画バッファをクリア
-					} else {
-						BG_LineBuf[i] = TextPal[0];
-					}
-				}
-			} else {		// 20010120 ¡Êàèàá¿§¡Ë
-				if (BG_DoubleBuffer) {
-					memset(&BG_LineBuf_Draw[16], 0, TextDotX * 2);  // 次フレーム用描画バッファをクリア
-				} else {
-					bzero(&BG_LineBuf[16], TextDotX * 2);
-				}
-			}
-			ZeroMemory(Text_TrFlag, TextDotX+16);
+				WDP_EMIT(WDP_BGFILL, 1, 0);
+			else			// 20010120 ¡Êàèàá¿§¡Ë
+				WDP_EMIT(WDP_BGFILL, 0, 0);
+			WDP_EMIT(WDP_CLRTR, 0, 0);
 			bgon = 1;
 		}
 
 		if ((VCReg2[1]&0x20)&&(Debug_Text))
 		{
-			Text_DrawLine_C(!bgon);
+			WDP_EMIT(WDP_TEXT, !bgon, 0);
 			ton = 1;
 		}
 	}
@@ -761,14 +798,14 @@ void WinDraw_DrawLine(void)
 			{
 				if ( (VCReg1[0]&3)<((VCReg1[0]>>2)&3) )
 				{
-					WinDraw_DrawBGLineTR(opaq);
+					WDP_EMIT(WDP_BGTR, opaq, 0);
 					tdrawed = 1;
 					opaq = 0;
 				}
 			}
 			else
 			{
-				WinDraw_DrawBGLine(opaq, /*tdrawed*/0);
+				WDP_EMIT(WDP_BGLINE, opaq, /*tdrawed*/0);
 				tdrawed = 1;
 				opaq = 0;
 			}
@@ -776,9 +813,9 @@ void WinDraw_DrawLine(void)
 		if ( ((VCReg1[0]&0x0c)==0x0c)&&(ton) )
 		{
 			if ( ((VCReg2[0]&0x5d)==0x1d)&&((VCReg1[0]&0x03)!=0x0c)&&(tron) )
-				WinDraw_DrawTextLineTR(opaq);
+				WDP_EMIT(WDP_TEXTTR, opaq, 0);
 			else
-				WinDraw_DrawTextLine(opaq, /*tdrawed*/((VCReg1[0]&0x30)==0x30));
+				WDP_EMIT(WDP_TEXTLINE, opaq, /*tdrawed*/((VCReg1[0]&0x30)==0x30));
 			opaq = 0;
 			tdrawed = 1;
 		}
@@ -795,12 +832,12 @@ void WinDraw_DrawLine(void)
 		{
 			if (gon)
 			{
-				WinDraw_DrawGrpLine(opaq);
+				WDP_EMIT(WDP_GRPLINE, opaq, 0);
 				opaq = 0;
 			}
 			if (tron)
 			{
-				WinDraw_DrawGrpLineNonSP(opaq);
+				WDP_EMIT(WDP_GRPNSP, opaq, 0);
 				opaq = 0;
 			}
 		}
@@ -810,14 +847,14 @@ void WinDraw_DrawLine(void)
 			{
 				if ( (VCReg1[0]&3)<((VCReg1[0]>>2)&3) )
 				{
-					WinDraw_DrawBGLineTR(opaq);
+					WDP_EMIT(WDP_BGTR, opaq, 0);
 					tdrawed = 1;
 					opaq = 0;
 				}
 			}
 			else
 			{
-				WinDraw_DrawBGLine(opaq, /*0*/tdrawed);
+				WDP_EMIT(WDP_BGLINE, opaq, /*0*/tdrawed);
 				tdrawed = 1;
 				opaq = 0;
 			}
@@ -825,9 +862,9 @@ void WinDraw_DrawLine(void)
 		if ( (VCReg1[0]&0x08)&&(ton) )
 		{
 			if ( ((VCReg2[0]&0x5d)==0x1d)&&((VCReg1[0]&0x03)!=0x02)&&(tron) )
-				WinDraw_DrawTextLineTR(opaq);
+				WDP_EMIT(WDP_TEXTTR, opaq, 0);
 			else
-				WinDraw_DrawTextLine(opaq, tdrawed/*((VCReg1[0]&0x30)>=0x20)*/);
+				WDP_EMIT(WDP_TEXTLINE, opaq, tdrawed/*((VCReg1[0]&0x30)>=0x20)*/);
 			opaq = 0;
 			tdrawed = 1;
 		}
@@ -835,7 +872,7 @@ void WinDraw_DrawLine(void)
 					// Pri = 1¡Ê2ÈÖÌÜ¡Ë¤ËÀßÄê¤µ¤ì¤Æ¤¤¤ë²èÌÌ¤òÉ½¼¨
 		if ( ((VCReg1[0]&0x03)==0x01)&&(gon) )
 		{
-			WinDraw_DrawGrpLine(opaq);
+			WDP_EMIT(WDP_GRPLINE, opaq, 0);
 			opaq = 0;
 		}
 		if ( ((VCReg1[0]&0x30)==0x10)&&(bgon) )
@@ -844,39 +881,39 @@ void WinDraw_DrawLine(void)
 			{
 				if ( (VCReg1[0]&3)<((VCReg1[0]>>2)&3) )
 				{
-					WinDraw_DrawBGLineTR(opaq);
+					WDP_EMIT(WDP_BGTR, opaq, 0);
 					tdrawed = 1;
 					opaq = 0;
 				}
 			}
 			else
 			{
-				WinDraw_DrawBGLine(opaq, ((VCReg1[0]&0xc)==0x8));
+				WDP_EMIT(WDP_BGLINE, opaq, ((VCReg1[0]&0xc)==0x8));
 				tdrawed = 1;
 				opaq = 0;
 			}
 		}
 		if ( ((VCReg1[0]&0x0c)==0x04) && ((VCReg2[0]&0x5d)==0x1d) && (VCReg1[0]&0x03) && (((VCReg1[0]>>4)&3)>(VCReg1[0]&3)) && (bgon) && (tron) )
 		{
-			WinDraw_DrawBGLineTR(opaq);
+			WDP_EMIT(WDP_BGTR, opaq, 0);
 			tdrawed = 1;
 			opaq = 0;
 			if (tron)
 			{
-				WinDraw_DrawGrpLineNonSP(opaq);
+				WDP_EMIT(WDP_GRPNSP, opaq, 0);
 			}
 		}
 		else if ( ((VCReg1[0]&0x03)==0x01)&&(tron)&&(gon)&&(VCReg2[0]&0x10) )
 		{
-			WinDraw_DrawGrpLineNonSP(opaq);
+			WDP_EMIT(WDP_GRPNSP, opaq, 0);
 			opaq = 0;
 		}
 		if ( ((VCReg1[0]&0x0c)==0x04)&&(ton) )
 		{
 			if ( ((VCReg2[0]&0x5d)==0x1d)&&(!(VCReg1[0]&0x03))&&(tron) )
-				WinDraw_DrawTextLineTR(opaq);
+				WDP_EMIT(WDP_TEXTTR, opaq, 0);
 			else
-				WinDraw_DrawTextLine(opaq, ((VCReg1[0]&0x30)>=0x10));
+				WDP_EMIT(WDP_TEXTLINE, opaq, ((VCReg1[0]&0x30)>=0x10));
 			opaq = 0;
 			tdrawed = 1;
 		}
@@ -884,33 +921,33 @@ void WinDraw_DrawLine(void)
 					// Pri = 0¡ÊºÇÍ¥Àè¡Ë¤ËÀßÄê¤µ¤ì¤Æ¤¤¤ë²èÌÌ¤òÉ½¼¨
 		if ( (!(VCReg1[0]&0x03))&&(gon) )
 		{
-			WinDraw_DrawGrpLine(opaq);
+			WDP_EMIT(WDP_GRPLINE, opaq, 0);
 			opaq = 0;
 		}
 		if ( (!(VCReg1[0]&0x30))&&(bgon) )
 		{
-			WinDraw_DrawBGLine(opaq, /*tdrawed*/((VCReg1[0]&0xc)>=0x4));
+			WDP_EMIT(WDP_BGLINE, opaq, /*tdrawed*/((VCReg1[0]&0xc)>=0x4));
 			tdrawed = 1;
 			opaq = 0;
 		}
 		if ( (!(VCReg1[0]&0x0c)) && ((VCReg2[0]&0x5d)==0x1d) && (((VCReg1[0]>>4)&3)>(VCReg1[0]&3)) && (bgon) && (tron) )
 		{
-			WinDraw_DrawBGLineTR(opaq);
+			WDP_EMIT(WDP_BGTR, opaq, 0);
 			tdrawed = 1;
 			opaq = 0;
 			if (tron)
 			{
-				WinDraw_DrawGrpLineNonSP(opaq);
+				WDP_EMIT(WDP_GRPNSP, opaq, 0);
 			}
 		}
 		else if ( (!(VCReg1[0]&0x03))&&(tron)&&(VCReg2[0]&0x10) )
 		{
-			WinDraw_DrawGrpLineNonSP(opaq);
+			WDP_EMIT(WDP_GRPNSP, opaq, 0);
 			opaq = 0;
 		}
 		if ( (!(VCReg1[0]&0x0c))&&(ton) )
 		{
-			WinDraw_DrawTextLine(opaq, 1);
+			WDP_EMIT(WDP_TEXTLINE, opaq, 1);
 			tdrawed = 1;
 			opaq = 0;
 		}
@@ -918,44 +955,165 @@ void WinDraw_DrawLine(void)
 					// ÆÃ¼ì¥×¥é¥¤¥ª¥ê¥Æ¥£»þ¤Î¥°¥é¥Õ¥£¥Ã¥¯
 		if ( ((VCReg2[0]&0x5c)==0x14)&&(pron) )	// ÆÃ¼ìPri»þ¤Ï¡¢ÂÐ¾Ý¥×¥ì¡¼¥ó¥Ó¥Ã¥È¤Ï°ÕÌ£¤¬Ìµ¤¤¤é¤·¤¤¡Ê¤Ä¤¤¤ó¤Ó¡¼¡Ë
 		{
-			WinDraw_DrawPriLine();
+			WDP_EMIT(WDP_PRI, 0, 0);
 		}
 		else if ( ((VCReg2[0]&0x5d)==0x1c)&&(tron) )	// È¾Æ©ÌÀ»þ¤ËÁ´¤Æ¤¬Æ©ÌÀ¤Ê¥É¥Ã¥È¤ò¥Ï¡¼¥Õ¥«¥é¡¼¤ÇËä¤á¤ë
 		{						// ¡ÊAQUALES¡Ë
-
-#define _DL_SUB(SUFFIX) \
-{								\
-	w = (Grp_DoubleBuffer ? Grp_LineBufSP_Active[i] : Grp_LineBufSP[i]);					\
-	if (w != 0 && (ScrBuf##SUFFIX[adr] & 0xffff) == 0)	\
-		ScrBuf##SUFFIX[adr] = (w & Pal_HalfMask) >> 1;	\
-}
-
-			DWORD adr = VLINE*SCRBUF_STRIDE;
-			WORD w;
-			int i;
-
-			WD_LOOP(0, TextDotX, _DL_SUB);
+			WDP_EMIT(WDP_HALF, 0, 0);
 		}
 
 
 	if (opaq && Debug_Text && ((VCReg2[1] & 0x20) == 0)) {
-		static int s_text_fallback_log_count = 0;
 		// Some SCSI boot paths leave VCReg2 text-enable cleared even though
 		// TVRAM has valid boot text. Render one text layer pass as a fallback.
-		Text_DrawLine_C(1);
-		WinDraw_DrawTextLine(1, 1);
+		WDP_EMIT(WDP_FALLBACK, 0, 0);
 		opaq = 0;
-		if (s_text_fallback_log_count < 8) {
-			p6logd("DRAW_FALLBACK_TEXT VLINE=%u VCReg2[1]=%02X\n",
-			       (unsigned int)VLINE,
-			       (unsigned int)VCReg2[1]);
-			s_text_fallback_log_count++;
-		}
 	}
 
 	if (opaq)
-	{
-		DWORD adr = VLINE*SCRBUF_STRIDE;
-		memset(&ScrBuf[adr], 0, TextDotX * 2);
+		WDP_EMIT(WDP_BLANK, 0, 0);
+	WDP_EMIT(WDP_END, 0, 0);
+}
+
+static WDP_PIPE *WinDraw_GetPipe(void)
+{
+	BYTE key[8];
+	WDP_PIPE *pp;
+
+	WinDraw_PipeKey(key);
+	if (WinDraw_Pipe && !memcmp(WinDraw_Pipe->key, key, sizeof(key)))
+		return WinDraw_Pipe;
+
+	pp = &WinDraw_Pipes[(key[0] ^ key[1] ^ (key[2] * 3) ^ (key[3] * 5) ^ (key[4] * 7) ^ key[5] ^ key[6]) & (WDP_CACHE - 1)];
+	if (!pp->valid || memcmp(pp->key, key, sizeof(key))) {
+		memcpy(pp->key, key, sizeof(key));
+		WinDraw_BuildPipe(pp);
+		pp->valid = 1;
+	}
+	WinDraw_Pipe = pp;
+	return pp;
+}
+
+static void WinDraw_RunPipe(const WDP_STEP *s, int palonly)
+{
+	static int s_text_fallback_log_count = 0;
+
+	for (;; s++) {
+		switch (s->op) {
+		case WDP_END:
+			return;
+		case WDP_GRP16:    Grp_DrawLine16(); break;
+		case WDP_GRP16SP:  Grp_DrawLine16SP(); break;
+		case WDP_GRP8:     Grp_DrawLine8(s->a, s->b); break;
+		case WDP_GRP8SP:   Grp_DrawLine8SP(s->a); break;
+		case WDP_GRP8TR:   Grp_DrawLine8TR(s->a, s->b); break;
+		case WDP_GRP4:     Grp_DrawLine4(s->a, s->b); break;
+		case WDP_GRP4SP:   Grp_DrawLine4SP(s->a); break;
+		case WDP_GRP4TR:   Grp_DrawLine4TR(s->a, s->b); break;
+		case WDP_GRP4H:    Grp_DrawLine4h(); break;
+		case WDP_GRP4HSP:  Grp_DrawLine4hSP(); break;
+		case WDP_TEXT:     Text_DrawLine_C(s->a); break;
+		case WDP_BG:
+			VLINEBG = BG_LineFromVLine(VLINE);
+			BG_DrawLineCached(s->a, s->b, palonly);
+			BG_SwapBuffers(); // フレーム描画完了後にバッファスワップ
+			Grp_SwapBuffers(); // グラフィックプレーン用バッファスワップ
+			break;
+		case WDP_BGFILL:   WinDraw_FillBGLine(s->a ? TextPal[0] : 0); break;
+		case WDP_CLRTR:    ZeroMemory(Text_TrFlag + 16, TextDotX); break;
+		case WDP_GRPLINE:  WinDraw_DrawGrpLine(s->a); break;
+		case WDP_GRPNSP:   WinDraw_DrawGrpLineNonSP(s->a); break;
+		case WDP_TEXTLINE: WinDraw_DrawTextLine(s->a, s->b); break;
+		case WDP_TEXTTR:   WinDraw_DrawTextLineTR(s->a); break;
+		case WDP_BGLINE:   WinDraw_DrawBGLine(s->a, s->b); break;
+		case WDP_BGTR:     WinDraw_DrawBGLineTR(s->a); break;
+		case WDP_PRI:      WinDraw_DrawPriLine(); break;
+		case WDP_HALF:     WinDraw_DrawHalfLine(); break;
+		case WDP_FALLBACK:
+			Text_DrawLine_C(1);
+			WinDraw_DrawTextLine(1, 1);
+			if (s_text_fallback_log_count < 8) {
+				p6logd("DRAW_FALLBACK_TEXT VLINE=%u VCReg2[1]=%02X\n",
+				       (unsigned int)VLINE,
+				       (unsigned int)VCReg2[1]);
+				s_text_fallback_log_count++;
+			}
+			break;
+		case WDP_BLANK:
+			memset(&ScrBuf[VLINE*SCRBUF_STRIDE], 0, TextDotX * 2);
+			break;
+		}
+	}
+}
+
+// このラインを描くならフラグを落として1を返す
+static int WinDraw_BeginLine(int *palonly)
+{
+//@    printf("%d\n", VLINE);
+    if((signed int)VLINE<0 )return 0; //@GOROman
+    // Never scan outside the buffer: lines past the row count and lines
+    // wider than the stride are dropped (the timing model flags such
+    // register settings as invalid).
+    if (VLINE >= SCRBUF_LINES) return 0;
+    if (TextDotX > SCRBUF_STRIDE) return 0;
+
+	if (!TextDirtyLine[VLINE]) return 0;
+	*palonly = !(TextDirtyLine[VLINE] & TDL_FULL);
+	TextDirtyLine[VLINE] = 0;
+	Draw_DrawFlag = 1;
+	Scrbuf_NoteLine(VLINE, TextDotX);
+	return 1;
+}
+
+void WinDraw_DrawLine(void)
+{
+	int palonly;
+
+	if (WinDraw_BeginLine(&palonly))
+		WinDraw_RunPipe(WinDraw_GetPipe()->step, palonly);
+}
+
+// -----------------------------------------------------------------------
+//   ラインのまとめ描画
+// -----------------------------------------------------------------------
+// メインループはラインをその場で描かずに WinDraw_QueueLine() で積んでおき、
+// 描画に効く状態が変わる直前（TVRAM/GVRAM/CRTC/パレット/VC/BG/システムポート
+// への書き込み、ラスタコピー、ストライドの切替え、フィールド終了）に
+// WinDraw_FlushLines() でまとめて描く。その間はレジスタが変わらないので、
+// 合成手順の取得は一回ですみ、各レイヤのコードもキャッシュに残ったまま回る。
+// 描き上がりは1ラインずつ描いた場合と同じ。
+
+int WinDraw_LinesPending = 0;
+int WinDraw_Measure = 0;
+DWORD WinDraw_DrawUs = 0;
+static DWORD WinDraw_LineQueue[SCRBUF_LINES];
+
+void WinDraw_FlushLines(void)
+{
+	DWORD vline = VLINE, t0 = 0;
+	int n = WinDraw_LinesPending, i, palonly;
+	const WDP_STEP *steps;
+
+	if (!n) return;
+	// 描画中に再入しないよう先に空にする
+	WinDraw_LinesPending = 0;
+	if (WinDraw_Measure)
+		t0 = FrameSkip_Now();
+	steps = WinDraw_GetPipe()->step;
+	for (i = 0; i < n; i++) {
+		VLINE = WinDraw_LineQueue[i];
+		if (WinDraw_BeginLine(&palonly))
+			WinDraw_RunPipe(steps, palonly);
 	}
+	VLINE = vline;
+	if (WinDraw_Measure)
+		WinDraw_DrawUs += FrameSkip_Now() - t0;
+}
+
+void WinDraw_QueueLine(void)
+{
+	if (VLINE >= SCRBUF_LINES || !TextDirtyLine[VLINE]) return;
+	if (WinDraw_LinesPending == SCRBUF_LINES)
+		WinDraw_FlushLines();
+	WinDraw_LineQueue[WinDraw_LinesPending++] = VLINE;
 }
@@ -22,6 +22,13 @@ void FASTCALL WinDraw_Draw(unsigned char* data);
 int X68000_GetImageInto(unsigned char* data, unsigned long capacityBytes);
 void WinDraw_ShowMenu(int flag);
 void WinDraw_DrawLine(void);
+void WinDraw_QueueLine(void);
+void WinDraw_FlushLines(void);
+extern int WinDraw_LinesPending;
+// 描画に効く状態を書き換える関数が先頭で呼ぶ。溜めてあるラインを書き換え前の状態で描く
+#define WinDraw_FlushPending()	do { if (WinDraw_LinesPending) WinDraw_FlushLines(); } while (0)
+extern int WinDraw_Measure;
+extern DWORD WinDraw_DrawUs;
 void WinDraw_ChangeSize(void);
 
 void WinDraw_StartupScreen(void);
@@ -1,5 +1,6 @@
 #ifdef  __cplusplus
 #include <atomic>
+#include "opm.h"
 
 extern "C" {
 #endif
@@ -18,12 +19,12 @@ extern "C" {
 #include "winx68k.h"
 #include "windraw.h"
 #include "scrbuf.h"
+#include "frameskip.h"
 //#include "winui.h"
 #include "../x68k/m68000.h" // xxx ����Ϥ����줤��ʤ��ʤ�Ϥ�
 #include "../m68000/m68000.h"
 #include "../x68k/x68kmemory.h"
 #include "mfp.h"
-#include "opm.h"
 #include "bg.h"
 #include "adpcm.h"
 //#include "mercury.h"
@@ -85,6 +86,9 @@ DWORD    vline = 0;
 
 
 BYTE DispFrame = 0;
+// Set while X68000_RenderAudio runs: WinX68k_Exec emulates the field but
+// composites nothing, whatever Config.FrameRate says.
+static int NoComposite = 0;
 
 unsigned int hTimerID = 0;
 DWORD TimerICount = 0;
@@ -98,10 +102,9 @@ BYTE ForceDebugMode = 0;
 DWORD skippedframes = 0;
 
 static int ClkUsed = 0;
-static int FrameSkipCount = 0;
 static CrtcFieldClock FieldClock10M;
 int hclk_line = 0;   // see winx68k.h
-static int FrameSkipQueue = 0;
+static FrameSkipState FrameSkip;
 static int g_storage_bus_mode = 0; // 0 = SASI, 1 = SCSI image, 2 = SCSI-U
 static unsigned char SASI_IPLROM[0x20000] = {0};
 static int SASI_IPLROM_loaded = 0;
@@ -516,8 +519,7 @@ WinX68k_Reset(void)
         skippedframes = 0;
 
         ClkUsed = 0;
-        FrameSkipCount = 0;
-        FrameSkipQueue = 0;
+        FrameSkip_Reset(&FrameSkip);
         g_scsi_link_scan_slice_count = 0;
     }
     
@@ -815,29 +817,22 @@ void WinX68k_Exec(const long clockMHz, const long vsync)
     CrtcScanMode scan_mode = CRTC_SCAN_NORMAL;
     CrtcRasterMap scan_map = { 0, 0 };
     int KeyIntCnt = 0, MouseIntCnt = 0;
-    DWORD t_start = timeGetTime(), t_end;
+    // Auto frame skip needs the compositing share of the field.
+    const int measure = (!NoComposite && Config.FrameRate == 7);
+    DWORD t_start = measure ? FrameSkip_Now() : 0;
 
     // Minimal debug for now
     (void)clockMHz; // suppress unused warning
 
-    if ( Config.FrameRate != 7 ) {
+    if ( NoComposite ) {
+        DispFrame = 1;
+    } else if ( Config.FrameRate != 7 ) {
         DispFrame = (DispFrame+1)%Config.FrameRate;
     } else {                // Auto Frame Skip
-        if ( FrameSkipQueue ) {
-            if ( FrameSkipCount>15 ) {
-                FrameSkipCount = 0;
-                FrameSkipQueue++;
-                DispFrame = 0;
-            } else {
-                FrameSkipCount++;
-                FrameSkipQueue--;
-                DispFrame = 1;
-            }
-        } else {
-            FrameSkipCount = 0;
-            DispFrame = 0;
-        }
+        DispFrame = (BYTE)FrameSkip_Decide(&FrameSkip);
     }
+    WinDraw_Measure = measure;
+    WinDraw_DrawUs = 0;
 
     if (CRTC_BeginField()) {
         // Rows from a non-interlaced image are not the missing parity of an
@@ -846,7 +841,8 @@ void WinX68k_Exec(const long clockMHz, const long vsync)
         Scrbuf_Clear();
         TVRAM_SetAllDirty();
         Draw_DrawFlag = 1;
-        DispFrame = 0;
+        if (!NoComposite)
+            DispFrame = 0;
     }
 
     vline = 0;
@@ -1006,8 +1002,11 @@ void WinX68k_Exec(const long clockMHz, const long vsync)
             // Interlace must render every field. Applying the ordinary
             // every-N-fields frame skip would repeatedly select the same
             // parity when N is even and leave half of the weave stale.
-            if (scan_map.draw && (!DispFrame || scan_mode == CRTC_SCAN_INTERLACE))
-                WinDraw_DrawLine();
+            // Lines are queued and composited in runs; the queue is flushed
+            // before any write that changes what they would show.
+            if (scan_map.draw && !NoComposite &&
+                (!DispFrame || scan_mode == CRTC_SCAN_INTERLACE))
+                WinDraw_QueueLine();
 
             // Raster copy is level-controlled and runs after this raster's
             // display period, before the next raster's hsync.
@@ -1035,7 +1034,9 @@ void WinX68k_Exec(const long clockMHz, const long vsync)
         }
     } while ( vline<(DWORD)active_vline_total );
 
+    WinDraw_FlushLines();
     CRTC_EndField();
+    Scrbuf_EndField();
 
     if ( CRTC_Mode&2 ) {        // FastClr�ӥåȤ�Ĵ����PITAPAT��
         if ( CRTC_FastClr ) {    // FastClr=1 ��� CRTC_Mode&2 �ʤ� ��λ
@@ -1057,15 +1058,12 @@ void WinX68k_Exec(const long clockMHz, const long vsync)
 /*@GOROman
 */
     TimerICount += clk_total;
-    t_end = timeGetTime();
-    const int dt = (int)(t_end-t_start);
-    if (( dt>((CRTC_Regs[0x29]&0x10)?14:16) ) && ( vsync == 1 )) {
-        FrameSkipQueue += ((t_end-t_start)/((CRTC_Regs[0x29]&0x10)?14:16))+1;
-        if ( FrameSkipQueue>100 )
-            FrameSkipQueue = 100;
-    }
-    if ( FrameSkipQueue != 0 ) {
-        // printf("FrameSkipQueue:%d\n", FrameSkipQueue);
+    if (measure) {
+        // The field budget keeps the old 14ms/16ms split on the 31kHz bit.
+        FrameSkip_Account(&FrameSkip, FrameSkip_Now() - t_start, WinDraw_DrawUs,
+                          (CRTC_Regs[0x29]&0x10) ? 14000 : 16000,
+                          !DispFrame || scan_mode == CRTC_SCAN_INTERLACE,
+                          vsync == 1);
     }
 }
 
@@ -1305,6 +1303,37 @@ void X68000_Update( const long clockMHz, const bool vsync  ) {
 	Update(clockMHz, vsync);
 }
 
+// Offline audio render: runs fields fields back to back, without waiting
+// for the host timer, and writes their sound to path (see
+// DSound_StartCapture). The result depends only on the emulated clock, so
+// the same state and input give the same file at any speed. Call from the
+// thread that runs X68000_Update; GameScene does so headless when
+// X68_AUDIO_RENDER is set. Returns the fields run, or -1 if the files
+// could not be written.
+long X68000_RenderAudio( const char* path, const long clockMHz, const long fields, const int stems ) {
+	long i;
+
+	if (!DSound_StartCapture(path, stems))
+		return -1;
+	// Nobody looks at the screen meanwhile; the frame rate setting is the
+	// user's and stays as it is.
+	NoComposite = 1;
+	for (i = 0; i < fields; i++)
+		WinX68k_Exec(clockMHz, 0);
+	NoComposite = 0;
+	return DSound_StopCapture() ? fields : -1;
+}
+
+// Records every OPM register write with its emulated time to path, until
+// called again with NULL (see OPM_StartLog). tests/core/test_opm_replay
+// plays the file back. Call from the thread that runs X68000_Update.
+// Returns FALSE if the file could not be created or written.
+int X68000_LogOPM( const char* path ) {
+	if (!path)
+		return OPM_StopLog();
+	return OPM_StartLog(path);
+}
+
 
 void X68000_Key_Down( unsigned int vkcode ) {
     Keyboard_KeyDown(vkcode);
@@ -2172,16 +2201,18 @@ static void monitor_format_audio(char** cursor, int* remaining)
     memset(&state, 0, sizeof(state));
     DSound_GetMonitorState(&state);
     monitor_appendf(cursor, remaining,
-                    "AUDIO rate=%luHz direct=%u buffer=%ld data=%ld free=%ld read=%ld write=%ld lastCallback=%u refillCount=%u preCounter=%ld\n",
+                    "AUDIO rate=%luHz direct=%u buffer=%ld target=%ld data=%ld free=%ld read=%ld write=%ld lastCallback=%u underruns=%u dropped=%u preCounter=%ld\n",
                     state.ratebase,
                     state.directCallback,
                     state.bufferBytes,
+                    state.targetBytes,
                     state.dataBytes,
                     state.freeBytes,
                     state.readOffset,
                     state.writeOffset,
                     state.lastCallbackBytes,
-                    state.refillCount,
+                    state.underrunCount,
+                    state.droppedFrames,
                     state.preCounter);
 }
 
@@ -2322,7 +2353,7 @@ static void monitor_format_midi(char** cursor, int* remaining)
                     state.playing,
                     state.regHigh);
     monitor_appendf(cursor, remaining,
-                    "MIDI int enable=%02X flag=%02X vect=%02X vectorBase=%02X buffered=%u txFull=%d bufTimer=%ld R05=%02X swiftBuffer=%ld delay=%d/%d count=%d\n",
+                    "MIDI int enable=%02X flag=%02X vect=%02X vectorBase=%02X buffered=%u txFull=%d bufTimer=%ld R05=%02X swiftBuffer=%ld delay=%d/%d count=%d ring=%u dropped=%u\n",
                     state.intEnable,
                     state.intFlag,
                     state.intVect,
@@ -2334,7 +2365,9 @@ static void monitor_format_midi(char** cursor, int* remaining)
                     state.swiftBufferSize,
                     state.delayRead,
                     state.delayWrite,
-                    state.delayCount);
+                    state.delayCount,
+                    state.ringCount,
+                    state.ringDropped);
     monitor_appendf(cursor, remaining,
                     "MIDI timers G=%u/%ld M=%u/%ld\n",
                     (unsigned int)state.gTimerMax,
@@ -2415,11 +2448,11 @@ static void monitor_format_summary(char** cursor, int* remaining)
                     (unsigned int)TextDotY,
                     CRTC_Mode);
     monitor_appendf(cursor, remaining,
-                    "SUMMARY audio data=%ld free=%ld lastCallback=%u refillCount=%u adpcmPlaying=%d midiBuffered=%u\n",
+                    "SUMMARY audio data=%ld free=%ld lastCallback=%u underruns=%u adpcmPlaying=%d midiBuffered=%u\n",
                     audioState.dataBytes,
                     audioState.freeBytes,
                     audioState.lastCallbackBytes,
-                    audioState.refillCount,
+                    audioState.underrunCount,
                     adpcmState.playing,
                     (unsigned int)midiState.buffered);
     monitor_appendf(cursor, remaining,
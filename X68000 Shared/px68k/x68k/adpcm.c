@@ -11,13 +11,9 @@
 #include "pia.h"
 #include "adpcm.h"
 #include "dmac.h"
-#include "adpcm_optimized.h"
+#include "resample.h"
 
-// Forward declarations for optimized functions
-#if ADPCM_ENABLE_OPTIMIZATIONS
-static void ADPCM_InitTable_Optimized(void);
-static void ADPCM_WriteOne_Optimized(int val);
-#endif
+static void ADPCM_Flush(void);
 
 #define ADPCM_BufSize      96000
 #define ADPCMMAX           2047
@@ -26,10 +22,11 @@ static void ADPCM_WriteOne_Optimized(int val);
 
 #define OVERSAMPLEMUL      2
 
-#define INTERPOLATE(y, x)	\
-	(((((((-y[0]+3*y[1]-3*y[2]+y[3]) * x + FM_IPSCALE/2) / FM_IPSCALE \
-	+ 3 * (y[0]-2*y[1]+y[2])) * x + FM_IPSCALE/2) / FM_IPSCALE \
-	- 2*y[0]-3*y[1]+6*y[2]-y[3]) * x + 3*FM_IPSCALE) / (6*FM_IPSCALE) + y[1])
+// Block sizes of the decode/resample pass (ADPCM_Flush) and of the
+// filter pass (ADPCM_Update)
+#define ADPCM_NIBBLEBLOCK  1024
+#define ADPCM_RSBLOCK      4096
+#define ADPCM_MIXBLOCK     512
 
 static int ADPCM_VolumeShift = 65536;
 static const int index_shift[16] = {
@@ -37,7 +34,7 @@ static const int index_shift[16] = {
 	-1*16, -1*16, -1*16, -1*16, 2*16, 4*16, 6*16, 8*16 };
 static const int ADPCM_Clocks[8] = {
 	93750, 125000, 187500, 125000, 46875, 62500, 93750, 62500 };
-static int dif_table[49*16];
+#include "adpcm_tables.inc"
 static signed short ADPCM_BufR[ADPCM_BufSize];
 static signed short ADPCM_BufL[ADPCM_BufSize];
 
@@ -54,11 +51,24 @@ static long long ADPCM_PreCounter = 0;
 static int ADPCM_DmaReady = 0;
 static int ADPCM_DifBuf = 0;
 
+// Nibbles written since the last ADPCM_Flush, not yet decoded
+static BYTE ADPCM_Nibbles[ADPCM_NIBBLEBLOCK];
+static int ADPCM_NibbleCnt = 0;
+
+// Decoded samples; the first RESAMPLE_TAPS-1 are the tail of the previous block
+static short ADPCM_Hist[RESAMPLE_TAPS-1+ADPCM_NIBBLEBLOCK];
+static int ADPCM_HistFill = 1;
+// One converter per ADPCM_Clock setting, built on first use
+static Resampler ADPCM_Rs[8];
+
+// floor(x/(ADPCM_SampleRate/100)) == (x*ADPCM_RatioMul)>>ADPCM_RatioShift
+static unsigned long long ADPCM_RatioMul = 1;
+static int ADPCM_RatioShift = 0;
+
 
 static int ADPCM_Pan = 0x00;
 static int OldR = 0, OldL = 0;
 static int Outs[8];
-static int OutsIp[4];
 static int OutsIpR[4];
 static int OutsIpL[4];
 
@@ -98,35 +108,6 @@ void ADPCM_GetMonitorState(ADPCMMonitorState* state)
 	state->oldRight = OldR;
 }
 
-static void ADPCM_InitTable(void)
-{
-#if ADPCM_ENABLE_OPTIMIZATIONS && ADPCM_OPTIMIZATION_LEVEL >= 1
-	ADPCM_InitTable_Optimized();
-#endif
-
-	int step, n;
-	double val;
-	static int bit[16][4] =
-	{
-		{ 1, 0, 0, 0}, { 1, 0, 0, 1}, { 1, 0, 1, 0}, { 1, 0, 1, 1},
-		{ 1, 1, 0, 0}, { 1, 1, 0, 1}, { 1, 1, 1, 0}, { 1, 1, 1, 1},
-		{-1, 0, 0, 0}, {-1, 0, 0, 1}, {-1, 0, 1, 0}, {-1, 0, 1, 1},
-		{-1, 1, 0, 0}, {-1, 1, 0, 1}, {-1, 1, 1, 0}, {-1, 1, 1, 1}
-	};
-
-	for (step=0; step<=48; step++) {
-		val = floor(16.0 * pow ((double)1.1, (double)step));
-		for (n=0; n<16; n++) {
-			dif_table[step*16+n] = bit[n][0] *
-			   (int)(val   * bit[n][1] +
-				 val/2 * bit[n][2] +
-				 val/4 * bit[n][3] +
-				 val/8);
-		}
-	}
-}
-
-
 #define LimitMix(val) { \
 	if ( val > 0x7fff )      val = 0x7fff; \
 	else if ( val < -0x8000 ) val = -0x8000; \
@@ -151,110 +132,195 @@ void FASTCALL ADPCM_PreUpdate(DWORD clock)
 
 
 // -----------------------------------------------------------------------
-//   DSoundが指定してくる分だけバッファにデータを書き出す
+//   バッファからnフレーム取り出す
+//   空になったらDMAを起こす。それでも無ければ直前の値で埋める
 // -----------------------------------------------------------------------
-void FASTCALL ADPCM_Update(signed short *buffer, DWORD length, int rate, BYTE *pbsp, BYTE *pbep)
+static void ADPCM_Fetch(int *r, int *l, int n)
 {
-	int outs;
-	signed int outl, outr;
+	int i = 0, j;
 
-	if ( length<=0 ) return;
+	while ( i<n ) {
+		long avail;
 
-	while ( length ) {
-		if (buffer >= (signed short *)pbep) {
-			buffer = (signed short *)pbsp;
+		if ( (ADPCM_WrPtr==ADPCM_RdPtr)&&(!(DMA[3].CCR&0x40)) ) {
+			DMA_Exec(3);
+			ADPCM_Flush();
 		}
-		int tmpl, tmpr;
-
-	if ( (ADPCM_WrPtr==ADPCM_RdPtr)&&(!(DMA[3].CCR&0x40)) ) DMA_Exec(3);
-		if ( ADPCM_WrPtr!=ADPCM_RdPtr ) {
-			OldR = outr = ADPCM_BufL[ADPCM_RdPtr];
-			OldL = outl = ADPCM_BufR[ADPCM_RdPtr];
-			ADPCM_RdPtr++;
+		avail = ((ADPCM_WrPtr<ADPCM_RdPtr)?ADPCM_BufSize:ADPCM_WrPtr) - ADPCM_RdPtr;
+		if ( avail ) {
+			int run = (avail<n-i) ? (int)avail : n-i;
+			// BufL goes to the right output and BufR to the left, as it always has
+			const signed short *sr = &ADPCM_BufL[ADPCM_RdPtr];
+			const signed short *sl = &ADPCM_BufR[ADPCM_RdPtr];
+			for (j=0; j<run; j++) {
+				r[i+j] = sr[j];
+				l[i+j] = sl[j];
+			}
+			OldR = r[i+run-1];
+			OldL = l[i+run-1];
+			ADPCM_RdPtr += run;
 			if ( ADPCM_RdPtr>=ADPCM_BufSize ) ADPCM_RdPtr = 0;
+			i += run;
 		} else {
+			int run = 1;
 			// Fix: Output silence when no audio data is available
 			// to prevent periodic noise from old audio data
-			if ( !ADPCM_Playing ) {
-				outr = 0;
-				outl = 0;
-				OldR = 0;
-				OldL = 0;
-			} else {
-				outr = OldR;
-				outl = OldL;
+			if ( !ADPCM_Playing ) OldR = OldL = 0;
+			// With continuous mode set or the channel inactive no DMA_Exec
+			// can deliver data for the rest of this call
+			if ( (DMA[3].CCR&0x40)||(!(DMA[3].CSR&0x08)) ) run = n-i;
+			for (j=0; j<run; j++) {
+				r[i+j] = OldR;
+				l[i+j] = OldL;
 			}
+			i += run;
 		}
+	}
+}
 
-		if ( Config.Sound_LPF ) {
-			outr = (int)(outr*40*ADPCM_VolumeShift);
-			outs = (outr + Outs[3]*2 + Outs[2] + Outs[1]*157 - Outs[0]*61) >> 8;
-			Outs[2] = Outs[3];
-			Outs[3] = outr;
-			Outs[0] = Outs[1];
-			Outs[1] = outs;
-		} else {
-			outs = (int)(outr*ADPCM_VolumeShift);
-		}
 
-		OutsIpR[0] = OutsIpR[1];
-		OutsIpR[1] = OutsIpR[2];
-		OutsIpR[2] = OutsIpR[3];
-		OutsIpR[3] = outs;
-
-		if ( Config.Sound_LPF ) {
-			outl = (int)(outl*40*ADPCM_VolumeShift);
-			outs = (outl + Outs[7]*2 + Outs[6] + Outs[5]*157 - Outs[4]*61) >> 8;
-			Outs[6] = Outs[7];
-			Outs[7] = outl;
-			Outs[4] = Outs[5];
-			Outs[5] = outs;
-		} else {
-			outs = (int)(outl*ADPCM_VolumeShift);
+// -----------------------------------------------------------------------
+//   ぼりゅーむ＆LPF（x[4..4+n) をその場で処理）
+//   lpf: y[-2], y[-1], x[-2], x[-1]  ip: 補間用の直前4サンプル
+// -----------------------------------------------------------------------
+static void ADPCM_Filter(int *x, int n, int *lpf, int *ip)
+{
+	int i;
+
+	if ( Config.Sound_LPF ) {
+		int vol = 40*ADPCM_VolumeShift;
+		int y2 = lpf[0], y1 = lpf[1], x2 = lpf[2], x1 = lpf[3];
+		for (i=0; i<n; i++) {
+			int in = x[4+i]*vol;
+			int y = (in + x1*2 + x2 + y1*157 - y2*61) >> 8;
+			x2 = x1; x1 = in;
+			y2 = y1; y1 = y;
+			x[4+i] = y;
 		}
+		lpf[0] = y2; lpf[1] = y1; lpf[2] = x2; lpf[3] = x1;
+	} else {
+		int vol = ADPCM_VolumeShift;
+		for (i=0; i<n; i++)
+			x[4+i] *= vol;
+	}
 
-		OutsIpL[0] = OutsIpL[1];
-		OutsIpL[1] = OutsIpL[2];
-		OutsIpL[2] = OutsIpL[3];
-		OutsIpL[3] = outs;
-
-#if 1
-		tmpr = INTERPOLATE(OutsIpR, 0);
-		if ( tmpr>32767 ) tmpr = 32767; else if ( tmpr<(-32768) ) tmpr = -32768;
-		*(buffer++) = (short)tmpr;
-		tmpl = INTERPOLATE(OutsIpL, 0);
-		if ( tmpl>32767 ) tmpl = 32767; else if ( tmpl<(-32768) ) tmpl = -32768;
-		*(buffer++) = (short)tmpl;
-		// PSP以外はrateは0
-		if (rate == 22050) {
-			if (buffer >= (signed short *)pbep) {
-				buffer = (signed short *)pbsp;
-			}
-			*(buffer++) = (short)tmpr;
-			*(buffer++) = (short)tmpl;
-		} else if (rate == 11025) {
-			if (buffer >= (signed short *)pbep) {
-				buffer = (signed short *)pbsp;
+	memcpy(x, ip, sizeof(int)*4);
+	memcpy(ip, x+n, sizeof(int)*4);
+}
+
+
+// -----------------------------------------------------------------------
+//   入力0が続いたときにフィルタの状態がもう変わらないか
+//   LPFは (y1*157-y2*61)>>8 の切り捨てで0か-1に落ち着く。*cにその値
+// -----------------------------------------------------------------------
+static int ADPCM_Settled(const int *lpf, const int *ip, int *c)
+{
+	int v = 0;
+
+	if ( Config.Sound_LPF ) {
+		if ( lpf[2]||lpf[3]||(lpf[0]!=lpf[1])||(((lpf[1]*96)>>8)!=lpf[1]) ) return 0;
+		v = lpf[1];
+	}
+	if ( (ip[0]!=v)||(ip[1]!=v)||(ip[2]!=v)||(ip[3]!=v) ) return 0;
+	*c = v;
+	return 1;
+}
+
+
+// -----------------------------------------------------------------------
+//   DSoundが指定してくる分だけバッファにデータを書き出す
+// -----------------------------------------------------------------------
+void FASTCALL ADPCM_Update(signed short *buffer, DWORD length, int rate, BYTE *pbsp, BYTE *pbep)
+{
+	static int ipR[ADPCM_MIXBLOCK+4], ipL[ADPCM_MIXBLOCK+4];
+
+	if ( length<=0 ) return;
+
+	ADPCM_Flush();
+	while ( length ) {
+		int i, n = (length>ADPCM_MIXBLOCK) ? ADPCM_MIXBLOCK : (int)length;
+		int cr, cl;
+
+		// 停止中でバッファも空、DMAも来ない。フィルタが落ち着いていれば
+		// 残りは全部同じ値なので、まとめて埋めて終わり
+		if ( (!ADPCM_Playing)&&(ADPCM_WrPtr==ADPCM_RdPtr)&&((DMA[3].CCR&0x40)||(!(DMA[3].CSR&0x08)))
+		  && ADPCM_Settled(&Outs[0], OutsIpR, &cr) && ADPCM_Settled(&Outs[4], OutsIpL, &cl) ) {
+			int copies = (rate==11025) ? 4 : (rate==22050) ? 2 : 1;
+			DWORD cnt = length*copies;
+			OldR = OldL = 0;
+			while ( cnt ) {
+				DWORD run;
+				if (buffer >= (signed short *)pbep) {
+					buffer = (signed short *)pbsp;
+				}
+				run = (DWORD)((signed short *)pbep-buffer)/2;
+				if ( run>cnt ) run = cnt;
+				for (i=0; i<(int)run; i++) {
+					buffer[i*2] = (short)cr;
+					buffer[i*2+1] = (short)cl;
+				}
+				buffer += run*2;
+				cnt -= run;
 			}
-			*(buffer++) = (short)tmpr;
-			*(buffer++) = (short)tmpl;
-			if (buffer >= (signed short *)pbep) {
-				buffer = (signed short *)pbsp;
+			break;
+		}
+
+		ADPCM_Fetch(ipR+4, ipL+4, n);
+		ADPCM_Filter(ipR, n, &Outs[0], OutsIpR);
+		ADPCM_Filter(ipL, n, &Outs[4], OutsIpL);
+
+		// The output keeps the two-frame lag of the old interpolated
+		// path: ip[i+2] for frame i
+		if (buffer >= (signed short *)pbep) {
+			buffer = (signed short *)pbsp;
+		}
+		if ( (rate!=22050)&&(rate!=11025)&&(buffer+n*2<=(signed short *)pbep) ) {
+			for (i=0; i<n; i++) {
+				int tmpr = ipR[i+2], tmpl = ipL[i+2];
+				if ( tmpr>32767 ) tmpr = 32767; else if ( tmpr<(-32768) ) tmpr = -32768;
+				if ( tmpl>32767 ) tmpl = 32767; else if ( tmpl<(-32768) ) tmpl = -32768;
+				buffer[i*2] = (short)tmpr;
+				buffer[i*2+1] = (short)tmpl;
 			}
-			*(buffer++) = (short)tmpr;
-			*(buffer++) = (short)tmpl;
-			if (buffer >= (signed short *)pbep) {
-				buffer = (signed short *)pbsp;
+			buffer += n*2;
+		} else {
+			for (i=0; i<n; i++) {
+				int tmpr = ipR[i+2], tmpl = ipL[i+2];
+				if (buffer >= (signed short *)pbep) {
+					buffer = (signed short *)pbsp;
+				}
+				if ( tmpr>32767 ) tmpr = 32767; else if ( tmpr<(-32768) ) tmpr = -32768;
+				*(buffer++) = (short)tmpr;
+				if ( tmpl>32767 ) tmpl = 32767; else if ( tmpl<(-32768) ) tmpl = -32768;
+				*(buffer++) = (short)tmpl;
+				// PSP以外はrateは0
+				if (rate == 22050) {
+					if (buffer >= (signed short *)pbep) {
+						buffer = (signed short *)pbsp;
+					}
+					*(buffer++) = (short)tmpr;
+					*(buffer++) = (short)tmpl;
+				} else if (rate == 11025) {
+					if (buffer >= (signed short *)pbep) {
+						buffer = (signed short *)pbsp;
+					}
+					*(buffer++) = (short)tmpr;
+					*(buffer++) = (short)tmpl;
+					if (buffer >= (signed short *)pbep) {
+						buffer = (signed short *)pbsp;
+					}
+					*(buffer++) = (short)tmpr;
+					*(buffer++) = (short)tmpl;
+					if (buffer >= (signed short *)pbep) {
+						buffer = (signed short *)pbsp;
+					}
+					*(buffer++) = (short)tmpr;
+					*(buffer++) = (short)tmpl;
+				}
 			}
-			*(buffer++) = (short)tmpr;
-			*(buffer++) = (short)tmpl;
 		}
-#else
-		*(buffer++) = (short)OutsIpR[3];
-		*(buffer++) = (short)OutsIpL[3];
-#endif
 
-		length--;
+		length -= n;
 	}
 
 	ADPCM_DifBuf = (int)(ADPCM_WrPtr-ADPCM_RdPtr);
@@ -264,51 +330,119 @@ void FASTCALL ADPCM_Update(signed short *buffer, DWORD length, int rate, BYTE *p
 
 
 // -----------------------------------------------------------------------
-//   1nibble（4bit）をデコード
+//   1nibble（4bit）を溜める。デコードはADPCM_Flushでまとめて
 // -----------------------------------------------------------------------
 INLINE void ADPCM_WriteOne(int val)
 {
-#if ADPCM_ENABLE_OPTIMIZATIONS && ADPCM_OPTIMIZATION_LEVEL >= 1
-	ADPCM_WriteOne_Optimized(val);
-	return;
-#endif
-
-	ADPCM_Out += dif_table[ADPCM_Step+val];
-	if ( ADPCM_Out>ADPCMMAX ) ADPCM_Out = ADPCMMAX; else if ( ADPCM_Out<ADPCMMIN ) ADPCM_Out = ADPCMMIN;
-	
-	ADPCM_Step += index_shift[val];
-	if ( ADPCM_Step>(48*16) ) ADPCM_Step = (48*16); else if ( ADPCM_Step<0 ) ADPCM_Step = 0;
-
-	if ( OutsIp[0]==-1 ) {
-		OutsIp[0] =
-		OutsIp[1] =
-		OutsIp[2] =
-		OutsIp[3] = ADPCM_Out;
-	} else {
-		OutsIp[0] = OutsIp[1];
-		OutsIp[1] = OutsIp[2];
-		OutsIp[2] = OutsIp[3];
-		OutsIp[3] = ADPCM_Out;
+	ADPCM_Nibbles[ADPCM_NibbleCnt++] = (BYTE)val;
+	if ( ADPCM_NibbleCnt>=ADPCM_NIBBLEBLOCK ) ADPCM_Flush();
+}
+
+
+// -----------------------------------------------------------------------
+//   リサンプル結果をパンに従ってバッファへ
+// -----------------------------------------------------------------------
+static void ADPCM_Store(const signed short *p, int n)
+{
+	while ( n>0 ) {
+		int run = ADPCM_BufSize-ADPCM_WrPtr;
+		if ( run>n ) run = n;
+		if ( !(ADPCM_Pan&1) )
+			memcpy(&ADPCM_BufR[ADPCM_WrPtr], p, run*sizeof(short));
+		else
+			memset(&ADPCM_BufR[ADPCM_WrPtr], 0, run*sizeof(short));
+		if ( !(ADPCM_Pan&2) )
+			memcpy(&ADPCM_BufL[ADPCM_WrPtr], p, run*sizeof(short));
+		else
+			memset(&ADPCM_BufL[ADPCM_WrPtr], 0, run*sizeof(short));
+		ADPCM_WrPtr += run;
+		if ( ADPCM_WrPtr>=ADPCM_BufSize ) ADPCM_WrPtr = 0;
+		p += run;
+		n -= run;
 	}
+}
 
-	while ( ADPCM_SampleRate>ADPCM_Count ) {
-		if ( ADPCM_Playing ) {
-			int ratio = (((ADPCM_Count/100)*FM_IPSCALE)/(ADPCM_SampleRate/100));
-			int tmp = INTERPOLATE(OutsIp, ratio);
-			if ( tmp>ADPCMMAX ) tmp = ADPCMMAX; else if ( tmp<ADPCMMIN ) tmp = ADPCMMIN;
-			if ( !(ADPCM_Pan&1) )
-				ADPCM_BufR[ADPCM_WrPtr] = (short)tmp;
-			else
-				ADPCM_BufR[ADPCM_WrPtr] = 0;
-			if ( !(ADPCM_Pan&2) )
-				ADPCM_BufL[ADPCM_WrPtr++] = (short)tmp;
-			else
-				ADPCM_BufL[ADPCM_WrPtr++] = 0;
-			if ( ADPCM_WrPtr>=ADPCM_BufSize ) ADPCM_WrPtr = 0;
+
+// -----------------------------------------------------------------------
+//   溜まったnibbleをデコードしてリサンプル
+//   1) デコード（逐次）→ ADPCM_Hist
+//   2) 出力サンプルごとの元nibbleと補間位置
+//   3) 帯域制限フィルタで補間 (resample.c)
+//   4) バッファへ
+//   nibbleを受け取ったのと同じ順・同じ状態で処理するので、結果は
+//   1nibbleずつ処理した場合と同じ。状態が変わる前には必ず呼ぶこと
+// -----------------------------------------------------------------------
+static void ADPCM_Flush(void)
+{
+	static int src[ADPCM_RSBLOCK];
+	static int ratio[ADPCM_RSBLOCK];
+	static signed short outs[ADPCM_RSBLOCK];
+	short *hist = ADPCM_Hist+RESAMPLE_TAPS-1;
+	Resampler *rs = &ADPCM_Rs[ADPCM_Clock&7];
+	int n = ADPCM_NibbleCnt, i, j, k;
+	int maxout = (int)(ADPCM_SampleRate/ADPCM_ClockRate) + 1;
+
+	if ( !n ) return;
+	ADPCM_NibbleCnt = 0;
+
+	if ( (rs->inrate!=ADPCM_ClockRate)||(rs->outrate!=ADPCM_SampleRate) )
+		Resample_Init(rs, ADPCM_ClockRate, ADPCM_SampleRate);
+
+	for (i=0; i<n; i++) {
+		int val = ADPCM_Nibbles[i];
+		ADPCM_Out += dif_table[ADPCM_Step+val];
+		if ( ADPCM_Out>ADPCMMAX ) ADPCM_Out = ADPCMMAX; else if ( ADPCM_Out<ADPCMMIN ) ADPCM_Out = ADPCMMIN;
+
+		ADPCM_Step += index_shift[val];
+		if ( ADPCM_Step>(48*16) ) ADPCM_Step = (48*16); else if ( ADPCM_Step<0 ) ADPCM_Step = 0;
+
+		hist[i] = (short)ADPCM_Out;
+		if ( ADPCM_HistFill ) {
+			// 再生開始直後は最初の値で履歴を埋める（0からの立ち上がりを出さない）
+			for (j=1; j<RESAMPLE_TAPS; j++) hist[i-j] = (short)ADPCM_Out;
+			ADPCM_HistFill = 0;
 		}
-		ADPCM_Count += ADPCM_ClockRate;
 	}
-	ADPCM_Count -= ADPCM_SampleRate;
+
+	// WriteOneは再生中しか呼ばれず、ADPCM_Playingが変わる前にはFlushされる
+	i = 0;
+	while ( i<n ) {
+		for (k=0; (i<n)&&(k+maxout<=ADPCM_RSBLOCK); i++) {
+			while ( ADPCM_SampleRate>ADPCM_Count ) {
+				int x = (int)((((ADPCM_Count/100)*FM_IPSCALE)*ADPCM_RatioMul)>>ADPCM_RatioShift);
+				src[k] = i;
+				ratio[k] = (x<RESAMPLE_PHASES) ? x : RESAMPLE_PHASES-1;
+				k++;
+				ADPCM_Count += ADPCM_ClockRate;
+			}
+			ADPCM_Count -= ADPCM_SampleRate;
+		}
+
+		Resample_Gather(rs, hist, src, ratio, outs, k);
+		for (j=0; j<k; j++) {
+			if ( outs[j]>ADPCMMAX ) outs[j] = ADPCMMAX; else if ( outs[j]<ADPCMMIN ) outs[j] = ADPCMMIN;
+		}
+
+		ADPCM_Store(outs, k);
+	}
+
+	memmove(ADPCM_Hist, ADPCM_Hist+n, (RESAMPLE_TAPS-1)*sizeof(short));
+}
+
+
+// -----------------------------------------------------------------------
+//   補間位置の割り算 (ADPCM_Count/100)*FM_IPSCALE/(ADPCM_SampleRate/100) を掛け算に
+//   x < 2^23 の範囲で割り算と一致する
+// -----------------------------------------------------------------------
+static void ADPCM_InitRatio(void)
+{
+	DWORD d = ADPCM_SampleRate/100;
+	int l = 0;
+
+	if ( !d ) d = 1;
+	while ( (1UL<<l)<d ) l++;
+	ADPCM_RatioShift = 23+l;
+	ADPCM_RatioMul = ((1ULL<<ADPCM_RatioShift)+d-1)/d;
 }
 
 
@@ -318,6 +452,7 @@ INLINE void ADPCM_WriteOne(int val)
 void FASTCALL ADPCM_Write(DWORD adr, BYTE data)
 {
 	if ( adr==0xe92001 ) {
+		ADPCM_Flush();
 		if ( data&1 ) {
 			ADPCM_Playing = 0;
 			// Original behavior: only clear last outputs to avoid clicks
@@ -339,7 +474,7 @@ void FASTCALL ADPCM_Write(DWORD adr, BYTE data)
 				ADPCM_DifBuf = 0;
 				ADPCM_RdPtr = ADPCM_WrPtr;
 			}
-			OutsIp[0] = OutsIp[1] = OutsIp[2] = OutsIp[3] = -1;
+			ADPCM_HistFill = 1;
 		}
 	} else if ( adr==0xe92003 ) {
 		if ( ADPCM_Playing ) {
@@ -382,6 +517,7 @@ void ADPCM_SetVolume(BYTE vol)
 // -----------------------------------------------------------------------
 void ADPCM_SetPan(int n)
 {
+	ADPCM_Flush();
 	if ( (ADPCM_Pan&0x0c)!=(n&0x0c) ) {
 		ADPCM_Count = 0;
 		ADPCM_Clock = (ADPCM_Clock&4)|((n>>2)&3);
@@ -398,6 +534,7 @@ void ADPCM_SetPan(int n)
 // -----------------------------------------------------------------------
 void ADPCM_SetClock(int n)
 {
+	ADPCM_Flush();
 	if ( (ADPCM_Clock&4)!=n ) {
 		ADPCM_Count = 0;
 		ADPCM_Clock = n|((ADPCM_Pan>>2)&3);
@@ -420,20 +557,16 @@ void ADPCM_Init(DWORD samplerate)
 	ADPCM_Playing = 0;
 	ADPCM_Count = 0;
 	ADPCM_SampleRate = (samplerate*12);
+	ADPCM_InitRatio();
 	ADPCM_PreCounter = 0;
 	ADPCM_DmaReady = 0;
 	ADPCM_DifBuf = 0;
+	ADPCM_NibbleCnt = 0;
 	memset(Outs, 0, sizeof(Outs));
-	OutsIp[0] = OutsIp[1] = OutsIp[2] = OutsIp[3] = -1;
+	ADPCM_HistFill = 1;
 	OutsIpR[0] = OutsIpR[1] = OutsIpR[2] = OutsIpR[3] = 0;
 	OutsIpL[0] = OutsIpL[1] = OutsIpL[2] = OutsIpL[3] = 0;
 	OldL = OldR = 0;
 
 	ADPCM_SetPan(0x0b);
-	ADPCM_InitTable();
 }
-
-// Include optimized implementations
-#if ADPCM_ENABLE_OPTIMIZATIONS
-#include "adpcm_optimized_safe.c"
-#endif
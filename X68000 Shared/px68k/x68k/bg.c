@@ -35,12 +35,12 @@
 	BYTE	BGCHR8[8*8*256];
 	BYTE	BGCHR16[16*16*256];
 
-	WORD	BG_LineBuf[1600];
-	WORD	BG_PriBuf[1600];
+	WORD	BG_LineBuf[BG_LINEBUF_WIDTH];
+	WORD	BG_PriBuf[BG_LINEBUF_WIDTH];
 
 	// ダブルバッファリング用バッファ
-	WORD	BG_LineBuf_Back[1600];	// バックバッファ（描画用）
-	WORD	BG_PriBuf_Back[1600];	// バックバッファ（優先度用）
+	WORD	BG_LineBuf_Back[BG_LINEBUF_WIDTH];	// バックバッファ（描画用）
+	WORD	BG_PriBuf_Back[BG_LINEBUF_WIDTH];	// バックバッファ（優先度用）
 	
 	// 現在のアクティブバッファを示すポインタ
 	WORD	*BG_LineBuf_Active = BG_LineBuf_Back;	// 表示用アクティブバッファ（初期は同一バッファ）
@@ -52,6 +52,245 @@
 
 	DWORD	VLINEBG = 0;
 
+// スプライトのライン別バケット
+// Sprite_DrawLineMcr で描画対象になるのは、l = VLINEBG-BG_VLINE+16 が
+// [posy, posy+15] に入るスプライトだけ。そこで l（0〜1038）ごとに掛かっている
+// スプライト番号を 128bit のビットマスクで持っておき、描画時は上位ビット
+// （番号の大きい方）から取り出す。全スプライトを逆順に舐めていた時と同じ順になる。
+// Y座標の書き換えは必ず BG_Write を通るので、そこで差分更新する。
+#define	SPRITE_BUCKETS	(1024+16)
+static	DWORD	Sprite_LineMask[SPRITE_BUCKETS][4];
+static	DWORD	Sprite_PatMask[256][4];		// 16x16パターン番号 → 使っているスプライト
+
+INLINE WORD Sprite_PosY(int n)
+{
+	// Sprite_Regs[] is little endian
+	return *(WORD *)(Sprite_Regs + (n << 3) + 2) & 0x3ff;
+}
+
+static void Sprite_SetBucket(int n, DWORD posy, int on)
+{
+	DWORD *p = &Sprite_LineMask[posy][n >> 5];
+	DWORD bit = 1u << (n & 31);
+	int i;
+
+	for (i = 0; i < 16; i++, p += 4) {
+		if (on)
+			*p |= bit;
+		else
+			*p &= ~bit;
+	}
+}
+
+static void Sprite_RebuildBuckets(void)
+{
+	int n;
+
+	ZeroMemory(Sprite_LineMask, sizeof(Sprite_LineMask));
+	ZeroMemory(Sprite_PatMask, sizeof(Sprite_PatMask));
+	for (n = 0; n < 128; n++) {
+		Sprite_SetBucket(n, Sprite_PosY(n), 1);
+		Sprite_PatMask[Sprite_Regs[(n << 3) + 4]][n >> 5] |= 1u << (n & 31);
+	}
+}
+
+// -----------------------------------------------------------------------
+//   PCG／マップ書き換え時のダーティライン
+// -----------------------------------------------------------------------
+// パターンやマップの1バイトが変わっても、それを表示しているラインは一部だけ。
+// 全ライン再描画（TVRAM_SetAllDirty）を避けるため、次の逆引きを持つ。
+//   BG_PatRowCount : マップ領域（0x4000/0x6000）の各行で、パターン番号を参照
+//                    しているセルの数（マップ書き込み時に差分更新）
+//   Sprite_PatMask : 16x16パターン番号を使っているスプライト（上で更新）
+//   BG_RowLines    : BG0/BG1 の各マップ行を表示している画面ライン
+//   BG_SprLineFirst/Last : スプライトの l 値（上記）を表示している画面ライン
+// 下の2つはスクロールや画面モードで変わるので、キーが変わった時に作り直す。
+static	BYTE	BG_PatRowCount[2][256][64];
+static	DWORD	BG_RowLines[2][64][32];
+static	WORD	BG_SprLineFirst[SPRITE_BUCKETS];
+static	WORD	BG_SprLineLast[SPRITE_BUCKETS];
+static	DWORD	BG_LineIndexKey[5];
+static	int		BG_LineIndexValid = 0;
+
+static void BG_RebuildPatRows(void)
+{
+	DWORD adr;
+
+	ZeroMemory(BG_PatRowCount, sizeof(BG_PatRowCount));
+	for (adr = 0x4001; adr < 0x8000; adr += 2)
+		BG_PatRowCount[(adr >> 13) & 1][BG[adr]][(adr >> 7) & 63]++;
+}
+
+// 画面ライン（VLINE）に対応するBGのライン（VLINEBG）
+DWORD FASTCALL BG_LineFromVLine(DWORD vline)
+{
+	DWORD line;
+	int s1, s2;
+
+	s1 = (((BG_Regs[0x11]  &4)?2:1)-((BG_Regs[0x11]  &16)?1:0));
+	s2 = (((CRTC_Regs[0x29]&4)?2:1)-((CRTC_Regs[0x29]&16)?1:0));
+	line = vline;
+	line <<= s1;
+	line >>= s2;
+	if ( !(BG_Regs[0x11]&16) ) line -= ((BG_Regs[0x0f]>>s1)-(CRTC_Regs[0x0d]>>s2));
+	return line;
+}
+
+static void BG_UpdateLineIndex(void)
+{
+	DWORD key[5];
+	DWORD vline, line, l, row;
+	DWORD mask;
+	int sh, k;
+
+	key[0] = CRTC_Regs[0x29] | (CRTC_Regs[0x0d] << 8) | (BG_Regs[0x0f] << 16) | (BG_Regs[0x11] << 24);
+	key[1] = (DWORD)BG_VLINE;
+	key[2] = BG0ScrollY;
+	key[3] = BG1ScrollY;
+	key[4] = BG_CHRSIZE;
+	if (BG_LineIndexValid && !memcmp(key, BG_LineIndexKey, sizeof(key)))
+		return;
+	memcpy(BG_LineIndexKey, key, sizeof(key));
+	BG_LineIndexValid = 1;
+
+	ZeroMemory(BG_RowLines, sizeof(BG_RowLines));
+	memset(BG_SprLineFirst, 0xff, sizeof(BG_SprLineFirst));
+	memset(BG_SprLineLast, 0xff, sizeof(BG_SprLineLast));
+
+	// bg_drawline_loop と同じ行の求め方
+	mask = (BG_CHRSIZE == 8) ? 0x1f8 : 0x3f0;
+	sh = (BG_CHRSIZE == 8) ? 3 : 4;
+
+	for (vline = 0; vline < 1024; vline++) {
+		line = BG_LineFromVLine(vline);
+		for (k = 0; k < 2; k++) {
+			row = (((k ? BG1ScrollY : BG0ScrollY) + line - BG_VLINE) & mask) >> sh;
+			BG_RowLines[k][row][vline >> 5] |= 1u << (vline & 31);
+		}
+		// Sprite_DrawLineMcr の l と同じ
+		l = (DWORD)(line - BG_VLINE + 16);
+		if (l < SPRITE_BUCKETS) {
+			if (BG_SprLineFirst[l] == 0xffff)
+				BG_SprLineFirst[l] = (WORD)vline;
+			BG_SprLineLast[l] = (WORD)vline;
+		}
+	}
+}
+
+static void BG_SetRowDirty(int plane, DWORD row)
+{
+	const DWORD *p = BG_RowLines[plane][row];
+	DWORD m;
+	int w;
+
+	for (w = 0; w < 32; w++)
+		for (m = p[w]; m; m &= m - 1)
+			TextDirtyLine[(w << 5) + __builtin_ctz(m)] = 1;
+}
+
+static void BG_SetSpriteDirty(int n)
+{
+	DWORD l, i, posy;
+
+	posy = Sprite_PosY(n);
+	for (l = posy; l < posy + 16; l++) {
+		if (BG_SprLineFirst[l] == 0xffff)
+			continue;
+		for (i = BG_SprLineFirst[l]; i <= BG_SprLineLast[l]; i++)
+			TextDirtyLine[i] = 1;
+	}
+}
+
+// マップ領域 region（0:0x4000〜, 1:0x6000〜）を表示しているBG面
+INLINE int BG_PlaneShowsRegion(int plane, int region)
+{
+	WORD top = plane ? BG_BG1TOP : BG_BG0TOP;
+	return top == (WORD)(0x4000 + (region << 13));
+}
+
+// パターンデータの書き込み
+// 描画側は BG_CHREND に関係なく BGCHR8/BGCHR16 を引くので、マップ領域への
+// 書き込みもパターンの書き換えとして扱う。
+static void BG_SetPatternDirty(DWORD adr)
+{
+	DWORD pat, row, m;
+	int plane, region, w;
+
+	BG_UpdateLineIndex();
+
+	// スプライトは常に16x16
+	for (w = 0; w < 4; w++) {
+		for (m = Sprite_PatMask[adr >> 7][w]; m; m &= m - 1) {
+			int n = (w << 5) + __builtin_ctz(m);
+			if (Sprite_Regs[(n << 3) + 6] & 3)
+				BG_SetSpriteDirty(n);
+		}
+	}
+
+	if (BG_CHRSIZE == 8) {
+		if (adr >= 0x2000)
+			return;
+		pat = adr >> 5;
+	} else
+		pat = adr >> 7;
+	for (plane = 0; plane < 2; plane++) {
+		for (region = 0; region < 2; region++) {
+			if (!BG_PlaneShowsRegion(plane, region))
+				continue;
+			for (row = 0; row < 64; row++)
+				if (BG_PatRowCount[region][pat][row])
+					BG_SetRowDirty(plane, row);
+		}
+	}
+}
+
+// マップエリアの書き込み
+static void BG_SetMapDirty(DWORD adr)
+{
+	int plane;
+
+	BG_UpdateLineIndex();
+	for (plane = 0; plane < 2; plane++)
+		if (BG_PlaneShowsRegion(plane, (adr >> 13) & 1))
+			BG_SetRowDirty(plane, (adr >> 7) & 63);
+}
+
+
+// -----------------------------------------------------------------------
+//   展開済みBGライン
+// -----------------------------------------------------------------------
+// BG面の1ライン（BG座標）分をマップとパターンから色番号（パレットブロック込み）
+// に展開して持っておく。描画はスクロール位置から窓を切り出すだけなので、
+// スクロールレジスタしか変わっていないフィールドではパターン展開が要らない。
+// キーはマップ領域（0x4000/0x6000）とラインで、中身はパターン・マップ・
+// BG_CHRSIZE だけで決まる。表示中かどうかに関係なく書き込みで無効化する。
+static	BYTE	BG_RowCache[2][1024][1024];
+static	BYTE	BG_RowValid[2][1024];
+
+INLINE void BG_InvalidateRow(int region, DWORD row)
+{
+	memset(&BG_RowValid[region][row * BG_CHRSIZE], 0, BG_CHRSIZE);
+}
+
+static void BG_InvalidateRows(DWORD adr)
+{
+	DWORD pat, row;
+	int region;
+
+	if (adr >= 0x4000)
+		BG_InvalidateRow((adr >> 13) & 1, (adr >> 7) & 63);
+	if (BG_CHRSIZE == 8) {
+		if (adr >= 0x2000)
+			return;
+		pat = adr >> 5;
+	} else
+		pat = adr >> 7;
+	for (region = 0; region < 2; region++)
+		for (row = 0; row < 64; row++)
+			if (BG_PatRowCount[region][pat][row])
+				BG_InvalidateRow(region, row);
+}
+
 
 // -----------------------------------------------------------------------
 //   初期化
@@ -60,15 +299,18 @@ void BG_Init(void)
 {
 	DWORD i;
 	ZeroMemory(Sprite_Regs, 0x800);
+	Sprite_RebuildBuckets();
 	ZeroMemory(BG, 0x8000);
+	BG_RebuildPatRows();
+	ZeroMemory(BG_RowValid, sizeof(BG_RowValid));
 	ZeroMemory(BGCHR8, 8*8*256);
 	ZeroMemory(BGCHR16, 16*16*256);
-	ZeroMemory(BG_LineBuf, 1600*2);
+	ZeroMemory(BG_LineBuf, sizeof(BG_LineBuf));
 	
 	// ダブルバッファリング用バッファも初期化
-	ZeroMemory(BG_LineBuf_Back, 1600*2);
-	memset(BG_PriBuf, 0xff, 1600*2);  // 優先度バッファは最低値で初期化
-	memset(BG_PriBuf_Back, 0xff, 1600*2);
+	ZeroMemory(BG_LineBuf_Back, sizeof(BG_LineBuf_Back));
+	memset(BG_PriBuf, 0xff, sizeof(BG_PriBuf));  // 優先度バッファは最低値で初期化
+	memset(BG_PriBuf_Back, 0xff, sizeof(BG_PriBuf_Back));
 	
 	for (i=0; i<0x12; i++)
 		BG_Write(0xeb0800+i, 0);
@@ -102,16 +344,19 @@ BYTE FASTCALL BG_Read(DWORD adr)
 void FASTCALL BG_Write(DWORD adr, BYTE data)
 {
 	DWORD bg16chr;
-	int s1, s2, v = 0;
-	s1 = (((BG_Regs[0x11]  &4)?2:1)-((BG_Regs[0x11]  &16)?1:0));
-	s2 = (((CRTC_Regs[0x29]&4)?2:1)-((CRTC_Regs[0x29]&16)?1:0));
-	if ( !(BG_Regs[0x11]&16) ) v = ((BG_Regs[0x0f]>>s1)-(CRTC_Regs[0x0d]>>s2));
+	WinDraw_FlushPending();
 	if ((adr>=0xeb0000)&&(adr<0xeb0400))
 	{
 		adr &= 0x3ff;
 		adr ^= 1;
 		if (Sprite_Regs[adr] != data)
 		{
+#if defined(USE_ASM) || (defined(USE_GAS) && defined(__i386__))
+			int s1, s2, v = 0;
+			s1 = (((BG_Regs[0x11]  &4)?2:1)-((BG_Regs[0x11]  &16)?1:0));
+			s2 = (((CRTC_Regs[0x29]&4)?2:1)-((CRTC_Regs[0x29]&16)?1:0));
+			if ( !(BG_Regs[0x11]&16) ) v = ((BG_Regs[0x0f]>>s1)-(CRTC_Regs[0x0d]>>s2));
+#endif
 #ifdef USE_ASM
 			_asm
 			{
@@ -190,29 +435,29 @@ void FASTCALL BG_Write(DWORD adr, BYTE data)
 			: "ax", "bx", "memory");
 #else /* !USE_ASM && !(USE_GAS && __i386__) */
 
-			WORD t0, t, *pw;
+			WORD *pw;
 
-			v = (int)(BG_VLINE - 16 - v);
 			// get YPOS pointer (Sprite_Regs[] is little endian)
 			pw = (WORD *)(Sprite_Regs + (adr & 0x3f8) + 2);
 
-#define UPDATE_TDL(t)				\
-{						\
-	int i;					\
-	for (i = 0; i < 16; i++) {		\
-		TextDirtyLine[(t)] = 1;		\
-		(t) = ((t) + 1) & 0x3ff;	\
-	}					\
-}
-
-			t = t0 = (*pw + v) & 0x3ff;
-			UPDATE_TDL(t);
-
-			Sprite_Regs[adr] = data;
-
-			t = (*pw + v) & 0x3ff;
-			if (t != t0) {
-				UPDATE_TDL(t);
+			// 書き換え前後で表示されるラインを更新する。
+			// BG_VLINE の向きと縦の倍率は BG_LineFromVLine と同じ換算表を使う
+			// （VLINE と VLINEBG を同一視していると 256ライン BG で取りこぼす）
+			BG_UpdateLineIndex();
+			BG_SetSpriteDirty(adr >> 3);
+
+			if ((adr & 6) == 2) {		// Y座標
+				Sprite_SetBucket(adr >> 3, *pw & 0x3ff, 0);
+				Sprite_Regs[adr] = data;
+				Sprite_SetBucket(adr >> 3, *pw & 0x3ff, 1);
+				BG_SetSpriteDirty(adr >> 3);
+			} else {
+				if ((adr & 7) == 4) {	// パターン番号
+					DWORD bit = 1u << ((adr >> 3) & 31);
+					Sprite_PatMask[Sprite_Regs[adr]][adr >> 8] &= ~bit;
+					Sprite_PatMask[data][adr >> 8] |= bit;
+				}
+				Sprite_Regs[adr] = data;
 			}
 
 #endif /* USE_ASM */
@@ -272,6 +517,7 @@ void FASTCALL BG_Write(DWORD adr, BYTE data)
 			else
 				BG_CHREND = 0x2000;
 			BG_CHRSIZE = ((data&3)?16:8);
+			ZeroMemory(BG_RowValid, sizeof(BG_RowValid));
 			BG_AdrMask = ((data&3)?1023:511);
 			BG_HAdjust = ((long)BG_Regs[0x0d]-(CRTC_HSTART+4))*8;				// 水平方向は解像度による1/2はいらない？（Tetris）
 			BG_VLINE = ((long)BG_Regs[0x0f]-CRTC_VSTART)/((BG_Regs[0x11]&4)?1:2);	// BGとその他がずれてる時の差分
@@ -328,6 +574,10 @@ void FASTCALL BG_Write(DWORD adr, BYTE data)
 	{
 		adr -= 0xeb8000;
 		if (BG[adr]==data) return;			// データに変化が無ければ帰る
+		if ((adr >= 0x4000) && (adr & 1)) {		// マップのパターン番号
+			BG_PatRowCount[(adr >> 13) & 1][BG[adr]][(adr >> 7) & 63]--;
+			BG_PatRowCount[(adr >> 13) & 1][data][(adr >> 7) & 63]++;
+		}
 		BG[adr] = data;
 		if (adr<0x2000)
 		{
@@ -338,21 +588,67 @@ void FASTCALL BG_Write(DWORD adr, BYTE data)
 		BGCHR16[bg16chr]   = data>>4;
 		BGCHR16[bg16chr+1] = data&15;
 
-		if (adr<BG_CHREND)				// パターンエリア
-		{
-			TVRAM_SetAllDirty();
-		}
-		if ((adr>=BG_BG1TOP)&&(adr<BG_BG1END))	// BG1 MAPエリア
+		BG_InvalidateRows(adr);
+		BG_SetPatternDirty(adr);			// パターンエリア
+		if (((adr>=BG_BG1TOP)&&(adr<BG_BG1END))	// BG1 MAPエリア
+		  ||((adr>=BG_BG0TOP)&&(adr<BG_BG0END)))	// BG0 MAPエリア
 		{
-			TVRAM_SetAllDirty();
+			BG_SetMapDirty(adr);
 		}
-		if ((adr>=BG_BG0TOP)&&(adr<BG_BG0END))	// BG0 MAPエリア
-		{
-			TVRAM_SetAllDirty();
+	}
+}
+
+// -----------------------------------------------------------------------
+//   表示窓
+// -----------------------------------------------------------------------
+// ラインバッファ上の表示窓 [16, BG_DispEnd()) の右端。TextDotX は CRTC の
+// R02/R03 から求めた表示幅（CrtcTiming の width と同じ）で、ScrBuf の幅を
+// 越えた分は表示されないのでそこで切る。
+INLINE DWORD BG_DispEnd(void)
+{
+	return ((TextDotX < SCRBUF_STRIDE) ? TextDotX : SCRBUF_STRIDE) + 16;
+}
+
+// -----------------------------------------------------------------------
+//   パレット変更時の再描画
+// -----------------------------------------------------------------------
+// BG/スプライトの描画結果は、書いたドットの TextPal の番号と Text_TrFlag の
+// bit1 だけで決まる。BG_DrawLine で書いた番号をライン毎に残しておき、
+// パレットしか変わっていないライン（TextDirtyLine が TDL_PALETTE だけ）は
+// スプライト評価やパターン展開をせずに色だけ引き直す。
+// テキストとグラフィックはもともと色番号（TextDrawWork／GVRAM）から描いて
+// いるので、そのまま描き直しても安い。
+static	BYTE	BG_IdxCache[1024][BG_LINEBUF_WIDTH];
+static	BYTE	BG_IdxScratch[BG_LINEBUF_WIDTH];
+static	BYTE	BG_IdxState[1024];		// 0:なし 1:gd=0 で記録 2:gd=1 で記録
+static	BYTE	*BG_IdxLine = BG_IdxScratch;
+
+static void BG_RecolorLine(int opaq)
+{
+	const BYTE *idx = BG_IdxCache[VLINE];
+	WORD *buf = BG_DoubleBuffer ? BG_LineBuf_Draw : BG_LineBuf;
+	DWORD i, end = BG_DispEnd();
+
+	if (opaq) {
+		for (i = 16; i < end; ++i)
+			buf[i] = TextPal[0];
+	}
+	for (i = 16; i < end; ++i) {
+		if (idx[i]) {
+			buf[i] = TextPal[idx[i]];
+			Text_TrFlag[i] |= 2;
 		}
 	}
 }
 
+void FASTCALL BG_DrawLineCached(int opaq, int gd, int palonly)
+{
+	if (palonly && (VLINE < 1024) && (BG_IdxState[VLINE] == (gd ? 2 : 1)))
+		BG_RecolorLine(opaq);
+	else
+		BG_DrawLine(opaq, gd);
+}
+
 #ifndef USE_GAS
 //#define USE_GAS
 #endif
@@ -483,29 +779,35 @@ INLINE void
 Sprite_DrawLineMcr(int pri)
 {
 	SPRITECTRLTBL_T *sct = (SPRITECTRLTBL_T *)Sprite_Regs;
+	const DWORD *mask;
+	DWORD l, m;
 	DWORD y;
-	DWORD t;
-	int n;
+	DWORD t, end = BG_DispEnd();
+	int n, w;
+
+	l = (DWORD)(VLINEBG - BG_VLINE + 16);
+	if (l >= SPRITE_BUCKETS)
+		return;
+	mask = Sprite_LineMask[l];
 
-	for (n = 127; n >= 0; --n) {
+	for (w = 3; w >= 0; --w)
+	for (m = mask[w]; m; m &= ~(1u << (n & 31))) {
+		n = (w << 5) + 31 - __builtin_clz(m);
 		if ((sct[n].sprite_ply & 3) == pri) {
 			SPRITECTRLTBL_T *sctp = &sct[n];
 
 			t = (sctp->sprite_posx + BG_HAdjust) & 0x3ff;
-			if (t >= TextDotX + 16)
+			// 表示窓に1ドットも掛からないものは飛ばす（t==0 は左の余白に収まる）
+			if (t >= end || t == 0)
 				continue;
 
-			y = sctp->sprite_posy & 0x3ff;
-			y -= VLINEBG;
-			y += BG_VLINE;
-			y = -y;
-			y += 16;
+			// バケットに入っているので必ず 0〜15
+			y = l - (sctp->sprite_posy & 0x3ff);
 
-			// add y, 16; jnc .spline_lpcnt
-			if (y <= 15) {
+			{
 				BYTE *p;
 				DWORD pal;
-				int i, d;
+				int i, d, last;
 				BYTE bh, dat;
 				
 				if (sctp->sprite_ctrl < 0x4000) {
@@ -522,10 +824,12 @@ Sprite_DrawLineMcr(int pri)
 					d = 1;
 				}
 
-				for (i = 0; i < 16; i++, t++, p += d) {
-					// 配列境界チェック
-					if (t >= 1600) break;
-					
+				// 表示窓の外にはみ出すドットは切り落とす
+				i = (t < 16) ? (int)(16 - t) : 0;
+				last = (end - t < 16) ? (int)(end - t) : 16;
+				t += i;
+				p += i * d;
+				for (; i < last; i++, t++, p += d) {
 					pal = *p & 0xf;
 					if (pal) {
 						pal |= (sctp->sprite_ctrl >> 4) & 0xf0;
@@ -534,6 +838,7 @@ Sprite_DrawLineMcr(int pri)
 							if (BG_PriBuf_Draw[t] >= n * 8) {
 								BG_LineBuf_Draw[t] = TextPal[pal];
 								Text_TrFlag[t] |= 2;
+								BG_IdxLine[t] = (BYTE)pal;
 								BG_PriBuf_Draw[t] = n * 8;
 							}
 						} else {
@@ -541,6 +846,7 @@ Sprite_DrawLineMcr(int pri)
 							if (BG_PriBuf[t] >= n * 8) {
 								BG_LineBuf[t] = TextPal[pal];
 								Text_TrFlag[t] |= 2;
+								BG_IdxLine[t] = (BYTE)pal;
 								BG_PriBuf[t] = n * 8;
 							}
 						}
@@ -551,177 +857,182 @@ Sprite_DrawLineMcr(int pri)
 	}
 }
 
-#define BG_DRAWLINE_LOOPY(cnt) \
-{ \
-	bl = bl << 4;							\
-	for (j = 0; j < cnt; j++, esi += d, edi++) {			\
-		dat = *esi | bl;					\
-		if (dat == 0)						\
-			continue;					\
-		if ((dat & 0xf) || !(Text_TrFlag[edi + 1] & 2)) {	\
-			if (BG_DoubleBuffer) { \
-				BG_LineBuf_Draw[1 + edi] = TextPal[dat]; \
-			} else { \
-				BG_LineBuf[1 + edi] = TextPal[dat]; \
-			} \
-			Text_TrFlag[edi + 1] |= 2;			\
-		}							\
-	}								\
-}
-
-#define BG_DRAWLINE_LOOPY_NG(cnt) \
-{  \
-	bl = bl << 4;					    \
-        for (j = 0; j < cnt; j++, esi += d, edi++) {	    \
-                dat = *esi & 0xf;			    \
-		if (dat) {				    \
-			dat |= bl;			    \
-			if (BG_DoubleBuffer) { \
-				BG_LineBuf_Draw[1 + edi] = TextPal[dat]; \
-			} else { \
-				BG_LineBuf[1 + edi] = TextPal[dat]; \
-			} \
-			Text_TrFlag[edi + 1] |= 2;	    \
-                }					    \
-        }						    \
-}
-
-void bg_drawline_loopx8(WORD BGTOP, DWORD BGScrollX, DWORD BGScrollY, long adjust, int ng)
-{
-       unsigned char dat, bl;
-       int i, j, d;
-       DWORD ebp, edx, edi, ecx;
-       WORD si;
-       BYTE *esi;
-
-       ebp = (DWORD)(((BGScrollY + VLINEBG - BG_VLINE) & 7) << 3);
-       edx = (DWORD)(BGTOP + (((BGScrollY + VLINEBG - BG_VLINE) & 0x1f8) << 4));
-       edi = ((BGScrollX - adjust) & 7) ^ 15;
-       ecx = ((BGScrollX - adjust) & 0x1f8) >> 2;
-
-       for (i = TextDotX >> 3; i >= 0; i--) {
-               bl = BG[ecx + edx];
-               si = (WORD)BG[ecx + edx + 1] << 6;
-
-               if (bl < 0x40) {
-                       esi = &BGCHR8[si + ebp];
-                       d = +1;
-               } else if ((bl - 0x40) & 0x80) {
-                       esi = &BGCHR8[si + 0x3f - ebp];
-                       d = -1;
-               } else if ((signed char)bl >= 0x40) {
-                       esi = &BGCHR8[si + ebp + 7];
-                       d = -1;
-               } else {
-                       esi = &BGCHR8[si + 0x38 - ebp];
-                       d = +1;
-               }
-	       if (ng) {
-		       BG_DRAWLINE_LOOPY_NG(8);
-	       } else {
-		       BG_DRAWLINE_LOOPY(8);
-	       }
-               ecx += 2;
-               ecx &= 0x7f;
-       }
-}
-
-void bg_drawline_loopx16(WORD BGTOP, DWORD BGScrollX, DWORD BGScrollY, long adjust, int ng)
-{
-       unsigned char dat, bl;
-       int i, j, d;
-       DWORD ebp, edx, edi, ecx;
-       WORD si;
-       BYTE *esi;
-
-       ebp = (DWORD)(((BGScrollY + VLINEBG - BG_VLINE) & 15) << 4);
-       edx = (DWORD)(BGTOP + (((BGScrollY + VLINEBG - BG_VLINE) & 0x3f0) << 3));
-       edi = ((BGScrollX - adjust) & 15) ^ 15;
-       ecx = ((BGScrollX - adjust) & 0x3f0) >> 3;
-
-       for (i = TextDotX >> 4; i >= 0; i--) {
-		bl = BG[ecx + edx];
-		si = BG[ecx + edx + 1] << 8;
-
-		if (bl < 0x40) {
-			esi = &BGCHR16[si + ebp];
-			d = +1;
-		} else if ((bl - 0x40) & 0x80) {
-			esi = &BGCHR16[si + 0xff - ebp];
-			d = -1;
-		} else if ((signed char)bl >= 0x40) {
-			esi = &BGCHR16[si + ebp + 15];
-			d = -1;
-		} else {
-			esi = &BGCHR16[si + 0xf0 - ebp];
-			d = +1;
+// BG座標 y のラインを展開する（マップ行の64セル分）
+static void BG_DecodeRow(BYTE *row, WORD BGTOP, DWORD y)
+{
+	const BYTE *map;
+	const BYTE *esi;
+	BYTE bl, pal;
+	DWORD ebp;
+	int c, j, d;
+
+	if (BG_CHRSIZE == 8) {
+		ebp = (y & 7) << 3;
+		map = &BG[BGTOP + ((y & 0x1f8) << 4)];
+		for (c = 0; c < 64; c++, map += 2) {
+			const BYTE *chr = &BGCHR8[(WORD)map[1] << 6];
+			bl = map[0];
+			if (bl < 0x40) {
+				esi = chr + ebp;
+				d = +1;
+			} else if ((BYTE)(bl - 0x40) & 0x80) {
+				esi = chr + 0x3f - ebp;
+				d = -1;
+			} else if ((signed char)bl >= 0x40) {
+				esi = chr + ebp + 7;
+				d = -1;
+			} else {
+				esi = chr + 0x38 - ebp;
+				d = +1;
+			}
+			pal = (BYTE)(bl << 4);
+			for (j = 0; j < 8; j++, esi += d)
+				*row++ = *esi | pal;
 		}
-		if (ng) {
-			BG_DRAWLINE_LOOPY_NG(16);
-		} else {
-			BG_DRAWLINE_LOOPY(16);
+	} else {
+		ebp = (y & 15) << 4;
+		map = &BG[BGTOP + ((y & 0x3f0) << 3)];
+		for (c = 0; c < 64; c++, map += 2) {
+			const BYTE *chr = &BGCHR16[(WORD)map[1] << 8];
+			bl = map[0];
+			if (bl < 0x40) {
+				esi = chr + ebp;
+				d = +1;
+			} else if ((BYTE)(bl - 0x40) & 0x80) {
+				esi = chr + 0xff - ebp;
+				d = -1;
+			} else if ((signed char)bl >= 0x40) {
+				esi = chr + ebp + 15;
+				d = -1;
+			} else {
+				esi = chr + 0xf0 - ebp;
+				d = +1;
+			}
+			pal = (BYTE)(bl << 4);
+			for (j = 0; j < 16; j++, esi += d)
+				*row++ = *esi | pal;
+		}
+	}
+}
+
+// BGの1ライン描画
+// 以前はセル毎にパターンを引いていたが、展開済みラインから窓を切り出すだけにした。
+// バッファ位置 p のドットは BG座標 x = BGScrollX - adjust + p - 16 で、描く範囲は
+// 先頭セルの端数の分だけ左にはみ出した所から (TextDotX/size+1) セル分だが、
+// 表示窓 [16, BG_DispEnd()) の外は誰も読まないので、両端とも窓で切る。
+static void bg_drawline_loop(WORD BGTOP, DWORD BGScrollX, DWORD BGScrollY, long adjust, int ng)
+{
+	WORD *buf = BG_DoubleBuffer ? BG_LineBuf_Draw : BG_LineBuf;
+	const BYTE *row;
+	DWORD size = BG_CHRSIZE;
+	DWORD mask = size * 64 - 1;
+	DWORD x, y, p, end;
+	int region;
+	BYTE dat;
+
+	y = (BGScrollY + VLINEBG - BG_VLINE) & mask;
+	region = (BGTOP >> 13) & 1;
+	row = BG_RowCache[region][y];
+	if (!BG_RowValid[region][y]) {
+		BG_DecodeRow(BG_RowCache[region][y], BGTOP, y);
+		BG_RowValid[region][y] = 1;
+	}
+
+	x = BGScrollX - adjust;
+	p = 16 - (x & (size - 1));
+	end = p + ((TextDotX / size) + 1) * size;
+	if (end > BG_DispEnd())
+		end = BG_DispEnd();
+	p = 16;
+	x -= 16;
+
+	if (ng) {
+		for (; p < end; p++) {
+			dat = row[(x + p) & mask];
+			if (!(dat & 0xf))
+				continue;
+			buf[p] = TextPal[dat];
+			BG_IdxLine[p] = dat;
+			Text_TrFlag[p] |= 2;
+		}
+	} else {
+		for (; p < end; p++) {
+			dat = row[(x + p) & mask];
+			if (dat == 0)
+				continue;
+			if ((dat & 0xf) || !(Text_TrFlag[p] & 2)) {
+				buf[p] = TextPal[dat];
+				BG_IdxLine[p] = dat;
+				Text_TrFlag[p] |= 2;
+			}
 		}
-		ecx += 2;
-		ecx &= 0x7f;
 	}
 }
 
 INLINE void
 BG_DrawLineMcr8(WORD BGTOP, DWORD BGScrollX, DWORD BGScrollY)
 {
-       bg_drawline_loopx8(BGTOP, BGScrollX, BGScrollY, BG_HAdjust, 0);
+       bg_drawline_loop(BGTOP, BGScrollX, BGScrollY, BG_HAdjust, 0);
 }
 
 INLINE void
 BG_DrawLineMcr16(WORD BGTOP, DWORD BGScrollX, DWORD BGScrollY)
 {
-	bg_drawline_loopx16(BGTOP, BGScrollX, BGScrollY, BG_HAdjust, 0);
+	bg_drawline_loop(BGTOP, BGScrollX, BGScrollY, BG_HAdjust, 0);
 }
 
 INLINE void
 BG_DrawLineMcr8_ng(WORD BGTOP, DWORD BGScrollX, DWORD BGScrollY)
 {
-       bg_drawline_loopx8(BGTOP, BGScrollX, BGScrollY, BG_HAdjust, 1);
+       bg_drawline_loop(BGTOP, BGScrollX, BGScrollY, BG_HAdjust, 1);
 }
 
 INLINE void
 BG_DrawLineMcr16_ng(WORD BGTOP, DWORD BGScrollX, DWORD BGScrollY)
 {
-       bg_drawline_loopx16(BGTOP, BGScrollX, BGScrollY, 0, 1);
+       bg_drawline_loop(BGTOP, BGScrollX, BGScrollY, 0, 1);
 }
 
 LABEL void FASTCALL
 BG_DrawLine(int opaq, int gd)
 {
-	int i;
+	int i, end = (int)BG_DispEnd();
 	void (*func8)(WORD, DWORD, DWORD), (*func16)(WORD, DWORD, DWORD);
 
 	// ダブルバッファリング: 描画用バッファに書き込み
 	if (BG_DoubleBuffer) {
 		if (opaq) {
-			for (i = 16; i < TextDotX + 16; ++i) {
+			for (i = 16; i < end; ++i) {
 				BG_LineBuf_Draw[i] = TextPal[0];
 				BG_PriBuf_Draw[i] = 0xffff;
 			}
 		} else {
-			for (i = 16; i < TextDotX + 16; ++i) {
+			for (i = 16; i < end; ++i) {
 				BG_PriBuf_Draw[i] = 0xffff;
 			}
 		}
 	} else {
 		// シングルバッファモード（従来の動作）
 		if (opaq) {
-			for (i = 16; i < TextDotX + 16; ++i) {
+			for (i = 16; i < end; ++i) {
 				BG_LineBuf[i] = TextPal[0];
 				BG_PriBuf[i] = 0xffff;
 			}
 		} else {
-			for (i = 16; i < TextDotX + 16; ++i) {
+			for (i = 16; i < end; ++i) {
 				BG_PriBuf[i] = 0xffff;
 			}
 		}
 	}
 
+	// このラインで書いた色番号を記録する（BG_DrawLineCached 用）
+	if (VLINE < 1024) {
+		BG_IdxLine = BG_IdxCache[VLINE];
+		BG_IdxState[VLINE] = 0;
+	} else
+		BG_IdxLine = BG_IdxScratch;
+	ZeroMemory(BG_IdxLine + 16, end - 16);
+
 	func8 = (gd)? BG_DrawLineMcr8 : BG_DrawLineMcr8_ng;
 	func16 = (gd)? BG_DrawLineMcr16 : BG_DrawLineMcr16_ng;
 
@@ -738,6 +1049,9 @@ BG_DrawLine(int opaq, int gd)
 		}
 	}
 	Sprite_DrawLineMcr(3);
+
+	if (VLINE < 1024)
+		BG_IdxState[VLINE] = (BYTE)(gd ? 2 : 1);
 }
 
 // -----------------------------------------------------------------------
@@ -769,8 +1083,8 @@ void FASTCALL BG_ClearBackBuffer(void)
 	if (!BG_DoubleBuffer) return;
 	
 	// ゼロクリアより高速な部分クリア
-	int i;
-	for (i = 16; i < TextDotX + 16; ++i) {
+	int i, end = (int)BG_DispEnd();
+	for (i = 16; i < end; ++i) {
 		BG_LineBuf_Draw[i] = 0;
 		BG_PriBuf_Draw[i] = 0xffff;
 	}
@@ -2,6 +2,12 @@
 #define _winx68k_bg
 
 #include "common.h"
+#include "scrbuf.h"
+
+// BG_LineBuf/BG_PriBuf は表示の0ドット目が [16]。合成が読み書きするのは
+// 表示窓 [16, 16+TextDotX) だけで、窓からはみ出すスプライト/BGは書く前に
+// 切り落とすので、左右の余白ぶんを持つ必要はない。
+#define	BG_LINEBUF_WIDTH	(SCRBUF_STRIDE + 16)
 
 extern	BYTE	BG_DrawWork0[1024*1024];
 extern	BYTE	BG_DrawWork1[1024*1024];
@@ -17,7 +23,7 @@ extern	long	BG_VLINE;
 extern	DWORD	VLINEBG;
 
 extern	BYTE	Sprite_DrawWork[1024*1024];
-extern	WORD	BG_LineBuf[1600];
+extern	WORD	BG_LineBuf[BG_LINEBUF_WIDTH];
 
 // ダブルバッファリング用の変数とアクセサ
 extern	WORD	*BG_LineBuf_Active;	// 表示用アクティブバッファ
@@ -32,6 +38,8 @@ BYTE FASTCALL BG_Read(DWORD adr);
 void FASTCALL BG_Write(DWORD adr, BYTE data);
 
 void FASTCALL BG_DrawLine(int opaq, int gd);
+void FASTCALL BG_DrawLineCached(int opaq, int gd, int palonly);
+DWORD FASTCALL BG_LineFromVLine(DWORD vline);
 
 // ダブルバッファリング管理関数
 void FASTCALL BG_SwapBuffers(void);
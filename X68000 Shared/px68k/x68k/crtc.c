@@ -114,6 +114,9 @@ void CRTC_UpdateVerticalScan(void)
 // ループが同じ hsync で自前のローカルに取る。
 CrtcScanMode CRTC_LatchScanState(void)
 {
+    // 描画待ちのラインは確定済みのストライドで描かせてから切り替える
+    if (CRTC_VramRowStepActive != CRTC_VramRowStep)
+        WinDraw_FlushLines();
     CRTC_VramRowStepActive = CRTC_VramRowStep;
     return CRTC_ScanMode;
 }
@@ -313,19 +316,29 @@ static void CRTC_RasterCopy(void)
 #else /* !USE_ASM && !(USE_GAS && __i386__) */
 {
 	static const DWORD off[4] = { 0, 0x20000, 0x40000, 0x60000 };
-	int i, bit;
+	int i, bit, changed = 0;
 
+	// ラスタコピースクロールでは同じブロックを毎ラインコピーし直すので、
+	// 中身が既に同じプレーンは触らない。全プレーン同じなら
+	// TextDrawWork の再変換も再描画も要らない
 	for (bit = 0; bit < 4; bit++) {
-		if (CRTC_Regs[0x2b] & (1 << bit)) {
-			memmove(&TVRAM[dst + off[bit]], &TVRAM[src + off[bit]],
-			    sizeof(DWORD) * 128);
+		if ((CRTC_Regs[0x2b] & (1 << bit)) &&
+		    memcmp(&TVRAM[dst + off[bit]], &TVRAM[src + off[bit]], 512)) {
+			if (!changed)
+				WinDraw_FlushLines();	// 描画待ちのラインはコピー前の内容で描く
+			memcpy(&TVRAM[dst + off[bit]], &TVRAM[src + off[bit]], 512);
+			changed = 1;
 		}
 	}
+	if (!changed)
+		return;
 
-	line = (line - TextScrollY) & 0x3ff;
+	// コピー先の 4 ラスタを表示しているラインだけ描き直す
+	// （インターレース時は CRTC_VramRowStepActive 行おきにしか表示されない）
 	for (i = 0; i < 4; i++) {
-		TextDirtyLine[line] = 1;
-		line = (line + 1) & 0x3ff;
+		DWORD d = (line + i - TextScrollY) & 0x3ff;
+		if (!(d % CRTC_VramRowStepActive))
+			TextDirtyLine[d / CRTC_VramRowStepActive] = TDL_FULL;
 	}
 }
 #endif	/* USE_ASM */
@@ -381,6 +394,7 @@ BYTE FASTCALL VCtrl_Read(DWORD adr)
 void FASTCALL VCtrl_Write(DWORD adr, BYTE data)
 {
 	BYTE old;
+	WinDraw_FlushPending();
 	switch(adr&0x701)
 	{
 	case 0x401:
@@ -419,6 +433,7 @@ void FASTCALL VCtrl_Write(DWORD adr, BYTE data)
 void CRTC_Init(void)
 {
 	ZeroMemory(CRTC_Regs, 48);
+	GVRAM_SetMode();
 	CRTC_Mode = 0;
 	CRTC_FastClr = 0;
 	CRTC_FastClrLine = 0;
@@ -471,6 +486,7 @@ void FASTCALL CRTC_Write(DWORD adr, BYTE data)
 	BYTE old;
 	BYTE reg = (BYTE)(adr&0x3f);
 	int old_vidmode = VID_MODE;
+	WinDraw_FlushPending();
 	if (adr<0xe80400)
 	{
 		if ( reg>=0x30 ) return;
@@ -518,6 +534,7 @@ void FASTCALL CRTC_Write(DWORD adr, BYTE data)
 			WinDraw_ChangeSize();
 			break;
 		case 0x28:
+			GVRAM_SetMode();
 			TVRAM_SetAllDirty();
 			break;
 		case 0x29:
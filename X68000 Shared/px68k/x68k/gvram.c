@@ -11,6 +11,7 @@
 #include	"gvram.h"
 #include	"m68000.h"
 #include	"memory.h"
+#include	"simd.h"
 
 	BYTE	GVRAM[0x80000];
 	WORD	Grp_LineBuf[1024];
@@ -40,6 +41,7 @@ void GVRAM_Init(void)
 	int i;
 
 	ZeroMemory(GVRAM, 0x80000);
+	GVRAM_SetMode();
 	for (i=0; i<128; i++)			// 16bit color パレットアドレス計算用
 	{
 		Pal16Adr[i*2] = i*4;
@@ -76,461 +78,695 @@ void FASTCALL Grp_SwapBuffers(void)
 // -----------------------------------------------------------------------------------
 //  高速クリア用ルーチン
 // -----------------------------------------------------------------------------------
+// フィールド終了時に全面を舐める代わりに、消去範囲（その時点のスクロール位置
+// からの h×v）とマスクを記録しておき、各行は最初に触られた時（描画・
+// GVRAM_Read・GVRAM_Write）に消す。行ごとに処理済みの世代を持ち、
+// GVRAM_ClrGen と違えば未処理。毎フレーム消すゲームでも、表示されない行は
+// 次の消去までそのまま残るだけになる。
+// 上記以外で GVRAM を直接見る時は、先に GVRAM_FastClearFlush を呼ぶこと。
+// （C68K の GVRAM からの命令フェッチは見ない。消去直後のプレーンを実行する
+// ことはまずない）
+static	DWORD	GVRAM_ClrGen = 0;
+static	DWORD	GVRAM_RowGen[512];
+static	DWORD	GVRAM_ClrX, GVRAM_ClrY, GVRAM_ClrW, GVRAM_ClrH;
+static	WORD	GVRAM_ClrMask;
+static	DWORD	GVRAM_ClrLeft = 0;		// 未処理の行数
+
+static void GVRAM_MaskSpan(WORD *p, DWORD n, WORD mask)
+{
+	DWORD i = 0;
+
+#if defined(PX68K_SIMD_SSE2)
+	{
+		const __m128i m = _mm_set1_epi16((short)mask);
+		for (; i + 8 <= n; i += 8) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+			_mm_storeu_si128((__m128i *)(p + i), _mm_and_si128(v, m));
+		}
+	}
+#elif defined(PX68K_SIMD_NEON)
+	{
+		const uint16x8_t m = vdupq_n_u16(mask);
+		for (; i + 8 <= n; i += 8)
+			vst1q_u16(p + i, vandq_u16(vld1q_u16(p + i), m));
+	}
+#endif
+	for (; i < n; ++i)
+		p[i] &= mask;
+}
+
+static void GVRAM_ClearRow(DWORD y)
+{
+	WORD *row;
+	DWORD seg;
+
+	GVRAM_RowGen[y] = GVRAM_ClrGen;
+	if (((y - GVRAM_ClrY) & 0x1ff) >= GVRAM_ClrH)
+		return;
+	// 横は512ドットで折り返す
+	row = (WORD *)(GVRAM + (y << 10));
+	seg = 0x200 - GVRAM_ClrX;
+	if (seg > GVRAM_ClrW)
+		seg = GVRAM_ClrW;
+	GVRAM_MaskSpan(row + GVRAM_ClrX, seg, GVRAM_ClrMask);
+	GVRAM_MaskSpan(row, GVRAM_ClrW - seg, GVRAM_ClrMask);
+	GVRAM_ClrLeft--;
+}
+
+// VRAM の y 行目（0〜511）を触る前に呼ぶ
+INLINE void GVRAM_Materialize(DWORD y)
+{
+	if (GVRAM_ClrLeft && (GVRAM_RowGen[y] != GVRAM_ClrGen))
+		GVRAM_ClearRow(y);
+}
+
+// 未処理の行を全部消す
+void FASTCALL GVRAM_FastClearFlush(void)
+{
+	DWORD y;
+
+	for (y = 0; GVRAM_ClrLeft && (y < 512); ++y)
+		GVRAM_Materialize(y);
+}
 
 void FASTCALL GVRAM_FastClear(void)
 {
-	DWORD v, h;
-	v = ((CRTC_Regs[0x29]&4)?512:256);
-	h = ((CRTC_Regs[0x29]&3)?512:256);
+	// 前回の残りを先に片付ける（範囲もマスクも違うかもしれない）
+	GVRAM_FastClearFlush();
+
 	// やっぱちゃんと範囲指定しないと変になるものもある（ダイナマイトデュークとか）
+	GVRAM_ClrH = ((CRTC_Regs[0x29]&4)?512:256);
+	GVRAM_ClrW = ((CRTC_Regs[0x29]&3)?512:256);
+	GVRAM_ClrX = GrphScrollX[0] & 0x1ff;
+	GVRAM_ClrY = GrphScrollY[0] & 0x1ff;
+	GVRAM_ClrMask = CRTC_FastClrMask;
+	GVRAM_ClrGen++;
+	GVRAM_ClrLeft = GVRAM_ClrH;
+}
+
+// -----------------------------------------------------------------------
+//   VRAM Read/Write
+// -----------------------------------------------------------------------
+// アクセス時の VRAM 配置は CRTC R20（CRTC_Regs[0x28]）で決まる。
+// 1バイト毎に R20 を解釈し直さないよう、配置別の関数を用意しておき、
+// R20 が書かれた時に GVRAM_SetMode で差し替える（メモリアクセスは
+// GVRAM_ReadFunc/GVRAM_WriteFunc を直接呼ぶ）。
+// adr は CPU アドレス（0xc00000〜0xdfffff）。
+
+// 65536色、または R20 bit3（65536色の配置）：1バイト1バイトそのまま
+static BYTE FASTCALL GVRAM_ReadLinear(DWORD adr)
 {
-	WORD *p;
-	DWORD x, y;
-	DWORD offx, offy;
+	adr = (adr ^ 1) - 0xc00000;
+	if (adr >= 0x80000)
+		return 0;
+	GVRAM_Materialize(adr >> 10);
+	return GVRAM[adr];
+}
 
-	offy = (GrphScrollY[0] & 0x1ff) << 10;
-	for (y = 0; y < v; ++y) {
-		offx = GrphScrollX[0] & 0x1ff;
-		p = (WORD *)(GVRAM + offy + offx * 2);
+// 16色：4プレーン（ページ）がワードの各ニブル
+static BYTE FASTCALL GVRAM_Read16(DWORD adr)
+{
+	adr = (adr ^ 1) - 0xc00000;
+	if (adr & 1)
+		return 0;
+	GVRAM_Materialize((adr >> 10) & 0x1ff);
+	return (BYTE)((*(WORD *)(&GVRAM[adr & 0x7fffe]) >> ((adr >> 17) & 0x0c)) & 15);
+}
 
-		for (x = 0; x < h; ++x) {
-			*p++ &= CRTC_FastClrMask;
-			offx = (offx + 1) & 0x1ff;
-		}
+// 16色 1024ドット：左右上下の512ドット四方がそれぞれニブル
+static BYTE FASTCALL GVRAM_Read16h(DWORD adr)
+{
+	DWORD page;
+
+	adr = (adr ^ 1) - 0xc00000;
+	if (adr & 1)
+		return 0;
+	GVRAM_Materialize((adr >> 11) & 0x1ff);
+	page = ((adr >> 17) & 0x08) + ((adr >> 8) & 4);
+	return (BYTE)((*(WORD *)(&GVRAM[((adr & 0xff800) >> 1) + (adr & 0x3fe)]) >> page) & 15);
+}
 
-		offy = (offy + 0x400) & 0x7fc00;
-	}
+// 256色：2ページがワードの上下バイト
+static BYTE FASTCALL GVRAM_Read256(DWORD adr)
+{
+	adr = (adr ^ 1) - 0xc00000;
+	if ((adr >= 0x100000) || (adr & 1))
+		return 0;
+	GVRAM_Materialize((adr >> 10) & 0x1ff);
+	return (BYTE)(*(WORD *)(&GVRAM[adr & 0x7fffe]) >> ((adr >> 16) & 0x08));
 }
+
+// R20 bit3 の配置で書く時はダーティラインを立てない（従来どおり）
+static void FASTCALL GVRAM_WriteLinear(DWORD adr, BYTE data)
+{
+	WinDraw_FlushPending();
+	adr = (adr ^ 1) - 0xc00000;
+	if (adr >= 0x80000)
+		return;
+	GVRAM_Materialize(adr >> 10);		// 書き込みは部分的なので先に消しておく
+	GVRAM[adr] = data;
 }
 
+static void FASTCALL GVRAM_Write64K(DWORD adr, BYTE data)
+{
+	WinDraw_FlushPending();
+	adr = (adr ^ 1) - 0xc00000;
+	if (adr >= 0x80000)
+		return;
+	GVRAM_Materialize(adr >> 10);
+	GVRAM[adr] = data;
+	TextDirtyLine[((adr >> 10) - GrphScrollY[0]) & 511] = 1;
+}
 
-// -----------------------------------------------------------------------
-//   VRAM Read
-// -----------------------------------------------------------------------
-BYTE FASTCALL GVRAM_Read(DWORD adr)
+static void FASTCALL GVRAM_Write16(DWORD adr, BYTE data)
+{
+	WORD *ram;
+	DWORD page;
+
+	WinDraw_FlushPending();
+	adr = (adr ^ 1) - 0xc00000;
+	if (adr & 1)
+		return;
+	GVRAM_Materialize((adr >> 10) & 0x1ff);
+	ram = (WORD *)(&GVRAM[adr & 0x7fffe]);
+	page = (adr >> 17) & 0x0c;
+	*ram = (*ram & ~(0xf << page)) | (((WORD)data & 15) << page);
+	TextDirtyLine[(((adr & 0x7ffff) >> 10) - GrphScrollY[adr >> 19]) & 511] = 1;
+}
+
+static void FASTCALL GVRAM_Write16h(DWORD adr, BYTE data)
 {
-	BYTE ret=0;
-	BYTE page;
-	WORD *ram = (WORD*)(&GVRAM[adr&0x7fffe]);
-	adr ^= 1;
-	adr -= 0xc00000;
+	WORD *ram;
+	DWORD page;
+
+	WinDraw_FlushPending();
+	adr = (adr ^ 1) - 0xc00000;
+	if (adr & 1)
+		return;
+	GVRAM_Materialize((adr >> 11) & 0x1ff);
+	ram = (WORD *)(&GVRAM[((adr & 0xff800) >> 1) + (adr & 0x3fe)]);
+	page = ((adr >> 17) & 0x08) + ((adr >> 8) & 4);
+	*ram = (*ram & ~(0xf << page)) | (((WORD)data & 15) << page);
+	TextDirtyLine[((adr >> 11) - GrphScrollY[0]) & 1023] = 1;
+}
 
-	if (CRTC_Regs[0x28]&8) {			// 読み込み側も65536モードのVRAM配置（苦胃頭捕物帳）
-		if (adr<0x80000) ret = GVRAM[adr];
-	} else {
-		switch(CRTC_Regs[0x28]&3)
-		{
-		case 0:					// 16 colors
-			if (!(adr&1))
-			{
-				if (CRTC_Regs[0x28]&4)		// 1024dot
-				{
-					ram = (WORD*)(&GVRAM[((adr&0xff800)>>1)+(adr&0x3fe)]);
-					page = (BYTE)((adr>>17)&0x08);
-					page += (BYTE)((adr>>8)&4);
-					ret = (((*ram)>>page)&15);
-				}
-				else
-				{
-					page = (BYTE)((adr>>17)&0x0c);
-					ret = (((*ram)>>page)&15);
-				}
-			}
-			break;
-		case 1:					// 256
-		case 2:					// Unknown
-			if ( adr<0x100000 )
-			{
-				if (!(adr&1))
-				{
-					page = (BYTE)((adr>>16)&0x08);
-					ret = (BYTE)((*ram)>>page);
-				}
-			}
-//			else
-//				BusErrFlag = 1;
-			break;
-		case 3:					// 65536
-			if (adr<0x80000)
-				ret = GVRAM[adr];
-//			else
-//				BusErrFlag = 1;
-			break;
+static void FASTCALL GVRAM_Write256(DWORD adr, BYTE data)
+{
+	DWORD pg;
+
+	WinDraw_FlushPending();
+	adr = (adr ^ 1) - 0xc00000;
+	if ((adr >= 0x100000) || (adr & 1))
+		return;
+	GVRAM_Materialize((adr >> 10) & 0x1ff);
+	// 32色4面みたいな使用方法時のため、上下バイトのページ両方のラインを立てる
+	pg = (adr >> 18) & 2;
+	TextDirtyLine[(((adr & 0x7ffff) >> 10) - GrphScrollY[pg]) & 511] = 1;
+	TextDirtyLine[(((adr & 0x7ffff) >> 10) - GrphScrollY[pg + 1]) & 511] = 1;
+	if (adr & 0x80000)
+		adr += 1;
+	GVRAM[adr & 0x7ffff] = data;
+}
+
+	BYTE	(FASTCALL *GVRAM_ReadFunc)(DWORD) = GVRAM_Read16;
+	void	(FASTCALL *GVRAM_WriteFunc)(DWORD, BYTE) = GVRAM_Write16;
+
+// R20 書き込み時に呼ぶ
+void FASTCALL GVRAM_SetMode(void)
+{
+	if (CRTC_Regs[0x28] & 8) {			// 65536モードのVRAM配置（Nemesis、苦胃頭捕物帳）
+		GVRAM_ReadFunc = GVRAM_ReadLinear;
+		GVRAM_WriteFunc = GVRAM_WriteLinear;
+		return;
+	}
+	switch (CRTC_Regs[0x28] & 3) {
+	case 0:						// 16 colors
+		if (CRTC_Regs[0x28] & 4) {		// 1024dot
+			GVRAM_ReadFunc = GVRAM_Read16h;
+			GVRAM_WriteFunc = GVRAM_Write16h;
+		} else {
+			GVRAM_ReadFunc = GVRAM_Read16;
+			GVRAM_WriteFunc = GVRAM_Write16;
 		}
+		break;
+	case 1:						// 256 colors
+	case 2:						// Unknown
+		GVRAM_ReadFunc = GVRAM_Read256;
+		GVRAM_WriteFunc = GVRAM_Write256;
+		break;
+	case 3:						// 65536 colors
+		GVRAM_ReadFunc = GVRAM_ReadLinear;
+		GVRAM_WriteFunc = GVRAM_Write64K;
+		break;
 	}
-	return ret;
+}
+
+BYTE FASTCALL GVRAM_Read(DWORD adr)
+{
+	return GVRAM_ReadFunc(adr);
+}
+
+void FASTCALL GVRAM_Write(DWORD adr, BYTE data)
+{
+	GVRAM_WriteFunc(adr, data);
 }
 
 
 // -----------------------------------------------------------------------
-//   VRAM Write
+//   こっから後はライン単位での画面展開部
 // -----------------------------------------------------------------------
-void FASTCALL GVRAM_Write(DWORD adr, BYTE data)
+// 各ルーチンは「取り出し」と「パレット引き」の2段に分けてある。
+//   1. Grp_FetchRow: 1ワード1ドットのVRAM行から指定ビット位置の色番号を
+//      バイト列に取り出す（512ドットで折り返し）
+//   2. Grp_Pal16Span/Grp_Pal256Span/Grp_HalfSpan/Grp_SplitSpan:
+//      色番号列をパレットに通し、透明色はマスクで合成する
+// どちらもSIMD版があり、端数と非SIMDビルドは同じ処理のスカラ版で行う。
+// 以前は先頭区間だけ折り返しを見ていたため、768/1024ドット幅でスクロール
+// すると右端で隣のラスタを読んでいた。SP/TR系と同じく毎回折り返す。
+
+static	BYTE	Grp_Idx[1024];		// 色番号（取り出し結果）
+static	BYTE	Grp_Idx2[1024];		// 256色時の上位ニブル／SP時の色番号
+static	WORD	Grp_Col[1024];		// パレット引き後の色
+
+INLINE WORD *Grp_DrawBuf(void)
 {
-	BYTE page;
-	int line = 1023, scr = 0;
-	WORD *ram = (WORD*)(&GVRAM[adr&0x7fffe]);
-	WORD temp;
+	return Grp_DoubleBuffer ? Grp_LineBuf_Draw : Grp_LineBuf;
+}
 
-	adr ^= 1;
-	adr -= 0xc00000;
+INLINE WORD *Grp_SPDrawBuf(void)
+{
+	return Grp_DoubleBuffer ? Grp_LineBufSP_Draw : Grp_LineBufSP;
+}
 
+INLINE WORD *Grp_SP2DrawBuf(void)
+{
+	return Grp_DoubleBuffer ? Grp_LineBufSP2_Draw : Grp_LineBufSP2;
+}
 
-	if (CRTC_Regs[0x28]&8)				// 65536モードのVRAM配置？（Nemesis）
-	{
-		if ( adr<0x80000 )
-		{
-			GVRAM[adr] = data;
-			line = (((adr&0x7ffff)/1024)-GrphScrollY[0])&511;
-		}
-	}
-	else
-	{
-		switch(CRTC_Regs[0x28]&3)
-		{
-		case 0:					// 16 colors
-			if (adr&1) break;
-			if (CRTC_Regs[0x28]&4)		// 1024dot
-			{
-				ram = (WORD*)(&GVRAM[((adr&0xff800)>>1)+(adr&0x3fe)]);
-				page = (BYTE)((adr>>17)&0x08);
-				page += (BYTE)((adr>>8)&4);
-				temp = ((WORD)data&15)<<page;
-				*ram = ((*ram)&(~(0xf<<page)))|temp;
-				line = ((adr/2048)-GrphScrollY[0])&1023;
-			}
-			else
-			{
-				page = (BYTE)((adr>>17)&0x0c);
-				temp = ((WORD)data&15)<<page;
-				*ram = ((*ram)&(~(0xf<<page)))|temp;
-				switch(adr/0x80000)
-				{
-					case 0:	scr = GrphScrollY[0]; break;
-					case 1: scr = GrphScrollY[1]; break;
-					case 2: scr = GrphScrollY[2]; break;
-					case 3: scr = GrphScrollY[3]; break;
-				}
-				line = (((adr&0x7ffff)/1024)-scr)&511;
-			}
-			break;
-		case 1:					// 256 colors
-		case 2:					// Unknown
-			if ( adr<0x100000 )
-			{
-				if ( !(adr&1) )
-				{
-					scr = GrphScrollY[(adr>>18)&2];
-					line = (((adr&0x7ffff)>>10)-scr)&511;
-					TextDirtyLine[line] = 1;			// 32色4面みたいな使用方法時
-					scr = GrphScrollY[((adr>>18)&2)+1];		//
-					line = (((adr&0x7ffff)>>10)-scr)&511;		//
-					if (adr&0x80000) adr+=1;
-					adr &= 0x7ffff;
-					GVRAM[adr] = data;
-				}
-			}
-//			else
-//			{
-//				BusErrFlag = 1;
-//				return;
-//			}
-			break;
-		case 3:					// 65536 colors
-			if ( adr<0x80000 )
-			{
-				GVRAM[adr] = data;
-				line = (((adr&0x7ffff)>>10)-GrphScrollY[0])&511;
-			}
-//			else
-//			{
-//				BusErrFlag = 1;
-//				return;
-//			}
-			break;
-		}
-		TextDirtyLine[line] = 1;
-	}
+INLINE const WORD *Grp_SPActiveBuf(void)
+{
+	return Grp_DoubleBuffer ? Grp_LineBufSP_Active : Grp_LineBufSP;
 }
 
+// 現在のラスタに対応するVRAM行の先頭（512ワード）
+INLINE const WORD *Grp_Row(DWORD scry)
+{
+	DWORD y = (scry + VLINE * CRTC_VramRowStepActive) & 0x1ff;
+	GVRAM_Materialize(y);
+	return (const WORD *)(GVRAM + (y << 10));
+}
 
 // -----------------------------------------------------------------------
-//   こっから後はライン単位での画面展開部
+//   取り出し：dst[i] = (src[i] >> shift) & mask  （連続区間）
 // -----------------------------------------------------------------------
-LABEL void Grp_DrawLine16(void)
+static void Grp_FetchRun(BYTE *dst, const WORD *src, DWORD n, int shift, WORD mask)
 {
-	WORD *srcp, *destp;
-	DWORD x, y;
-	DWORD i;
-	WORD v, v0;
-
-	y = GrphScrollY[0] + VLINE * CRTC_VramRowStepActive;
-	y = (y & 0x1ff) << 10;
+	DWORD i = 0;
 
-	x = GrphScrollX[0] & 0x1ff;
-	srcp = (WORD *)(GVRAM + y + x * 2);
-	destp = (WORD *)(Grp_DoubleBuffer ? Grp_LineBuf_Draw : Grp_LineBuf);
-
-	x = (x ^ 0x1ff) + 1;
-
-	v = v0 = 0;
-	i = 0;
-	if (x < TextDotX) {
-		for (; i < x; ++i) {
-			v = *srcp++;
-			if (v != 0) {
-				v0 = (v >> 8) & 0xff;
-				v &= 0x00ff;
-
-				v = Pal_Regs[Pal16Adr[v]];
-				v |= Pal_Regs[Pal16Adr[v0] + 2] << 8;
-				v = Pal16[v];
-			}
-			*destp++ = v;
+#if defined(PX68K_SIMD_SSE2)
+	{
+		const __m128i m = _mm_set1_epi16((short)mask);
+		const __m128i sh = _mm_cvtsi32_si128(shift);
+		for (; i + 16 <= n; i += 16) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+			__m128i b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+			a = _mm_and_si128(_mm_srl_epi16(a, sh), m);
+			b = _mm_and_si128(_mm_srl_epi16(b, sh), m);
+			_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
 		}
-		srcp -= 0x200;
 	}
-
-	for (; i < TextDotX; ++i) {
-		v = *srcp++;
-		if (v != 0) {
-			v0 = (v >> 8) & 0xff;
-			v &= 0x00ff;
-
-			v = Pal_Regs[Pal16Adr[v]];
-			v |= Pal_Regs[Pal16Adr[v0] + 2] << 8;
-			v = Pal16[v];
+#elif defined(PX68K_SIMD_NEON)
+	{
+		const uint16x8_t m = vdupq_n_u16(mask);
+		const int16x8_t sh = vdupq_n_s16((int16_t)-shift);
+		for (; i + 16 <= n; i += 16) {
+			uint16x8_t a = vld1q_u16(src + i);
+			uint16x8_t b = vld1q_u16(src + i + 8);
+			a = vandq_u16(vshlq_u16(a, sh), m);
+			b = vandq_u16(vshlq_u16(b, sh), m);
+			vst1q_u8(dst + i, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
 		}
-		*destp++ = v;
 	}
+#endif
+	for (; i < n; ++i)
+		dst[i] = (BYTE)((src[i] >> shift) & mask);
 }
 
-
-LABEL void FASTCALL Grp_DrawLine8(int page, int opaq)
+// 1ラスタ分（n ドット、x から開始して 512 ドットで折り返し）
+static void Grp_FetchRow(BYTE *dst, const WORD *row, DWORD x, DWORD n, int shift, WORD mask)
 {
-	WORD *srcp, *destp;
-	DWORD x, x0;
-	DWORD y, y0;
-	DWORD off;
-	DWORD i;
-	WORD v;
+	DWORD seg;
+
+	x &= 0x1ff;
+	while (n) {
+		seg = 0x200 - x;
+		if (seg > n)
+			seg = n;
+		Grp_FetchRun(dst, row + x, seg, shift, mask);
+		dst += seg;
+		n -= seg;
+		x = 0;
+	}
+}
 
-	page &= 1;
+// 1024ドットモード用：512ドットを超えるごとに左右のページ（ビット位置）が入れ替わる
+static void Grp_FetchRow4h(BYTE *dst, DWORD mask)
+{
+	const WORD *row;
+	DWORD y, x, n, seg;
+	int bits;
 
-	y = GrphScrollY[page * 2] + VLINE * CRTC_VramRowStepActive;
-	y0 = GrphScrollY[page * 2 + 1] + VLINE * CRTC_VramRowStepActive;
-	y = ((y & 0x1ff) << 10) + page;
-	y0 = ((y0 & 0x1ff) << 10) + page;
+	y = GrphScrollY[0] + VLINE * CRTC_VramRowStepActive;
+	y &= 0x3ff;
 
-	x = GrphScrollX[page * 2] & 0x1ff;
-	x0 = GrphScrollX[page * 2 + 1] & 0x1ff;
+	if ((y & 0x200) == 0x000) {
+		row = (const WORD *)(GVRAM + (y << 10));
+		bits = (GrphScrollX[0] & 0x200) ? 4 : 0;
+	} else {
+		row = (const WORD *)(GVRAM + ((y & 0x1ff) << 10));
+		bits = (GrphScrollX[0] & 0x200) ? 12 : 8;
+	}
 
-	off = y0 + x0 * 2;
-	srcp = (WORD *)(GVRAM + y + x * 2);
-	destp = (WORD *)(Grp_DoubleBuffer ? Grp_LineBuf_Draw : Grp_LineBuf);
+	GVRAM_Materialize(y & 0x1ff);
+	x = GrphScrollX[0] & 0x1ff;
+	for (n = TextDotX; n; n -= seg, x = 0, bits ^= 4) {
+		seg = 0x200 - x;
+		if (seg > n)
+			seg = n;
+		Grp_FetchRun(dst, row + x, seg, bits, (WORD)mask);
+		dst += seg;
+	}
+}
 
-	x = (x ^ 0x1ff) + 1;
+// -----------------------------------------------------------------------
+//   16色パレット引き：dst[i] = GrphPal[idx[i]]（idx < 16）
+//   opaq=0 の時は色番号0のドットに書き込まない
+// -----------------------------------------------------------------------
+static void Grp_Pal16Span(WORD *dst, const BYTE *idx, DWORD n, int opaq)
+{
+	DWORD i = 0;
 
-	v = 0;
-	i = 0;
+#if defined(PX68K_SIMD_SSSE3) || defined(PX68K_SIMD_NEON)
+	{
+		BYTE lo[16], hi[16];
+		int k;
 
-	if (opaq) {
-		if (x < TextDotX) {
-			for (; i < x; ++i) {
-				v = *(BYTE *)srcp;
-				srcp++;
-				v = GrphPal[(GVRAM[off] & 0xf0) | (v & 0x0f)];
-				*destp++ = v;
-
-				off += 2;
-				if ((off & 0x3fe) == 0x000)
-					off -= 0x400;
-			}
-			srcp -= 0x200;
+		for (k = 0; k < 16; ++k) {
+			lo[k] = (BYTE)GrphPal[k];
+			hi[k] = (BYTE)(GrphPal[k] >> 8);
 		}
-
-		for (; i < TextDotX; ++i) {
-			v = *(BYTE *)srcp;
-			srcp++;
-			v = GrphPal[(GVRAM[off] & 0xf0) | (v & 0x0f)];
-			*destp++ = v;
-
-			off += 2;
-			if ((off & 0x3fe) == 0x000)
-				off -= 0x400;
+#if defined(PX68K_SIMD_SSSE3)
+		{
+			const __m128i tlo = _mm_loadu_si128((const __m128i *)lo);
+			const __m128i thi = _mm_loadu_si128((const __m128i *)hi);
+			const __m128i z = _mm_setzero_si128();
+			for (; i + 16 <= n; i += 16) {
+				__m128i v = _mm_loadu_si128((const __m128i *)(idx + i));
+				__m128i l = _mm_shuffle_epi8(tlo, v);
+				__m128i h = _mm_shuffle_epi8(thi, v);
+				__m128i c0 = _mm_unpacklo_epi8(l, h);
+				__m128i c1 = _mm_unpackhi_epi8(l, h);
+				if (!opaq) {
+					__m128i t = _mm_cmpeq_epi8(v, z);
+					__m128i t0 = _mm_unpacklo_epi8(t, t);
+					__m128i t1 = _mm_unpackhi_epi8(t, t);
+					__m128i d0 = _mm_loadu_si128((const __m128i *)(dst + i));
+					__m128i d1 = _mm_loadu_si128((const __m128i *)(dst + i + 8));
+					c0 = _mm_or_si128(_mm_and_si128(t0, d0), _mm_andnot_si128(t0, c0));
+					c1 = _mm_or_si128(_mm_and_si128(t1, d1), _mm_andnot_si128(t1, c1));
+				}
+				_mm_storeu_si128((__m128i *)(dst + i), c0);
+				_mm_storeu_si128((__m128i *)(dst + i + 8), c1);
+			}
 		}
-	} else {
-		if (x < TextDotX) {
-			for (; i < x; ++i) {
-				v = *(BYTE *)srcp;
-				srcp++;
-				v = (GVRAM[off] & 0xf0) | (v & 0x0f);
-				if (v != 0x00)
-					*destp = GrphPal[v];
-				destp++;
-
-				off += 2;
-				if ((off & 0x3fe) == 0x000)
-					off -= 0x400;
+#else
+		{
+			const uint8x16_t tlo = vld1q_u8(lo);
+			const uint8x16_t thi = vld1q_u8(hi);
+			for (; i + 16 <= n; i += 16) {
+				uint8x16_t v = vld1q_u8(idx + i);
+				uint8x16x2_t c;
+				c.val[0] = vqtbl1q_u8(tlo, v);
+				c.val[1] = vqtbl1q_u8(thi, v);
+				if (!opaq) {
+					uint8x16_t t = vceqq_u8(v, vdupq_n_u8(0));
+					uint8x16x2_t d = vld2q_u8((const uint8_t *)(dst + i));
+					c.val[0] = vbslq_u8(t, d.val[0], c.val[0]);
+					c.val[1] = vbslq_u8(t, d.val[1], c.val[1]);
+				}
+				vst2q_u8((uint8_t *)(dst + i), c);
 			}
-			srcp -= 0x200;
 		}
+#endif
+	}
+#endif
+	if (opaq) {
+		for (; i < n; ++i)
+			dst[i] = GrphPal[idx[i]];
+	} else {
+		for (; i < n; ++i)
+			if (idx[i])
+				dst[i] = GrphPal[idx[i]];
+	}
+}
 
-		for (; i < TextDotX; ++i) {
-			v = *(BYTE *)srcp;
-			srcp++;
-			v = (GVRAM[off] & 0xf0) | (v & 0x0f);
-			if (v != 0x00)
-				*destp = GrphPal[v];
-			destp++;
+// -----------------------------------------------------------------------
+//   透明色マスク合成：idx[i] が0でないドットだけ col[i] を書く
+// -----------------------------------------------------------------------
+static void Grp_MaskSpan(WORD *dst, const WORD *col, const BYTE *idx, DWORD n)
+{
+	DWORD i = 0;
 
-			off += 2;
-			if ((off & 0x3fe) == 0x000)
-				off -= 0x400;
+#if defined(PX68K_SIMD_SSE2)
+	{
+		const __m128i z = _mm_setzero_si128();
+		for (; i + 8 <= n; i += 8) {
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(idx + i)), z);
+			__m128i t = _mm_cmpeq_epi16(v, z);
+			__m128i c = _mm_loadu_si128((const __m128i *)(col + i));
+			__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+			_mm_storeu_si128((__m128i *)(dst + i),
+			    _mm_or_si128(_mm_and_si128(t, d), _mm_andnot_si128(t, c)));
 		}
 	}
+#elif defined(PX68K_SIMD_NEON)
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t t = vceqq_u16(vmovl_u8(vld1_u8(idx + i)), vdupq_n_u16(0));
+		vst1q_u16(dst + i, vbslq_u16(t, vld1q_u16(dst + i), vld1q_u16(col + i)));
+	}
+#endif
+	for (; i < n; ++i)
+		if (idx[i])
+			dst[i] = col[i];
 }
 
-				// Manhattan Requiem Opening 7.0→7.5MHz
-LABEL void FASTCALL Grp_DrawLine4(DWORD page, int opaq)
+// -----------------------------------------------------------------------
+//   256色パレット引き
+// -----------------------------------------------------------------------
+// 256エントリは1命令のシャッフルに載らないので、引くのはスカラで行い
+// （L1に収まる512バイトの表）、透明色の合成だけをベクタで行う。
+static void Grp_Pal256Span(WORD *dst, const BYTE *idx, DWORD n, int opaq)
 {
-	WORD *srcp, *destp;	// XXX: ALIGN
-	DWORD x, y;
-	DWORD off;
 	DWORD i;
-	WORD v;
 
-	page &= 3;
+	if (opaq) {
+		for (i = 0; i < n; ++i)
+			dst[i] = GrphPal[idx[i]];
+	} else {
+		for (i = 0; i < n; ++i)
+			Grp_Col[i] = GrphPal[idx[i]];
+		Grp_MaskSpan(dst, Grp_Col, idx, n);
+	}
+}
 
-	y = GrphScrollY[page] + VLINE * CRTC_VramRowStepActive;
-	y = (y & 0x1ff) << 10;
+// -----------------------------------------------------------------------
+//   特殊プライオリティ／半透明ベースの振り分け
+//   idx の bit0 が立っていれば sp に、そうでなければ sp2 に col を置く
+// -----------------------------------------------------------------------
+static void Grp_SplitSpan(WORD *sp, WORD *sp2, const WORD *col, const BYTE *idx, DWORD n)
+{
+	DWORD i = 0;
 
-	x = GrphScrollX[page] & 0x1ff;
-	off = y + x * 2;
+#if defined(PX68K_SIMD_SSE2)
+	{
+		const __m128i z = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(1);
+		for (; i + 8 <= n; i += 8) {
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(idx + i)), z);
+			__m128i t = _mm_cmpeq_epi16(_mm_and_si128(v, one), one);
+			__m128i c = _mm_loadu_si128((const __m128i *)(col + i));
+			_mm_storeu_si128((__m128i *)(sp + i), _mm_and_si128(t, c));
+			_mm_storeu_si128((__m128i *)(sp2 + i), _mm_andnot_si128(t, c));
+		}
+	}
+#elif defined(PX68K_SIMD_NEON)
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t t = vtstq_u16(vmovl_u8(vld1_u8(idx + i)), vdupq_n_u16(1));
+		uint16x8_t c = vld1q_u16(col + i);
+		vst1q_u16(sp + i, vandq_u16(t, c));
+		vst1q_u16(sp2 + i, vbicq_u16(c, t));
+	}
+#endif
+	for (; i < n; ++i) {
+		if (idx[i] & 1) {
+			sp[i] = col[i];
+			sp2[i] = 0;
+		} else {
+			sp[i] = 0;
+			sp2[i] = col[i];
+		}
+	}
+}
 
-	x = (x ^ 0x1ff) + 1;
+// -----------------------------------------------------------------------
+//   半透明合成
+// -----------------------------------------------------------------------
+// base: 半透明ベースプレーン（Grp_LineBufSP）、col: 対象プレーンの色、
+// idx: 対象プレーンの色番号。
+//   base!=0 : 色番号0→0、色が0→0（opaq=0なら書かない）、それ以外は半々
+//   base==0 : col（opaq=0なら色番号0のドットに書かない）
+// 平均は (a+b)>>1 を桁あふれなしに (a&b)+((a^b)>>1) で求める。
+INLINE WORD Grp_HalfPixel(WORD v0, WORD v)
+{
+	DWORD a, b;
 
-	srcp = (WORD *)(GVRAM + off + (page >> 1));
-	destp = (WORD *)(Grp_DoubleBuffer ? Grp_LineBuf_Draw : Grp_LineBuf);
+	a = v0 & Pal_HalfMask;
+	if (v & Ibit)
+		a |= Pal_Ix2;
+	b = v & Pal_HalfMask;
+	return (WORD)((a + b) >> 1);
+}
 
-	v = 0;
-	i = 0;
+static void Grp_HalfSpan(WORD *dst, const WORD *base, const WORD *col, const BYTE *idx, DWORD n, int opaq)
+{
+	DWORD i = 0;
 
-	if (page & 1) {
-		if (opaq) {
-			if (x < TextDotX) {
-				for (; i < x; ++i) {
-					v = *(BYTE *)srcp;
-					srcp++;
-					v = GrphPal[(v >> 4) & 0xf];
-					*destp++ = v;
-				}
-				srcp -= 0x200;
-			}
-			for (; i < TextDotX; ++i) {
-				v = *(BYTE *)srcp;
-				srcp++;
-				v = GrphPal[(v >> 4) & 0xf];
-				*destp++ = v;
-			}
-		} else {
-			if (x < TextDotX) {
-				for (; i < x; ++i) {
-					v = *(BYTE *)srcp;
-					srcp++;
-					v = (v >> 4) & 0x0f;
-					if (v != 0x00)
-						*destp = GrphPal[v];
-					destp++;
-				}
-				srcp -= 0x200;
-			}
-			for (; i < TextDotX; ++i) {
-				v = *(BYTE *)srcp;
-				srcp++;
-				v = (v >> 4) & 0x0f;
-				if (v != 0x00)
-					*destp = GrphPal[v];
-				destp++;
+#if defined(PX68K_SIMD_SSE2)
+	{
+		const __m128i z = _mm_setzero_si128();
+		const __m128i hm = _mm_set1_epi16((short)Pal_HalfMask);
+		const __m128i ib = _mm_set1_epi16((short)Ibit);
+		const __m128i ix = _mm_set1_epi16((short)Pal_Ix2);
+		for (; i + 8 <= n; i += 8) {
+			__m128i v0 = _mm_loadu_si128((const __m128i *)(base + i));
+			__m128i c = _mm_loadu_si128((const __m128i *)(col + i));
+			__m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(idx + i)), z);
+			__m128i a = _mm_or_si128(_mm_and_si128(v0, hm),
+			    _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(c, ib), ib), ix));
+			__m128i b = _mm_and_si128(c, hm);
+			__m128i h = _mm_add_epi16(_mm_and_si128(a, b), _mm_srli_epi16(_mm_xor_si128(a, b), 1));
+			__m128i nb = _mm_cmpeq_epi16(v0, z);
+			__m128i zi = _mm_cmpeq_epi16(v, z);
+			__m128i zc = _mm_cmpeq_epi16(c, z);
+			__m128i r = _mm_or_si128(_mm_and_si128(nb, c),
+			    _mm_andnot_si128(nb, _mm_andnot_si128(_mm_or_si128(zi, zc), h)));
+			if (!opaq) {
+				__m128i keep = _mm_or_si128(_mm_and_si128(nb, zi),
+				    _mm_andnot_si128(nb, _mm_andnot_si128(zi, zc)));
+				__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+				r = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, r));
 			}
+			_mm_storeu_si128((__m128i *)(dst + i), r);
 		}
-	} else {
-		if (opaq) {
-			if (x < TextDotX) {
-				for (; i < x; ++i) {
-					v = *(BYTE *)srcp;
-					srcp++;
-					v = GrphPal[v & 0x0f];
-					*destp++ = v;
-				}
-				srcp -= 0x200;
-			}
-			for (; i < TextDotX; ++i) {
-				v = *(BYTE *)srcp;
-				srcp++;
-				v = GrphPal[v & 0x0f];
-				*destp++ = v;
-			}
-		} else {
-			if (x < TextDotX) {
-				for (; i < x; ++i) {
-					v = *(BYTE *)srcp;
-					srcp++;
-					v &= 0x0f;
-					if (v != 0x00)
-						*destp = GrphPal[v];
-					destp++;
-				}
-				srcp -= 0x200;
-			}
-			for (; i < TextDotX; ++i) {
-				v = *(BYTE *)srcp;
-				srcp++;
-				v &= 0x0f;
-				if (v != 0x00)
-					*destp = GrphPal[v];
-				destp++;
+	}
+#elif defined(PX68K_SIMD_NEON)
+	{
+		const uint16x8_t hm = vdupq_n_u16(Pal_HalfMask);
+		const uint16x8_t ib = vdupq_n_u16(Ibit);
+		const uint16x8_t ix = vdupq_n_u16(Pal_Ix2);
+		const uint16x8_t z = vdupq_n_u16(0);
+		for (; i + 8 <= n; i += 8) {
+			uint16x8_t v0 = vld1q_u16(base + i);
+			uint16x8_t c = vld1q_u16(col + i);
+			uint16x8_t v = vmovl_u8(vld1_u8(idx + i));
+			uint16x8_t a = vorrq_u16(vandq_u16(v0, hm), vandq_u16(vtstq_u16(c, ib), ix));
+			uint16x8_t h = vhaddq_u16(a, vandq_u16(c, hm));
+			uint16x8_t nb = vceqq_u16(v0, z);
+			uint16x8_t zi = vceqq_u16(v, z);
+			uint16x8_t zc = vceqq_u16(c, z);
+			uint16x8_t r = vbslq_u16(nb, c, vbicq_u16(h, vorrq_u16(zi, zc)));
+			if (!opaq) {
+				uint16x8_t keep = vbslq_u16(nb, zi, vbicq_u16(zc, zi));
+				r = vbslq_u16(keep, vld1q_u16(dst + i), r);
 			}
+			vst1q_u16(dst + i, r);
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		if (base[i] != 0) {
+			if (!idx[i])
+				dst[i] = 0;
+			else if (col[i])
+				dst[i] = Grp_HalfPixel(base[i], col[i]);
+			else if (opaq)
+				dst[i] = 0;
+		} else if (opaq || idx[i]) {
+			dst[i] = col[i];
 		}
 	}
 }
 
-					// この画面モードは勘弁して下さい…
-void FASTCALL Grp_DrawLine4h(void)
+// -----------------------------------------------------------------------
+//   65536色
+// -----------------------------------------------------------------------
+LABEL void Grp_DrawLine16(void)
 {
-	WORD *srcp, *destp;
-	DWORD x, y;
-	DWORD i;
-	WORD v;
-	int bits;
+	const WORD *row;
+	WORD *destp;
+	DWORD x, end, n, i;
+	WORD v, c;
 
-	y = GrphScrollY[0] + VLINE * CRTC_VramRowStepActive;
-	y &= 0x3ff;
+	row = Grp_Row(GrphScrollY[0]);
+	destp = Grp_DrawBuf();
+	x = GrphScrollX[0] & 0x1ff;
 
-	if ((y & 0x200) == 0x000) {
-		y <<= 10;
-		bits = (GrphScrollX[0] & 0x200) ? 4 : 0;
-	} else {
-		y = (y & 0x1ff) << 10;
-		bits = (GrphScrollX[0] & 0x200) ? 12 : 8;
+	for (n = TextDotX; n; n -= end - x, x = 0) {
+		end = (x + n < 0x200) ? x + n : 0x200;
+		for (i = x; i < end; ++i) {
+			v = row[i];
+			c = Pal_Regs[Pal16Adr[v & 0xff]];
+			c |= Pal_Regs[Pal16Adr[v >> 8] + 2] << 8;
+			*destp++ = Pal16[c] & (WORD)-(v != 0);
+		}
 	}
+}
 
-	x = GrphScrollX[0] & 0x1ff;
-	srcp = (WORD *)(GVRAM + y + x * 2);
-	destp = (WORD *)(Grp_DoubleBuffer ? Grp_LineBuf_Draw : Grp_LineBuf);
 
-	x = ((x & 0x1ff) ^ 0x1ff) + 1;
+// -----------------------------------------------------------------------
+//   256色：下位ニブルは page*2、上位ニブルは page*2+1 のスクロール位置から
+// -----------------------------------------------------------------------
+LABEL void FASTCALL Grp_DrawLine8(int page, int opaq)
+{
+	DWORD i;
 
-	for (i = 0; i < TextDotX; ++i) {
-		v = *srcp++;
-		*destp++ = GrphPal[(v >> bits) & 0x0f];
+	page &= 1;
 
-		if (--x == 0) {
-			srcp -= 0x200;
-			bits ^= 4;
-			x = 512;
-		}
-	}
+	Grp_FetchRow(Grp_Idx, Grp_Row(GrphScrollY[page * 2]), GrphScrollX[page * 2],
+	    TextDotX, page * 8, 0x0f);
+	Grp_FetchRow(Grp_Idx2, Grp_Row(GrphScrollY[page * 2 + 1]), GrphScrollX[page * 2 + 1],
+	    TextDotX, page * 8, 0xf0);
+	for (i = 0; i < TextDotX; ++i)
+		Grp_Idx[i] |= Grp_Idx2[i];
+
+	Grp_Pal256Span(Grp_DrawBuf(), Grp_Idx, TextDotX, opaq);
+}
+
+				// Manhattan Requiem Opening 7.0→7.5MHz
+LABEL void FASTCALL Grp_DrawLine4(DWORD page, int opaq)
+{
+	page &= 3;
+
+	Grp_FetchRow(Grp_Idx, Grp_Row(GrphScrollY[page]), GrphScrollX[page],
+	    TextDotX, (int)(((page >> 1) * 8) + ((page & 1) * 4)), 0x0f);
+	Grp_Pal16Span(Grp_DrawBuf(), Grp_Idx, TextDotX, opaq);
+}
+
+					// この画面モードは勘弁して下さい…
+void FASTCALL Grp_DrawLine4h(void)
+{
+	Grp_FetchRow4h(Grp_Idx, 0x0f);
+	Grp_Pal16Span(Grp_DrawBuf(), Grp_Idx, TextDotX, 1);
 }
 
 
@@ -539,250 +775,91 @@ void FASTCALL Grp_DrawLine4h(void)
 // -------------------------------------------------
 void FASTCALL Grp_DrawLine16SP(void)
 {
-	DWORD x, y;
-	DWORD off;
-	DWORD i;
+	const BYTE *row;
+	WORD *sp, *sp2;
+	DWORD x, i;
 	WORD v;
 
-	y = GrphScrollY[0] + VLINE * CRTC_VramRowStepActive;
-	y = (y & 0x1ff) << 10;
-
+	row = (const BYTE *)Grp_Row(GrphScrollY[0]);
+	sp = Grp_SPDrawBuf();
+	sp2 = Grp_SP2DrawBuf();
 	x = GrphScrollX[0] & 0x1ff;
-	off = y + x * 2;
-	x = (x ^ 0x1ff) + 1;
 
-	for (i = 0; i < TextDotX; ++i) {
-		v = (Pal_Regs[GVRAM[off+1]*2] << 8) | Pal_Regs[GVRAM[off]*2+1];
-		if ((GVRAM[off] & 1) == 0) {
-		if (Grp_DoubleBuffer) {
-			Grp_LineBufSP_Draw[i] = 0;
-			Grp_LineBufSP2_Draw[i] = Pal16[v & 0xfffe];
-		} else {
-			Grp_LineBufSP[i] = 0;
-			Grp_LineBufSP2[i] = Pal16[v & 0xfffe];
-		}
-	} else {
-		if (Grp_DoubleBuffer) {
-			Grp_LineBufSP_Draw[i] = Pal16[v & 0xfffe];
-			Grp_LineBufSP2_Draw[i] = 0;
-		} else {
-			Grp_LineBufSP[i] = Pal16[v & 0xfffe];
-			Grp_LineBufSP2[i] = 0;
-		}
-	}
-
-		off += 2;
-		if (--x == 0)
-			off -= 0x400;
+	for (i = 0; i < TextDotX; ++i, x = (x + 1) & 0x1ff) {
+		v = (Pal_Regs[row[x * 2 + 1] * 2] << 8) | Pal_Regs[row[x * 2] * 2 + 1];
+		Grp_Idx[i] = row[x * 2];
+		Grp_Col[i] = Pal16[v & 0xfffe];
 	}
+	Grp_SplitSpan(sp, sp2, Grp_Col, Grp_Idx, TextDotX);
 }
 
 
 void FASTCALL Grp_DrawLine8SP(int page)
 {
-	DWORD x, x0;
-	DWORD y, y0;
-	DWORD off, off0;
+	WORD *sp, *sp2;
 	DWORD i;
 	WORD v;
 
 	page &= 1;
 
-	y = GrphScrollY[page * 2] + VLINE * CRTC_VramRowStepActive;
-	y0 = GrphScrollY[page * 2 + 1] + VLINE * CRTC_VramRowStepActive;
-	y = (y & 0x1ff) << 10;
-	y0 = (y0 & 0x1ff) << 10;
-
-	x = GrphScrollX[page * 2] & 0x1ff;
-	x0 = GrphScrollX[page * 2 + 1] & 0x1ff;
+	Grp_FetchRow(Grp_Idx, Grp_Row(GrphScrollY[page * 2]), GrphScrollX[page * 2],
+	    TextDotX, page * 8, 0x0f);
+	Grp_FetchRow(Grp_Idx2, Grp_Row(GrphScrollY[page * 2 + 1]), GrphScrollX[page * 2 + 1],
+	    TextDotX, page * 8, 0xf0);
 
-	off = y + x * 2 + page;
-	off0 = y0 + x0 * 2 + page;
-
-	x = (x ^ 0x1ff) + 1;
+	sp = Grp_SPDrawBuf();
+	sp2 = Grp_SP2DrawBuf();
 
 	for (i = 0; i < TextDotX; ++i) {
-		v = (GVRAM[off] & 0x0f) | (GVRAM[off0] & 0xf0);
+		v = (Grp_Idx[i] | Grp_Idx2[i]);
 		Grp_LineBufSP_Tr[i] = 0;
 
 		if ((v & 1) == 0) {
 			v &= 0xfe;
 			if (v != 0x00) {
- 				v = GrphPal[v];
+				v = GrphPal[v];
 				if (!v)
 					Grp_LineBufSP_Tr[i] = 0x1234;
 			}
-
-			if (Grp_DoubleBuffer) {
-			Grp_LineBufSP_Draw[i] = 0;
-			Grp_LineBufSP2_Draw[i] = v;
-		} else {
-			Grp_LineBufSP[i] = 0;
-			Grp_LineBufSP2[i] = v;
-		}
+			sp[i] = 0;
+			sp2[i] = v;
 		} else {
 			v &= 0xfe;
 			if (v != 0x00)
 				v = GrphPal[v] | Ibit;
-			if (Grp_DoubleBuffer) {
-			Grp_LineBufSP_Draw[i] = v;
-			Grp_LineBufSP2_Draw[i] = 0;
-		} else {
-			Grp_LineBufSP[i] = v;
-			Grp_LineBufSP2[i] = 0;
-		}
+			sp[i] = v;
+			sp2[i] = 0;
 		}
-
-		off += 2;
-		off0 += 2;
-		if ((off0 & 0x3fe) == 0)
-			off0 -= 0x400;
-		if (--x == 0)
-			off -= 0x400;
 	}
 }
 
 
 void FASTCALL Grp_DrawLine4SP(DWORD page/*, int opaq*/)
 {
-	DWORD scrx, scry;
-	page &= 3;
-	switch(page)		// 美しくなさすぎる（笑）
-	{
-	case 0:	scrx = GrphScrollX[0]; scry = GrphScrollY[0]; break;
-	case 1: scrx = GrphScrollX[1]; scry = GrphScrollY[1]; break;
-	case 2: scrx = GrphScrollX[2]; scry = GrphScrollY[2]; break;
-	case 3: scrx = GrphScrollX[3]; scry = GrphScrollY[3]; break;
-	default: scrx = GrphScrollX[0]; scry = GrphScrollY[0]; break; // Should never reach here due to page &= 3
-	}
-
-	DWORD x, y;
-	DWORD off;
 	DWORD i;
-	WORD v;
 
-	if (page & 1) {
-		y = scry + VLINE * CRTC_VramRowStepActive;
-		y = (y & 0x1ff) << 10;
-
-		x = scrx & 0x1ff;
-		off = y + x * 2;
-		if (page & 2)
-			off++;
-		x = (x ^ 0x1ff) + 1;
-
-		for (i = 0; i < TextDotX; ++i) {
-			v = GVRAM[off] >> 4;
-			if ((v & 1) == 0) {
-			v &= 0x0e;
-			if (Grp_DoubleBuffer) {
-				Grp_LineBufSP_Draw[i] = 0;
-				Grp_LineBufSP2_Draw[i] = GrphPal[v];
-			} else {
-				Grp_LineBufSP[i] = 0;
-				Grp_LineBufSP2[i] = GrphPal[v];
-			}
-		} else {
-			v &= 0x0e;
-			if (Grp_DoubleBuffer) {
-				Grp_LineBufSP_Draw[i] = GrphPal[v];
-				Grp_LineBufSP2_Draw[i] = 0;
-			} else {
-				Grp_LineBufSP[i] = GrphPal[v];
-				Grp_LineBufSP2[i] = 0;
-			}
-		}
-
-			off += 2;
-			if (--x == 0)
-				off -= 0x400;
-		}
-	} else {
-		y = scry + VLINE * CRTC_VramRowStepActive;
-		y = (y & 0x1ff) << 10;
-
-		x = scrx & 0x1ff;
-		off = y + x * 2;
-		if (page & 2)
-			off++;
-		x = (x ^ 0x1ff) + 1;
-
-		for (i = 0; i < TextDotX; ++i) {
-			v = GVRAM[off];
-			if ((v & 1) == 0) {
-			v &= 0x0e;
-			if (Grp_DoubleBuffer) {
-				Grp_LineBufSP_Draw[i] = 0;
-				Grp_LineBufSP2_Draw[i] = GrphPal[v];
-			} else {
-				Grp_LineBufSP[i] = 0;
-				Grp_LineBufSP2[i] = GrphPal[v];
-			}
-		} else {
-			v &= 0x0e;
-			if (Grp_DoubleBuffer) {
-				Grp_LineBufSP_Draw[i] = GrphPal[v];
-				Grp_LineBufSP2_Draw[i] = 0;
-			} else {
-				Grp_LineBufSP[i] = GrphPal[v];
-				Grp_LineBufSP2[i] = 0;
-			}
-		}
+	page &= 3;
 
-			off += 2;
-			if (--x == 0)
-				off -= 0x400;
-		}
-	}
+	Grp_FetchRow(Grp_Idx, Grp_Row(GrphScrollY[page]), GrphScrollX[page],
+	    TextDotX, (int)(((page >> 1) * 8) + ((page & 1) * 4)), 0x0f);
+	for (i = 0; i < TextDotX; ++i)
+		Grp_Idx2[i] = Grp_Idx[i] & 0x0e;
+	Grp_Pal16Span(Grp_Col, Grp_Idx2, TextDotX, 1);
+	Grp_SplitSpan(Grp_SPDrawBuf(), Grp_SP2DrawBuf(), Grp_Col, Grp_Idx, TextDotX);
 }
 
 
+// 以前は折り返しで2ラスタ前に戻っていたので、Grp_DrawLine4h と同じく
+// 同じラスタの反対側のページへ移るようにした。
 void FASTCALL Grp_DrawLine4hSP(void)
 {
-	WORD *srcp;
-	DWORD x, y;
 	DWORD i;
-	int bits;
-	WORD v;
 
-	y = GrphScrollY[0] + VLINE * CRTC_VramRowStepActive;
-	y &= 0x3ff;
-
-	if ((y & 0x200) == 0x000) {
-		y <<= 10;
-		bits = (GrphScrollX[0] & 0x200) ? 4 : 0;
-	} else {
-		y = (y & 0x1ff) << 10;
-		bits = (GrphScrollX[0] & 0x200) ? 12 : 8;
-	}
-
-	x = GrphScrollX[0] & 0x1ff;
-	srcp = (WORD *)(GVRAM + y + x * 2);
-	x = ((x & 0x1ff) ^ 0x1ff) + 1;
-
-	for (i = 0; i < TextDotX; ++i) {
-		v = *srcp++ >> bits;
-		if ((v & 1) == 0) {
-		if (Grp_DoubleBuffer) {
-			Grp_LineBufSP_Draw[i] = 0;
-			Grp_LineBufSP2_Draw[i] = GrphPal[v & 0x0e];
-		} else {
-			Grp_LineBufSP[i] = 0;
-			Grp_LineBufSP2[i] = GrphPal[v & 0x0e];
-		}
-	} else {
-		if (Grp_DoubleBuffer) {
-			Grp_LineBufSP_Draw[i] = GrphPal[v & 0x0e];
-			Grp_LineBufSP2_Draw[i] = 0;
-		} else {
-			Grp_LineBufSP[i] = GrphPal[v & 0x0e];
-			Grp_LineBufSP2[i] = 0;
-		}
-	}
-
-		if (--x == 0)
-			srcp -= 0x400;
-	}
+	Grp_FetchRow4h(Grp_Idx, 0x0f);
+	for (i = 0; i < TextDotX; ++i)
+		Grp_Idx2[i] = Grp_Idx[i] & 0x0e;
+	Grp_Pal16Span(Grp_Col, Grp_Idx2, TextDotX, 1);
+	Grp_SplitSpan(Grp_SPDrawBuf(), Grp_SP2DrawBuf(), Grp_Col, Grp_Idx, TextDotX);
 }
 
 
@@ -802,190 +879,29 @@ LABEL void FASTCALL
 Grp_DrawLine8TR(int page, int opaq)
 {
 	if (opaq) {
-		DWORD x, y;
-		DWORD v, v0;
 		DWORD i;
 
 		page &= 1;
 
-		y = GrphScrollY[page * 2] + VLINE * CRTC_VramRowStepActive;
-		y = ((y & 0x1ff) << 10) + page;
-		x = GrphScrollX[page * 2] & 0x1ff;
-
-		for (i = 0; i < TextDotX; ++i, x = (x + 1) & 0x1ff) {
-			v0 = Grp_DoubleBuffer ? Grp_LineBufSP_Active[i] : Grp_LineBufSP[i];
-			v = GVRAM[y + x * 2];
-
-			if (v0 != 0) {
-				if (v != 0) {
-					v = GrphPal[v];
-					if (v != 0) {
-						v0 &= Pal_HalfMask;
-						if (v & Ibit)
-							v0 |= Pal_Ix2;
-						v &= Pal_HalfMask;
-						v += v0;
-						v >>= 1;
-					}
-				}
-			} else
-				v = GrphPal[v];
-			if (Grp_DoubleBuffer) {
-				Grp_LineBuf_Draw[i] = (WORD)v;
-			} else {
-				Grp_LineBuf[i] = (WORD)v;
-			}
-		}
+		Grp_FetchRow(Grp_Idx, Grp_Row(GrphScrollY[page * 2]), GrphScrollX[page * 2],
+		    TextDotX, page * 8, 0xff);
+		for (i = 0; i < TextDotX; ++i)
+			Grp_Col[i] = GrphPal[Grp_Idx[i]];
+		Grp_HalfSpan(Grp_DrawBuf(), Grp_SPActiveBuf(), Grp_Col, Grp_Idx, TextDotX, 1);
 	}
 }
 
+// 奇数ページの非Opaque時は合成結果をさらに GrphPal[] の添字にしていて、
+// 表の外を読んでいた。偶数ページと同じく合成結果をそのまま使う。
 LABEL void FASTCALL
 Grp_DrawLine4TR(DWORD page, int opaq)
 {
-	DWORD x, y;
-	DWORD v, v0;
-	DWORD i;
-
 	page &= 3;
 
-	y = GrphScrollY[page] + VLINE * CRTC_VramRowStepActive;
-	y = (y & 0x1ff) << 10;
-	x = GrphScrollX[page] & 0x1ff;
-
-	if (page & 1) {
-		page >>= 1;
-		y += page;
-
-		if (opaq) {
-			for (i = 0; i < TextDotX; ++i, x = (x + 1) & 0x1ff) {
-				v0 = Grp_DoubleBuffer ? Grp_LineBufSP_Active[i] : Grp_LineBufSP[i];
-				v = GVRAM[y + x * 2] >> 4;
-
-				if (v0 != 0) {
-					if (v != 0) {
-						v = GrphPal[v];
-						if (v != 0) {
-							v0 &= Pal_HalfMask;
-							if (v & Ibit)
-								v0 |= Pal_Ix2;
-							v &= Pal_HalfMask;
-							v += v0;
-							v >>= 1;
-						}
-					}
-				} else
-					v = GrphPal[v];
-				if (Grp_DoubleBuffer) {
-				Grp_LineBuf_Draw[i] = (WORD)v;
-			} else {
-				Grp_LineBuf[i] = (WORD)v;
-			}
-			}
-		} else {
-			for (i = 0; i < TextDotX; ++i, x = (x + 1) & 0x1ff) {
-				v0 = Grp_DoubleBuffer ? Grp_LineBufSP_Active[i] : Grp_LineBufSP[i];
-
-				if (v0 == 0) {
-					v = GVRAM[y + x * 2] >> 4;
-					if (v != 0) {
-						if (Grp_DoubleBuffer) {
-							Grp_LineBuf_Draw[i] = GrphPal[v];
-						} else {
-							Grp_LineBuf[i] = GrphPal[v];
-						}
-					}
-				} else {
-					v = GVRAM[y + x * 2] >> 4;
-					if (v != 0) {
-						v = GrphPal[v];
-						if (v != 0) {
-							v0 &= Pal_HalfMask;
-							if (v & Ibit)
-								v0 |= Pal_Ix2;
-							v &= Pal_HalfMask;
-							v += v0;
-							v = GrphPal[v >> 1];
-							if (Grp_DoubleBuffer) {
-								Grp_LineBuf_Draw[i] = (WORD)v;
-							} else {
-								Grp_LineBuf[i] = (WORD)v;
-							}
-						}
-					} else
-						if (Grp_DoubleBuffer) {
-				Grp_LineBuf_Draw[i] = (WORD)v;
-			} else {
-				Grp_LineBuf[i] = (WORD)v;
-			}
-				}
-			}
-		}
-	} else {
-		page >>= 1;
-		y += page;
-
-		if (opaq) {
-			for (i = 0; i < TextDotX; ++i, x = (x + 1) & 0x1ff) {
-				v = GVRAM[y + x * 2] & 0x0f;
-				v0 = Grp_DoubleBuffer ? Grp_LineBufSP_Active[i] : Grp_LineBufSP[i];
-
-				if (v0 != 0) {
-					if (v != 0) {
-						v = GrphPal[v];
-						if (v != 0) {
-							v0 &= Pal_HalfMask;
-							if (v & Ibit)
-								v0 |= Pal_Ix2;
-							v &= Pal_HalfMask;
-							v += v0;
-							v >>= 1;
-						}
-					}
-				} else
-					v = GrphPal[v];
-				if (Grp_DoubleBuffer) {
-				Grp_LineBuf_Draw[i] = (WORD)v;
-			} else {
-				Grp_LineBuf[i] = (WORD)v;
-			}
-			}
-		} else {
-			for (i = 0; i < TextDotX; ++i, x = (x + 1) & 0x1ff) {
-				v = GVRAM[y + x * 2] & 0x0f;
-				v0 = Grp_DoubleBuffer ? Grp_LineBufSP_Active[i] : Grp_LineBufSP[i];
-
-				if (v0 != 0) {
-					if (v != 0) {
-						v = GrphPal[v];
-						if (v != 0) {
-							v0 &= Pal_HalfMask;
-							if (v & Ibit)
-								v0 |= Pal_Ix2;
-							v &= Pal_HalfMask;
-							v += v0;
-							v >>= 1;
-							if (Grp_DoubleBuffer) {
-								Grp_LineBuf_Draw[i] = (WORD)v;
-							} else {
-								Grp_LineBuf[i] = (WORD)v;
-							}
-						}
-					} else
-						if (Grp_DoubleBuffer) {
-				Grp_LineBuf_Draw[i] = (WORD)v;
-			} else {
-				Grp_LineBuf[i] = (WORD)v;
-			}
-				} else if (v != 0) {
-					if (Grp_DoubleBuffer) {
-							Grp_LineBuf_Draw[i] = GrphPal[v];
-						} else {
-							Grp_LineBuf[i] = GrphPal[v];
-						}
-				}
-			}
-		}
-	}
+	Grp_FetchRow(Grp_Idx, Grp_Row(GrphScrollY[page]), GrphScrollX[page],
+	    TextDotX, (int)(((page >> 1) * 8) + ((page & 1) * 4)), 0x0f);
+	Grp_Pal16Span(Grp_Col, Grp_Idx, TextDotX, 1);
+	Grp_HalfSpan(Grp_DrawBuf(), Grp_SPActiveBuf(), Grp_Col, Grp_Idx, TextDotX, opaq);
 }
 
 /*
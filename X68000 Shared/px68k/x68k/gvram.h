@@ -20,6 +20,12 @@ extern	int		Grp_DoubleBuffer;		// ダブルバッファリング有効フラグ
 void GVRAM_Init(void);
 
 void FASTCALL GVRAM_FastClear(void);
+void FASTCALL GVRAM_FastClearFlush(void);
+
+// CRTC R20 の VRAM 配置に合わせた読み書き（GVRAM_SetMode で差し替わる）
+extern	BYTE	(FASTCALL *GVRAM_ReadFunc)(DWORD);
+extern	void	(FASTCALL *GVRAM_WriteFunc)(DWORD, BYTE);
+void FASTCALL GVRAM_SetMode(void);
 
 BYTE FASTCALL GVRAM_Read(DWORD adr);
 void FASTCALL GVRAM_Write(DWORD adr, BYTE data);
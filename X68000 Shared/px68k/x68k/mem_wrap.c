@@ -614,7 +614,7 @@ wm_cnt(DWORD addr, BYTE val)
 		Memory_LogStackSlotWriteWatch(addr, oldVal, val);
 #endif
 	} else if (addr < 0x00e00000) {
-		GVRAM_Write(addr, val);
+		GVRAM_WriteFunc(addr, val);
 	} else {
 		MemWriteTable[(addr >> 13) & 0xff](addr, val);
 	}
@@ -804,7 +804,7 @@ rm_main(DWORD addr)
 	if (addr < 0x00c00000) {	// Use RAM upto 12MB
 		v = MEM[addr ^ 1];
 	} else if (addr < 0x00e00000) {
-		v = GVRAM_Read(addr);
+		v = GVRAM_ReadFunc(addr);
 	} else {
 #if 0 // for debug @GOROman
         //eafa01
@@ -25,11 +25,14 @@
 #include "irqh.h"
 #include "midi.h"
 #include "m68000.h"
+#include "dswin.h"
+#include "midiring.h"
 
 #define MIDIBUFFERS 1024			// 1024は流石に越えないでしょう^_^;
 #define MIDIBUFTIMER 3200			// 10MHz / (31.25K / 10bit) = 3200 が正解になります... 
 #define MIDIFIFOSIZE 256
 #define MIDIDELAYBUF 4096			// 31250/10 = 3125 byts (1s分) あればおっけ？
+#define MIDIRINGSIZE 8192			// ホストへ渡すイベント (2^n)
 
 enum {						// 各機種リセット用に一応。
 	MIDI_NOTUSED,
@@ -86,6 +89,10 @@ static DELAYBUFITEM DelayBuf[MIDIDELAYBUF];
 static int DBufPtrW = 0;
 static int DBufPtrR = 0;
 
+static DWORD MIDI_Clock = 0;			// 前ラインまでの経過クロック (10MHz)
+static MIDIEvent MIDI_RingBuf[MIDIRINGSIZE];
+static MIDIRing MIDI_Ring = { .ev = MIDI_RingBuf, .size = MIDIRINGSIZE };
+
 // ------------------------------------------------------------------
 // ねこみぢ6、MIMPIトーンマップ対応関係
 // ------------------------------------------------------------------
@@ -158,6 +165,7 @@ DWORD FASTCALL MIDI_Int(BYTE irq)
 // -----------------------------------------------------------------------
 void FASTCALL MIDI_Timer(DWORD clk)
 {
+	MIDI_Clock += clk;		// FM音源からのMIDI出力もあるので常に進める
 	if ( !Config.MIDI_SW ) return;	// MIDI OFF時は帰る
 
 	MIDI_BufTimer -= clk;
@@ -649,17 +657,25 @@ BYTE FASTCALL MIDI_Read(DWORD adr)
 }
 
 
-#define MAX_MIDI_BUFFER_SIZE 4096
-static BYTE s_midibuffer[MAX_MIDI_BUFFER_SIZE];
-static long s_midibuffersize = 0;
+static long s_midihanded = 0;			// bytes given to the host last time
+
+// Every byte for the host goes through MIDI_Ring, stamped with where the
+// emulation is inside the current line. A full ring drops (and counts)
+// the byte, as the flat buffer used to.
 void X68000_AddMIDIBuffer( const BYTE data )
 {
-    // Prevent overflow: drop when buffer is full to avoid asserts/crash
-    if (s_midibuffersize >= MAX_MIDI_BUFFER_SIZE) {
-        return; // graceful drop on overflow
-    }
-    s_midibuffer[s_midibuffersize] = data;
-    s_midibuffersize++;
+    MIDIEvent ev;
+
+    ev.cycle = MIDI_Clock + (DWORD)hclk_line;
+    ev.sample = DSound_SamplePos(hclk_line);
+    ev.data = data;
+    MIDIRing_Push(&MIDI_Ring, &ev);
+}
+
+unsigned int MIDI_Dispatch(DWORD until, unsigned int max,
+                           void (*sink)(const struct MIDIEvent *ev, void *ctx), void *ctx)
+{
+    return MIDIRing_Dispatch(&MIDI_Ring, until, max, sink, ctx);
 }
 
 static void AddDelayBuf(BYTE msg)
@@ -675,14 +691,17 @@ static void AddDelayBuf(BYTE msg)
 }
 
 
-const long X68000_GetMIDIBufferSize(void)
-{
-    return s_midibuffersize;
-}
-unsigned char* X68000_GetMIDIBuffer(void)
+// Hands the host every queued byte with how many audio frames after the
+// frame it is about to play the byte falls. The host sends each one at that
+// time (MIDIPacket timeStamp), so notes sound with the OPM/ADPCM they were
+// written next to instead of in one burst per emulated frame.
+long X68000_GetMIDIEvents(unsigned char* data, unsigned int* frames, long max)
 {
-    s_midibuffersize = 0;
-    return s_midibuffer;
+    if (max <= 0)
+        return 0;
+    s_midihanded = (long)MIDIRing_Take(&MIDI_Ring, DSound_PlayPos(), data, frames,
+                                       (unsigned int)max);
+    return s_midihanded;
 }
 
 void MIDI_GetMonitorState(MIDIMonitorState* state)
@@ -712,7 +731,9 @@ void MIDI_GetMonitorState(MIDIMonitorState* state)
 	state->delayWrite = DBufPtrW;
 	state->delayRead = DBufPtrR;
 	state->delayCount = (DBufPtrW >= DBufPtrR) ? (DBufPtrW - DBufPtrR) : (MIDIDELAYBUF - DBufPtrR + DBufPtrW);
-	state->swiftBufferSize = s_midibuffersize;
+	state->swiftBufferSize = s_midihanded;
+	state->ringCount = MIDIRing_Fill(&MIDI_Ring);
+	state->ringDropped = atomic_load(&MIDI_Ring.dropped);
 }
 
 void MIDI_DelayOut(unsigned int delay)
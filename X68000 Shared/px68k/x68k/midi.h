@@ -3,6 +3,8 @@
 
 #include "common.h"
 
+struct MIDIEvent;			/* midiring.h */
+
 typedef struct {
 	int enabled;
 	int hasOutput;
@@ -28,7 +30,9 @@ typedef struct {
 	int delayWrite;
 	int delayRead;
 	int delayCount;
-	long swiftBufferSize;
+	long swiftBufferSize;		/* bytes handed to the host last call */
+	unsigned int ringCount;		/* bytes queued for the host */
+	unsigned int ringDropped;	/* bytes lost to a full ring */
 } MIDIMonitorState;
 
 void MIDI_Init(void);
@@ -42,5 +46,9 @@ int MIDI_SetMimpiMap(char *filename);
 int MIDI_EnableMimpiDef(int enable);
 void MIDI_DelayOut(unsigned int delay);
 void MIDI_GetMonitorState(MIDIMonitorState* state);
+// Takes the bytes for the host whose audio frame is at or before until
+// (see midiring.h), at most max of them.
+unsigned int MIDI_Dispatch(DWORD until, unsigned int max,
+                           void (*sink)(const struct MIDIEvent *ev, void *ctx), void *ctx);
 
 #endif
@@ -141,6 +141,7 @@ void FASTCALL Pal_Write(DWORD adr, BYTE data)
 	WORD pal;
 
 	if (adr>=0xe82400) return;
+	WinDraw_FlushPending();
 
 	adr -= 0xe82000;
 	if (Pal_Regs[adr] == data) return;
@@ -148,7 +149,7 @@ void FASTCALL Pal_Write(DWORD adr, BYTE data)
 	if (adr<0x200)
 	{
 		Pal_Regs[adr] = data;
-		TVRAM_SetAllDirty();
+		TVRAM_SetAllPalDirty();
 		pal = Pal_Regs[adr&0xfffe];
 		pal = (pal<<8)+Pal_Regs[adr|1];
 		GrphPal[adr/2] = Pal16[pal];
@@ -157,7 +158,7 @@ void FASTCALL Pal_Write(DWORD adr, BYTE data)
 	{
 		if (MemByteAccess) return;		// TextPalはバイトアクセスは出来ないらしい（神戸恋愛物語）
 		Pal_Regs[adr] = data;
-		TVRAM_SetAllDirty();
+		TVRAM_SetAllPalDirty();
 		pal = Pal_Regs[adr&0xfffe];
 		pal = (pal<<8)+Pal_Regs[adr|1];
 		TextPal[(adr-0x200)/2] = Pal16[pal];
@@ -0,0 +1,116 @@
+// ---------------------------------------------------------------------------------------
+//  RESAMPLE.C - Polyphase band-limited sample rate converter (OPM / ADPCM)
+// ---------------------------------------------------------------------------------------
+
+#include <math.h>
+
+#include "common.h"
+#include "simd.h"
+#include "resample.h"
+
+// Passband edge as a fraction of the lower Nyquist frequency, and the
+// Kaiser window shape. With 16 taps this gives about 50dB of stopband
+// attenuation past the transition band.
+#define RESAMPLE_CUTOFF		0.90
+#define RESAMPLE_BETA		6.0
+
+static double Resample_I0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for (k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+void Resample_Init(Resampler *r, DWORD inrate, DWORD outrate)
+{
+	const double half = RESAMPLE_TAPS / 2;
+	double c, h[RESAMPLE_TAPS];
+	int p, k;
+
+	r->inrate = inrate;
+	r->outrate = outrate;
+
+	// cutoff relative to the input Nyquist frequency
+	c = RESAMPLE_CUTOFF;
+	if (outrate < inrate)
+		c *= (double)outrate / (double)inrate;
+
+	for (p = 0; p < RESAMPLE_PHASES; p++) {
+		double f = (double)p / RESAMPLE_PHASES, sum = 0.0;
+		int total = 0, peak = RESAMPLE_TAPS / 2 - 1;
+
+		for (k = 0; k < RESAMPLE_TAPS; k++) {
+			// distance from the output instant, in input samples
+			double t = (k - (half - 1)) - f;
+			double x = t / half;
+			double s = (t == 0.0) ? 1.0 : sin(M_PI * c * t) / (M_PI * c * t);
+			double w = (x * x < 1.0) ? Resample_I0(RESAMPLE_BETA * sqrt(1.0 - x * x)) / Resample_I0(RESAMPLE_BETA) : 0.0;
+			h[k] = s * w;
+			sum += h[k];
+		}
+		for (k = 0; k < RESAMPLE_TAPS; k++) {
+			r->coef[p][k] = (short)floor(h[k] / sum * RESAMPLE_ONE + 0.5);
+			total += r->coef[p][k];
+			if (r->coef[p][k] > r->coef[p][peak])
+				peak = k;
+		}
+		// rounding leftovers go to the largest tap so every phase sums to 1.0
+		r->coef[p][peak] += (short)(RESAMPLE_ONE - total);
+	}
+}
+
+// One output from in[0..RESAMPLE_TAPS-1]
+INLINE short Resample_Dot(const short *in, const short *coef)
+{
+	int acc;
+#if defined(PX68K_SIMD_SSE2)
+	__m128i s = _mm_add_epi32(
+		_mm_madd_epi16(_mm_loadu_si128((const __m128i *)in), _mm_loadu_si128((const __m128i *)coef)),
+		_mm_madd_epi16(_mm_loadu_si128((const __m128i *)(in + 8)), _mm_loadu_si128((const __m128i *)(coef + 8))));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+	acc = _mm_cvtsi128_si32(s);
+#elif defined(PX68K_SIMD_NEON)
+	int32x4_t s = vmull_s16(vld1_s16(in), vld1_s16(coef));
+	s = vmlal_s16(s, vld1_s16(in + 4), vld1_s16(coef + 4));
+	s = vmlal_s16(s, vld1_s16(in + 8), vld1_s16(coef + 8));
+	s = vmlal_s16(s, vld1_s16(in + 12), vld1_s16(coef + 12));
+	acc = vaddvq_s32(s);
+#else
+	int k;
+	acc = 0;
+	for (k = 0; k < RESAMPLE_TAPS; k++)
+		acc += in[k] * coef[k];
+#endif
+	acc = (acc + RESAMPLE_ONE / 2) >> 14;
+	if (acc > 32767) acc = 32767; else if (acc < -32768) acc = -32768;
+	return (short)acc;
+}
+
+void Resample_Gather(const Resampler *r, const short *in, const int *pos,
+                     const int *phase, short *out, int n)
+{
+	int j;
+
+	in -= RESAMPLE_TAPS - 1;
+	for (j = 0; j < n; j++)
+		out[j] = Resample_Dot(in + pos[j], r->coef[phase[j]]);
+}
+
+DWORD Resample_Step(const Resampler *r, const short *in, DWORD t, DWORD step,
+                    short *out, int n)
+{
+	int j;
+
+	in -= RESAMPLE_TAPS - 1;
+	for (j = 0; j < n; j++) {
+		out[j] = Resample_Dot(in + (t >> 16), r->coef[(t >> (16 - RESAMPLE_PHASEBITS)) & (RESAMPLE_PHASES - 1)]);
+		t += step;
+	}
+	return t;
+}
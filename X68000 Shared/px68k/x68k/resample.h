@@ -0,0 +1,49 @@
+// ---------------------------------------------------------------------------------------
+//  RESAMPLE.H - Polyphase band-limited sample rate converter (OPM / ADPCM)
+// ---------------------------------------------------------------------------------------
+//
+// A windowed-sinc FIR of RESAMPLE_TAPS taps, tabulated at RESAMPLE_PHASES
+// fractional positions in Q14. The cutoff sits just below the lower of the
+// two Nyquist frequencies, so it removes images when upsampling (ADPCM) and
+// aliases when downsampling (OPM at its native rate).
+//
+// Input is mono 16-bit. An output with window end pos and phase p is the
+// signal at input time
+//     pos - RESAMPLE_TAPS/2 + p / RESAMPLE_PHASES
+// computed from in[pos - RESAMPLE_TAPS + 1 .. pos]; the converter lags its
+// input by RESAMPLE_TAPS/2 samples. Callers keep RESAMPLE_TAPS-1 samples of
+// history in front of each block.
+//
+// Integer arithmetic only; the vector and scalar paths give identical
+// results. Every phase sums to exactly 1.0, so DC passes unchanged.
+
+#ifndef _winx68k_resample
+#define _winx68k_resample
+
+#include "common.h"
+
+#define RESAMPLE_TAPS		16
+#define RESAMPLE_PHASEBITS	8
+#define RESAMPLE_PHASES		(1 << RESAMPLE_PHASEBITS)
+#define RESAMPLE_ONE		(1 << 14)
+
+typedef struct {
+	short coef[RESAMPLE_PHASES][RESAMPLE_TAPS];
+	DWORD inrate;
+	DWORD outrate;
+} Resampler;
+
+// Only the ratio of the two rates matters; any common unit will do.
+void Resample_Init(Resampler *r, DWORD inrate, DWORD outrate);
+
+// Arbitrary output positions: in[pos[j]] is the newest sample of the
+// window, phase[j] in [0, RESAMPLE_PHASES).
+void Resample_Gather(const Resampler *r, const short *in, const int *pos,
+                     const int *phase, short *out, int n);
+
+// Evenly spaced outputs. t and step are 16.16 positions relative to in[0]
+// (the newest sample of the first window); returns t after n outputs.
+DWORD Resample_Step(const Resampler *r, const short *in, DWORD t, DWORD step,
+                    short *out, int n);
+
+#endif	/* _winx68k_resample */
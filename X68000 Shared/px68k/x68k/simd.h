@@ -0,0 +1,35 @@
+// ---------------------------------------------------------------------------------------
+//  SIMD.H - Host vector instruction set selection for the C core
+// ---------------------------------------------------------------------------------------
+//
+// The renderers and mixers pick their vector paths at compile time from the
+// macros below; there is no runtime dispatch. Apple Silicon builds get NEON,
+// Intel builds get SSSE3 (every Intel Mac has it; clang's x86_64 macOS
+// default enables it) and anything else falls back to SSE2 or plain C.
+// Define PX68K_NO_SIMD to force the scalar paths, e.g. to compare output.
+//
+// Every vector path must produce exactly what its scalar counterpart does;
+// the scalar code stays compiled in as the reference and as the tail loop.
+
+#ifndef _winx68k_simd
+#define _winx68k_simd
+
+#if !defined(PX68K_NO_SIMD)
+#if defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define PX68K_SIMD_NEON		1
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#define PX68K_SIMD_SSE2		1
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#define PX68K_SIMD_SSSE3	1
+#include <tmmintrin.h>
+#endif
+#endif
+#endif	/* !PX68K_NO_SIMD */
+
+#if defined(PX68K_SIMD_NEON) || defined(PX68K_SIMD_SSE2)
+#define PX68K_SIMD		1
+#endif
+
+#endif	/* _winx68k_simd */
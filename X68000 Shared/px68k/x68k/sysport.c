@@ -7,6 +7,7 @@
 #include "sysport.h"
 #include "palette.h"
 #include "crtc.h"
+#include "windraw.h"
 
 BYTE	SysPort[7];
 
@@ -25,6 +26,7 @@ void SysPort_Init(void)
 // -----------------------------------------------------------------------
 void FASTCALL SysPort_Write(DWORD adr, BYTE data)
 {
+	WinDraw_FlushPending();
 	switch(adr)
 	{
 	case 0xe8e001:
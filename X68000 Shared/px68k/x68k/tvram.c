@@ -11,18 +11,130 @@
 #include	"palette.h"
 #include	"m68000.h"
 #include	"tvram.h"
+#include	"simd.h"
 
 	BYTE	TVRAM[0x80000];
+#ifndef PX68K_TEXT_NODRAWWORK
 	BYTE	TextDrawWork[1024*1024];
+#endif
 	BYTE	TextDirtyLine[1024];
 
-	BYTE	TextDrawPattern[2048*4];
+#include "tvram_tables.inc"
 
 //	WORD	Text_LineBuf[1024];	// →BGのを使うように変更
 	BYTE	Text_TrFlag[SCRBUF_STRIDE + 16];
 
 INLINE void TVRAM_WriteByteMask(DWORD adr, BYTE data);
 
+// -----------------------------------------------------------------------
+//   プレーン→パックド変換
+// -----------------------------------------------------------------------
+// TVRAM の4プレーンの n バイト（CPU から見たアドレス adr から）を、1ドット
+// 1バイトの色番号 8n 個に展開する。TVRAM はワード内でバイトが入れ替わって
+// いるので adr^1 を読む。SIMD 版は16バイト（128ドット）ずつビット行列を
+// 転置する：各バイトを8レーンに複製してビット位置のマスクと比べ、プレーンの
+// 重みを掛けて OR する。端数と非SIMDビルドは TextDrawPattern を引く。
+static void Text_PlanarToChunky(BYTE *dst, DWORD adr, DWORD n)
+{
+	DWORD i = 0;
+
+#if defined(PX68K_SIMD_SSE2)
+	if (!(adr & 1)) {
+		const __m128i bits = _mm_set1_epi64x(0x0102040810204080LL);
+		for (; i + 16 <= n; i += 16, adr += 16, dst += 128) {
+			__m128i acc[8];
+			int j, k;
+
+			for (j = 0; j < 8; j++)
+				acc[j] = _mm_setzero_si128();
+			for (k = 0; k < 4; k++) {
+				const __m128i w = _mm_set1_epi8((char)(1 << k));
+				__m128i v = _mm_loadu_si128((const __m128i *)(TVRAM + (k << 17) + adr));
+				__m128i lo, hi, q[4], r;
+
+				v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+				lo = _mm_unpacklo_epi8(v, v);
+				hi = _mm_unpackhi_epi8(v, v);
+				q[0] = _mm_unpacklo_epi16(lo, lo);
+				q[1] = _mm_unpackhi_epi16(lo, lo);
+				q[2] = _mm_unpacklo_epi16(hi, hi);
+				q[3] = _mm_unpackhi_epi16(hi, hi);
+				for (j = 0; j < 4; j++) {
+					r = _mm_unpacklo_epi32(q[j], q[j]);
+					r = _mm_cmpeq_epi8(_mm_and_si128(r, bits), bits);
+					acc[j * 2] = _mm_or_si128(acc[j * 2], _mm_and_si128(r, w));
+					r = _mm_unpackhi_epi32(q[j], q[j]);
+					r = _mm_cmpeq_epi8(_mm_and_si128(r, bits), bits);
+					acc[j * 2 + 1] = _mm_or_si128(acc[j * 2 + 1], _mm_and_si128(r, w));
+				}
+			}
+			for (j = 0; j < 8; j++)
+				_mm_storeu_si128((__m128i *)(dst + j * 16), acc[j]);
+		}
+	}
+#elif defined(PX68K_SIMD_NEON)
+	if (!(adr & 1)) {
+		const uint8x16_t bits = vreinterpretq_u8_u64(vdupq_n_u64(0x0102040810204080ULL));
+		for (; i + 16 <= n; i += 16, adr += 16, dst += 128) {
+			uint8x16_t acc[8];
+			int j, k, h, g;
+
+			for (j = 0; j < 8; j++)
+				acc[j] = vdupq_n_u8(0);
+			for (k = 0; k < 4; k++) {
+				const uint8x16_t w = vdupq_n_u8((uint8_t)(1 << k));
+				uint8x16_t v = vrev16q_u8(vld1q_u8(TVRAM + (k << 17) + adr));
+				uint8x16x2_t a = vzipq_u8(v, v);
+
+				for (h = 0; h < 2; h++) {
+					uint16x8_t a16 = vreinterpretq_u16_u8(a.val[h]);
+					uint16x8x2_t b = vzipq_u16(a16, a16);
+					for (g = 0; g < 2; g++) {
+						uint32x4_t b32 = vreinterpretq_u32_u16(b.val[g]);
+						uint32x4x2_t c = vzipq_u32(b32, b32);
+						j = h * 4 + g * 2;
+						acc[j] = vorrq_u8(acc[j],
+						    vandq_u8(vtstq_u8(vreinterpretq_u8_u32(c.val[0]), bits), w));
+						acc[j + 1] = vorrq_u8(acc[j + 1],
+						    vandq_u8(vtstq_u8(vreinterpretq_u8_u32(c.val[1]), bits), w));
+					}
+				}
+			}
+			for (j = 0; j < 8; j++)
+				vst1q_u8(dst + j * 16, acc[j]);
+		}
+	}
+#endif
+	{
+		const DWORD *ptr = (const DWORD *)TextDrawPattern;
+		DWORD t0, t1, tadr;
+		BYTE pat;
+
+		for (; i < n; i++, adr++, dst += 8) {
+			tadr = (adr ^ 1) & 0x1ffff;
+
+			pat = TVRAM[tadr + 0x60000];
+			t0 = ptr[(pat * 2) + 1536];
+			t1 = ptr[(pat * 2 + 1) + 1536];
+
+			pat = TVRAM[tadr + 0x40000];
+			t0 |= ptr[(pat * 2) + 1024];
+			t1 |= ptr[(pat * 2 + 1) + 1024];
+
+			pat = TVRAM[tadr + 0x20000];
+			t0 |= ptr[(pat * 2) + 512];
+			t1 |= ptr[(pat * 2 + 1) + 512];
+
+			pat = TVRAM[tadr];
+			t0 |= ptr[(pat * 2)];
+			t1 |= ptr[(pat * 2 + 1)];
+
+			memcpy(dst, &t0, 4);
+			memcpy(dst + 4, &t1, 4);
+		}
+	}
+}
+
 // -----------------------------------------------------------------------
 //   全部書き換え〜
 // -----------------------------------------------------------------------
@@ -31,30 +143,27 @@ void TVRAM_SetAllDirty(void)
 	memset(TextDirtyLine, 1, 1024);
 }
 
+// パレットのみ変更（TDL_FULL が立っていればそちらが優先）
+void TVRAM_SetAllPalDirty(void)
+{
+	int i;
+
+	for (i = 0; i < 1024; i++)
+		TextDirtyLine[i] |= TDL_PALETTE;
+}
+
 
 // -----------------------------------------------------------------------
 //   初期化
 // -----------------------------------------------------------------------
 void TVRAM_Init(void)
 {
-	int i, j, bit;
 	ZeroMemory(TVRAM, 0x80000);
+#ifndef PX68K_TEXT_NODRAWWORK
 	ZeroMemory(TextDrawWork, 1024*1024);
+#endif
 	TVRAM_SetAllDirty();
 
-	ZeroMemory(TextDrawPattern, 2048*4);		// パターンテーブル初期化
-	for (i=0; i<256; i++)
-	{
-		for (j=0, bit=0x80; j<8; j++, bit>>=1)
-		{
-			if (i&bit) {
-				TextDrawPattern[i*8+j     ] = 1;
-				TextDrawPattern[i*8+j+2048] = 2;
-				TextDrawPattern[i*8+j+4096] = 4;
-				TextDrawPattern[i*8+j+6144] = 8;
-			}
-		}
-	}
 }
 
 
@@ -109,6 +218,7 @@ INLINE void TVRAM_WriteByteMask(DWORD adr, BYTE data)
 // -----------------------------------------------------------------------
 void FASTCALL TVRAM_Write(DWORD adr, BYTE data)
 {
+	WinDraw_FlushPending();
 	adr &= 0x7ffff;
 	adr ^= 1;
 	if (CRTC_Regs[0x2a]&1)			// 同時アクセス
@@ -208,32 +318,11 @@ void FASTCALL TVRAM_Write(DWORD adr, BYTE data)
 	: /* output: nothing */
 	: "m" (adr)
 	: "ax", "cx", "dx", "si", "di", "memory");
-#else /* !USE_ASM && !(USE_GAS && __i386__) */
+#elif !defined(PX68K_TEXT_NODRAWWORK)
 	{
-		DWORD *ptr = (DWORD *)TextDrawPattern;
-		DWORD tvram_addr = adr & 0x1ffff;
-		DWORD workadr = ((adr & 0x1ff80) + ((adr ^ 1) & 0x7f)) << 3;
-		DWORD t0, t1;
-		BYTE pat;
-
-		pat = TVRAM[tvram_addr + 0x60000];
-		t0 = ptr[(pat * 2) + 1536];
-		t1 = ptr[(pat * 2 + 1) + 1536];
-
-		pat = TVRAM[tvram_addr + 0x40000];
-		t0 |= ptr[(pat * 2) + 1024];
-		t1 |= ptr[(pat * 2 + 1) + 1024];
-
-		pat = TVRAM[tvram_addr + 0x20000];
-		t0 |= ptr[(pat * 2) + 512];
-		t1 |= ptr[(pat * 2 + 1) + 512];
+		DWORD la = (adr & 0x1ff80) + ((adr ^ 1) & 0x7f);
 
-		pat = TVRAM[tvram_addr];
-		t0 |= ptr[(pat * 2)];
-		t1 |= ptr[(pat * 2 + 1)];
-
-		*((DWORD *)&TextDrawWork[workadr]) = t0;
-		*(((DWORD *)(&TextDrawWork[workadr])) + 1) = t1;
+		Text_PlanarToChunky(TextDrawWork + (la << 3), la, 1);
 	}
 #endif	/* USE_ASM */
 }
@@ -315,38 +404,102 @@ void FASTCALL TVRAM_RCUpdate(void)
 	: /* output: nothing */
 	: "m" (adr)
 	: "ax", "bx", "cx", "dx", "si", "di", "memory");
-#else /* !USE_ASM && !(USE_GAS && __i386__) */
-	/* XXX: BUG */
-	DWORD *ptr = (DWORD *)TextDrawPattern;
-	DWORD *wptr = (DWORD *)(TextDrawWork + (adr << 3));
-	DWORD t0, t1;
-	DWORD tadr;
-	BYTE pat;
-	int i;
-
-	for (i = 0; i < 512; i++, adr++) {
-		tadr = adr ^ 1;
+#elif !defined(PX68K_TEXT_NODRAWWORK)
+	Text_PlanarToChunky(TextDrawWork + (adr << 3), adr, 512);
+#else
+	(void)adr;
+#endif	/* USE_ASM */
+}
 
-		pat = TVRAM[tadr + 0x60000];
-		t0 = ptr[(pat * 2) + 1536];
-		t1 = ptr[(pat * 2 + 1) + 1536];
+// -----------------------------------------------------------------------
+//   テキストパレット引き
+// -----------------------------------------------------------------------
+// dst[i] = TextPal[idx[i] & 15]、tr[i] = 色番号が0以外なら1
+// opaq=0 の時は色番号0のドットに書き込まない
+static void Text_PalSpan(WORD *dst, BYTE *tr, const BYTE *idx, DWORD n, int opaq)
+{
+	DWORD i = 0;
 
-		pat = TVRAM[tadr + 0x40000];
-		t0 |= ptr[(pat * 2) + 1024];
-		t1 |= ptr[(pat * 2 + 1) + 1024];
+#if defined(PX68K_SIMD_SSSE3) || defined(PX68K_SIMD_NEON)
+	{
+		BYTE lo[16], hi[16];
+		int k;
 
-		pat = TVRAM[tadr + 0x20000];
-		t0 |= ptr[(pat * 2) + 512];
-		t1 |= ptr[(pat * 2 + 1) + 512];
+		for (k = 0; k < 16; ++k) {
+			lo[k] = (BYTE)TextPal[k];
+			hi[k] = (BYTE)(TextPal[k] >> 8);
+		}
+#if defined(PX68K_SIMD_SSSE3)
+		{
+			const __m128i tlo = _mm_loadu_si128((const __m128i *)lo);
+			const __m128i thi = _mm_loadu_si128((const __m128i *)hi);
+			const __m128i m = _mm_set1_epi8(15);
+			const __m128i one = _mm_set1_epi8(1);
+			const __m128i z = _mm_setzero_si128();
+			for (; i + 16 <= n; i += 16) {
+				__m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(idx + i)), m);
+				__m128i l = _mm_shuffle_epi8(tlo, v);
+				__m128i h = _mm_shuffle_epi8(thi, v);
+				__m128i c0 = _mm_unpacklo_epi8(l, h);
+				__m128i c1 = _mm_unpackhi_epi8(l, h);
+				__m128i t = _mm_cmpeq_epi8(v, z);
+				if (!opaq) {
+					__m128i t0 = _mm_unpacklo_epi8(t, t);
+					__m128i t1 = _mm_unpackhi_epi8(t, t);
+					__m128i d0 = _mm_loadu_si128((const __m128i *)(dst + i));
+					__m128i d1 = _mm_loadu_si128((const __m128i *)(dst + i + 8));
+					c0 = _mm_or_si128(_mm_and_si128(t0, d0), _mm_andnot_si128(t0, c0));
+					c1 = _mm_or_si128(_mm_and_si128(t1, d1), _mm_andnot_si128(t1, c1));
+				}
+				_mm_storeu_si128((__m128i *)(dst + i), c0);
+				_mm_storeu_si128((__m128i *)(dst + i + 8), c1);
+				_mm_storeu_si128((__m128i *)(tr + i), _mm_andnot_si128(t, one));
+			}
+		}
+#else
+		{
+			const uint8x16_t tlo = vld1q_u8(lo);
+			const uint8x16_t thi = vld1q_u8(hi);
+			for (; i + 16 <= n; i += 16) {
+				uint8x16_t v = vandq_u8(vld1q_u8(idx + i), vdupq_n_u8(15));
+				uint8x16_t t = vceqq_u8(v, vdupq_n_u8(0));
+				uint8x16x2_t c;
+				c.val[0] = vqtbl1q_u8(tlo, v);
+				c.val[1] = vqtbl1q_u8(thi, v);
+				if (!opaq) {
+					uint8x16x2_t d = vld2q_u8((const uint8_t *)(dst + i));
+					c.val[0] = vbslq_u8(t, d.val[0], c.val[0]);
+					c.val[1] = vbslq_u8(t, d.val[1], c.val[1]);
+				}
+				vst2q_u8((uint8_t *)(dst + i), c);
+				vst1q_u8(tr + i, vbicq_u8(vdupq_n_u8(1), t));
+			}
+		}
+#endif
+	}
+#endif
+	for (; i < n; ++i) {
+		BYTE pat = idx[i] & 15;
+		tr[i] = pat ? 1 : 0;
+		if (pat || opaq)
+			dst[i] = TextPal[pat];
+	}
+}
 
-		pat = TVRAM[tadr];
-		t0 |= ptr[(pat * 2)];
-		t1 |= ptr[(pat * 2 + 1)];
+#ifdef PX68K_TEXT_NODRAWWORK
+static	BYTE	Text_RowWork[1024];
+#endif
 
-		*wptr++ = t0;
-		*wptr++ = t1;
-	}
-#endif	/* USE_ASM */
+// TextDrawWork 上のライン（VRAMの y 行目、1024ドット）
+// PX68K_TEXT_NODRAWWORK の時は1MBの展開済みプレーンを持たず、描く時に展開する
+INLINE const BYTE *Text_Row(DWORD y)
+{
+#ifdef PX68K_TEXT_NODRAWWORK
+	Text_PlanarToChunky(Text_RowWork, y << 7, 128);
+	return Text_RowWork;
+#else
+	return TextDrawWork + (y << 10);
+#endif
 }
 
 // -----------------------------------------------------------------------
@@ -355,50 +508,21 @@ void FASTCALL TVRAM_RCUpdate(void)
 void FASTCALL Text_DrawLine_C(int opaq)
 {
 	WORD *target_buf;
-	BYTE *tr_flag;
-	DWORD line, scroll_x, scroll_y;
-	int i, x, y;
-	WORD color;
-	BYTE pattern;
-	
+	const BYTE *row;
+	DWORD x, n, seg, i;
+
 	// ダブルバッファ対応：適切なバッファを選択
-	if (BG_DoubleBuffer) {
-		target_buf = BG_LineBuf_Draw;  // 描画用バッファに書き込み
-	} else {
-		target_buf = BG_LineBuf;       // 元のバッファに書き込み
-	}
-	
-	tr_flag = Text_TrFlag;
-	line = VLINE;
-	
-	// インターレース処理
-	line *= CRTC_VramRowStepActive;
-	
-	scroll_y = (line + TextScrollY) & 1023;
-	scroll_x = TextScrollX & 1023;
-	
-	y = scroll_y << 10;
-	x = scroll_x;
-	
-	if (opaq) {
-		// 不透明描画：全ピクセルを描画
-		for (i = 0; i < TextDotX; i++) {
-			pattern = TextDrawWork[y + ((x + i) & 1023)];
-			tr_flag[i + 16] = (pattern & 15) ? 1 : 0;
-			color = TextPal[pattern & 15];
-			target_buf[i + 16] = color;
-		}
-	} else {
-		// 透明描画：透明でないピクセルのみ描画
-		for (i = 0; i < TextDotX; i++) {
-			pattern = TextDrawWork[y + ((x + i) & 1023)];
-			if (pattern & 15) {
-				tr_flag[i + 16] = 1;
-				color = TextPal[pattern & 15];
-				target_buf[i + 16] = color;
-			} else {
-				tr_flag[i + 16] = 0;
-			}
-		}
+	target_buf = BG_DoubleBuffer ? BG_LineBuf_Draw : BG_LineBuf;
+
+	// インターレース時は CRTC_VramRowStepActive 行ずつ進む
+	row = Text_Row((VLINE * CRTC_VramRowStepActive + TextScrollY) & 1023);
+
+	// 1024ドットで折り返す
+	x = TextScrollX & 1023;
+	for (i = 0, n = TextDotX; n; n -= seg, i += seg, x = 0) {
+		seg = 1024 - x;
+		if (seg > n)
+			seg = n;
+		Text_PalSpan(target_buf + 16 + i, Text_TrFlag + 16 + i, row + x, seg, opaq);
 	}
 }
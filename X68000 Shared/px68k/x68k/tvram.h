@@ -5,14 +5,22 @@
 #include "scrbuf.h"
 
 extern	BYTE	TVRAM[0x80000];
+// 展開済みテキストプレーン（1024x1024、1ドット1バイト）
+// PX68K_TEXT_NODRAWWORK を定義すると持たずに、描画時に TVRAM から展開する
+#ifndef PX68K_TEXT_NODRAWWORK
 extern	BYTE	TextDrawWork[1024*1024];
+#endif
 extern	BYTE	TextDirtyLine[1024];
+// TextDirtyLine[] のビット
+#define	TDL_FULL	1		// VRAM／レジスタの変更：全レイヤーを描き直す
+#define	TDL_PALETTE	2		// パレットだけの変更：BG/スプライトは色を引き直すだけ
 //extern	WORD	Text_LineBuf[1024];
 // Indexed up to TextDotX + 16 by the text/BG line renderers, so it needs
 // 16 bytes of headroom past the widest scannable line (SCRBUF_STRIDE).
 extern	BYTE	Text_TrFlag[SCRBUF_STRIDE + 16];
 
 void TVRAM_SetAllDirty(void);
+void TVRAM_SetAllPalDirty(void);
 
 void TVRAM_Init(void);
 void TVRAM_Cleanup(void);
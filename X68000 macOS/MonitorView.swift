@@ -496,7 +496,7 @@ struct MonitorView: View {
           HW FDC       FDC command, status, transfer buffers, data-ready state
           HW CRTC      Screen geometry, scroll registers, CRTC register blocks
           HW SCSI      SCSI/SASI mount, boot, dirty, image state
-          HW AUDIO     Audio callback buffer, fill, refill counters
+          HW AUDIO     Audio callback buffer, fill, underrun counters
           HW ADPCM     ADPCM playback, DMA, buffer, clock and output state
           HW INPUT     Keyboard, mouse, PPI joystick state
           HW VIDEO     Frame dirty, text dirty, BG scroll and graphics state
@@ -0,0 +1,665 @@
+/*
+ * Golden-output tests for the block ADPCM pipeline (x68k/adpcm.c).
+ *
+ * The reference below is the previous per-sample implementation: one
+ * nibble decoded and resampled per ADPCM_WriteOne, one frame filtered and
+ * written per ADPCM_Update loop iteration. Its resampling step is a plain
+ * scalar dot product over a 16-sample history with the coefficients from
+ * resample.c, so the block path (vector dot, history carried between
+ * blocks) is checked against the simplest form of the same filter. Both run side by side on the
+ * same random event stream (DMA blocks, CPU data writes, start/stop, pan,
+ * clock, volume and LPF changes, PreUpdate/Update calls of random size)
+ * and every Update must produce identical output and leave identical
+ * decoder/buffer state:
+ *   - host rates 22050/44100/48000/96000
+ *   - rate 0 and the PSP 22050/11025 duplication, with the output ring
+ *     wrapping inside a call
+ *   - DMA continuous mode (no DMA_Exec from Update) and idle channels
+ *   - stopping with LPF on and off, then long Updates: the idle fast path
+ *     must reproduce the LPF decay and the value it settles at (0 or -1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "common.h"
+#include "prop.h"
+#include "dmac.h"
+#include "adpcm.h"
+#include "resample.h"
+
+/* ---- stubs for link dependencies of adpcm.c ---- */
+Win68Conf Config;
+dmac_ch DMA[4];
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+/* ------------------------------------------------------------------------
+ * Reference: the per-sample implementation
+ * ------------------------------------------------------------------------ */
+
+#define R_BufSize       96000
+#define R_ADPCMMAX      2047
+#define R_ADPCMMIN      -2048
+#define R_IPSCALE       256L
+
+#define R_INTERPOLATE(y, x)	\
+	(((((((-y[0]+3*y[1]-3*y[2]+y[3]) * x + R_IPSCALE/2) / R_IPSCALE \
+	+ 3 * (y[0]-2*y[1]+y[2])) * x + R_IPSCALE/2) / R_IPSCALE \
+	- 2*y[0]-3*y[1]+6*y[2]-y[3]) * x + 3*R_IPSCALE) / (6*R_IPSCALE) + y[1])
+
+static int r_VolumeShift = 65536;
+static const int r_index_shift[16] = {
+	-1*16, -1*16, -1*16, -1*16, 2*16, 4*16, 6*16, 8*16,
+	-1*16, -1*16, -1*16, -1*16, 2*16, 4*16, 6*16, 8*16 };
+static const int r_Clocks[8] = {
+	93750, 125000, 187500, 125000, 46875, 62500, 93750, 62500 };
+static int r_dif_table[49*16];
+static signed short r_BufR[R_BufSize];
+static signed short r_BufL[R_BufSize];
+
+static long r_WrPtr, r_RdPtr;
+static DWORD r_SampleRate, r_ClockRate, r_Count;
+static int r_Step, r_Out;
+static BYTE r_Playing, r_Clock;
+static long long r_PreCounter;
+static int r_DmaReady, r_DifBuf, r_Pan;
+static int r_OldR, r_OldL;
+static int r_Outs[8], r_OutsIpR[4], r_OutsIpL[4];
+static short r_Hist[RESAMPLE_TAPS];
+static int r_HistFill;
+static Resampler r_Rs;
+
+static void r_InitTable(void)
+{
+	int step, n;
+	double val;
+	static int bit[16][4] =
+	{
+		{ 1, 0, 0, 0}, { 1, 0, 0, 1}, { 1, 0, 1, 0}, { 1, 0, 1, 1},
+		{ 1, 1, 0, 0}, { 1, 1, 0, 1}, { 1, 1, 1, 0}, { 1, 1, 1, 1},
+		{-1, 0, 0, 0}, {-1, 0, 0, 1}, {-1, 0, 1, 0}, {-1, 0, 1, 1},
+		{-1, 1, 0, 0}, {-1, 1, 0, 1}, {-1, 1, 1, 0}, {-1, 1, 1, 1}
+	};
+
+	for (step=0; step<=48; step++) {
+		val = floor(16.0 * pow ((double)1.1, (double)step));
+		for (n=0; n<16; n++) {
+			r_dif_table[step*16+n] = bit[n][0] *
+			   (int)(val   * bit[n][1] +
+				 val/2 * bit[n][2] +
+				 val/4 * bit[n][3] +
+				 val/8);
+		}
+	}
+}
+
+static void r_PreUpdate(DWORD clock)
+{
+	r_PreCounter += ((r_ClockRate/24)*clock);
+	while ( r_PreCounter>=10000000L ) {
+		r_DifBuf -= ( (r_SampleRate*400)/r_ClockRate );
+		if ( r_DifBuf<=0 ) {
+			r_DifBuf = 0;
+			DMA_Exec(3);
+		}
+		r_PreCounter -= 10000000L;
+	}
+}
+
+static void r_Update(signed short *buffer, DWORD length, int rate, BYTE *pbsp, BYTE *pbep)
+{
+	int outs;
+	signed int outl, outr;
+
+	if ( length<=0 ) return;
+
+	while ( length ) {
+		if (buffer >= (signed short *)pbep) {
+			buffer = (signed short *)pbsp;
+		}
+		int tmpl, tmpr;
+
+		if ( (r_WrPtr==r_RdPtr)&&(!(DMA[3].CCR&0x40)) ) DMA_Exec(3);
+		if ( r_WrPtr!=r_RdPtr ) {
+			r_OldR = outr = r_BufL[r_RdPtr];
+			r_OldL = outl = r_BufR[r_RdPtr];
+			r_RdPtr++;
+			if ( r_RdPtr>=R_BufSize ) r_RdPtr = 0;
+		} else {
+			if ( !r_Playing ) {
+				outr = 0;
+				outl = 0;
+				r_OldR = 0;
+				r_OldL = 0;
+			} else {
+				outr = r_OldR;
+				outl = r_OldL;
+			}
+		}
+
+		if ( Config.Sound_LPF ) {
+			outr = (int)(outr*40*r_VolumeShift);
+			outs = (outr + r_Outs[3]*2 + r_Outs[2] + r_Outs[1]*157 - r_Outs[0]*61) >> 8;
+			r_Outs[2] = r_Outs[3];
+			r_Outs[3] = outr;
+			r_Outs[0] = r_Outs[1];
+			r_Outs[1] = outs;
+		} else {
+			outs = (int)(outr*r_VolumeShift);
+		}
+
+		r_OutsIpR[0] = r_OutsIpR[1];
+		r_OutsIpR[1] = r_OutsIpR[2];
+		r_OutsIpR[2] = r_OutsIpR[3];
+		r_OutsIpR[3] = outs;
+
+		if ( Config.Sound_LPF ) {
+			outl = (int)(outl*40*r_VolumeShift);
+			outs = (outl + r_Outs[7]*2 + r_Outs[6] + r_Outs[5]*157 - r_Outs[4]*61) >> 8;
+			r_Outs[6] = r_Outs[7];
+			r_Outs[7] = outl;
+			r_Outs[4] = r_Outs[5];
+			r_Outs[5] = outs;
+		} else {
+			outs = (int)(outl*r_VolumeShift);
+		}
+
+		r_OutsIpL[0] = r_OutsIpL[1];
+		r_OutsIpL[1] = r_OutsIpL[2];
+		r_OutsIpL[2] = r_OutsIpL[3];
+		r_OutsIpL[3] = outs;
+
+		tmpr = R_INTERPOLATE(r_OutsIpR, 0);
+		if ( tmpr>32767 ) tmpr = 32767; else if ( tmpr<(-32768) ) tmpr = -32768;
+		*(buffer++) = (short)tmpr;
+		tmpl = R_INTERPOLATE(r_OutsIpL, 0);
+		if ( tmpl>32767 ) tmpl = 32767; else if ( tmpl<(-32768) ) tmpl = -32768;
+		*(buffer++) = (short)tmpl;
+		if (rate == 22050) {
+			if (buffer >= (signed short *)pbep) {
+				buffer = (signed short *)pbsp;
+			}
+			*(buffer++) = (short)tmpr;
+			*(buffer++) = (short)tmpl;
+		} else if (rate == 11025) {
+			if (buffer >= (signed short *)pbep) {
+				buffer = (signed short *)pbsp;
+			}
+			*(buffer++) = (short)tmpr;
+			*(buffer++) = (short)tmpl;
+			if (buffer >= (signed short *)pbep) {
+				buffer = (signed short *)pbsp;
+			}
+			*(buffer++) = (short)tmpr;
+			*(buffer++) = (short)tmpl;
+			if (buffer >= (signed short *)pbep) {
+				buffer = (signed short *)pbsp;
+			}
+			*(buffer++) = (short)tmpr;
+			*(buffer++) = (short)tmpl;
+		}
+
+		length--;
+	}
+
+	r_DifBuf = (int)(r_WrPtr-r_RdPtr);
+	if ( r_DifBuf<0 ) r_DifBuf += R_BufSize;
+}
+
+static void r_WriteOne(int val)
+{
+	int k;
+
+	r_Out += r_dif_table[r_Step+val];
+	if ( r_Out>R_ADPCMMAX ) r_Out = R_ADPCMMAX; else if ( r_Out<R_ADPCMMIN ) r_Out = R_ADPCMMIN;
+
+	r_Step += r_index_shift[val];
+	if ( r_Step>(48*16) ) r_Step = (48*16); else if ( r_Step<0 ) r_Step = 0;
+
+	if ( r_HistFill ) {
+		for (k=0; k<RESAMPLE_TAPS; k++) r_Hist[k] = (short)r_Out;
+		r_HistFill = 0;
+	} else {
+		memmove(r_Hist, r_Hist+1, (RESAMPLE_TAPS-1)*sizeof(short));
+		r_Hist[RESAMPLE_TAPS-1] = (short)r_Out;
+	}
+	if ( (r_Rs.inrate!=r_ClockRate)||(r_Rs.outrate!=r_SampleRate) )
+		Resample_Init(&r_Rs, r_ClockRate, r_SampleRate);
+
+	while ( r_SampleRate>r_Count ) {
+		if ( r_Playing ) {
+			int ratio = (((r_Count/100)*R_IPSCALE)/(r_SampleRate/100));
+			int tmp = 0;
+			if ( ratio>=RESAMPLE_PHASES ) ratio = RESAMPLE_PHASES-1;
+			for (k=0; k<RESAMPLE_TAPS; k++) tmp += r_Hist[k]*r_Rs.coef[ratio][k];
+			tmp = (tmp+RESAMPLE_ONE/2)>>14;
+			if ( tmp>R_ADPCMMAX ) tmp = R_ADPCMMAX; else if ( tmp<R_ADPCMMIN ) tmp = R_ADPCMMIN;
+			if ( !(r_Pan&1) )
+				r_BufR[r_WrPtr] = (short)tmp;
+			else
+				r_BufR[r_WrPtr] = 0;
+			if ( !(r_Pan&2) )
+				r_BufL[r_WrPtr++] = (short)tmp;
+			else
+				r_BufL[r_WrPtr++] = 0;
+			if ( r_WrPtr>=R_BufSize ) r_WrPtr = 0;
+		}
+		r_Count += r_ClockRate;
+	}
+	r_Count -= r_SampleRate;
+}
+
+static void r_Write(DWORD adr, BYTE data)
+{
+	if ( adr==0xe92001 ) {
+		if ( data&1 ) {
+			r_Playing = 0;
+			r_OldL = r_OldR = 0;
+			r_DmaReady = 0;
+			r_PreCounter = 0;
+			r_DifBuf = 0;
+			r_RdPtr = r_WrPtr;
+		} else if ( data&2 ) {
+			if ( !r_Playing ) {
+				r_Step = 0;
+				r_Out = 0;
+				r_OldL = r_OldR = 0;
+				r_Playing = 1;
+				r_Count = 0;
+				r_PreCounter = 0;
+				r_DmaReady = 64;
+				r_DifBuf = 0;
+				r_RdPtr = r_WrPtr;
+			}
+			r_HistFill = 1;
+		}
+	} else if ( adr==0xe92003 ) {
+		if ( r_Playing ) {
+			r_WriteOne((int)(data&15));
+			r_WriteOne((int)((data>>4)&15));
+		}
+	}
+}
+
+static void r_SetVolume(BYTE vol)
+{
+	if ( vol>16 ) vol=16;
+	if ( vol )
+		r_VolumeShift = (int)((double)16/pow(1.189207115, (16-vol)));
+	else
+		r_VolumeShift = 0;
+}
+
+static void r_SetPan(int n)
+{
+	if ( (r_Pan&0x0c)!=(n&0x0c) ) {
+		r_Count = 0;
+		r_Clock = (r_Clock&4)|((n>>2)&3);
+		r_ClockRate = r_Clocks[r_Clock];
+		r_PreCounter = 0;
+		r_DmaReady = 0;
+	}
+	r_Pan = n;
+}
+
+static void r_SetClock(int n)
+{
+	if ( (r_Clock&4)!=n ) {
+		r_Count = 0;
+		r_Clock = n|((r_Pan>>2)&3);
+		r_ClockRate = r_Clocks[r_Clock];
+		r_PreCounter = 0;
+		r_DmaReady = 0;
+	}
+}
+
+static void r_Init(DWORD samplerate)
+{
+	r_WrPtr = 0;
+	r_RdPtr = 0;
+	r_Out = 0;
+	r_Step = 0;
+	r_Playing = 0;
+	r_Count = 0;
+	r_SampleRate = (samplerate*12);
+	r_PreCounter = 0;
+	r_DmaReady = 0;
+	r_DifBuf = 0;
+	memset(r_Outs, 0, sizeof(r_Outs));
+	r_HistFill = 1;
+	r_OutsIpR[0] = r_OutsIpR[1] = r_OutsIpR[2] = r_OutsIpR[3] = 0;
+	r_OutsIpL[0] = r_OutsIpL[1] = r_OutsIpL[2] = r_OutsIpL[3] = 0;
+	r_OldL = r_OldR = 0;
+	r_SetPan(0x0b);
+	r_InitTable();
+}
+
+static void r_GetMonitorState(ADPCMMonitorState *state)
+{
+	state->writePtr = r_WrPtr;
+	state->readPtr = r_RdPtr;
+	state->bufferSize = R_BufSize;
+	state->sampleRate = r_SampleRate;
+	state->clockRate = r_ClockRate;
+	state->count = r_Count;
+	state->preCounter = r_PreCounter;
+	state->step = r_Step;
+	state->output = r_Out;
+	state->playing = r_Playing;
+	state->dmaReady = r_DmaReady;
+	state->diffBuffer = r_DifBuf;
+	state->pan = r_Pan;
+	state->volumeShift = r_VolumeShift;
+	state->oldLeft = r_OldL;
+	state->oldRight = r_OldR;
+}
+
+/* ------------------------------------------------------------------------
+ * Both implementations behind one interface, each with its own DMA ch3
+ * ------------------------------------------------------------------------ */
+
+typedef struct {
+    void (*init)(DWORD);
+    void (*write)(DWORD, BYTE);
+    void (*update)(signed short *, DWORD, int, BYTE *, BYTE *);
+    void (*preupdate)(DWORD);
+    void (*setvolume)(BYTE);
+    void (*setpan)(int);
+    void (*setclock)(int);
+    void (*state)(ADPCMMonitorState *);
+} Chip;
+
+static void m_write(DWORD adr, BYTE data) { ADPCM_Write(adr, data); }
+static void m_update(signed short *b, DWORD n, int rate, BYTE *s, BYTE *e) { ADPCM_Update(b, n, rate, s, e); }
+static void m_preupdate(DWORD clock) { ADPCM_PreUpdate(clock); }
+
+static const Chip g_chips[2] = {
+    { ADPCM_Init, m_write, m_update, m_preupdate,
+      ADPCM_SetVolume, ADPCM_SetPan, ADPCM_SetClock, ADPCM_GetMonitorState },
+    { r_Init, r_Write, r_Update, r_PreUpdate,
+      r_SetVolume, r_SetPan, r_SetClock, r_GetMonitorState },
+};
+
+#define SRC_LEN     65536
+#define RING_SHORTS 4096
+
+static BYTE g_src[SRC_LEN];
+static dmac_ch g_dma[2];
+static int g_cur;
+
+/* Request-mode DMA as dmac.c runs it for ch3: one byte per call */
+int FASTCALL DMA_Exec(int ch)
+{
+    if (ch == 3 && (DMA[3].CSR & 0x08) && DMA[3].MTC) {
+        g_chips[g_cur].write(0xe92003, g_src[DMA[3].MAR++ % SRC_LEN]);
+        if (!--DMA[3].MTC) {
+            DMA[3].CSR |= 0x80;
+            DMA[3].CSR &= 0xf7;
+        }
+    }
+    return 0;
+}
+
+static void enter(int c) { g_cur = c; DMA[3] = g_dma[c]; }
+static void leave(int c) { g_dma[c] = DMA[3]; }
+
+static unsigned int g_seed;
+
+static unsigned int rnd(void)
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+static int same_state(const ADPCMMonitorState *a, const ADPCMMonitorState *b)
+{
+    return a->writePtr == b->writePtr && a->readPtr == b->readPtr
+        && a->count == b->count && a->step == b->step && a->output == b->output
+        && a->playing == b->playing && a->diffBuffer == b->diffBuffer
+        && a->preCounter == b->preCounter && a->clockRate == b->clockRate
+        && a->oldLeft == b->oldLeft && a->oldRight == b->oldRight;
+}
+
+/* Returns 1 when all Updates matched; *audible is set when any output
+ * sample was non-zero. */
+static int run(unsigned int seed, DWORD samplerate, int rate, int steps, int *audible)
+{
+    static signed short ring[2][RING_SHORTS];
+    ADPCMMonitorState st[2];
+    int c, i, s, updates = 0;
+
+    for (c = 0; c < 2; c++) {
+        memset(&g_dma[c], 0, sizeof(g_dma[c]));
+        memset(ring[c], 0, sizeof(ring[c]));
+        Config.Sound_LPF = 0;
+        enter(c);
+        g_chips[c].init(samplerate);
+        g_chips[c].setvolume(16);
+        g_chips[c].setclock(0);
+        g_chips[c].setpan(0x08);
+        g_chips[c].write(0xe92001, 2);
+        leave(c);
+    }
+    for (i = 0; i < SRC_LEN; i++)
+        g_src[i] = (BYTE)rnd();
+    g_seed = seed;
+    *audible = 0;
+
+    for (s = 0; s < steps; s++) {
+        unsigned int ev = rnd() % 100, a = rnd(), b = rnd();
+        int lpf = Config.Sound_LPF;
+
+        /* LPF is only read by Update; flip it now and then for both */
+        if (ev < 3)
+            lpf = !lpf;
+        for (c = 0; c < 2; c++) {
+            Config.Sound_LPF = lpf;
+            enter(c);
+            if (ev < 35) {
+                g_chips[c].preupdate(a % 20000);
+            } else if (ev < 70) {
+                DWORD len = 1 + a % 1500;
+                int pos = (int)(b % (RING_SHORTS / 2)) * 2;
+                g_chips[c].update(ring[c] + pos, len, rate,
+                                  (BYTE *)ring[c], (BYTE *)(ring[c] + RING_SHORTS));
+            } else if (ev < 78) {
+                DMA[3].CSR = 0x08;
+                DMA[3].MTC = (WORD)(1 + a % 3000);
+                DMA[3].MAR = b;
+                DMA[3].CCR = (b & 0x700) == 0 ? 0x40 : 0x00;
+            } else if (ev < 81) {
+                g_chips[c].write(0xe92001, (a & 3) == 0 ? 1 : 2);
+            } else if (ev < 85) {
+                g_chips[c].setpan((int)(a % 16));
+            } else if (ev < 87) {
+                g_chips[c].setclock((a & 1) * 4);
+            } else if (ev < 89) {
+                g_chips[c].setvolume((BYTE)(a % 18));
+            } else if (ev < 95) {
+                /* CPU writes to the data port */
+                for (i = 0; i < (int)(a % 8); i++)
+                    g_chips[c].write(0xe92003, (BYTE)(b >> i));
+            } else if (ev < 97) {
+                DMA[3].CCR ^= 0x40;
+            } else {
+                DMA[3].CSR = 0;
+            }
+            leave(c);
+        }
+
+        if (ev >= 35 && ev < 70) {
+            updates++;
+            g_chips[0].state(&st[0]);
+            g_chips[1].state(&st[1]);
+            if (memcmp(ring[0], ring[1], sizeof(ring[0]))) {
+                printf("  update %d (step %d): output differs\n", updates, s);
+                return 0;
+            }
+            if (!same_state(&st[0], &st[1])) {
+                printf("  update %d (step %d): state differs wr %ld/%ld rd %ld/%ld count %u/%u\n",
+                       updates, s, st[0].writePtr, st[1].writePtr,
+                       st[0].readPtr, st[1].readPtr, st[0].count, st[1].count);
+                return 0;
+            }
+            for (i = 0; i < RING_SHORTS; i++)
+                *audible |= ring[0][i] != 0;
+        }
+    }
+    return 1;
+}
+
+static void test_rates(void)
+{
+    static const DWORD rates[] = { 22050, 44100, 48000, 96000 };
+    char name[80];
+    int i, audible;
+
+    for (i = 0; i < 4; i++) {
+        snprintf(name, sizeof(name), "%luHz matches per-sample path", (unsigned long)rates[i]);
+        CHECK(run(0x100 + i, rates[i], 0, 6000, &audible), name);
+        CHECK(audible, "  ... and is audible");
+    }
+}
+
+static void test_psp_rates(void)
+{
+    int audible;
+
+    CHECK(run(0x200, 44100, 22050, 3000, &audible), "rate 22050 duplication matches");
+    CHECK(audible, "  ... and is audible");
+    CHECK(run(0x201, 44100, 11025, 3000, &audible), "rate 11025 duplication matches");
+    CHECK(audible, "  ... and is audible");
+}
+
+/* Play, stop, and let the filters run down over many Updates */
+static int idle_run(unsigned int seed, int lpf, int rate, int *settled)
+{
+    static signed short ring[2][RING_SHORTS];
+    ADPCMMonitorState st[2];
+    int c, i, k;
+
+    g_seed = seed;
+    for (i = 0; i < SRC_LEN; i++)
+        g_src[i] = (BYTE)rnd();
+    Config.Sound_LPF = lpf;
+    for (c = 0; c < 2; c++) {
+        memset(&g_dma[c], 0, sizeof(g_dma[c]));
+        enter(c);
+        g_chips[c].init(44100);
+        g_chips[c].setvolume(16);
+        g_chips[c].setpan(0x08);
+        leave(c);
+    }
+    *settled = 0;
+
+    for (k = 0; k < 40; k++) {
+        unsigned int play = 1 + rnd() % 4000, a = rnd(), b = rnd();
+        int chunks = 1 + (int)(rnd() % 12);
+
+        for (c = 0; c < 2; c++) {
+            enter(c);
+            g_chips[c].write(0xe92001, 2);
+            DMA[3].CSR = 0x08;
+            DMA[3].MTC = (WORD)play;
+            DMA[3].MAR = a;
+            DMA[3].CCR = 0;
+            g_chips[c].setvolume((BYTE)(1 + b % 16));
+            leave(c);
+        }
+        for (i = 0; i < chunks; i++) {
+            DWORD len = 1 + rnd() % 1500;
+            int pos = (int)(rnd() % (RING_SHORTS / 2)) * 2;
+            int ev = (int)(rnd() % 8);
+
+            for (c = 0; c < 2; c++) {
+                enter(c);
+                if (ev == 0)
+                    g_chips[c].write(0xe92001, 1);          /* stop */
+                else if (ev == 1)
+                    DMA[3].CCR ^= 0x40;
+                memset(ring[c], 0, sizeof(ring[c]));
+                g_chips[c].update(ring[c] + pos, len, rate,
+                                  (BYTE *)ring[c], (BYTE *)(ring[c] + RING_SHORTS));
+                leave(c);
+            }
+            g_chips[0].state(&st[0]);
+            g_chips[1].state(&st[1]);
+            if (memcmp(ring[0], ring[1], sizeof(ring[0])) || !same_state(&st[0], &st[1]))
+                return 0;
+        }
+        /* stop and run down in Updates of every size */
+        for (c = 0; c < 2; c++) {
+            enter(c);
+            g_chips[c].write(0xe92001, 1);
+            if (rnd() & 1)
+                DMA[3].CSR = 0;
+            leave(c);
+        }
+        for (i = 0; i < 30; i++) {
+            DWORD len = (i & 1) ? 1 + rnd() % 8 : 1 + rnd() % 1500;
+            int pos = (int)(rnd() % (RING_SHORTS / 2)) * 2;
+
+            for (c = 0; c < 2; c++) {
+                enter(c);
+                memset(ring[c], 0x5a, sizeof(ring[c]));
+                g_chips[c].update(ring[c] + pos, len, rate,
+                                  (BYTE *)ring[c], (BYTE *)(ring[c] + RING_SHORTS));
+                leave(c);
+            }
+            if (memcmp(ring[0], ring[1], sizeof(ring[0])))
+                return 0;
+            if (i == 29)
+                *settled |= ring[0][pos] == -1;
+        }
+    }
+    return 1;
+}
+
+static void test_idle(void)
+{
+    int settled, any = 0;
+
+    CHECK(idle_run(0x400, 0, 0, &settled), "idle without LPF matches per-sample path");
+    CHECK(idle_run(0x401, 1, 0, &settled), "idle with LPF matches per-sample path");
+    any |= settled;
+    CHECK(idle_run(0x402, 1, 22050, &settled), "idle with LPF, rate 22050 matches");
+    any |= settled;
+    CHECK(idle_run(0x403, 1, 11025, &settled), "idle with LPF, rate 11025 matches");
+    any |= settled;
+    CHECK(any, "  ... and the LPF settles at -1 at least once");
+}
+
+static void test_long_run(void)
+{
+    int audible;
+
+    /* long enough for the 96000-sample buffer pointers to wrap */
+    CHECK(run(0x300, 44100, 0, 40000, &audible), "long run matches per-sample path");
+    CHECK(audible, "  ... and is audible");
+}
+
+int main(void)
+{
+    test_rates();
+    test_psp_rates();
+    test_idle();
+    test_long_run();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,549 @@
+/*
+ * Unit tests for the BG/sprite renderer (x68k/bg.c).
+ *
+ * Links the real bg.c with stubs for the text/CRTC globals and verifies
+ * that the per-line sprite buckets maintained by BG_Write select exactly
+ * the sprites the old full 128-entry scan did: every rendered line is
+ * compared with a brute-force reference after random sprite moves,
+ * including the BG_VLINE offset and the out-of-range line numbers.
+ *
+ * It also checks the PCG/map dirty-line tracking: after a pattern or map
+ * write, every screen line whose rendered output changed must be marked in
+ * TextDirtyLine, without falling back to marking the whole screen.
+ *
+ * BG_DrawLineCached's palette-only path must give the same line buffer and
+ * Text_TrFlag bits as a full BG_DrawLine with the new palette.
+ *
+ * The BG planes are drawn from decoded rows cut at the scroll position;
+ * after random scroll, map and pattern writes every line must match the
+ * original per-cell decoder.
+ *
+ * Finally, sprites and BG cells straddling either edge of the display are
+ * clipped: nothing outside [16, 16 + TextDotX) of the line buffers and
+ * Text_TrFlag may be written, even at the full 1024-dot width.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "winx68k.h"
+#include "windraw.h"
+#include "crtc.h"
+#include "tvram.h"
+#include "bg.h"
+
+/* ---- stubs for link dependencies of bg.c ---- */
+BYTE CRTC_Regs[48];
+WORD CRTC_HSTART, CRTC_VSTART = 0x28;
+DWORD TextDotX = 512;
+DWORD VLINE = 0;
+BYTE TextDirtyLine[1024];
+WORD TextPal[256];
+BYTE Text_TrFlag[SCRBUF_STRIDE + 16];
+BYTE Draw_DrawFlag;
+
+void TVRAM_SetAllDirty(void) { memset(TextDirtyLine, 1, 1024); }
+int WinDraw_LinesPending;
+void WinDraw_FlushLines(void) {}
+
+extern BYTE Sprite_Regs[0x800];
+extern BYTE BG[0x8000];
+extern BYTE BGCHR8[8 * 8 * 256];
+extern BYTE BGCHR16[16 * 16 * 256];
+extern WORD BG_CHREND;
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+/* ---- helpers ---- */
+
+static void sprite_write(int n, int field, WORD value)
+{
+    /* CPU-side big-endian word at 0xeb0000 + n*8 + field*2 */
+    BG_Write(0xeb0000 + n * 8 + field * 2, (BYTE)(value >> 8));
+    BG_Write(0xeb0000 + n * 8 + field * 2 + 1, (BYTE)value);
+}
+
+static WORD sprite_reg(int n, int field)
+{
+    return *(WORD *)(Sprite_Regs + n * 8 + field * 2);
+}
+
+static WORD ref_line[1600], ref_pri[1600];
+
+/* the original full scan of all 128 sprites for one priority */
+static void ref_sprites(int pri)
+{
+    int n, i, d;
+    for (n = 127; n >= 0; --n) {
+        WORD ctrl = sprite_reg(n, 2);
+        DWORD t, y;
+        BYTE *p;
+        if ((sprite_reg(n, 3) & 3) != pri)
+            continue;
+        t = (sprite_reg(n, 0) + BG_HAdjust) & 0x3ff;
+        if (t >= TextDotX + 16)
+            continue;
+        y = 16 - ((sprite_reg(n, 1) & 0x3ff) - VLINEBG + BG_VLINE);
+        if (y > 15)
+            continue;
+        if (ctrl < 0x4000) {
+            p = &BGCHR16[((ctrl * 256) & 0xffff) + (y * 16)];
+            d = 1;
+        } else if ((ctrl - 0x4000) & 0x8000) {
+            p = &BGCHR16[((ctrl * 256) & 0xffff) + (((y * 16) & 0xff) ^ 0xf0) + 15];
+            d = -1;
+        } else if ((signed short)ctrl >= 0x4000) {
+            p = &BGCHR16[((ctrl * 256) & 0xffff) + (y * 16) + 15];
+            d = -1;
+        } else {
+            p = &BGCHR16[((ctrl << 8) & 0xffff) + (((y * 16) & 0xff) ^ 0xf0)];
+            d = 1;
+        }
+        for (i = 0; i < 16 && t < 1600; i++, t++, p += d) {
+            DWORD pal = *p & 0xf;
+            if (pal && ref_pri[t] >= n * 8) {
+                ref_line[t] = TextPal[pal | ((ctrl >> 4) & 0xf0)];
+                ref_pri[t] = n * 8;
+            }
+        }
+    }
+}
+
+static int line_matches(void)
+{
+    DWORD i;
+    for (i = 16; i < TextDotX + 16; ++i) {
+        ref_line[i] = TextPal[0];
+        ref_pri[i] = 0xffff;
+    }
+    ref_sprites(1);
+    ref_sprites(2);
+    ref_sprites(3);
+    BG_DrawLine(1, 1);
+    return memcmp(BG_LineBuf_Draw + 16, ref_line + 16, TextDotX * 2) == 0;
+}
+
+static int all_lines_match(void)
+{
+    int ok = 1;
+    long adj;
+    for (adj = -40; adj <= 40; adj += 40) {
+        BG_VLINE = adj;
+        for (VLINEBG = 0; VLINEBG < 1080; ++VLINEBG)
+            ok &= line_matches();
+    }
+    BG_VLINE = 0;
+    VLINEBG = 0;
+    return ok;
+}
+
+static void setup(void)
+{
+    int i;
+    BG_Init();
+    for (i = 0; i < 256; ++i)
+        TextPal[i] = (WORD)(i * 0x0101 + 1);
+    /* random pattern data through the PCG window */
+    srand(1);
+    for (i = 0; i < 0x8000; ++i)
+        BG_Write(0xeb8000 + i, (BYTE)rand());
+    /* 16x16 sprites, BG planes off so only sprites are drawn */
+    BG_Write(0xeb0811, 1);
+    BG_Write(0xeb0809, 0);
+}
+
+/* ---- tests ---- */
+
+static void test_buckets_after_init(void)
+{
+    int n;
+    setup();
+    for (n = 0; n < 128; ++n) {
+        sprite_write(n, 0, (WORD)(rand() & 0x3ff));
+        sprite_write(n, 2, (WORD)rand());
+        sprite_write(n, 3, (WORD)(rand() & 3));
+    }
+    /* all sprites still at Y=0 (only visible above line 0) */
+    CHECK(all_lines_match(), "sprites at Y=0 match full scan");
+}
+
+static void test_buckets_after_moves(void)
+{
+    int n, k, ok = 1;
+    for (n = 0; n < 128; ++n)
+        sprite_write(n, 1, (WORD)(rand() & 0x3ff));
+    CHECK(all_lines_match(), "random Y positions match full scan");
+
+    /* move sprites around, including byte-wise partial updates */
+    for (k = 0; k < 8; ++k) {
+        for (n = 0; n < 64; ++n) {
+            int s = rand() & 127;
+            if (rand() & 1)
+                sprite_write(s, 1, (WORD)rand());
+            else
+                BG_Write(0xeb0000 + s * 8 + 3, (BYTE)rand());
+        }
+        ok &= all_lines_match();
+    }
+    CHECK(ok, "incremental Y moves match full scan");
+
+    /* stack every sprite on the same lines: priority order matters */
+    for (n = 0; n < 128; ++n) {
+        sprite_write(n, 0, (WORD)(16 + (n & 7) * 4));
+        sprite_write(n, 1, 100);
+    }
+    CHECK(all_lines_match(), "overlapping sprites keep priority order");
+}
+
+/* ---- PCG / map dirty tracking ---- */
+
+static WORD frame_before[1024][512], frame_after[1024][512];
+
+static void render_frame(WORD (*frame)[512])
+{
+    DWORD v;
+    for (v = 0; v < 1024; ++v) {
+        VLINEBG = BG_LineFromVLine(v);
+        BG_DrawLine(1, 1);
+        memcpy(frame[v], BG_LineBuf_Draw + 16, TextDotX * 2);
+    }
+}
+
+/* returns 0 if a changed line was left clean; counts dirty lines */
+static int changed_lines_dirty(int *ndirty)
+{
+    int v, ok = 1;
+    *ndirty = 0;
+    for (v = 0; v < 1024; ++v) {
+        if (memcmp(frame_before[v], frame_after[v], TextDotX * 2) && !TextDirtyLine[v])
+            ok = 0;
+        *ndirty += TextDirtyLine[v];
+    }
+    return ok;
+}
+
+static void dirty_tracking_case(BYTE reg11, BYTE crtc29, BYTE reg0f, const char *name)
+{
+    int k, n, ndirty, ok = 1, precise = 1;
+    char label[128];
+
+    setup();
+    CRTC_Regs[0x29] = crtc29;
+    BG_Write(0xeb0809, 0x19);               /* BG0 @0x4000, BG1 @0x6000 */
+    BG_Write(0xeb0811, reg11);
+    BG_Write(0xeb080f, reg0f);
+    BG_Write(0xeb0801, 37);                 /* BG0 scroll X/Y */
+    BG_Write(0xeb0803, 200);
+    BG_Write(0xeb0807, 77);                 /* BG1 scroll Y */
+    for (n = 0; n < 128; ++n) {
+        sprite_write(n, 0, (WORD)(rand() & 0x1ff));
+        sprite_write(n, 1, (WORD)(rand() & 0x3ff));
+        sprite_write(n, 2, (WORD)rand());
+        sprite_write(n, 3, (WORD)(rand() & 3));
+    }
+    render_frame(frame_before);
+
+    for (k = 0; k < 72; ++k) {
+        DWORD adr;
+        memset(TextDirtyLine, 0, sizeof(TextDirtyLine));
+        if (k % 3 == 2) {
+            /* sprite register: position, pattern/colour or priority */
+            BG_Write(0xeb0000 + (rand() & 0x3ff), (BYTE)rand());
+        } else {
+            if (k % 3)
+                adr = 0x4000 + (rand() & 0x3fff);   /* map cell */
+            else
+                adr = rand() % BG_CHREND;           /* pattern data */
+            BG_Write(0xeb8000 + adr, (BYTE)rand());
+        }
+        render_frame(frame_after);
+        ok &= changed_lines_dirty(&ndirty);
+        if (ndirty == 1024)
+            precise = 0;
+        memcpy(frame_before, frame_after, sizeof(frame_before));
+    }
+    snprintf(label, sizeof(label), "%s: changed lines are marked dirty", name);
+    CHECK(ok, label);
+    snprintf(label, sizeof(label), "%s: writes do not dirty the whole screen", name);
+    CHECK(precise, label);
+}
+
+static void test_pattern_map_dirty(void)
+{
+    TextDotX = 512;
+    dirty_tracking_case(0x00, 0x00, 0x00, "8x8 256-line");
+    dirty_tracking_case(0x01, 0x00, 0x00, "16x16 256-line");
+    dirty_tracking_case(0x05, 0x04, 0x00, "16x16 512-line");
+    dirty_tracking_case(0x01, 0x04, 0x30, "16x16 on 512-line CRTC, V offset");
+}
+
+/* ---- palette-only recolouring ---- */
+
+static WORD cached_line[BG_LINEBUF_WIDTH];
+static BYTE cached_tr[SCRBUF_STRIDE + 16];
+
+static void test_palette_recolor(void)
+{
+    int opaq, gd, ok = 1, used_cache = 1, i;
+    DWORD v;
+
+    dirty_tracking_case(0x00, 0x00, 0x00, "8x8 scene for recolour");
+    for (gd = 0; gd < 2; ++gd)
+        for (opaq = 0; opaq < 2; ++opaq) {
+            /* full render records the per-line indices */
+            for (v = 0; v < 1024; ++v) {
+                VLINE = v;
+                VLINEBG = BG_LineFromVLine(v);
+                memset(Text_TrFlag, 0, sizeof(Text_TrFlag));
+                BG_DrawLineCached(opaq, gd, 0);
+            }
+            for (i = 0; i < 256; ++i)
+                TextPal[i] = (WORD)rand();
+            for (v = 0; v < 1024; ++v) {
+                VLINE = v;
+                VLINEBG = BG_LineFromVLine(v);
+                /* prior text layer content for the non-opaque case */
+                for (i = 0; i < BG_LINEBUF_WIDTH; ++i)
+                    BG_LineBuf_Draw[i] = (WORD)(i * 7);
+                memset(Text_TrFlag, 1, sizeof(Text_TrFlag));
+                BG_DrawLineCached(opaq, gd, 1);
+                memcpy(cached_line, BG_LineBuf_Draw, sizeof(cached_line));
+                memcpy(cached_tr, Text_TrFlag, sizeof(cached_tr));
+
+                for (i = 0; i < BG_LINEBUF_WIDTH; ++i)
+                    BG_LineBuf_Draw[i] = (WORD)(i * 7);
+                memset(Text_TrFlag, 1, sizeof(Text_TrFlag));
+                BG_DrawLine(opaq, gd);
+                ok &= !memcmp(cached_line + 16, BG_LineBuf_Draw + 16, TextDotX * 2);
+                ok &= !memcmp(cached_tr, Text_TrFlag, TextDotX + 16);
+            }
+        }
+    CHECK(ok, "palette-only recolour matches full BG_DrawLine");
+
+    /* a recolour must not be taken when the cache was recorded for another gd */
+    VLINE = 5;
+    VLINEBG = BG_LineFromVLine(5);
+    BG_DrawLineCached(1, 1, 0);
+    TextPal[0] ^= 0xffff;
+    for (i = 0; i < BG_LINEBUF_WIDTH; ++i)
+        BG_LineBuf_Draw[i] = 0x5555;
+    BG_DrawLineCached(1, 0, 1);
+    memcpy(cached_line, BG_LineBuf_Draw, sizeof(cached_line));
+    BG_DrawLine(1, 0);
+    used_cache = memcmp(cached_line + 16, BG_LineBuf_Draw + 16, TextDotX * 2) != 0;
+    CHECK(!used_cache, "cache recorded with other gd falls back to full draw");
+    VLINE = 0;
+}
+
+/* ---- scroll: windows cut from decoded rows ---- */
+
+static BYTE ref_tr[1600];
+
+/* the original per-cell BG plane loop (bg_drawline_loopx8/16) */
+static void ref_bg_plane(WORD top, DWORD sx, DWORD sy, long adjust, int ng)
+{
+    int size = BG_CHRSIZE, i, j, d;
+    DWORD ebp, edx, edi, ecx;
+    const BYTE *chr = (size == 8) ? BGCHR8 : BGCHR16;
+    BYTE bl, dat;
+    const BYTE *esi;
+
+    if (size == 8) {
+        ebp = ((sy + VLINEBG - BG_VLINE) & 7) << 3;
+        edx = top + (((sy + VLINEBG - BG_VLINE) & 0x1f8) << 4);
+        edi = ((sx - adjust) & 7) ^ 15;
+        ecx = ((sx - adjust) & 0x1f8) >> 2;
+    } else {
+        ebp = ((sy + VLINEBG - BG_VLINE) & 15) << 4;
+        edx = top + (((sy + VLINEBG - BG_VLINE) & 0x3f0) << 3);
+        edi = ((sx - adjust) & 15) ^ 15;
+        ecx = ((sx - adjust) & 0x3f0) >> 3;
+    }
+    for (i = TextDotX / size; i >= 0; i--) {
+        DWORD si = (DWORD)BG[ecx + edx + 1] * size * size;
+        int last = size * size - 1;
+        bl = BG[ecx + edx];
+        if (bl < 0x40) {
+            esi = &chr[si + ebp];
+            d = 1;
+        } else if ((bl - 0x40) & 0x80) {
+            esi = &chr[si + last - ebp];
+            d = -1;
+        } else if ((signed char)bl >= 0x40) {
+            esi = &chr[si + ebp + size - 1];
+            d = -1;
+        } else {
+            esi = &chr[si + last - (size - 1) - ebp];
+            d = 1;
+        }
+        bl = (BYTE)(bl << 4);
+        for (j = 0; j < size; j++, esi += d, edi++) {
+            dat = *esi | bl;
+            if (ng ? !(dat & 0xf) : (!dat || (!(dat & 0xf) && (ref_tr[edi + 1] & 2))))
+                continue;
+            ref_line[edi + 1] = TextPal[dat];
+            ref_tr[edi + 1] |= 2;
+        }
+        ecx = (ecx + 2) & 0x7f;
+    }
+}
+
+static int scrolled_line_matches(int gd)
+{
+    DWORD i;
+
+    for (i = 0; i < 1600; ++i)
+        ref_line[i] = (WORD)(i * 3);
+    for (i = 0; i < BG_LINEBUF_WIDTH; ++i)
+        BG_LineBuf_Draw[i] = (WORD)(i * 3);
+    for (i = 0; i < sizeof(Text_TrFlag); ++i)
+        ref_tr[i] = Text_TrFlag[i] = (BYTE)(i % 5 == 0);
+    for (i = 16; i < TextDotX + 16; ++i)
+        ref_line[i] = TextPal[0];
+    if (BG_CHRSIZE == 8)
+        ref_bg_plane(BG_BG1TOP, BG1ScrollX, BG1ScrollY, BG_HAdjust, !gd);
+    if (BG_CHRSIZE == 8)
+        ref_bg_plane(BG_BG0TOP, BG0ScrollX, BG0ScrollY, BG_HAdjust, !gd);
+    else
+        ref_bg_plane(BG_BG0TOP, BG0ScrollX, BG0ScrollY, gd ? BG_HAdjust : 0, !gd);
+    BG_DrawLine(1, gd);
+    return !memcmp(BG_LineBuf_Draw + 16, ref_line + 16, TextDotX * 2)
+        && !memcmp(Text_TrFlag + 16, ref_tr + 16, TextDotX);
+}
+
+static void scroll_case(BYTE reg11, DWORD dotx, const char *name)
+{
+    int k, n, gd, ok = 1;
+    DWORD v;
+    char label[128];
+
+    setup();
+    TextDotX = dotx;
+    BG_Write(0xeb0809, 0x19);               /* BG0 @0x4000, BG1 @0x6000 */
+    BG_Write(0xeb0811, reg11);
+    for (n = 0; n < 128; ++n)
+        sprite_write(n, 3, 0);              /* sprites off */
+
+    for (k = 0; k < 24; ++k) {
+        for (n = 0; n < 8; ++n)             /* scroll registers */
+            BG_Write(0xeb0800 + n, (BYTE)rand());
+        BG_Write(0xeb080d, (BYTE)rand());   /* BG_HAdjust */
+        if (k & 1) {
+            for (n = 0; n < 16; ++n) {
+                BG_Write(0xeb8000 + 0x4000 + (rand() & 0x3fff), (BYTE)rand());
+                BG_Write(0xeb8000 + (rand() % BG_CHREND), (BYTE)rand());
+            }
+        }
+        for (gd = 0; gd < 2; ++gd)
+            for (v = 0; v < 1024; v += 3) {
+                VLINE = v;
+                VLINEBG = BG_LineFromVLine(v);
+                ok &= scrolled_line_matches(gd);
+            }
+    }
+    VLINE = 0;
+    TextDotX = 512;
+    snprintf(label, sizeof(label), "%s: scrolled lines match per-cell decoder", name);
+    CHECK(ok, label);
+}
+
+static void test_scroll_window(void)
+{
+    scroll_case(0x00, 512, "8x8");
+    scroll_case(0x01, 512, "16x16");
+    scroll_case(0x00, 256, "8x8 256 dots");
+    scroll_case(0x01, 768, "16x16 768 dots");
+}
+
+/* ---- clipping to the display window ---- */
+
+static int margins_untouched(DWORD dotx)
+{
+    DWORD i;
+    int ok = 1;
+
+    for (i = 0; i < BG_LINEBUF_WIDTH; ++i) {
+        if (i >= 16 && i < dotx + 16)
+            continue;
+        ok &= BG_LineBuf_Draw[i] == 0x5a5a && BG_PriBuf_Draw[i] == 0x5a5a
+            && Text_TrFlag[i] == 0x40;
+    }
+    return ok;
+}
+
+static void clip_case(DWORD dotx, const char *name)
+{
+    int n, gd, ok = 1, match = 1;
+    DWORD v;
+    char label[128];
+
+    setup();
+    TextDotX = dotx;
+    BG_Write(0xeb0809, 0x19);               /* BG0 @0x4000, BG1 @0x6000 */
+    BG_Write(0xeb0811, 0x01);
+    BG_Write(0xeb080d, 3);                  /* BG_HAdjust: cells straddle the left edge */
+    for (n = 0; n < 128; ++n) {
+        /* bunch sprites around both edges of the display */
+        WORD x = (WORD)((n & 1) ? (rand() & 31) : (dotx - 16 + (rand() & 31)));
+        sprite_write(n, 0, (WORD)(x - BG_HAdjust));
+        sprite_write(n, 1, (WORD)(rand() & 0x3ff));
+        sprite_write(n, 2, (WORD)rand());
+        sprite_write(n, 3, (WORD)(1 + (rand() % 3)));
+    }
+    for (gd = 0; gd < 2; ++gd)
+        for (v = 0; v < 1024; ++v) {
+            VLINE = v;
+            VLINEBG = BG_LineFromVLine(v);
+            for (n = 0; n < BG_LINEBUF_WIDTH; ++n)
+                BG_LineBuf_Draw[n] = BG_PriBuf_Draw[n] = 0x5a5a;
+            memset(Text_TrFlag, 0x40, sizeof(Text_TrFlag));
+            BG_DrawLine(1, gd);
+            ok &= margins_untouched(dotx);
+        }
+    /* BG planes off: the visible part still matches the full scan */
+    BG_Write(0xeb0809, 0);
+    for (v = 0; v < 1024; v += 7) {
+        VLINEBG = v;
+        match &= line_matches();
+    }
+    VLINE = 0;
+    VLINEBG = 0;
+    TextDotX = 512;
+    snprintf(label, sizeof(label), "%s: nothing drawn outside the display window", name);
+    CHECK(ok, label);
+    snprintf(label, sizeof(label), "%s: clipped sprites match full scan", name);
+    CHECK(match, label);
+}
+
+static void test_clip_window(void)
+{
+    clip_case(256, "256 dots");
+    clip_case(1024, "1024 dots");
+}
+
+int main(void)
+{
+    test_buckets_after_init();
+    test_buckets_after_moves();
+    test_pattern_map_dirty();
+    test_palette_recolor();
+    test_scroll_window();
+    test_clip_window();
+
+    if (g_failures) {
+        printf("%d test(s) FAILED\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
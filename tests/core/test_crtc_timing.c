@@ -35,8 +35,13 @@ WORD VLINE_TOTAL = 0;
 DWORD vline = 0;
 
 void TVRAM_SetAllDirty(void) {}
-void FASTCALL TVRAM_RCUpdate(void) {}
+void GVRAM_SetMode(void) {}
+static int g_rcupdate_calls = 0;
+void FASTCALL TVRAM_RCUpdate(void) { g_rcupdate_calls++; }
 void WinDraw_ChangeSize(void) {}
+static int g_flush_calls;
+int WinDraw_LinesPending;
+void WinDraw_FlushLines(void) { g_flush_calls++; WinDraw_LinesPending = 0; }
 void Pal_ChangeContrast(int num) { (void)num; }
 
 static int g_failures = 0;
@@ -679,6 +684,95 @@ static void test_raster_copy_runs_at_front_porch(void)
           "raster copy: switch off suppresses later porches");
 }
 
+static int dirty_count(void)
+{
+    int i, n = 0;
+
+    for (i = 0; i < 1024; i++)
+        n += TextDirtyLine[i] != 0;
+    return n;
+}
+
+static void test_raster_copy_dirty_lines(void)
+{
+    const int src = 5 << 9;
+    const int dst = 9 << 9;
+    int calls, flushes;
+
+    CRTC_Init();
+    CRTC_Write(0xe80481, 0);
+    memset(TVRAM, 0, sizeof(TVRAM));
+    TVRAM[src + 0x60000 + 7] = 0x81;  /* only plane 3 differs */
+
+    CRTC_Write(0xe8002b, 0x0f);
+    CRTC_Write(0xe8002c, 5);
+    CRTC_Write(0xe8002d, 9);
+    TextScrollY = 30;                 /* rows 36..39 are shown on lines 6..9 */
+    memset(TextDirtyLine, 0, sizeof(TextDirtyLine));
+    calls = g_rcupdate_calls;
+    flushes = g_flush_calls;
+    CRTC_Write(0xe80481, 8);
+
+    CHECK_EQ(g_flush_calls - flushes, 1,
+             "raster copy: queued lines flushed once before the copy");
+    CHECK(TVRAM[dst + 0x60000 + 7] == 0x81, "raster copy: plane 3 copied");
+    CHECK_EQ(g_rcupdate_calls - calls, 1, "raster copy: TextDrawWork rebuilt once");
+    CHECK_EQ(dirty_count(), 4, "raster copy: exactly four lines dirty");
+    CHECK(TextDirtyLine[6] && TextDirtyLine[9],
+          "raster copy: dirty lines follow TextScrollY");
+
+    /* scroll steady state: same block again, nothing to do */
+    memset(TextDirtyLine, 0, sizeof(TextDirtyLine));
+    calls = g_rcupdate_calls;
+    flushes = g_flush_calls;
+    CRTC_HorizontalFrontPorch();
+    CHECK_EQ(g_rcupdate_calls - calls, 0,
+             "raster copy: identical block skips TextDrawWork update");
+    CHECK_EQ(g_flush_calls - flushes, 0,
+             "raster copy: identical block keeps the line queue");
+    CHECK_EQ(dirty_count(), 0, "raster copy: identical block marks nothing");
+
+    /* destination above the scroll origin wraps at 1024 rows */
+    TextScrollY = 1020;
+    TVRAM[src + 3] = 0x42;
+    CRTC_HorizontalFrontPorch();
+    CHECK(TextDirtyLine[(36 - 1020) & 1023] && TextDirtyLine[(39 - 1020) & 1023],
+          "raster copy: dirty lines wrap around the text plane");
+
+    CRTC_Write(0xe80481, 0);
+    TextScrollY = 0;
+    memset(TextDirtyLine, 0, sizeof(TextDirtyLine));
+}
+
+/* Lines queued for drawing must be drawn with the state they were queued
+ * under, so every video register writer flushes the queue first, whichever
+ * way it is reached (the SCSI boot path calls the writers directly). */
+static void test_video_writes_flush_queued_lines(void)
+{
+    int flushes;
+
+    CRTC_Init();
+    WinDraw_LinesPending = 3;
+    flushes = g_flush_calls;
+    CRTC_Write(0xe80029, 0x10);
+    CHECK_EQ(g_flush_calls - flushes, 1, "flush: CRTC write draws queued lines first");
+
+    WinDraw_LinesPending = 3;
+    flushes = g_flush_calls;
+    VCtrl_Write(0xe82601, 0x20);
+    CHECK_EQ(g_flush_calls - flushes, 1, "flush: VC write draws queued lines first");
+
+    WinDraw_LinesPending = 3;
+    flushes = g_flush_calls;
+    SysPort_Write(0xe8e001, 5);
+    CHECK_EQ(g_flush_calls - flushes, 1, "flush: system port write draws queued lines first");
+
+    flushes = g_flush_calls;
+    CRTC_Write(0xe80029, 0x00);
+    CHECK_EQ(g_flush_calls - flushes, 0, "flush: empty queue is left alone");
+    SysPort_Write(0xe8e001, 0);
+}
+
 /* Write a 16-bit CRTC register so that both byte handlers actually run.
  * CRTC_Write returns early when a byte already holds the value being
  * written, so passing the current value is a no-op; go via a scratch value
@@ -835,6 +929,8 @@ int main(void)
     test_vertical_scan_decode_all_vres();
     test_vram_row_step();
     test_raster_copy_runs_at_front_porch();
+    test_raster_copy_dirty_lines();
+    test_video_writes_flush_queued_lines();
     test_vertical_scan_decode_is_single_sourced();
     test_legacy_agreement();
 
@@ -0,0 +1,140 @@
+/*
+ * Unit tests for the auto frame skip policy (x11/frameskip.c).
+ *
+ * Feeds synthetic per-field timings into FrameSkip_Account and checks which
+ * fields FrameSkip_Decide drops:
+ *   - no skipping while the fields fit the budget
+ *   - skipping when compositing pushes a field over budget, with at least
+ *     one drawn field per FRAMESKIP_MAX_RUN + 1
+ *   - no skipping when the emulation alone is over budget
+ *   - lag is dropped when the host is not vsync paced
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "frameskip.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected, name) do { \
+    long long _a = (long long)(actual), _e = (long long)(expected); \
+    if (_a == _e) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s: got %lld, want %lld (%s:%d)\n", \
+               name, _a, _e, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define BUDGET 16000
+
+/* Run n fields whose emulation takes cpu_us and whose compositing takes
+ * draw_us when drawn; returns how many were skipped. */
+static int run_fields(FrameSkipState *fs, int n, DWORD cpu_us, DWORD draw_us,
+                      int paced, int *max_run)
+{
+    int i, skipped = 0, run = 0;
+
+    for (i = 0; i < n; i++) {
+        int skip = FrameSkip_Decide(fs);
+        DWORD d = skip ? 0 : draw_us;
+
+        skipped += skip;
+        run = skip ? run + 1 : 0;
+        if (max_run && run > *max_run)
+            *max_run = run;
+        FrameSkip_Account(fs, cpu_us + d, d, BUDGET, !skip, paced);
+    }
+    return skipped;
+}
+
+static void test_fast_fields_draw_everything(void)
+{
+    FrameSkipState fs;
+
+    FrameSkip_Reset(&fs);
+    CHECK_EQ(run_fields(&fs, 200, 8000, 4000, 1, NULL), 0,
+             "fields within budget are all drawn");
+    CHECK_EQ(fs.lag_us, 0, "no lag accumulates within budget");
+}
+
+static void test_compositing_bound(void)
+{
+    FrameSkipState fs;
+    int max_run = 0, skipped;
+
+    /* 12ms of emulation + 8ms of compositing: drawing every field runs
+     * 4ms late, skipping recovers 8ms */
+    FrameSkip_Reset(&fs);
+    skipped = run_fields(&fs, 300, 12000, 8000, 1, &max_run);
+    CHECK(skipped > 50 && skipped < 200, "compositing-bound fields are skipped");
+    CHECK(max_run <= FRAMESKIP_MAX_RUN, "a drawn field at least every 16");
+    CHECK(fs.lag_us < 2 * BUDGET, "lag stays bounded");
+
+    /* heavy compositing hits the run limit but still draws */
+    FrameSkip_Reset(&fs);
+    max_run = 0;
+    skipped = run_fields(&fs, 300, 15000, 200000, 1, &max_run);
+    CHECK_EQ(max_run, FRAMESKIP_MAX_RUN, "run limit reached under heavy load");
+    CHECK(skipped < 300, "run limit forces drawn fields");
+    CHECK(fs.lag_us <= FRAMESKIP_MAX_LAG, "lag is capped");
+}
+
+static void test_cpu_bound(void)
+{
+    FrameSkipState fs;
+
+    /* emulation alone takes 20ms: skipping cannot help */
+    FrameSkip_Reset(&fs);
+    CHECK_EQ(run_fields(&fs, 200, 20000, 3000, 1, NULL), 0,
+             "cpu-bound fields are not skipped");
+    CHECK(fs.lag_us > 0, "cpu-bound fields still report lag");
+
+    /* once the emulation speeds up, compositing skip takes over */
+    CHECK(run_fields(&fs, 50, 10000, 3000, 1, NULL) > 0,
+          "skipping resumes when the emulation fits again");
+}
+
+static void test_unpaced(void)
+{
+    FrameSkipState fs;
+
+    FrameSkip_Reset(&fs);
+    CHECK_EQ(run_fields(&fs, 100, 12000, 8000, 0, NULL), 0,
+             "unpaced host never skips");
+    CHECK_EQ(fs.lag_us, 0, "unpaced host keeps no lag");
+}
+
+static void test_clock(void)
+{
+    DWORD a = FrameSkip_Now(), b = FrameSkip_Now();
+
+    CHECK(b - a < 1000000, "monotonic clock advances sanely");
+}
+
+int main(void)
+{
+    test_fast_fields_draw_everything();
+    test_compositing_bound();
+    test_cpu_bound();
+    test_unpaced();
+    test_clock();
+
+    if (g_failures) {
+        printf("%d test(s) FAILED\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,349 @@
+/*
+ * Unit tests for the timestamped MIDI ring between the emulation and the
+ * host (x11/midiring.c) and the Standard MIDI File writer used as its
+ * file backend (x11/smfout.c).
+ *
+ *   - fill level, full ring drops and counts
+ *   - Dispatch hands over only events due by the audio clock, in order,
+ *     at most max, with stamps and indices wrapping past UINT_MAX
+ *   - Take hands over everything queued with its frame distance from the
+ *     play position, 0 for bytes already due; a static designated
+ *     initialiser gives an empty ring
+ *   - a producer and a consumer thread: every byte arrives once, in
+ *     order, and never before its frame
+ *   - the SMF track for a byte stream with running status, system
+ *     exclusive, real-time and system common bytes, in frame and
+ *     millisecond ticks
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "midiring.h"
+#include "smfout.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected, name) do { \
+    long long _a = (long long)(actual), _e = (long long)(expected); \
+    if (_a == _e) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s: got %lld, expected %lld (%s:%d)\n", \
+               name, _a, _e, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define SIZE    16
+
+static MIDIEvent g_buf[SIZE];
+static MIDIRing g_ring;
+
+static BYTE g_got[64];
+static DWORD g_got_sample[64];
+static int g_ngot;
+
+static void collect(const MIDIEvent *ev, void *ctx)
+{
+    (void)ctx;
+    g_got_sample[g_ngot] = ev->sample;
+    g_got[g_ngot++] = ev->data;
+}
+
+static int push(DWORD sample, BYTE data)
+{
+    MIDIEvent ev;
+
+    ev.cycle = sample * 227;
+    ev.sample = sample;
+    ev.data = data;
+    return MIDIRing_Push(&g_ring, &ev);
+}
+
+static void test_fill(void)
+{
+    int i, ok = 1;
+
+    MIDIRing_Init(&g_ring, g_buf, SIZE);
+    CHECK_EQ(MIDIRing_Fill(&g_ring), 0, "empty after init");
+    for (i = 0; i < SIZE; i++)
+        ok &= push(100, (BYTE)i);
+    CHECK(ok, "push up to the size");
+    CHECK_EQ(MIDIRing_Fill(&g_ring), SIZE, "full");
+    CHECK(!push(100, 0xff), "push into a full ring fails");
+    CHECK(!push(100, 0xff), "and again");
+    CHECK_EQ(atomic_load(&g_ring.dropped), 2, "dropped pushes are counted");
+
+    g_ngot = 0;
+    CHECK_EQ(MIDIRing_Dispatch(&g_ring, 100, 1000, collect, NULL), SIZE, "dispatch everything due");
+    for (i = 0, ok = 1; i < SIZE; i++)
+        ok &= g_got[i] == i;
+    CHECK(ok, "dispatch keeps push order");
+    CHECK_EQ(MIDIRing_Fill(&g_ring), 0, "empty after dispatch");
+}
+
+static void test_due(void)
+{
+    int ok = 1, i;
+
+    MIDIRing_Init(&g_ring, g_buf, SIZE);
+    /* stamps across the 32-bit wrap */
+    push(0xfffffff0u, 1);
+    push(0xfffffff8u, 2);
+    push(0xfffffffeu, 3);
+    push(0x00000004u, 4);
+    push(0x00000004u, 5);
+    push(0x00000010u, 6);
+
+    g_ngot = 0;
+    CHECK_EQ(MIDIRing_Dispatch(&g_ring, 0xffffffe0u, 100, collect, NULL), 0, "nothing due yet");
+    CHECK_EQ(MIDIRing_Dispatch(&g_ring, 0xfffffff8u, 100, collect, NULL), 2, "due includes until itself");
+    CHECK_EQ(MIDIRing_Dispatch(&g_ring, 0x00000008u, 1, collect, NULL), 1, "max limits the run");
+    CHECK_EQ(MIDIRing_Dispatch(&g_ring, 0x00000008u, 100, collect, NULL), 2, "due across the stamp wrap");
+    CHECK_EQ(MIDIRing_Fill(&g_ring), 1, "later event stays queued");
+    for (i = 0; i < 5; i++)
+        ok &= g_got[i] == i + 1;
+    CHECK(ok && g_ngot == 5, "events come out in order");
+    CHECK_EQ(MIDIRing_Dispatch(&g_ring, 0x00000010u, 100, collect, NULL), 1, "last one when due");
+
+    /* free-running indices past UINT_MAX */
+    MIDIRing_Init(&g_ring, g_buf, SIZE);
+    atomic_store(&g_ring.head, 0xfffffffau);
+    atomic_store(&g_ring.tail, 0xfffffffau);
+    for (i = 0, ok = 1, g_ngot = 0; i < 40; i++) {
+        ok &= push((DWORD)i, (BYTE)i);
+        ok &= MIDIRing_Fill(&g_ring) == 1;
+        ok &= MIDIRing_Dispatch(&g_ring, (DWORD)i, 100, collect, NULL) == 1;
+        ok &= g_got[g_ngot - 1] == i;
+        g_ngot = 0;
+    }
+    CHECK(ok, "indices wrap past UINT_MAX");
+}
+
+static MIDIEvent g_static_buf[SIZE];
+static MIDIRing g_static = { .ev = g_static_buf, .size = SIZE };
+
+static void test_take(void)
+{
+    BYTE data[SIZE];
+    DWORD frames[SIZE];
+    int ok, i;
+
+    CHECK_EQ(MIDIRing_Fill(&g_static), 0, "static ring starts empty");
+    CHECK_EQ(MIDIRing_Take(&g_static, 0, data, frames, SIZE), 0, "nothing to take");
+
+    MIDIRing_Init(&g_ring, g_buf, SIZE);
+    push(0xfffffff0u, 1);       /* already played */
+    push(0xfffffffcu, 2);       /* due now */
+    push(0x00000004u, 3);       /* ahead, across the stamp wrap */
+    push(0x00000100u, 4);
+    memset(frames, 0xff, sizeof(frames));
+    CHECK_EQ(MIDIRing_Take(&g_ring, 0xfffffffcu, data, frames, 3), 3, "max limits the take");
+    CHECK(data[0] == 1 && data[1] == 2 && data[2] == 3, "take keeps push order");
+    CHECK(frames[0] == 0 && frames[1] == 0, "late and due bytes go at once");
+    CHECK_EQ(frames[2], 8, "bytes ahead carry their distance");
+    CHECK_EQ(MIDIRing_Take(&g_ring, 0xfffffffcu, data, frames, SIZE), 1, "the rest in the next take");
+    CHECK(data[0] == 4 && frames[0] == 0x104, "whatever its frame");
+    CHECK_EQ(MIDIRing_Fill(&g_ring), 0, "empty after take");
+
+    for (i = 0; i < SIZE; i++)
+        push((DWORD)i * 10, (BYTE)i);
+    CHECK_EQ(MIDIRing_Take(&g_ring, 0, data, frames, SIZE), SIZE, "take a full ring");
+    for (i = 0, ok = 1; i < SIZE; i++)
+        ok &= data[i] == i && frames[i] == (DWORD)i * 10;
+    CHECK(ok, "full ring comes out in order with its offsets");
+    CHECK(push(0, 0), "room again after take");
+}
+
+/* ------------------------------------------------------------------------ */
+
+#define STRESS_EVENTS   (1 << 21)
+#define STRESS_RING     256
+
+static MIDIEvent g_stress_buf[STRESS_RING];
+static MIDIRing g_stress;
+static _Atomic DWORD g_clock;       /* the producer's audio frame */
+static int g_stress_bad, g_stress_early;
+static unsigned int g_stress_got;
+
+static unsigned int lcg(unsigned int *s)
+{
+    *s = *s * 1103515245u + 12345u;
+    return *s >> 16;
+}
+
+static void *producer(void *arg)
+{
+    unsigned int seed = 1, sent = 0;
+    DWORD frame = 0;
+
+    (void)arg;
+    while (sent < STRESS_EVENTS) {
+        MIDIEvent ev;
+
+        if (lcg(&seed) % 4 == 0)
+            frame += lcg(&seed) % 8;
+        ev.cycle = sent;
+        ev.sample = frame;
+        ev.data = (BYTE)sent;
+        if (MIDIRing_Push(&g_stress, &ev))
+            sent++;
+        atomic_store(&g_clock, frame);
+    }
+    atomic_store(&g_clock, frame + 1000);
+    return NULL;
+}
+
+static void check_event(const MIDIEvent *ev, void *ctx)
+{
+    DWORD until = *(DWORD *)ctx;
+
+    if (ev->cycle != g_stress_got || ev->data != (BYTE)g_stress_got)
+        g_stress_bad++;
+    if ((int)(ev->sample - until) > 0)
+        g_stress_early++;
+    g_stress_got++;
+}
+
+static void *consumer(void *arg)
+{
+    unsigned int seed = 2;
+
+    (void)arg;
+    while (g_stress_got < STRESS_EVENTS) {
+        /* the host plays a little behind the emulation */
+        DWORD until = atomic_load(&g_clock) - lcg(&seed) % 4;
+
+        MIDIRing_Dispatch(&g_stress, until, 1 + lcg(&seed) % 64, check_event, &until);
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    pthread_t p, c;
+
+    MIDIRing_Init(&g_stress, g_stress_buf, STRESS_RING);
+    pthread_create(&c, NULL, consumer, NULL);
+    pthread_create(&p, NULL, producer, NULL);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    CHECK_EQ(g_stress_bad, 0, "producer/consumer threads: stream arrives intact");
+    CHECK_EQ(g_stress_early, 0, "producer/consumer threads: nothing before its frame");
+    CHECK_EQ(MIDIRing_Fill(&g_stress), 0, "producer/consumer threads: ring drained");
+}
+
+/* ------------------------------------------------------------------------ */
+
+static BYTE g_file[4096];
+
+static long load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    long n;
+
+    if (!fp)
+        return -1;
+    n = (long)fread(g_file, 1, sizeof(g_file), fp);
+    fclose(fp);
+    return n;
+}
+
+static void feed(SMFOut *s, DWORD sample, const BYTE *bytes, int n)
+{
+    MIDIEvent ev;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        ev.cycle = 0;
+        ev.sample = sample;
+        ev.data = bytes[i];
+        SMFOut_Event(&ev, s);
+    }
+}
+
+static void test_smf(void)
+{
+    static const BYTE head[] = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0x06, 0xe4,     /* 1764 */
+        'M', 'T', 'r', 'k' };
+    static const BYTE track[] = {
+        0x00, 0xff, 0x51, 0x03, 0x00, 0x9c, 0x40,           /* 40000us */
+        0x00, 0x90, 0x3c, 0x64,                 /* before start: tick 0 */
+        0x81, 0x0c, 0x90, 0x40, 0x64,           /* 140 frames, running status */
+        0x00, 0xc1, 0x05,                       /* program change */
+        0x00, 0xc1, 0x06,                       /* running 1-byte */
+        0xce, 0x10, 0xf0, 0x05, 0x41, 0x10, 0x42, 0x12, 0xf7,   /* 10000 frames */
+        0x00, 0x80, 0x3c, 0x00,                 /* real-time inside a message */
+        0x00, 0xb0, 0x07, 0x70,
+        0x00, 0xff, 0x2f, 0x00 };
+    static BYTE sysex_big[SMFOUT_SYSEX_MAX + 2];
+    SMFOut s;
+    long size;
+
+    CHECK(SMFOut_Open(&s, "_test_midi.mid", 44100, 1000), "open");
+    feed(&s, 900, (const BYTE *)"\x90\x3c\x64", 3);
+    feed(&s, 1140, (const BYTE *)"\x40\x64", 2);
+    feed(&s, 1140, (const BYTE *)"\xc1\x05\x06", 3);
+    /* system common cancels running status; its data bytes are skipped */
+    feed(&s, 2000, (const BYTE *)"\xf2\x01\x02\x11\x22", 5);
+    feed(&s, 2000, (const BYTE *)"\xf1\x01\xf6\x33", 4);
+    feed(&s, 11140, (const BYTE *)"\xf0\x41\x10\x42\x12\xf7", 6);
+    feed(&s, 11140, (const BYTE *)"\x80\x3c\xf8\xfe\x00", 5);
+    /* a sysex cut short by a status byte is dropped */
+    feed(&s, 11140, (const BYTE *)"\xf0\x41\x10\xb0\x07\x70", 6);
+    /* as is one too long to buffer */
+    memset(sysex_big, 0x11, sizeof(sysex_big));
+    sysex_big[0] = 0xf0;
+    sysex_big[sizeof(sysex_big) - 1] = 0xf7;
+    feed(&s, 11140, sysex_big, (int)sizeof(sysex_big));
+    CHECK(SMFOut_Close(&s), "close");
+    CHECK(SMFOut_Close(&s), "closing twice is harmless");
+
+    size = load("_test_midi.mid");
+    CHECK_EQ(size, (long)(sizeof(head) + 4 + sizeof(track)), "file size");
+    CHECK(!memcmp(g_file, head, sizeof(head)), "header: format 0, one track, frame ticks");
+    CHECK_EQ((g_file[18] << 24) | (g_file[19] << 16) | (g_file[20] << 8) | g_file[21],
+             sizeof(track), "track length");
+    CHECK(!memcmp(g_file + 22, track, sizeof(track)), "track events");
+
+    /* a rate that is not a multiple of 25: millisecond ticks */
+    CHECK(SMFOut_Open(&s, "_test_midi.mid", 44101, 0), "open at 44101Hz");
+    feed(&s, 44101, (const BYTE *)"\x90\x3c\x64", 3);
+    feed(&s, 44101 + 44101 / 2, (const BYTE *)"\x3c\x00", 2);
+    CHECK(SMFOut_Close(&s), "close at 44101Hz");
+    load("_test_midi.mid");
+    CHECK(g_file[12] == 0x03 && g_file[13] == 0xe8, "1000 ticks per quarter note");
+    CHECK(g_file[26] == 0x0f && g_file[27] == 0x42 && g_file[28] == 0x40, "one second per quarter note");
+    CHECK(!memcmp(g_file + 29, "\x87\x68\x90\x3c\x64\x83\x73\x90\x3c\x00", 10), "millisecond deltas");
+
+    CHECK(!SMFOut_Open(&s, "_no_such_dir/x.mid", 44100, 0), "open fails on a bad path");
+    remove("_test_midi.mid");
+}
+
+int main(void)
+{
+    test_fill();
+    test_due();
+    test_take();
+    test_threads();
+    test_smf();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,215 @@
+/*
+ * Unit tests for the block mixer between the sound sources and the PCM
+ * ring (x11/mixer.c).
+ *
+ *   - the vector kernel matches a scalar reference for 0..4 sources, every
+ *     length up to a few vectors and gains from 0 to MIXER_MAX_GAIN,
+ *     including full-scale inputs that saturate
+ *   - two sources at unity gain give the old add-and-clip result
+ *   - Render runs every source once per block and Output mixes the
+ *     requested span, so split ring spans join up seamlessly
+ *   - source slots and gain limits
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "mixer.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected, name) do { \
+    long long _a = (long long)(actual), _e = (long long)(expected); \
+    if (_a == _e) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s: got %lld, expected %lld (%s:%d)\n", \
+               name, _a, _e, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+static unsigned int g_seed = 1;
+
+static unsigned int rnd(void)
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+static short ref_sample(const short *const *src, const int *gain, int nsrc, int i)
+{
+    long long acc = MIXER_UNITY / 2;
+    int s;
+
+    for (s = 0; s < nsrc; s++)
+        acc += (long long)src[s][i] * gain[s];
+    acc >>= 12;
+    if (acc > 32767) acc = 32767; else if (acc < -32768) acc = -32768;
+    return (short)acc;
+}
+
+#define LEN     80
+
+static void test_kernel(void)
+{
+    static short in[MIXER_MAX_SOURCES][LEN + 1];
+    static const int gains[] = { 0, 1, MIXER_UNITY / 3, MIXER_UNITY, MIXER_UNITY + 777, MIXER_MAX_GAIN };
+    const short *src[MIXER_MAX_SOURCES];
+    int gain[MIXER_MAX_SOURCES];
+    short out[LEN + 8];
+    int ok = 1, okguard = 1, iter, n, s, i;
+
+    for (iter = 0; iter < 4000; iter++) {
+        int nsrc = (int)(rnd() % (MIXER_MAX_SOURCES + 1));
+        int len = (int)(rnd() % LEN) + 1;
+        int off = (int)(rnd() & 1);     /* misaligned sources */
+
+        for (s = 0; s < MIXER_MAX_SOURCES; s++) {
+            int mode = (int)(rnd() % 4);
+            for (i = 0; i < LEN + 1; i++) {
+                if (mode == 0)
+                    in[s][i] = (short)rnd();
+                else if (mode == 1)
+                    in[s][i] = (rnd() & 1) ? 32767 : -32768;
+                else
+                    in[s][i] = (short)((int)(rnd() % 2001) - 1000);
+            }
+            src[s] = in[s] + off;
+            gain[s] = gains[rnd() % 6];
+        }
+        for (i = 0; i < LEN + 8; i++)
+            out[i] = 0x5a5a;
+        Mixer_Mix(out, src, gain, nsrc, len);
+        for (i = 0; i < len; i++)
+            ok &= out[i] == ref_sample(src, gain, nsrc, i);
+        for (n = len; n < LEN + 8; n++)
+            okguard &= out[n] == 0x5a5a;
+    }
+    CHECK(ok, "kernel matches scalar reference");
+    CHECK(okguard, "kernel writes exactly the requested samples");
+}
+
+static void test_unity_is_add_clip(void)
+{
+    static short a[4096], b[4096], out[4096];
+    const short *src[2] = { a, b };
+    int gain[2] = { MIXER_UNITY, MIXER_UNITY };
+    int ok = 1, i;
+
+    for (i = 0; i < 4096; i++) {
+        a[i] = (short)rnd();
+        b[i] = (short)rnd();
+    }
+    Mixer_Mix(out, src, gain, 2, 4096);
+    for (i = 0; i < 4096; i++) {
+        int v = a[i] + b[i];
+        if (v > 32767) v = 32767; else if (v < -32768) v = -32768;
+        ok &= out[i] == v;
+    }
+    CHECK(ok, "unity gain is add and clip");
+}
+
+/* ---- Render/Output with counting sources ---- */
+
+static int g_calls[2], g_frames[2], g_pos[2];
+
+static void src_ramp(short *buf, int frames)
+{
+    int i;
+
+    g_calls[0]++;
+    g_frames[0] = frames;
+    for (i = 0; i < frames; i++, g_pos[0]++) {
+        buf[i * 2] = (short)(g_pos[0] * 3);
+        buf[i * 2 + 1] = (short)-g_pos[0];
+    }
+}
+
+static void src_const(short *buf, int frames)
+{
+    int i;
+
+    g_calls[1]++;
+    g_frames[1] = frames;
+    for (i = 0; i < frames * 2; i++)
+        buf[i] = 100;
+    g_pos[1] += frames;
+}
+
+static void test_render_output(void)
+{
+    static short ring[MIXER_BLOCK * 2 + 16];
+    int ok = 1, i;
+
+    memset(g_calls, 0, sizeof(g_calls));
+    memset(g_pos, 0, sizeof(g_pos));
+    Mixer_Init();
+    CHECK_EQ(Mixer_AddSource(src_ramp, MIXER_UNITY), 0, "first source id");
+    CHECK_EQ(Mixer_AddSource(src_const, MIXER_UNITY / 2), 1, "second source id");
+
+    Mixer_Render(700);
+    CHECK(g_calls[0] == 1 && g_calls[1] == 1, "render calls every source once");
+    CHECK(g_frames[0] == 700 && g_frames[1] == 700, "render passes the block size");
+
+    /* a ring span split at 300 frames */
+    memset(ring, 0, sizeof(ring));
+    Mixer_Output(ring, 0, 300);
+    Mixer_Output(ring + 300 * 2, 300, 400);
+    for (i = 0; i < 700; i++) {
+        ok &= ring[i * 2] == (short)(i * 3 + 50);
+        ok &= ring[i * 2 + 1] == (short)(-i + 50);
+    }
+    CHECK(ok, "split output joins up");
+    CHECK_EQ(ring[700 * 2], 0, "output stops at the requested frames");
+
+    Mixer_Render(MIXER_BLOCK + 100);
+    CHECK_EQ(g_frames[0], MIXER_BLOCK, "render is capped at MIXER_BLOCK");
+}
+
+static void test_slots(void)
+{
+    static short out[8];
+    int i;
+
+    Mixer_Init();
+    for (i = 0; i < MIXER_MAX_SOURCES; i++)
+        Mixer_AddSource(src_const, MIXER_UNITY);
+    CHECK_EQ(Mixer_AddSource(src_const, MIXER_UNITY), -1, "no slot past MIXER_MAX_SOURCES");
+
+    Mixer_Init();
+    Mixer_AddSource(src_const, MIXER_MAX_GAIN * 4);
+    Mixer_Render(4);
+    Mixer_Output(out, 0, 4);
+    CHECK_EQ(out[0], 100 * MIXER_MAX_GAIN / MIXER_UNITY, "gain is capped at MIXER_MAX_GAIN");
+    Mixer_SetGain(0, -5);
+    Mixer_Output(out, 0, 4);
+    CHECK_EQ(out[0], 0, "negative gain is muted");
+    Mixer_SetGain(0, MIXER_UNITY);
+    Mixer_Output(out, 0, 4);
+    CHECK_EQ(out[0], 100, "set gain back to unity");
+}
+
+int main(void)
+{
+    test_kernel();
+    test_unity_is_add_clip();
+    test_render_output();
+    test_slots();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
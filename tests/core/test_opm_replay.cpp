@@ -0,0 +1,450 @@
+/*
+ * Replay tests for batched OPM register writes (FM::OPM::WriteReg,
+ * fmgen/fmg_wrap.cpp) and the OPM write log (OPM_StartLog).
+ *
+ * A write stream is a list of (delay in 10MHz clocks, register, data)
+ * records, the format OPM_StartLog writes. It is played into two chips the
+ * way the emulator drives one: the timers advance and the chip is mixed up
+ * to the current time in raster-sized steps, then the writes due at that
+ * time are made. One chip takes them through SetReg, the other through
+ * WriteReg, and the output, the IRQ edges and the status register must
+ * match at every step:
+ *   - driver-like streams: a timer B tick rewriting TL/KC/KF several times
+ *     per channel, voice reloads between key-off and key-on, LFO and noise
+ *     changes, on the scalar and the SoA synthesis paths
+ *   - CSM: timer A keys every channel on, and CSM is switched off and on,
+ *     while TL/AR writes are pending
+ *   - Reset with writes pending
+ *   - a log taken through OPM_Write/OPM_Timer holds the writes and their
+ *     delays exactly, and replays the same way
+ *
+ * Captured logs can be given on the command line: ./test_opm_replay a.log
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headers.h"
+#include "opm.h"
+
+extern "C" {
+#include "common.h"
+#include "fmg_wrap.h"
+
+/* ---- stubs for link dependencies of fmg_wrap.cpp ---- */
+void FASTCALL MFP_Int(int irq) { (void)irq; }
+void ADPCM_SetClock(int n) { (void)n; }
+void FDC_SetForceReady(int n) { (void)n; }
+}
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CLOCK       4000000
+#define SYSCLK      10000000        /* OPM_Timer counts 10MHz clocks */
+#define LINE        320             /* about one 31kHz raster */
+#define MAX_RECS    200000
+#define MAX_EDGES   8192
+
+typedef struct {
+    DWORD delay;
+    BYTE reg, data;
+} Rec;
+
+static Rec g_recs[MAX_RECS];
+static int g_nrecs;
+
+static uint32 g_seed;
+
+static uint32 rnd(void)
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+static void put(DWORD delay, int reg, int data)
+{
+    if (g_nrecs < MAX_RECS) {
+        g_recs[g_nrecs].delay = delay;
+        g_recs[g_nrecs].reg = (BYTE)reg;
+        g_recs[g_nrecs].data = (BYTE)data;
+        g_nrecs++;
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Player
+ * ------------------------------------------------------------------------ */
+
+class ReplayOPM : public FM::OPM
+{
+public:
+    ReplayOPM() : now(0), nedges(0) {}
+    DWORD now;                      /* 10MHz clocks played so far */
+    DWORD edges[MAX_EDGES];         /* IRQ changes: time << 1 | level */
+    int nedges;
+private:
+    virtual void Intr(bool f)
+    {
+        if (nedges < MAX_EDGES)
+            edges[nedges++] = (now << 1) | (f ? 1 : 0);
+    }
+};
+
+typedef struct {
+    FM::Sample *out;                /* stereo, native rate */
+    int frames;
+    BYTE *status;                   /* ReadStatus after each step */
+    int steps;
+    int edges;
+    DWORD edge[MAX_EDGES];
+} Played;
+
+static void played_free(Played *p)
+{
+    free(p->out);
+    free(p->status);
+}
+
+/* Plays recs into a fresh chip; simd selects Channel4x8 */
+static void play(const Rec *recs, int n, DWORD clock, int batched, int simd, Played *p)
+{
+    ReplayOPM *opm = new ReplayOPM;
+    DWORD total = 0, acc = 0;
+    unsigned long long native = clock / 64;
+    int i, maxsteps, maxframes;
+
+    for (i = 0; i < n; i++)
+        total += recs[i].delay;
+    maxsteps = (int)(total / LINE) + n + 1;
+    maxframes = (int)((unsigned long long)total * native / SYSCLK) + 1;
+    p->out = (FM::Sample *)calloc((size_t)maxframes * 2, sizeof(FM::Sample));
+    p->status = (BYTE *)malloc((size_t)maxsteps);
+    p->frames = 0;
+    p->steps = 0;
+
+    opm->Init(clock, clock / 64, true);
+    opm->UseSIMD(simd != 0);
+    for (i = 0; i < n; i++) {
+        DWORD d = recs[i].delay;
+
+        while (d) {
+            DWORD step = d < LINE ? d : LINE;
+            int due;
+
+            d -= step;
+            opm->now += step;
+            acc += step;
+            opm->Count((int32)(acc / 10));
+            acc %= 10;
+            due = (int)((unsigned long long)opm->now * native / SYSCLK);
+            if (due > p->frames) {
+                opm->Mix(p->out + p->frames * 2, due - p->frames, 0,
+                         (BYTE *)p->out, (BYTE *)(p->out + maxframes * 2));
+                p->frames = due;
+            }
+            p->status[p->steps++] = (BYTE)opm->ReadStatus();
+        }
+        if (batched)
+            opm->WriteReg(recs[i].reg, recs[i].data);
+        else
+            opm->SetReg(recs[i].reg, recs[i].data);
+    }
+    p->edges = opm->nedges;
+    memcpy(p->edge, opm->edges, sizeof(DWORD) * opm->nedges);
+    delete opm;
+}
+
+/* Batched against immediate; returns 1 when everything matched */
+static int replay(const Rec *recs, int n, DWORD clock, int simd, int *audible, int *irqs)
+{
+    Played a, b;
+    int ok, i;
+
+    play(recs, n, clock, 0, simd, &a);
+    play(recs, n, clock, 1, simd, &b);
+    ok = a.frames == b.frames && a.steps == b.steps && a.edges == b.edges
+        && !memcmp(a.out, b.out, sizeof(FM::Sample) * a.frames * 2)
+        && !memcmp(a.status, b.status, a.steps)
+        && !memcmp(a.edge, b.edge, sizeof(DWORD) * a.edges);
+    if (!ok) {
+        for (i = 0; i < a.frames * 2 && i < b.frames * 2; i++)
+            if (a.out[i] != b.out[i]) {
+                printf("  first output difference at frame %d\n", i / 2);
+                break;
+            }
+        printf("  frames %d/%d steps %d/%d edges %d/%d\n",
+               a.frames, b.frames, a.steps, b.steps, a.edges, b.edges);
+    }
+    if (audible) {
+        *audible = 0;
+        for (i = 0; i < a.frames * 2; i++)
+            *audible |= a.out[i] != 0;
+    }
+    if (irqs)
+        *irqs = a.edges;
+    played_free(&a);
+    played_free(&b);
+    return ok;
+}
+
+/* ------------------------------------------------------------------------
+ * Driver-like streams
+ * ------------------------------------------------------------------------ */
+
+/* CPU time between two writes of one burst */
+static DWORD gap(void)
+{
+    return (DWORD)(20 + rnd() % 60);
+}
+
+static void voice(int ch, int lfo, DWORD first)
+{
+    int s;
+
+    put(first, 0x20 + ch, 0xc0 | (int)(rnd() % 0x40));
+    put(gap(), 0x38 + ch, lfo ? 0x40 | (int)(rnd() % 8) << 4 | (int)(rnd() % 4) : 0);
+    for (s = 0; s < 4; s++) {
+        int r = s * 8 + ch;
+        put(gap(), 0x40 + r, (int)(rnd() % 0x80));
+        put(gap(), 0x60 + r, s == 3 ? 0x04 : (int)(rnd() % 0x30));
+        /* AR 31 skips the attack at key-on, so AR must land before it */
+        put(gap(), 0x80 + r, (int)(rnd() % 4) << 6 | (rnd() % 3 ? 0x08 + (int)(rnd() % 0x17) : 0x1f));
+        put(gap(), 0xa0 + r, (lfo ? 0x80 : 0) | (int)(rnd() % 0x14));
+        put(gap(), 0xc0 + r, (int)(rnd() % 4) << 6 | (int)(rnd() % 0x10));
+        put(gap(), 0xe0 + r, (int)(rnd() % 0x100));
+    }
+}
+
+/* A timer B driven sequencer: every tick acknowledges the timer, then
+ * rewrites volume and pitch of each channel, sometimes several times over,
+ * and now and then restarts a note with a new voice. */
+static void driver_stream(unsigned seed, int ticks, int lfo, int noise)
+{
+    int t, ch, k;
+
+    g_seed = seed;
+    g_nrecs = 0;
+    put(0, 0x12, 0xe0);                 /* timer B: 32 * 1024 / 62500 s */
+    put(gap(), 0x14, 0x3a);             /* load B, IRQ B, reset flags */
+    if (lfo) {
+        put(gap(), 0x18, 0xc0 + (int)(rnd() % 0x30));
+        put(gap(), 0x19, 0x80 | 0x30);
+        put(gap(), 0x19, 0x20);
+        put(gap(), 0x1b, (int)(rnd() % 4));
+    }
+    if (noise)
+        put(gap(), 0x0f, 0x80 | 0x10);
+    for (ch = 0; ch < 8; ch++)
+        voice(ch, lfo, gap());
+
+    for (t = 0; t < ticks; t++) {
+        put(5120 * 8 + (DWORD)(rnd() % 3000), 0x14, 0x3a);
+        for (ch = 0; ch < 8; ch++) {
+            int restart = rnd() % 6 == 0;
+
+            if (restart) {
+                put(gap(), 0x08, ch);
+                if (rnd() % 2)
+                    voice(ch, lfo, gap());
+            }
+            /* software envelope and vibrato, redone per pass */
+            for (k = (int)(rnd() % 4); k >= 0; k--) {
+                put(gap(), 0x78 + ch, (int)(rnd() % 0x20));
+                put(gap(), 0x68 + ch, (int)(rnd() % 0x40));
+                put(gap(), 0x30 + ch, (int)(rnd() % 0x100));
+                put(gap(), 0x28 + ch, 0x20 + (int)(rnd() % 0x50));
+            }
+            if (restart || rnd() % 12 == 0)
+                put(gap(), 0x08, 0x78 | ch);
+            if (lfo && rnd() % 16 == 0)
+                put(gap(), 0x19, (int)(rnd() % 0x80));
+            if (rnd() % 20 == 0)
+                put(gap(), 0x01, rnd() % 2 ? 0x02 : 0x00);
+        }
+    }
+}
+
+static void test_driver_streams(void)
+{
+    static const struct {
+        unsigned seed;
+        int lfo, noise, simd;
+        const char *name;
+    } cases[] = {
+        { 0x200, 0, 0, 0, "driver stream replays identically (scalar)" },
+        { 0x201, 0, 0, 1, "driver stream replays identically (SoA)" },
+        { 0x202, 1, 0, 1, "driver stream with LFO replays identically" },
+        { 0x203, 1, 1, 1, "driver stream with LFO and noise replays identically" },
+        { 0x204, 1, 1, 0, "driver stream with LFO and noise replays identically (scalar)" },
+    };
+    unsigned i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        int audible = 0, irqs = 0, ok;
+
+        driver_stream(cases[i].seed, 120, cases[i].lfo, cases[i].noise);
+        ok = replay(g_recs, g_nrecs, CLOCK, cases[i].simd, &audible, &irqs);
+        CHECK(ok && audible && irqs > 100, cases[i].name);
+    }
+}
+
+/* Timer A in CSM mode keys all channels on; the TL/AR written just before
+ * an overflow must already be in effect at that key-on. */
+static void test_csm(void)
+{
+    int ch, t, audible = 0, irqs = 0;
+
+    g_seed = 0x300;
+    g_nrecs = 0;
+    for (ch = 0; ch < 8; ch++)
+        voice(ch, 0, 10);
+    put(10, 0x10, 0xf0);                /* timer A: 64 ticks */
+    put(10, 0x11, 0x00);
+    put(10, 0x14, 0x85);                /* CSM, load A, IRQ A */
+    for (t = 0; t < 300; t++) {
+        /* land the writes on and around the overflows (~1ms apart) */
+        DWORD wait = (DWORD)(rnd() % 1200);
+        for (ch = 0; ch < 8; ch++) {
+            put(wait, 0x80 + ch * 1 + (int)(rnd() % 4) * 8, (int)(rnd() % 0x20));
+            put(gap(), 0x60 + ch + (int)(rnd() % 4) * 8, (int)(rnd() % 0x40));
+            wait = gap();
+        }
+        /* acknowledge A, leaving CSM every other time: TL written in CSM
+         * mode only reaches the latch, so it has to land before 0x14 */
+        if (t % 7 == 0)
+            put(gap(), 0x14, (t / 7) % 2 ? 0x15 : 0x95);
+        if (t % 50 == 49)
+            put(gap(), 0x08, (int)(rnd() % 8));
+    }
+    CHECK(replay(g_recs, g_nrecs, CLOCK, 1, &audible, &irqs) && audible && irqs,
+          "CSM key-on sees the parameters written before it");
+}
+
+/* Reset drops what is pending; it must not be applied afterwards. */
+static void test_reset_pending(void)
+{
+    FM::OPM a, b;
+    static FM::Sample oa[2048 * 2], ob[2048 * 2];
+
+    a.Init(CLOCK, CLOCK / 64, true);
+    b.Init(CLOCK, CLOCK / 64, true);
+    b.WriteReg(0x20, 0xc7);
+    b.WriteReg(0x60, 0x00);
+    b.WriteReg(0x28, 0x4a);
+    b.Reset();
+    a.SetReg(0x80, 0x1f);
+    b.WriteReg(0x80, 0x1f);
+    a.SetReg(0xe0, 0x0f);
+    b.WriteReg(0xe0, 0x0f);
+    a.SetReg(0x08, 0x08);
+    b.WriteReg(0x08, 0x08);
+    memset(oa, 0, sizeof(oa));
+    memset(ob, 0, sizeof(ob));
+    a.Mix(oa, 2048, 0, (BYTE *)oa, (BYTE *)(oa + 2048 * 2));
+    b.Mix(ob, 2048, 0, (BYTE *)ob, (BYTE *)(ob + 2048 * 2));
+    CHECK(!memcmp(oa, ob, sizeof(oa)), "Reset discards pending writes");
+}
+
+/* ------------------------------------------------------------------------
+ * Write log
+ * ------------------------------------------------------------------------ */
+
+static DWORD le32(const BYTE *p)
+{
+    return (DWORD)p[0] | (DWORD)p[1] << 8 | (DWORD)p[2] << 16 | (DWORD)p[3] << 24;
+}
+
+/* Reads an OPM_StartLog file into g_recs; returns the OPM clock or 0 */
+static DWORD load_log(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    BYTE head[OPMLOG_HEADER], rec[OPMLOG_RECORD];
+    DWORD clock = 0;
+
+    g_nrecs = 0;
+    if (!fp)
+        return 0;
+    if (fread(head, sizeof(head), 1, fp) == 1 && !memcmp(head, OPMLOG_MAGIC, 8)) {
+        clock = le32(head + 8);
+        while (fread(rec, sizeof(rec), 1, fp) == 1)
+            put(le32(rec), rec[4], rec[5]);
+    }
+    fclose(fp);
+    return clock;
+}
+
+static void test_log(void)
+{
+    static Rec sent[MAX_RECS];
+    const char *path = "_test_opm.log";
+    int n, i, same;
+    DWORD clock;
+
+    driver_stream(0x400, 40, 1, 0);
+    n = g_nrecs;
+    memcpy(sent, g_recs, sizeof(Rec) * n);
+
+    OPM_Init(CLOCK, 44100);
+    OPM_Timer(12345);                   /* time before the log is not in it */
+    OPM_Write(0, 0x20);
+    OPM_Write(1, 0xc7);
+    CHECK(OPM_StartLog(path), "log opens");
+    for (i = 0; i < n; i++) {
+        DWORD d = sent[i].delay;
+        /* the emulator steps the timer per raster */
+        while (d) {
+            DWORD step = d < 317 ? d : 317;
+            OPM_Timer(step);
+            d -= step;
+        }
+        OPM_Write(0, sent[i].reg);
+        OPM_Write(1, sent[i].data);
+    }
+    CHECK(OPM_StopLog(), "log closes without errors");
+    OPM_Write(0, 0x08);
+    OPM_Write(1, 0x00);
+    OPM_Cleanup();
+
+    clock = load_log(path);
+    same = clock == CLOCK && g_nrecs == n;
+    for (i = 0; same && i < n; i++)
+        same = g_recs[i].delay == sent[i].delay && g_recs[i].reg == sent[i].reg
+            && g_recs[i].data == sent[i].data;
+    CHECK(same, "log holds every write with its delay");
+    CHECK(replay(g_recs, g_nrecs, clock, 1, NULL, NULL), "logged stream replays identically");
+    remove(path);
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    test_driver_streams();
+    test_csm();
+    test_reset_pending();
+    test_log();
+
+    for (i = 1; i < argc; i++) {
+        char name[512];
+        DWORD clock = load_log(argv[i]);
+
+        snprintf(name, sizeof(name), "%s (%d writes) replays identically", argv[i], g_nrecs);
+        CHECK(clock && replay(g_recs, g_nrecs, clock, 1, NULL, NULL), name);
+    }
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,317 @@
+/*
+ * Golden-output tests for the silent-chip fast path of OPM_Update
+ * (fmgen/fmg_wrap.cpp, OPM::IsSilent).
+ *
+ * The reference below is OPM_Update without the fast path: every native
+ * frame comes from OPM::Mix and every output from Resample_Step. It drives
+ * its own FM::OPM with the same register writes, and every OPM_Update
+ * call must produce identical output:
+ *   - notes that release into long silences, restarted after random gaps,
+ *     and chip resets that cut the sound off mid-window
+ *   - LFO (including the noise waveform) and ch7 noise across silences
+ *   - output sizes from 1 frame up, so silences start and end inside the
+ *     resampler window and inside a block
+ *   - PSP 22050/11025 duplication with the output ring wrapping, and
+ *     host rate changes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headers.h"
+#include "opm.h"
+
+extern "C" {
+#include "common.h"
+#include "resample.h"
+#include "fmg_wrap.h"
+
+/* ---- stubs for link dependencies of fmg_wrap.cpp ---- */
+void FASTCALL MFP_Int(int irq) { (void)irq; }
+void ADPCM_SetClock(int n) { (void)n; }
+void FDC_SetForceReady(int n) { (void)n; }
+}
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CLOCK       4000000
+
+/* ------------------------------------------------------------------------
+ * Reference: OPM_Update without the fast path
+ * ------------------------------------------------------------------------ */
+
+#define R_RSBLOCK   1024
+
+static FM::OPM *r_opm;
+static Resampler r_rs;
+static DWORD r_step, r_t;
+static int r_avail;
+static short r_in[2][RESAMPLE_TAPS - 1 + R_RSBLOCK];
+
+static void r_Setup(int clock, int rate)
+{
+    DWORD native = (DWORD)clock / 64;
+
+    Resample_Init(&r_rs, native, (DWORD)rate);
+    r_step = (DWORD)((((unsigned long long)native << 16) + rate / 2) / rate);
+    r_t = 0;
+    r_avail = 0;
+    memset(r_in, 0, sizeof(r_in));
+}
+
+static void r_Update(short *buffer, int length, int rate, BYTE *pbsp, BYTE *pbep)
+{
+    static FM::Sample mix[R_RSBLOCK * 2];
+    static short outs[2][R_RSBLOCK];
+    int copies = (rate == 11025) ? 4 : (rate == 22050) ? 2 : 1;
+
+    while (length > 0) {
+        int i, c, n, last;
+        int d = (int)(r_t >> 16);
+
+        if (d > r_avail) d = r_avail;
+        if (d) {
+            for (c = 0; c < 2; c++)
+                memmove(r_in[c], r_in[c] + d, (RESAMPLE_TAPS - 1 + r_avail - d) * sizeof(short));
+            r_avail -= d;
+            r_t -= (DWORD)d << 16;
+        }
+
+        n = (int)((((DWORD)R_RSBLOCK << 16) - 1 - r_t) / r_step) + 1;
+        if (n > length) n = length;
+        last = (int)((r_t + (DWORD)(n - 1) * r_step) >> 16);
+
+        if (last >= r_avail) {
+            int g = last + 1 - r_avail;
+            memset(mix, 0, g * 2 * sizeof(FM::Sample));
+            r_opm->Mix(mix, g, 0, (BYTE *)mix, (BYTE *)(mix + R_RSBLOCK * 2));
+            for (i = 0; i < g; i++) {
+                r_in[0][RESAMPLE_TAPS - 1 + r_avail + i] = mix[i * 2];
+                r_in[1][RESAMPLE_TAPS - 1 + r_avail + i] = mix[i * 2 + 1];
+            }
+            r_avail += g;
+        }
+
+        Resample_Step(&r_rs, r_in[0] + RESAMPLE_TAPS - 1, r_t, r_step, outs[0], n);
+        r_t = Resample_Step(&r_rs, r_in[1] + RESAMPLE_TAPS - 1, r_t, r_step, outs[1], n);
+
+        for (i = 0; i < n; i++) {
+            for (c = 0; c < copies; c++) {
+                if ((BYTE *)buffer >= pbep) buffer = (short *)pbsp;
+                buffer[0] = outs[0][i];
+                buffer[1] = outs[1][i];
+                buffer += 2;
+            }
+        }
+        length -= n;
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+
+static uint32 g_seed;
+
+static uint32 rnd(void)
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+static void reg(int r, int v)
+{
+    OPM_Write(0, (BYTE)r);
+    OPM_Write(1, (BYTE)v);
+    r_opm->SetReg(r, v);
+}
+
+/* Fast release so notes die out into silence quickly */
+static void voice(int ch, int lfo)
+{
+    int s;
+
+    reg(0x20 + ch, 0xc0 | (int)(rnd() % 0x40));
+    reg(0x38 + ch, lfo ? 0x77 : 0);
+    for (s = 0; s < 4; s++) {
+        int r = s * 8 + ch;
+        reg(0x40 + r, (int)(rnd() % 0x80));
+        reg(0x60 + r, s == 3 ? 0x08 : (int)(rnd() % 0x30));
+        reg(0x80 + r, 0x1f);
+        reg(0xa0 + r, (lfo ? 0x80 : 0) | 0x08);
+        reg(0xc0 + r, 0x04);
+        reg(0xe0 + r, 0x2c + (int)(rnd() % 4));
+    }
+}
+
+static void note(int ch, int on)
+{
+    reg(0x28 + ch, 0x30 + (int)(rnd() % 0x30));
+    reg(0x08, (on ? 0x78 : 0) | ch);
+}
+
+#define RING_FRAMES 3000
+
+static int g_rate;
+
+static void set_rate(int rate)
+{
+    g_rate = rate;
+    OPM_SetRate(CLOCK, rate);
+    r_opm->SetRate(CLOCK, CLOCK / 64, true);
+    r_Setup(CLOCK, rate);
+}
+
+/* One OPM_Update against the reference; psp selects the rate argument */
+static int update(int frames, int psp, int *silent, int *audible)
+{
+    static short a[RING_FRAMES * 2], b[RING_FRAMES * 2];
+    int pos = (int)(rnd() % RING_FRAMES) * 2, i;
+
+    memset(a, 0x5a, sizeof(a));
+    memset(b, 0x5a, sizeof(b));
+    OPM_Update(a + pos, frames, psp, (BYTE *)a, (BYTE *)(a + RING_FRAMES * 2));
+    r_Update(b + pos, frames, psp, (BYTE *)b, (BYTE *)(b + RING_FRAMES * 2));
+    for (i = 0; i < RING_FRAMES * 2; i++) {
+        *silent |= a[i] == 0;
+        *audible |= a[i] != 0 && a[i] != 0x5a5a;
+    }
+    return !memcmp(a, b, sizeof(a));
+}
+
+static void setup(int lfowave, int noise)
+{
+    int ch;
+
+    if (lfowave >= 0) {
+        reg(0x18, 0xc8);
+        reg(0x19, 0x80 | 0x40);
+        reg(0x19, 0x30);
+        reg(0x1b, lfowave);
+    }
+    if (noise)
+        reg(0x0f, 0x80 | 0x0c);
+    for (ch = 0; ch < 8; ch++)
+        voice(ch, lfowave >= 0);
+}
+
+/* A random session on fresh chips (Reset leaves the LFO counter alone);
+ * returns 1 when all updates matched */
+static int session(unsigned seed, int lfowave, int noise, int psp)
+{
+    FM::OPM ref;
+    int i, ch, silent = 0, audible = 0;
+
+    g_seed = seed;
+    OPM_Cleanup();
+    OPM_Init(CLOCK, 44100);
+    ref.Init(CLOCK, CLOCK / 64, true);
+    r_opm = &ref;
+    set_rate(44100);
+    OPM_SetVolume(16);
+    ref.SetVolume(-0);
+
+    setup(lfowave, noise);
+
+    for (i = 0; i < 400; i++) {
+        uint32 ev = rnd() % 100;
+
+        if (ev < 25) {
+            ch = (int)(rnd() % 8);
+            note(ch, 1);
+            if (!update(1 + (int)(rnd() % 300), psp, &silent, &audible))
+                return 0;
+            note(ch, 0);
+        } else if (ev < 30) {
+            for (ch = 0; ch < 8; ch++)
+                note(ch, 0);
+        } else if (ev < 32 && !psp) {
+            static const int rates[] = { 22050, 44100, 48000, 96000 };
+            set_rate(rates[rnd() % 4]);
+        } else if (ev < 36) {
+            /* Reset silences every channel at once, with sound still in
+             * the resampler window */
+            note((int)(rnd() % 8), 1);
+            if (!update(1 + (int)(rnd() % 200), psp, &silent, &audible))
+                return 0;
+            OPM_Reset();
+            ref.Reset();
+            setup(lfowave, noise);
+            /* single frames walk the window across the cut-off point */
+            for (ch = 0; ch < 16; ch++)
+                if (!update(1, psp, &silent, &audible))
+                    return 0;
+        } else if (ev < 38) {
+            BYTE vol = (BYTE)(rnd() % 17);
+            OPM_SetVolume(vol);
+            ref.SetVolume(vol ? -((16 - vol) * 4) : -192);
+        } else {
+            int frames = (ev < 80) ? 1 + (int)(rnd() % 40) : 1 + (int)(rnd() % (RING_FRAMES / 4));
+            if (!update(frames, psp, &silent, &audible))
+                return 0;
+        }
+    }
+    return silent && audible;
+}
+
+static void test_sessions(void)
+{
+    CHECK(session(0x100, -1, 0, 0), "notes and silences match full path");
+    CHECK(session(0x101, 0, 0, 0), "LFO saw across silences matches full path");
+    CHECK(session(0x102, 3, 0, 0), "LFO noise waveform across silences matches full path");
+    CHECK(session(0x103, 2, 1, 0), "ch7 noise across silences matches full path");
+    CHECK(session(0x104, -1, 0, 22050), "rate 22050 duplication with ring wrap matches");
+    CHECK(session(0x105, 1, 0, 11025), "rate 11025 duplication with ring wrap matches");
+}
+
+static void test_is_silent(void)
+{
+    FM::OPM opm;
+    static FM::Sample buf[4096 * 2];
+    int i, quiet = 1;
+
+    opm.Init(CLOCK, CLOCK / 64, true);
+    CHECK(opm.IsSilent(), "reset chip is silent");
+    opm.SetReg(0x20, 0xc7);
+    opm.SetReg(0x80, 0x1f);
+    opm.SetReg(0xe0, 0x0f);
+    opm.SetReg(0x28, 0x40);
+    opm.SetReg(0x08, 0x08);
+    CHECK(!opm.IsSilent(), "key on makes it active");
+    opm.SetReg(0x08, 0x00);
+    CHECK(!opm.IsSilent(), "still active while releasing");
+    for (i = 0; i < 200 && !opm.IsSilent(); i++)
+        opm.Mix(buf, 64, 0, (BYTE *)buf, (BYTE *)(buf + 4096 * 2));
+    CHECK(opm.IsSilent(), "silent once the release has finished");
+
+    /* the silent branch fills across the ring end at PSP rates */
+    for (i = 0; i < 4096 * 2; i++)
+        buf[i] = 123;
+    opm.Mix(buf + 4000 * 2, 50, 22050, (BYTE *)buf, (BYTE *)(buf + 4096 * 2));
+    for (i = 0; i < 4096 * 2; i++) {
+        int written = i >= 4000 * 2 || i < 4 * 2;
+        quiet &= buf[i] == (written ? 0 : 123);
+    }
+    CHECK(quiet, "silent Mix fills exactly the duplicated frames across the wrap");
+}
+
+int main(void)
+{
+    test_is_silent();
+    test_sessions();
+    OPM_Cleanup();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * Unit tests for the SPSC PCM ring between the emulation and the host
+ * audio callback (x11/pcmring.c).
+ *
+ *   - fill level, full and empty behaviour
+ *   - Reserve stops at the wrap point and Read copies across it
+ *   - indices keep working when the free-running counters overflow
+ *   - a producer and a consumer thread moving a numbered stream in uneven
+ *     chunks: every frame arrives once, in order, with both samples intact
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "pcmring.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected, name) do { \
+    long long _a = (long long)(actual), _e = (long long)(expected); \
+    if (_a == _e) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s: got %lld, expected %lld (%s:%d)\n", \
+               name, _a, _e, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define FRAMES  16
+
+static short g_buf[FRAMES * 2];
+static PCMRing g_ring;
+
+static void fill_seq(short *p, unsigned int n, int first)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        p[i * 2] = (short)(first + i);
+        p[i * 2 + 1] = (short)~(first + i);
+    }
+}
+
+static int is_seq(const short *p, unsigned int n, int first)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        if (p[i * 2] != (short)(first + i) || p[i * 2 + 1] != (short)~(first + i))
+            return 0;
+    return 1;
+}
+
+static void test_fill(void)
+{
+    short in[FRAMES * 2 + 8], out[FRAMES * 2 + 8];
+
+    PCMRing_Init(&g_ring, g_buf, FRAMES);
+    CHECK_EQ(PCMRing_Fill(&g_ring), 0, "new ring is empty");
+    CHECK_EQ(PCMRing_Read(&g_ring, out, 4), 0, "read from empty ring returns 0");
+
+    fill_seq(in, FRAMES + 4, 0);
+    CHECK_EQ(PCMRing_Write(&g_ring, in, 5), 5, "write 5 frames");
+    CHECK_EQ(PCMRing_Fill(&g_ring), 5, "fill is 5");
+    CHECK_EQ(PCMRing_Write(&g_ring, in + 10, FRAMES), FRAMES - 5, "write stops when full");
+    CHECK_EQ(PCMRing_Fill(&g_ring), FRAMES, "fill is capacity");
+    CHECK_EQ(PCMRing_Write(&g_ring, in, 1), 0, "write to full ring returns 0");
+
+    memset(out, 0, sizeof(out));
+    CHECK_EQ(PCMRing_Read(&g_ring, out, FRAMES + 4), FRAMES, "read returns only queued frames");
+    CHECK(is_seq(out, FRAMES, 0), "frames come out in order");
+    CHECK_EQ(PCMRing_Fill(&g_ring), 0, "ring empty after read");
+
+    PCMRing_Write(&g_ring, in, 3);
+    PCMRing_Reset(&g_ring);
+    CHECK_EQ(PCMRing_Fill(&g_ring), 0, "reset empties the ring");
+}
+
+static void test_wrap(void)
+{
+    short in[FRAMES * 2], out[FRAMES * 2];
+    unsigned int n;
+    short *p;
+
+    PCMRing_Init(&g_ring, g_buf, FRAMES);
+    fill_seq(in, FRAMES, 0);
+    PCMRing_Write(&g_ring, in, 12);
+    PCMRing_Read(&g_ring, out, 10);
+
+    /* write position 12, 14 frames free */
+    p = PCMRing_Reserve(&g_ring, 100, &n);
+    CHECK_EQ(n, FRAMES - 12, "reserve stops at the wrap point");
+    CHECK(p == g_buf + 12 * 2, "reserve points at the write position");
+    fill_seq(p, n, 100);
+    PCMRing_Commit(&g_ring, n);
+
+    p = PCMRing_Reserve(&g_ring, 100, &n);
+    CHECK_EQ(n, 10, "second reserve continues from the start");
+    CHECK(p == g_buf, "second reserve points at the buffer start");
+    fill_seq(p, 3, 104);
+    PCMRing_Commit(&g_ring, 3);
+
+    p = PCMRing_Reserve(&g_ring, 2, &n);
+    CHECK_EQ(n, 2, "reserve honours max");
+
+    memset(out, 0, sizeof(out));
+    CHECK_EQ(PCMRing_Read(&g_ring, out, FRAMES), 9, "read across the wrap");
+    CHECK(is_seq(out, 2, 10) && is_seq(out + 4, 7, 100), "wrapped frames in order");
+}
+
+static void test_counter_overflow(void)
+{
+    short in[FRAMES * 2], out[FRAMES * 2];
+    int ok = 1, i;
+
+    PCMRing_Init(&g_ring, g_buf, FRAMES);
+    atomic_store(&g_ring.head, 0xfffffff8u);
+    atomic_store(&g_ring.tail, 0xfffffff8u);
+    for (i = 0; i < 8; i++) {
+        fill_seq(in, 5, i * 5);
+        ok &= PCMRing_Write(&g_ring, in, 5) == 5;
+        ok &= PCMRing_Fill(&g_ring) == 5;
+        ok &= PCMRing_Read(&g_ring, out, FRAMES) == 5;
+        ok &= is_seq(out, 5, i * 5);
+    }
+    CHECK(ok, "indices wrap past UINT_MAX");
+}
+
+/* ------------------------------------------------------------------------ */
+
+#define STRESS_FRAMES   (1 << 22)
+#define STRESS_RING     1024
+
+static short g_stress_buf[STRESS_RING * 2];
+static PCMRing g_stress;
+static int g_stress_bad;
+
+static unsigned int lcg(unsigned int *s)
+{
+    *s = *s * 1103515245u + 12345u;
+    return *s >> 16;
+}
+
+static void *producer(void *arg)
+{
+    unsigned int seed = 1, sent = 0;
+
+    (void)arg;
+    while (sent < STRESS_FRAMES) {
+        unsigned int want = 1 + lcg(&seed) % 300, n;
+        short *p;
+
+        if (want > STRESS_FRAMES - sent)
+            want = STRESS_FRAMES - sent;
+        p = PCMRing_Reserve(&g_stress, want, &n);
+        fill_seq(p, n, (int)sent);
+        PCMRing_Commit(&g_stress, n);
+        sent += n;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    static short out[512 * 2];
+    unsigned int seed = 2, got = 0;
+
+    (void)arg;
+    while (got < STRESS_FRAMES) {
+        unsigned int n = PCMRing_Read(&g_stress, out, 1 + lcg(&seed) % 512);
+
+        if (!is_seq(out, n, (int)got))
+            g_stress_bad++;
+        got += n;
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    pthread_t p, c;
+
+    PCMRing_Init(&g_stress, g_stress_buf, STRESS_RING);
+    pthread_create(&c, NULL, consumer, NULL);
+    pthread_create(&p, NULL, producer, NULL);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    CHECK_EQ(g_stress_bad, 0, "producer/consumer threads: stream arrives intact");
+    CHECK_EQ(PCMRing_Fill(&g_stress), 0, "producer/consumer threads: ring drained");
+}
+
+int main(void)
+{
+    test_fill();
+    test_wrap();
+    test_counter_overflow();
+    test_threads();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Determinism test for the offline audio render (X68000_RenderAudio): the
+ * real OPM (fmgen/fmg_wrap.cpp) driven through the capture mode of the
+ * sound output (DSound_StartCapture in x11/dswin.c), the way
+ * X68000_RenderAudio runs fields back to back.
+ *
+ * A short song with the LFO on its noise waveform is rendered twice, with
+ * the C library's rand() disturbed in between, and the files must be
+ * identical byte for byte:
+ *   - rendering twice gives the same file, stems included
+ *   - the same clocks in other pieces (another host speed) give the same file
+ *   - the noise waveform is really in use: the triangle one sounds different
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "common.h"
+#include "prop.h"
+#include "dswin.h"
+#include "wavout.h"
+#include "fmg_wrap.h"
+
+/* ---- stubs for link dependencies of dswin.c and fmg_wrap.cpp ---- */
+Win68Conf Config;
+
+void FASTCALL ADPCM_Update(signed short *buffer, DWORD length, int rate, BYTE *pbsp, BYTE *pbep)
+{
+    (void)rate; (void)pbsp; (void)pbep;
+    memset(buffer, 0, length * 2 * sizeof(short));
+}
+void ADPCM_SetVolume(BYTE vol) { (void)vol; }
+void FASTCALL MFP_Int(int irq) { (void)irq; }
+void ADPCM_SetClock(int n) { (void)n; }
+void FDC_SetForceReady(int n) { (void)n; }
+}
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CLOCK       4000000
+#define RATE        44100
+#define FIELDS      40
+#define FIELD_CLK   166666          /* about one 31kHz field of 10MHz clocks */
+#define MAX_BYTES   (WAVOUT_HEADER_BYTES + 400000 * 4)
+
+static BYTE g_file[MAX_BYTES];
+static BYTE g_first[MAX_BYTES];
+static BYTE g_stem[MAX_BYTES];
+
+/* Reads path into buf and returns its size, or -1 */
+static long load(const char *path, BYTE *buf)
+{
+    FILE *fp = fopen(path, "rb");
+    long n;
+
+    if (!fp)
+        return -1;
+    n = (long)fread(buf, 1, MAX_BYTES, fp);
+    fclose(fp);
+    return n;
+}
+
+static void reg(int r, int v)
+{
+    OPM_Write(0, (BYTE)r);
+    OPM_Write(1, (BYTE)v);
+}
+
+/* Four channels of a plain voice, vibrato and tremolo from the LFO */
+static void setup(int lfowave)
+{
+    int ch, s;
+
+    reg(0x18, 0xc0);                    /* LFO frequency */
+    reg(0x19, 0x7f);                    /* AMD */
+    reg(0x19, 0x80 | 0x60);             /* PMD */
+    reg(0x1b, lfowave);
+    for (ch = 0; ch < 4; ch++) {
+        reg(0x20 + ch, 0xc0 | 0x07);    /* both sides, algorithm 7 */
+        reg(0x38 + ch, 0x70 | 0x03);    /* PMS 7, AMS 3 */
+        for (s = 0; s < 4; s++) {
+            int r = s * 8 + ch;
+            reg(0x40 + r, 0x01);
+            reg(0x60 + r, s == 0 ? 0x08 : 0x7f);
+            reg(0x80 + r, 0x80 | 0x80 | 0x1f);
+            reg(0xa0 + r, 0x80 | 0x05);  /* AMS on */
+            reg(0xc0 + r, 0x00);
+            reg(0xe0 + r, 0x2f);
+        }
+    }
+}
+
+/* The notes of field f: every few fields one channel changes its note */
+static void song(int f)
+{
+    int ch = f % 4;
+
+    if (f % 3)
+        return;
+    reg(0x08, ch);                      /* key off */
+    reg(0x28 + ch, 0x30 + (f * 5) % 0x40);
+    reg(0x30 + ch, (f * 13) & 0xfc);
+    reg(0x08, 0x78 | ch);               /* key on */
+}
+
+/* Renders FIELDS fields from power-on to path as X68000_RenderAudio
+ * does; split picks hsync-sized or odd clock pieces. Returns the file
+ * size. */
+static long render(const char *path, int lfowave, int split, int stems)
+{
+    int f, clk;
+    long size;
+
+    OPM_Init(CLOCK, RATE);
+    DSound_Init(RATE, 100);
+    setup(lfowave);
+    if (!DSound_StartCapture(path, stems))
+        return -1;
+    for (f = 0; f < FIELDS; f++) {
+        song(f);
+        for (clk = 0; clk < FIELD_CLK; ) {
+            int n = split ? 318 : 1 + (f * 7919 + clk) % 5000;
+            if (n > FIELD_CLK - clk)
+                n = FIELD_CLK - clk;
+            OPM_Timer(n);
+            DSound_Send0(n);
+            clk += n;
+        }
+    }
+    size = DSound_StopCapture() ? load(path, g_file) : -1;
+    OPM_Cleanup();
+    DSound_Cleanup();
+    return size;
+}
+
+static int audible(const BYTE *file, long size)
+{
+    long i;
+
+    for (i = WAVOUT_HEADER_BYTES; i < size; i++)
+        if (file[i])
+            return 1;
+    return 0;
+}
+
+static void test_render(void)
+{
+    long size, size2, stem;
+    int i;
+
+    srand(1);
+    size = render("_test_render2.wav", 3, 1, 1);
+    CHECK(size > WAVOUT_HEADER_BYTES && audible(g_file, size), "first render has sound");
+    memcpy(g_first, g_file, size);
+    stem = load("_test_render2.opm.wav", g_stem);
+
+    /* other users of rand() must not reach the output */
+    srand(12345);
+    for (i = 0; i < 1000; i++)
+        (void)rand();
+    size2 = render("_test_render2.wav", 3, 1, 1);
+    CHECK(size2 == size && !memcmp(g_file, g_first, size), "second render gives the same file");
+    CHECK(stem > WAVOUT_HEADER_BYTES && load("_test_render2.opm.wav", g_file) == stem
+          && !memcmp(g_file, g_stem, stem), "and the same OPM stem");
+
+    size2 = render("_test_render2.wav", 3, 0, 0);
+    CHECK(size2 == size && !memcmp(g_file, g_first, size), "other clock pieces give the same file");
+
+    size2 = render("_test_render2.wav", 2, 1, 0);
+    CHECK(size2 == size && memcmp(g_file, g_first, size), "the noise LFO is what was rendered");
+
+    remove("_test_render2.wav");
+    remove("_test_render2.adpcm.wav");
+    remove("_test_render2.opm.wav");
+}
+
+int main(void)
+{
+    test_render();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
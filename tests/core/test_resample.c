@@ -0,0 +1,206 @@
+/*
+ * Unit tests for the polyphase resampler shared by OPM and ADPCM
+ * (x68k/resample.c).
+ *
+ *   - every phase sums to exactly 1.0 (Q14), so DC passes unchanged
+ *   - the vector dot product (SSE2/NEON) matches a scalar reference
+ *   - Resample_Step and Resample_Gather agree on the same positions
+ *   - in-band tones pass at close to unity gain, and tones above the output
+ *     Nyquist frequency (OPM 62500->44100) or images of the input
+ *     (ADPCM 7812.5->44100) are attenuated by at least 40dB
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "common.h"
+#include "resample.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected, name) do { \
+    long long _a = (long long)(actual), _e = (long long)(expected); \
+    if (_a == _e) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s: got %lld, expected %lld (%s:%d)\n", \
+               name, _a, _e, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define IN_LEN      16384
+#define OUT_LEN     8192
+
+static Resampler g_rs;
+static short g_in[RESAMPLE_TAPS - 1 + IN_LEN];
+static short g_out[OUT_LEN];
+
+static unsigned int g_seed = 1;
+
+static unsigned int rnd(void)
+{
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+static short ref_dot(const short *in, const short *coef)
+{
+    int acc = 0, k;
+
+    for (k = 0; k < RESAMPLE_TAPS; k++)
+        acc += in[k] * coef[k];
+    acc = (acc + RESAMPLE_ONE / 2) >> 14;
+    if (acc > 32767) acc = 32767; else if (acc < -32768) acc = -32768;
+    return (short)acc;
+}
+
+static void test_phase_sums(void)
+{
+    static const DWORD rates[][2] = {
+        { 62500, 44100 }, { 62500, 22050 }, { 7812, 44100 }, { 15625, 48000 } };
+    int i, p, k, ok = 1;
+
+    for (i = 0; i < 4; i++) {
+        Resample_Init(&g_rs, rates[i][0], rates[i][1]);
+        for (p = 0; p < RESAMPLE_PHASES; p++) {
+            int sum = 0;
+            for (k = 0; k < RESAMPLE_TAPS; k++)
+                sum += g_rs.coef[p][k];
+            ok &= sum == RESAMPLE_ONE;
+        }
+    }
+    CHECK(ok, "every phase sums to 1.0");
+
+    /* phase 0 is centred on in[pos - RESAMPLE_TAPS/2] */
+    Resample_Init(&g_rs, 7812, 44100);
+    for (k = 0, ok = 1; k < RESAMPLE_TAPS; k++)
+        ok &= g_rs.coef[0][k] <= g_rs.coef[0][RESAMPLE_TAPS / 2 - 1];
+    CHECK(ok, "phase 0 peaks on the centre tap");
+}
+
+static void test_dc(void)
+{
+    short *in = g_in + RESAMPLE_TAPS - 1;
+    int i, ok = 1;
+
+    Resample_Init(&g_rs, 62500, 44100);
+    for (i = 0; i < RESAMPLE_TAPS - 1 + IN_LEN; i++)
+        g_in[i] = -12345;
+    Resample_Step(&g_rs, in, 0, (62500u << 16) / 44100, g_out, OUT_LEN);
+    for (i = 0; i < OUT_LEN; i++)
+        ok &= g_out[i] == -12345;
+    CHECK(ok, "DC passes exactly");
+}
+
+static void test_vector_matches_scalar(void)
+{
+    static int pos[OUT_LEN], phase[OUT_LEN];
+    short *in = g_in + RESAMPLE_TAPS - 1;
+    DWORD t, step = (62500u << 16) / 44100;
+    int i, ok = 1, okg = 1;
+
+    Resample_Init(&g_rs, 62500, 44100);
+    for (i = 0; i < RESAMPLE_TAPS - 1 + IN_LEN; i++) {
+        /* full scale noise, including the clamp region */
+        g_in[i] = (short)rnd();
+    }
+    t = Resample_Step(&g_rs, in, 0, step, g_out, OUT_LEN);
+    CHECK_EQ(t, step * OUT_LEN, "Step returns the advanced position");
+    for (i = 0, t = 0; i < OUT_LEN; i++, t += step) {
+        pos[i] = (int)(t >> 16);
+        phase[i] = (int)(t >> (16 - RESAMPLE_PHASEBITS)) & (RESAMPLE_PHASES - 1);
+        ok &= g_out[i] == ref_dot(in + pos[i] - (RESAMPLE_TAPS - 1), g_rs.coef[phase[i]]);
+    }
+    CHECK(ok, "vector dot matches scalar reference");
+
+    memset(g_out, 0, sizeof(g_out));
+    Resample_Gather(&g_rs, in, pos, phase, g_out, OUT_LEN);
+    for (i = 0; i < OUT_LEN; i++)
+        okg &= g_out[i] == ref_dot(in + pos[i] - (RESAMPLE_TAPS - 1), g_rs.coef[phase[i]]);
+    CHECK(okg, "Gather matches scalar reference");
+}
+
+/* Level of frequency f (Hz) in the output, relative to full scale */
+static double goertzel(const short *x, int n, double f, double rate)
+{
+    double w = 2.0 * M_PI * f / rate, c = 2.0 * cos(w), s1 = 0.0, s2 = 0.0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        double s0 = x[i] + c * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    return sqrt(s1 * s1 + s2 * s2 - c * s1 * s2) * 2.0 / n / 16384.0;
+}
+
+/* Resample a 16384-amplitude sine of frequency f and return the output level
+ * at frequency probe. inrate is in 1/16Hz so 7812.5Hz is exact. */
+static double tone(DWORD inrate16, DWORD outrate, double f, double probe)
+{
+    short *in = g_in + RESAMPLE_TAPS - 1;
+    double inrate = inrate16 / 16.0;
+    DWORD step = (DWORD)(((unsigned long long)inrate16 << 16) / (outrate * 16));
+    int i, n = (int)((unsigned long long)(IN_LEN - 1) * 65536 / step);
+
+    if (n > OUT_LEN)
+        n = OUT_LEN;
+    Resample_Init(&g_rs, inrate16, outrate * 16);
+    for (i = 0; i < RESAMPLE_TAPS - 1 + IN_LEN; i++)
+        g_in[i] = (short)floor(16384.0 * sin(2.0 * M_PI * f * i / inrate) + 0.5);
+    Resample_Step(&g_rs, in, 0, step, g_out, n);
+    /* skip the first window so only the settled output is measured */
+    return goertzel(g_out + RESAMPLE_TAPS, n - RESAMPLE_TAPS, probe, outrate);
+}
+
+static void test_frequency_response(void)
+{
+    char name[96];
+    double g;
+
+    /* OPM: 62.5kHz down to 44.1kHz */
+    g = tone(62500 * 16, 44100, 1000.0, 1000.0);
+    CHECK(g > 0.97 && g < 1.03, "62500->44100: 1kHz passes at unity");
+    g = tone(62500 * 16, 44100, 15000.0, 15000.0);
+    snprintf(name, sizeof(name), "62500->44100: 15kHz passes (%.3f)", g);
+    CHECK(g > 0.85 && g < 1.05, name);
+    /* 28kHz would fold back to 16.1kHz */
+    g = tone(62500 * 16, 44100, 28000.0, 44100.0 - 28000.0);
+    snprintf(name, sizeof(name), "62500->44100: 28kHz alias below -40dB (%.1fdB)", 20.0 * log10(g));
+    CHECK(g < 0.01, name);
+
+    /* ADPCM: 7812.5Hz up to 44.1kHz */
+    g = tone(125000, 44100, 1000.0, 1000.0);
+    CHECK(g > 0.97 && g < 1.03, "7812.5->44100: 1kHz passes at unity");
+    g = tone(125000, 44100, 1000.0, 7812.5 - 1000.0);
+    snprintf(name, sizeof(name), "7812.5->44100: first image below -40dB (%.1fdB)", 20.0 * log10(g));
+    CHECK(g < 0.01, name);
+    g = tone(125000, 44100, 1000.0, 7812.5 + 1000.0);
+    snprintf(name, sizeof(name), "7812.5->44100: second image below -40dB (%.1fdB)", 20.0 * log10(g));
+    CHECK(g < 0.01, name);
+}
+
+int main(void)
+{
+    test_phase_sums();
+    test_dc();
+    test_vector_matches_scalar();
+    test_frequency_response();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
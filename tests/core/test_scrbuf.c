@@ -8,7 +8,11 @@
  *     line renderer and both RGBA conversion paths
  *   - the X68000_GetFrameInfo snapshot (size, scan mode, refresh rate,
  *     geometry generation counter)
+ *   - the per-field frame hash
+ *   - Scrbuf_Clear limiting itself to the rows the renderer reported
  *   - the out-of-range guards that keep renderer writes inside the buffer
+ *   - the cached composition pipelines against output recorded from the
+ *     original per-line decision tree
  */
 #include <math.h>
 #include <stdio.h>
@@ -45,7 +49,7 @@ WORD *Grp_LineBufSP_Draw = Grp_LineBufSP;
 WORD *Grp_LineBufSP2_Active = Grp_LineBufSP2;
 WORD *Grp_LineBufSP2_Draw = Grp_LineBufSP2;
 int Grp_DoubleBuffer = 0;
-WORD BG_LineBuf[1600];
+WORD BG_LineBuf[BG_LINEBUF_WIDTH];
 WORD *BG_LineBuf_Active = BG_LineBuf;
 WORD *BG_LineBuf_Draw = BG_LineBuf;
 int BG_DoubleBuffer = 0;
@@ -53,28 +57,116 @@ BYTE BG_Regs[0x12];
 long BG_HAdjust = 0;
 long BG_VLINE = 0;
 BYTE SysPort[7];
+extern BYTE Debug_Text, Debug_Grp, Debug_Sp;
 WORD VLINE_TOTAL = 0;
 DWORD VLINE = 0;
 DWORD vline = 0;
 DWORD VLINEBG = 0;
 
+/*
+ * The layer stubs do nothing unless g_layers is set; then each one logs its
+ * call into g_log and fills its line buffers with a pattern derived from
+ * the call and VLINE, so the composition stage has something to mix.
+ */
+static int g_layers = 0;
+static unsigned long long g_log;
+
+static void log_call(DWORD tag, DWORD a, DWORD b)
+{
+    DWORD v[3] = { tag, a, b };
+    const BYTE *p = (const BYTE *)v;
+    size_t i;
+
+    for (i = 0; i < sizeof(v); i++)
+        g_log = (g_log ^ p[i]) * 0x100000001b3ULL;
+}
+
+static WORD layer_pixel(DWORD tag, DWORD i)
+{
+    DWORD h = (tag * 0x9e3779b1u) ^ (i * 0x85ebca6bu) ^ (VLINE * 0xc2b2ae35u);
+
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 13;
+    return (h & 3) ? (WORD)((h >> 16) | 1) : 0;
+}
+
+static void fill_layer(WORD *buf, DWORD from, DWORD tag, int opaq)
+{
+    DWORD i;
+
+    for (i = from; i < from + 1024; i++) {
+        WORD w = layer_pixel(tag, i);
+        if (w || opaq)
+            buf[i] = w;
+    }
+}
+
+static void grp_layer(DWORD tag, DWORD page, int opaq)
+{
+    if (!g_layers)
+        return;
+    log_call(tag, page, opaq);
+    fill_layer(Grp_LineBuf, 0, tag ^ (page << 8), opaq);
+}
+
+static void grp_sp_layer(DWORD tag, DWORD page)
+{
+    if (!g_layers)
+        return;
+    log_call(tag, page, 0);
+    fill_layer(Grp_LineBuf, 0, tag ^ (page << 8), 1);
+    fill_layer(Grp_LineBufSP, 0, tag ^ (page << 8) ^ 0x10000, 1);
+    fill_layer(Grp_LineBufSP2, 0, tag ^ (page << 8) ^ 0x20000, 1);
+}
+
 void TVRAM_SetAllDirty(void) {}
+void GVRAM_SetMode(void) {}
 void FASTCALL TVRAM_RCUpdate(void) {}
-void FASTCALL Text_DrawLine_C(int opaq) { (void)opaq; }
+void FASTCALL Text_DrawLine_C(int opaq)
+{
+    DWORD i;
+
+    if (!g_layers)
+        return;
+    log_call(0x7e, opaq, 0);
+    for (i = 16; i < TextDotX + 16; i++) {
+        WORD w = layer_pixel(0x7e, i);
+        Text_TrFlag[i] = w ? 1 : 0;
+        if (w || opaq)
+            BG_LineBuf[i] = w;
+    }
+}
 void Mouse_ChangePos(void) {}
 void FASTCALL BG_DrawLine(int opaq, int gd) { (void)opaq; (void)gd; }
-void FASTCALL BG_SwapBuffers(void) {}
-void FASTCALL Grp_SwapBuffers(void) {}
-void Grp_DrawLine16(void) {}
-void FASTCALL Grp_DrawLine8(int page, int opaq) { (void)page; (void)opaq; }
-void FASTCALL Grp_DrawLine4(DWORD page, int opaq) { (void)page; (void)opaq; }
-void FASTCALL Grp_DrawLine4h(void) {}
-void FASTCALL Grp_DrawLine16SP(void) {}
-void FASTCALL Grp_DrawLine8SP(int page) { (void)page; }
-void FASTCALL Grp_DrawLine4SP(DWORD page) { (void)page; }
-void FASTCALL Grp_DrawLine4hSP(void) {}
-void FASTCALL Grp_DrawLine8TR(int page, int opaq) { (void)page; (void)opaq; }
-void FASTCALL Grp_DrawLine4TR(DWORD page, int opaq) { (void)page; (void)opaq; }
+DWORD FASTCALL BG_LineFromVLine(DWORD vline) { return vline; }
+void FASTCALL BG_DrawLineCached(int opaq, int gd, int palonly)
+{
+    DWORD i;
+
+    if (!g_layers)
+        return;
+    log_call(0xb9, opaq | (gd << 1), palonly);
+    for (i = 16; i < TextDotX + 16; i++) {
+        WORD w = layer_pixel(0xb9 + gd, i);
+        if (w)
+            Text_TrFlag[i] |= 2;
+        if (w || opaq)
+            BG_LineBuf[i] = w;
+    }
+}
+void FASTCALL BG_SwapBuffers(void) { if (g_layers) log_call(0x5b, 0, 0); }
+void FASTCALL Grp_SwapBuffers(void) { if (g_layers) log_call(0x5a, 0, 0); }
+void Grp_DrawLine16(void) { grp_layer(0x16, 0, 1); }
+void FASTCALL Grp_DrawLine8(int page, int opaq) { grp_layer(0x08, page, opaq); }
+void FASTCALL Grp_DrawLine4(DWORD page, int opaq) { grp_layer(0x04, page, opaq); }
+void FASTCALL Grp_DrawLine4h(void) { grp_layer(0x4f, 0, 1); }
+void FASTCALL Grp_DrawLine16SP(void) { grp_sp_layer(0x116, 0); }
+void FASTCALL Grp_DrawLine8SP(int page) { grp_sp_layer(0x108, page); }
+void FASTCALL Grp_DrawLine4SP(DWORD page) { grp_sp_layer(0x104, page); }
+void FASTCALL Grp_DrawLine4hSP(void) { grp_sp_layer(0x14f, 0); }
+void FASTCALL Grp_DrawLine8TR(int page, int opaq) { grp_layer(0x208, page, opaq); }
+void FASTCALL Grp_DrawLine4TR(DWORD page, int opaq) { grp_layer(0x204, page, opaq); }
 void p6logd(const char *fmt, ...) { (void)fmt; }
 
 static int g_failures = 0;
@@ -235,6 +327,89 @@ static void test_line_render_1024(void)
     CHECK_EQ(ScrBuf[10 * SCRBUF_STRIDE], 0, "1024-dot: next row untouched");
 }
 
+static void test_partial_clear(void)
+{
+    int i, ok = 1;
+
+    apply_768x512_31k();
+    Scrbuf_Clear();
+    VCReg0[1] = 3;
+    VCReg1[0] = 0x02;
+    VCReg2[1] = 0x01;
+    for (i = 0; i < 1024; i++)
+        Grp_LineBuf[i] = (WORD)(0x3000 + i);
+    VLINE = 40;
+    TextDirtyLine[40] = 1;
+    WinDraw_DrawLine();
+    VLINE = 300;
+    TextDirtyLine[300] = 1;
+    WinDraw_DrawLine();
+
+    /* written outside the renderer, so outside the tracked box */
+    ScrBuf[600 * SCRBUF_STRIDE] = 0x1111;
+    ScrBuf[100 * SCRBUF_STRIDE + 900] = 0x2222;
+    ScrBuf[SCRBUF_LINES * SCRBUF_STRIDE + 5] = 0x3333;
+
+    Scrbuf_Clear();
+    for (i = 0; i < 768; i++)
+        ok &= ScrBuf[40 * SCRBUF_STRIDE + i] == 0 && ScrBuf[300 * SCRBUF_STRIDE + i] == 0;
+    CHECK(ok, "partial clear: rendered rows cleared");
+    CHECK_EQ(ScrBuf[SCRBUF_LINES * SCRBUF_STRIDE + 5], 0,
+             "partial clear: guard rows cleared");
+    CHECK_EQ(ScrBuf[600 * SCRBUF_STRIDE], 0x1111,
+             "partial clear: rows below the box untouched");
+    CHECK_EQ(ScrBuf[100 * SCRBUF_STRIDE + 900], 0x2222,
+             "partial clear: columns right of the box untouched");
+
+    /* a second clear with nothing drawn only touches the guard rows */
+    ScrBuf[40 * SCRBUF_STRIDE] = 0x4444;
+    Scrbuf_Clear();
+    CHECK_EQ(ScrBuf[40 * SCRBUF_STRIDE], 0x4444,
+             "partial clear: box resets after each clear");
+
+    ScrBuf[40 * SCRBUF_STRIDE] = 0;
+    ScrBuf[600 * SCRBUF_STRIDE] = 0;
+    ScrBuf[100 * SCRBUF_STRIDE + 900] = 0;
+    VCReg0[1] = VCReg1[0] = VCReg2[1] = 0;
+}
+
+/* XXH64-based Scrbuf_HashFrame of an all-zero 768x512 normal-scan frame */
+#define FRAME_HASH_BLANK_768 0x030be4f294beef98ULL
+
+static void test_frame_hash(void)
+{
+    unsigned long long h0, h1, h;
+
+    apply_768x512_31k();
+    Scrbuf_Clear();
+    X68000_SetFrameHashing(0);
+    Scrbuf_EndField();
+    CHECK_EQ(X68000_GetFrameHash(&h), 0, "frame hash: nothing hashed while disabled");
+
+    X68000_SetFrameHashing(1);
+    Scrbuf_EndField();
+    CHECK_EQ(X68000_GetFrameHash(&h0), 1, "frame hash: one field hashed");
+    CHECK(h0 == Scrbuf_HashFrame(), "frame hash: EndField stores the frame hash");
+    printf("blank 768x512 hash %016llx\n", h0);
+    CHECK(h0 == FRAME_HASH_BLANK_768, "frame hash: stable value for a blank frame");
+
+    ScrBuf[511 * SCRBUF_STRIDE + 767] = 1;
+    Scrbuf_EndField();
+    CHECK_EQ(X68000_GetFrameHash(&h1), 2, "frame hash: count advances per field");
+    CHECK(h1 != h0, "frame hash: last visible pixel changes the hash");
+    ScrBuf[511 * SCRBUF_STRIDE + 767] = 0;
+
+    ScrBuf[10 * SCRBUF_STRIDE + 800] = 1;
+    ScrBuf[600 * SCRBUF_STRIDE] = 1;
+    CHECK(Scrbuf_HashFrame() == h0, "frame hash: pixels outside the visible area ignored");
+    ScrBuf[10 * SCRBUF_STRIDE + 800] = 0;
+    ScrBuf[600 * SCRBUF_STRIDE] = 0;
+
+    apply_512x512_31k();
+    CHECK(Scrbuf_HashFrame() != h0, "frame hash: geometry is part of the hash");
+    X68000_SetFrameHashing(0);
+}
+
 static void test_frame_info_interlace_consistency(void)
 {
     X68FrameInfo info;
@@ -312,14 +487,158 @@ static void test_image_conversion(void)
     free(buf);
 }
 
+/*
+ * Composition golden test: random VC/BG register settings (biased towards
+ * the special priority and translucency combinations), each drawn on two
+ * lines so both a fresh and a repeated configuration are covered.  The hash
+ * folds the stub call log, the ScrBuf row, BG_LineBuf and Text_TrFlag.  The
+ * expected value was recorded from the original nested-if WinDraw_DrawLine;
+ * layer stub or sweep changes need it re-recorded.
+ */
+#define COMPOSE_GOLDEN 0x7809fc5b1db59337ULL
+
+static DWORD g_seed = 0x6d2b79f5u;
+
+static DWORD sweep_rand(void)
+{
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 17;
+    g_seed ^= g_seed << 5;
+    return g_seed;
+}
+
+static void fold_words(const WORD *p, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        log_call(p[i], 0, 0);
+}
+
+static void test_compose_golden(void)
+{
+    DWORD i;
+    int k, line;
+
+    apply_768x512_31k();
+    Scrbuf_Clear();
+    Pal_HalfMask = 0xf7de;
+    Ibit = 0x0001;
+    Pal_Ix2 = 0x0002;
+    TextPal[0] = 0x1234;
+    g_layers = 1;
+    g_log = 0xcbf29ce484222325ULL;
+
+    for (k = 0; k < 20000; k++) {
+        DWORD r = sweep_rand(), r2 = sweep_rand();
+
+        VCReg0[1] = r & 7;
+        VCReg1[0] = (r >> 3) & 0x3f;
+        VCReg1[1] = (BYTE)(r >> 9);
+        VCReg2[0] = (r >> 17) & 0x5f;
+        if (r2 & 1)
+            VCReg2[0] |= (r2 & 2) ? 0x1c : 0x14;
+        VCReg2[1] = (r >> 24) & 0x7f;
+        BG_Regs[8] = (r2 >> 2) & 2;
+        BG_Regs[0x11] = ((r2 >> 4) & 3) ? 0 : 2;
+        if ((r2 >> 6) & 7) {
+            Debug_Text = Debug_Grp = Debug_Sp = 1;
+        } else {
+            Debug_Text = (r2 >> 9) & 1;
+            Debug_Grp = (r2 >> 10) & 1;
+            Debug_Sp = (r2 >> 11) & 1;
+        }
+        for (line = 0; line < 2; line++) {
+            VLINE = (k * 2 + line) % 512;
+            TextDirtyLine[VLINE] = ((r2 >> 12) & 1) ? TDL_FULL : 2;
+            memset(&ScrBuf[VLINE * SCRBUF_STRIDE], 0xa5, TextDotX * 2);
+            WinDraw_DrawLine();
+            fold_words(&ScrBuf[VLINE * SCRBUF_STRIDE], TextDotX);
+            fold_words(BG_LineBuf, TextDotX + 16);
+            for (i = 0; i < TextDotX + 16; i++)
+                log_call(Text_TrFlag[i], 1, 0);
+        }
+    }
+    g_layers = 0;
+    Debug_Text = Debug_Grp = Debug_Sp = 1;
+    VCReg0[1] = VCReg1[0] = VCReg1[1] = VCReg2[0] = VCReg2[1] = 0;
+
+    printf("compose hash %016llx\n", g_log);
+    CHECK(g_log == COMPOSE_GOLDEN, "composition matches recorded output");
+}
+
+/*
+ * Queued lines must come out exactly as if each had been drawn when it was
+ * queued: same ScrBuf rows, same per-line VLINE, and VLINE itself restored.
+ */
+#define BATCH_LINES 24
+
+static void test_batched_lines(void)
+{
+    static WORD want[BATCH_LINES][SCRBUF_STRIDE];
+    int k, line, same = 1;
+
+    apply_768x512_31k();
+    g_layers = 1;
+    g_seed = 0x2545f491u;
+
+    for (k = 0; k < 64 && same; k++) {
+        DWORD r = sweep_rand();
+
+        VCReg0[1] = r & 7;
+        VCReg1[0] = (r >> 3) & 0x3f;
+        VCReg1[1] = (BYTE)(r >> 9);
+        VCReg2[0] = (r >> 17) & 0x5f;
+        VCReg2[1] = (r >> 24) & 0x7f;
+
+        for (line = 0; line < BATCH_LINES; line++) {
+            VLINE = 100 + line;
+            TextDirtyLine[VLINE] = (line % 3) ? TDL_FULL : 2;
+            memset(&ScrBuf[VLINE * SCRBUF_STRIDE], 0xa5, SCRBUF_STRIDE * 2);
+            WinDraw_DrawLine();
+            memcpy(want[line], &ScrBuf[VLINE * SCRBUF_STRIDE], SCRBUF_STRIDE * 2);
+        }
+        for (line = 0; line < BATCH_LINES; line++) {
+            VLINE = 100 + line;
+            TextDirtyLine[VLINE] = (line % 3) ? TDL_FULL : 2;
+            memset(&ScrBuf[VLINE * SCRBUF_STRIDE], 0xa5, SCRBUF_STRIDE * 2);
+            WinDraw_QueueLine();
+        }
+        VLINE = 7;
+        WinDraw_FlushLines();
+        for (line = 0; line < BATCH_LINES; line++)
+            if (memcmp(want[line], &ScrBuf[(100 + line) * SCRBUF_STRIDE],
+                       SCRBUF_STRIDE * 2))
+                same = 0;
+    }
+    CHECK(same, "batched lines match line-at-a-time drawing");
+    CHECK_EQ(VLINE, 7, "flush restores VLINE");
+    CHECK_EQ(WinDraw_LinesPending, 0, "flush empties the queue");
+
+    VLINE = 100;
+    TextDirtyLine[VLINE] = 0;
+    WinDraw_QueueLine();
+    CHECK_EQ(WinDraw_LinesPending, 0, "clean lines are not queued");
+    VLINE = SCRBUF_LINES;
+    WinDraw_QueueLine();
+    CHECK_EQ(WinDraw_LinesPending, 0, "out-of-range lines are not queued");
+
+    g_layers = 0;
+    VCReg0[1] = VCReg1[0] = VCReg1[1] = VCReg2[0] = VCReg2[1] = 0;
+}
+
 int main(void)
 {
     test_init_and_alloc();
     test_frame_info_and_generation();
     test_line_render_stride();
     test_line_render_1024();
+    test_partial_clear();
+    test_frame_hash();
     test_frame_info_interlace_consistency();
     test_draw_guards();
+    test_compose_golden();
+    test_batched_lines();
     test_image_conversion();
 
     WinDraw_Cleanup();
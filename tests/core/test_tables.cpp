@@ -0,0 +1,227 @@
+/*
+ * Unit tests for the generated constant tables (tools/gentables).
+ *
+ * Every *_tables.inc is included into a namespace of its own here and
+ * compared entry by entry with the formula the module used to run at
+ * startup:
+ *   - fmgen: Operator cltable/sinetable, Channel4 kftable, LFO pm/am
+ *   - OPM LFO waveforms (the noise row only for its range; it was rand())
+ *   - ADPCM dif_table
+ *   - TVRAM TextDrawPattern
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headers.h"
+#include "misc.h"
+#include "opm.h"
+#include "fmgeninl.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+namespace gen
+{
+    struct Operator
+    {
+        static const uint sinetable[1024];
+        static const int32 cltable[FM_CLENTS];
+    };
+    struct Channel4
+    {
+        static const int kftable[64];
+    };
+    struct OPM
+    {
+        enum { OPM_LFOENTS = 512 };
+        static const int amtable[4][OPM_LFOENTS];
+        static const int pmtable[4][OPM_LFOENTS];
+    };
+
+#include "fmgen_tables.inc"
+#include "opm_tables.inc"
+#include "adpcm_tables.inc"
+#include "tvram_tables.inc"
+}
+
+static const int OPM_LFOENTS = gen::OPM::OPM_LFOENTS;
+
+static int first_diff(const int *a, const int *b, int n)
+{
+    for (int i = 0; i < n; i++)
+        if (a[i] != b[i]) {
+            printf("  [%d] %d != %d\n", i, a[i], b[i]);
+            return i;
+        }
+    return -1;
+}
+
+/* fmgen.cpp Operator::MakeTable */
+static void test_operator_tables(void)
+{
+    static int cl[FM_CLENTS];
+    static int sine[1024];
+    int *p = cl;
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        int v = int(floor(pow(2., 13. - i / 256.)));
+        v = (v + 2) & ~3;
+        *p++ = v;
+        *p++ = -v;
+    }
+    while (p < cl + FM_CLENTS) {
+        *p = p[-512] / 2;
+        p++;
+    }
+    for (i = 0; i < FM_OPSINENTS / 2; i++) {
+        double r = (i * 2 + 1) * FM_PI / FM_OPSINENTS;
+        double q = -256 * log(sin(r)) / log(2.);
+        uint s = (int)(floor(q + 0.5)) + 1;
+        sine[i] = s * 2;
+        sine[FM_OPSINENTS / 2 + i] = s * 2 + 1;
+    }
+
+    CHECK(first_diff(cl, gen::Operator::cltable, FM_CLENTS) < 0, "cltable matches the formula");
+    CHECK(first_diff(sine, (const int *)gen::Operator::sinetable, FM_OPSINENTS) < 0,
+          "sinetable matches the formula");
+}
+
+/* fmgen.cpp Channel4::MakeTable */
+static void test_kftable(void)
+{
+    int kf[64];
+
+    for (int i = 0; i < 64; i++)
+        kf[i] = int(0x10000 * pow(2., i / 768.));
+    CHECK(first_diff(kf, gen::Channel4::kftable, 64) < 0, "kftable matches the formula");
+}
+
+/* fmgen.cpp MakeLFOTable */
+static void test_fm_lfo(void)
+{
+    static const double pms[2][8] =
+    {
+        { 0, 1/360., 2/360., 3/360.,  4/360.,  6/360., 12/360.,  24/360., },
+        { 0, 1/480., 2/480., 4/480., 10/480., 20/480., 80/480., 140/480., },
+    };
+    static const int amt[2][4] = { { 31, 6, 4, 3 }, { 31, 2, 1, 0 } };
+    static int pm[2][8][FM_LFOENTS];
+    static int am[2][4][FM_LFOENTS];
+
+    for (int type = 0; type < 2; type++) {
+        for (int i = 0; i < 8; i++)
+            for (int j = 0; j < FM_LFOENTS; j++) {
+                double w = 0.6 * pms[type][i] * sin(2 * j * 3.14159265358979323846 / FM_LFOENTS) + 1;
+                pm[type][i][j] = int(0x10000 * (w - 1));
+            }
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < FM_LFOENTS; j++)
+                am[type][i][j] = (((j * 4) >> amt[type][i]) * 2) << 2;
+    }
+    CHECK(first_diff(&pm[0][0][0], &gen::pmtable[0][0][0], 2 * 8 * FM_LFOENTS) < 0,
+          "FM pmtable matches the formula");
+    CHECK(first_diff(&am[0][0][0], (const int *)&gen::amtable[0][0][0], 2 * 4 * FM_LFOENTS) < 0,
+          "FM amtable matches the formula");
+}
+
+/* opm.cpp OPM::BuildLFOTable, waveforms 0-2 */
+static void test_opm_lfo(void)
+{
+    static int am[3][OPM_LFOENTS];
+    static int pm[3][OPM_LFOENTS];
+    int ok;
+
+    for (int c = 0; c < OPM_LFOENTS; c++) {
+        int p;
+
+        am[0][c] = 0xff - c / 2;
+        pm[0][c] = -((((c + 0x100) & 0x1ff) / 2) - 0x80) - 1;
+        am[1][c] = c < 0x100 ? 0xff : 0;
+        pm[1][c] = -(c < 0x100 ? 0x7f : -0x80) - 1;
+        p = (c + 0x80) & 0x1ff;
+        p = p < 0x100 ? p - 0x80 : 0x17f - p;
+        am[2][c] = c < 0x100 ? 0xff - c : c - 0x100;
+        pm[2][c] = -p - 1;
+    }
+    CHECK(first_diff(&am[0][0], &gen::OPM::amtable[0][0], 3 * OPM_LFOENTS) < 0,
+          "OPM amtable saw/square/triangle match the formula");
+    CHECK(first_diff(&pm[0][0], &gen::OPM::pmtable[0][0], 3 * OPM_LFOENTS) < 0,
+          "OPM pmtable saw/square/triangle match the formula");
+
+    // Noise: a byte held for four entries, pm = -(a - 0x80) - 1
+    ok = 1;
+    for (int c = 0; c < OPM_LFOENTS; c++) {
+        int a = gen::OPM::amtable[3][c];
+        if (a < 0 || a > 0xff || gen::OPM::pmtable[3][c] != 0x7f - a
+            || (c & 3 && a != gen::OPM::amtable[3][c & ~3]))
+            ok = 0;
+    }
+    CHECK(ok, "OPM noise row holds bytes in steps of four");
+}
+
+/* adpcm.c ADPCM_InitTable */
+static void test_adpcm(void)
+{
+    static const int bit[16][4] =
+    {
+        { 1, 0, 0, 0}, { 1, 0, 0, 1}, { 1, 0, 1, 0}, { 1, 0, 1, 1},
+        { 1, 1, 0, 0}, { 1, 1, 0, 1}, { 1, 1, 1, 0}, { 1, 1, 1, 1},
+        {-1, 0, 0, 0}, {-1, 0, 0, 1}, {-1, 0, 1, 0}, {-1, 0, 1, 1},
+        {-1, 1, 0, 0}, {-1, 1, 0, 1}, {-1, 1, 1, 0}, {-1, 1, 1, 1}
+    };
+    int dif[49*16];
+
+    for (int step = 0; step <= 48; step++) {
+        double val = floor(16.0 * pow((double)1.1, (double)step));
+        for (int n = 0; n < 16; n++)
+            dif[step*16+n] = bit[n][0] *
+                (int)(val * bit[n][1] + val/2 * bit[n][2] + val/4 * bit[n][3] + val/8);
+    }
+    CHECK(first_diff(dif, gen::dif_table, 49*16) < 0, "ADPCM dif_table matches the formula");
+}
+
+/* tvram.c TVRAM_Init */
+static void test_tvram(void)
+{
+    static BYTE pat[2048*4];
+
+    memset(pat, 0, sizeof(pat));
+    for (int i = 0; i < 256; i++)
+        for (int j = 0, bit = 0x80; j < 8; j++, bit >>= 1)
+            if (i & bit) {
+                pat[i*8+j     ] = 1;
+                pat[i*8+j+2048] = 2;
+                pat[i*8+j+4096] = 4;
+                pat[i*8+j+6144] = 8;
+            }
+    CHECK(sizeof(gen::TextDrawPattern) == sizeof(pat)
+          && memcmp(pat, gen::TextDrawPattern, sizeof(pat)) == 0,
+          "TextDrawPattern matches the loop");
+}
+
+int main(void)
+{
+    test_operator_tables();
+    test_kftable();
+    test_fm_lfo();
+    test_opm_lfo();
+    test_adpcm();
+    test_tvram();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,244 @@
+/*
+ * Tests for the offline audio render: the WAV writer (x11/wavout.c) and
+ * the capture mode of the sound output (DSound_StartCapture in
+ * x11/dswin.c), driven through DSound_Send0 with stub sources.
+ *
+ *   - header fields, chunk sizes and little-endian samples
+ *   - the file holds exactly the frames the emulated clocks call for, the
+ *     same however the clocks are split, with no gaps between blocks
+ *   - the mix is the saturated sum of the stems
+ *   - nothing reaches the host ring while capturing; afterwards it does
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "prop.h"
+#include "dswin.h"
+#include "mixer.h"
+#include "wavout.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond, name) do { \
+    if (cond) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s (%s:%d)\n", name, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected, name) do { \
+    long long _a = (long long)(actual), _e = (long long)(expected); \
+    if (_a == _e) { \
+        printf("PASS: %s\n", name); \
+    } else { \
+        printf("FAIL: %s: got %lld, expected %lld (%s:%d)\n", \
+               name, _a, _e, __FILE__, __LINE__); \
+        g_failures++; \
+    } \
+} while (0)
+
+/* ---- stubs for link dependencies of dswin.c ---- */
+Win68Conf Config;
+
+static unsigned int g_adpcm_pos, g_opm_pos;
+
+/* A ramp that reaches full scale so the mix saturates now and then */
+void FASTCALL ADPCM_Update(signed short *buffer, DWORD length, int rate, BYTE *pbsp, BYTE *pbep)
+{
+    DWORD i;
+
+    (void)rate; (void)pbsp; (void)pbep;
+    for (i = 0; i < length; i++, g_adpcm_pos++) {
+        buffer[i * 2] = (short)(g_adpcm_pos * 37);
+        buffer[i * 2 + 1] = (short)(g_adpcm_pos * -11);
+    }
+}
+
+void OPM_Update(short *buffer, int length, int rate, BYTE *pbsp, BYTE *pbep)
+{
+    int i;
+
+    (void)rate; (void)pbsp; (void)pbep;
+    for (i = 0; i < length; i++, g_opm_pos++) {
+        buffer[i * 2] = (short)((g_opm_pos & 1) ? 30000 : -30000);
+        buffer[i * 2 + 1] = (short)(g_opm_pos * 5);
+    }
+}
+
+void ADPCM_SetVolume(BYTE vol) { (void)vol; }
+void OPM_SetVolume(BYTE vol) { (void)vol; }
+
+/* ------------------------------------------------------------------------ */
+
+#define MAX_FRAMES  200000
+
+static BYTE g_file[WAVOUT_HEADER_BYTES + MAX_FRAMES * 4];
+
+static DWORD get16(const BYTE *p) { return p[0] | (p[1] << 8); }
+static DWORD get32(const BYTE *p) { return get16(p) | (get16(p + 2) << 16); }
+
+/* Reads path into g_file and returns its size, or -1 */
+static long load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    long n;
+
+    if (!fp)
+        return -1;
+    n = (long)fread(g_file, 1, sizeof(g_file), fp);
+    fclose(fp);
+    return n;
+}
+
+static short sample(long frame, int ch)
+{
+    return (short)get16(g_file + WAVOUT_HEADER_BYTES + frame * 4 + ch * 2);
+}
+
+static void test_writer(void)
+{
+    static const short pcm[] = { 0, -1, 32767, -32768, 0x1234, -0x1234 };
+    static short big[3000 * 2];
+    WavOut w;
+    long size;
+    int i, ok = 1;
+
+    CHECK(WavOut_Open(&w, "_test_wavout.wav", 48000), "open");
+    WavOut_Write(&w, pcm, 3);
+    for (i = 0; i < 3000 * 2; i++)
+        big[i] = (short)(i * 7 - 3000);
+    WavOut_Write(&w, big, 3000);    /* more than one conversion chunk */
+    CHECK(WavOut_Close(&w), "close");
+    CHECK(WavOut_Close(&w), "closing twice is harmless");
+
+    size = load("_test_wavout.wav");
+    CHECK_EQ(size, WAVOUT_HEADER_BYTES + 3003 * 4, "file size");
+    CHECK(!memcmp(g_file, "RIFF", 4) && !memcmp(g_file + 8, "WAVEfmt ", 8)
+          && !memcmp(g_file + 36, "data", 4), "chunk ids");
+    CHECK_EQ(get32(g_file + 4), size - 8, "RIFF size");
+    CHECK_EQ(get32(g_file + 16), 16, "fmt size");
+    CHECK_EQ(get16(g_file + 20), 1, "PCM format");
+    CHECK_EQ(get16(g_file + 22), 2, "stereo");
+    CHECK_EQ(get32(g_file + 24), 48000, "rate");
+    CHECK_EQ(get32(g_file + 28), 48000 * 4, "byte rate");
+    CHECK_EQ(get16(g_file + 32), 4, "block align");
+    CHECK_EQ(get16(g_file + 34), 16, "bits per sample");
+    CHECK_EQ(get32(g_file + 40), 3003 * 4, "data size");
+    CHECK(g_file[44 + 4] == 0xff && g_file[44 + 5] == 0x7f, "samples are little-endian");
+    for (i = 0; i < 6; i++)
+        ok &= sample(i / 2, i & 1) == pcm[i];
+    for (i = 0; i < 3000 * 2; i++)
+        ok &= sample(3 + i / 2, i & 1) == big[i];
+    CHECK(ok, "samples round-trip");
+
+    CHECK(!WavOut_Open(&w, "_no_such_dir/x.wav", 44100), "open fails on a bad path");
+    remove("_test_wavout.wav");
+}
+
+static void send_fields(int fields, int split)
+{
+    /* about one 31kHz field of 10MHz clocks, in hsync-sized or odd pieces */
+    int f, clk;
+
+    for (f = 0; f < fields; f++) {
+        for (clk = 0; clk < 166666; ) {
+            int n = split ? 318 : 1 + (f * 7919 + clk) % 5000;
+            if (n > 166666 - clk)
+                n = 166666 - clk;
+            DSound_Send0(n);
+            clk += n;
+        }
+    }
+}
+
+/* Renders fields to path; returns the frame count in the file */
+static long render(const char *path, int fields, int split, int stems)
+{
+    long size;
+
+    g_adpcm_pos = g_opm_pos = 0;
+    if (!DSound_StartCapture(path, stems))
+        return -1;
+    send_fields(fields, split);
+    if (!DSound_StopCapture())
+        return -1;
+    size = load(path);
+    return size < WAVOUT_HEADER_BYTES ? -1 : (size - WAVOUT_HEADER_BYTES) / 4;
+}
+
+static void test_capture(void)
+{
+    static BYTE first[WAVOUT_HEADER_BYTES + MAX_FRAMES * 4];
+    static short adpcm[MAX_FRAMES * 2], opm[MAX_FRAMES * 2];
+    DSoundMonitorState st;
+    long frames, expect = (long)(44100LL * 166666 * 30 / 10000000), i;
+    int ok = 1, sat = 0;
+
+    DSound_Init(44100, 100);
+    CHECK(!DSound_StopCapture(), "stop without a capture fails");
+
+    frames = render("_test_render.wav", 30, 1, 1);
+    CHECK_EQ(frames, expect, "frames follow the emulated clocks");
+    memcpy(first, g_file, sizeof(first));
+    DSound_GetMonitorState(&st);
+    CHECK_EQ(st.dataBytes, 0, "nothing queued for the host while capturing");
+
+    /* stems are the raw sources, with no gap between blocks */
+    CHECK_EQ(load("_test_render.adpcm.wav"), WAVOUT_HEADER_BYTES + expect * 4, "adpcm stem size");
+    for (i = 0; i < expect; i++) {
+        adpcm[i * 2] = sample(i, 0);
+        adpcm[i * 2 + 1] = sample(i, 1);
+        ok &= adpcm[i * 2] == (short)(i * 37) && adpcm[i * 2 + 1] == (short)(i * -11);
+    }
+    CHECK(ok, "adpcm stem is the source output");
+    CHECK_EQ(load("_test_render.opm.wav"), WAVOUT_HEADER_BYTES + expect * 4, "opm stem size");
+    for (i = 0; i < expect * 2; i++)
+        opm[i] = sample(i / 2, (int)(i & 1));
+
+    memcpy(g_file, first, sizeof(first));
+    for (i = 0, ok = 1; i < expect * 2; i++) {
+        int v = adpcm[i] + opm[i];
+        if (v > 32767) v = 32767, sat = 1; else if (v < -32768) v = -32768, sat = 1;
+        ok &= sample(i / 2, (int)(i & 1)) == v;
+    }
+    CHECK(ok && sat, "mix is the saturated sum of the stems");
+
+    /* same clocks in other pieces: same file */
+    remove("_test_render.adpcm.wav");
+    remove("_test_render.opm.wav");
+    CHECK_EQ(render("_test_render.wav", 30, 0, 0), expect, "odd clock pieces give the same length");
+    CHECK(!memcmp(g_file, first, WAVOUT_HEADER_BYTES + expect * 4), "odd clock pieces give the same file");
+    CHECK(load("_test_render.opm.wav") < 0, "no stems unless asked for");
+
+    CHECK(DSound_StartCapture("_test_nostem", 1), "start with a name without .wav");
+    CHECK(!DSound_StartCapture("_test_render.wav", 0), "one capture at a time");
+    CHECK(DSound_StopCapture(), "stop");
+    CHECK(load("_test_nostem.opm.wav") == WAVOUT_HEADER_BYTES, "stem name appends to other names");
+    CHECK(!DSound_StartCapture("_no_such_dir/x.wav", 0), "start fails on a bad path");
+
+    /* back to the host ring */
+    send_fields(1, 1);
+    DSound_GetMonitorState(&st);
+    CHECK(st.dataBytes > 0, "sound goes to the host again after the capture");
+
+    remove("_test_render.wav");
+    remove("_test_nostem");
+    remove("_test_nostem.adpcm.wav");
+    remove("_test_nostem.opm.wav");
+}
+
+int main(void)
+{
+    test_writer();
+    test_capture();
+
+    if (g_failures) {
+        printf("%d test(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh -e
+# Build gentables with the host compiler and regenerate the constant table
+# sources (*_tables.inc) in the px68k tree. Rerun after changing a formula
+# in gentables.c and commit the regenerated files.
+# Override the compiler with CC=... if needed.
+cd "$(dirname "$0")"
+CC=${CC:-cc}
+
+"$CC" -O2 -Wall -o gentables gentables.c -lm
+./gentables "../../X68000 Shared/px68k"
+rm -f gentables
+echo "tables written"
@@ -0,0 +1,340 @@
+// ---------------------------------------------------------------------------------------
+//  GENTABLES.C - Writes the constant lookup tables of the sound and text cores
+// ---------------------------------------------------------------------------------------
+//
+// Each table used to be computed when its module started. The formulas are
+// kept here, exactly as they ran there, and the results are written out as
+// read-only definitions that the modules #include:
+//
+//   fmgen/fmgen_tables.inc   Operator cltable/sinetable, Channel4 kftable,
+//                            OPN/OPM LFO pmtable/amtable
+//   fmgen/opm_tables.inc     OPM LFO waveform tables
+//   x68k/adpcm_tables.inc    MSM6258 step difference table
+//   x68k/tvram_tables.inc    plane bit -> colour bit expansion
+//
+// Usage: gentables <px68k directory>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FM_PI           3.14159265358979323846
+#define FM_CLENTS       (0x1000 * 2)
+#define FM_OPSINENTS    1024
+#define FM_LFOENTS      256
+#define OPM_LFOENTS     512
+
+static const char *banner =
+    "// Generated by tools/gentables/gentables.c -- do not edit.\n";
+
+static FILE *out;
+
+static FILE *open_out(const char *dir, const char *name)
+{
+    char path[1024];
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        exit(1);
+    }
+    fputs(banner, out);
+    return out;
+}
+
+static void close_out(void)
+{
+    if (ferror(out) || fclose(out) != 0) {
+        perror("gentables");
+        exit(1);
+    }
+}
+
+// Comma separated values, per_line to a row, indented by depth tabs.
+static void values(const int *v, int n, int per_line, int depth)
+{
+    int i, t;
+
+    for (i = 0; i < n; i++) {
+        if (i % per_line == 0)
+            for (t = 0; t < depth; t++)
+                fputc('\t', out);
+        fprintf(out, "%d,", v[i]);
+        fputc((i % per_line == per_line - 1 || i == n - 1) ? '\n' : ' ', out);
+    }
+}
+
+static void open_brace(int depth)
+{
+    int t;
+
+    for (t = 0; t < depth; t++)
+        fputc('\t', out);
+    fputs("{\n", out);
+}
+
+static void close_brace(int depth, const char *tail)
+{
+    int t;
+
+    for (t = 0; t < depth; t++)
+        fputc('\t', out);
+    fprintf(out, "}%s\n", tail);
+}
+
+// ---------------------------------------------------------------------------
+//  fmgen: fmgen.cpp Operator::MakeTable, Channel4::MakeTable, MakeLFOTable
+// ---------------------------------------------------------------------------
+static void gen_fmgen(const char *dir)
+{
+    static int cltable[FM_CLENTS];
+    static int sinetable[FM_OPSINENTS];
+    static int kftable[64];
+    static int pmtable[2][8][FM_LFOENTS];
+    static int amtable[2][4][FM_LFOENTS];
+    static const double pms[2][8] =
+    {
+        { 0, 1/360., 2/360., 3/360.,  4/360.,  6/360., 12/360.,  24/360., },  // OPNA
+        { 0, 1/480., 2/480., 4/480., 10/480., 20/480., 80/480., 140/480., },  // OPM
+    };
+    static const int amt[2][4] =
+    {
+        { 31, 6, 4, 3 },    // OPNA
+        { 31, 2, 1, 0 },    // OPM
+    };
+    double log2 = log(2.);
+    int *p = cltable;
+    int i, j, type;
+
+    for (i = 0; i < 256; i++) {
+        int v = (int)floor(pow(2., 13. - i / 256.));
+        v = (v + 2) & ~3;
+        *p++ = v;
+        *p++ = -v;
+    }
+    while (p < cltable + FM_CLENTS) {
+        *p = p[-512] / 2;
+        p++;
+    }
+
+    for (i = 0; i < FM_OPSINENTS / 2; i++) {
+        double r = (i * 2 + 1) * FM_PI / FM_OPSINENTS;
+        double q = -256 * log(sin(r)) / log2;
+        unsigned s = (int)floor(q + 0.5) + 1;
+        sinetable[i] = s * 2;
+        sinetable[FM_OPSINENTS / 2 + i] = s * 2 + 1;
+    }
+
+    // 100/64 cent = 2^(i*100/64*1200)
+    for (i = 0; i < 64; i++)
+        kftable[i] = (int)(0x10000 * pow(2., i / 768.));
+
+    for (type = 0; type < 2; type++) {
+        for (i = 0; i < 8; i++) {
+            double pmb = pms[type][i];
+            for (j = 0; j < FM_LFOENTS; j++) {
+                double w = 0.6 * pmb * sin(2 * j * 3.14159265358979323846 / FM_LFOENTS) + 1;
+                pmtable[type][i][j] = (int)(0x10000 * (w - 1));
+            }
+        }
+        for (i = 0; i < 4; i++)
+            for (j = 0; j < FM_LFOENTS; j++)
+                amtable[type][i][j] = (((j * 4) >> amt[type][i]) * 2) << 2;
+    }
+
+    open_out(dir, "fmgen/fmgen_tables.inc");
+
+    fputs("\n// 2^(-i/256) in 13 bits, as (+, -) pairs; each 512 entries one octave down\n", out);
+    fputs("const int32 Operator::cltable[FM_CLENTS] =\n{\n", out);
+    values(cltable, FM_CLENTS, 16, 1);
+    fputs("};\n", out);
+
+    fputs("\n// -log2(sin) in 1/256 steps, times two; odd entries are the negative half\n", out);
+    fputs("const uint Operator::sinetable[1024] =\n{\n", out);
+    values(sinetable, FM_OPSINENTS, 16, 1);
+    fputs("};\n", out);
+
+    fputs("\n// key fraction -> 2^(i/768) in 16.16\n", out);
+    fputs("const int Channel4::kftable[64] =\n{\n", out);
+    values(kftable, 64, 8, 1);
+    fputs("};\n", out);
+
+    fputs("\n// LFO: [OPNA/OPM][PMS/AMS][phase]\n", out);
+    fputs("const int pmtable[2][8][FM_LFOENTS] =\n{\n", out);
+    for (type = 0; type < 2; type++) {
+        open_brace(1);
+        for (i = 0; i < 8; i++) {
+            open_brace(2);
+            values(pmtable[type][i], FM_LFOENTS, 16, 3);
+            close_brace(2, ",");
+        }
+        close_brace(1, ",");
+    }
+    fputs("};\n", out);
+
+    fputs("\nconst uint amtable[2][4][FM_LFOENTS] =\n{\n", out);
+    for (type = 0; type < 2; type++) {
+        open_brace(1);
+        for (i = 0; i < 4; i++) {
+            open_brace(2);
+            values(amtable[type][i], FM_LFOENTS, 16, 3);
+            close_brace(2, ",");
+        }
+        close_brace(1, ",");
+    }
+    fputs("};\n", out);
+
+    close_out();
+}
+
+// ---------------------------------------------------------------------------
+//  fmgen: opm.cpp OPM::BuildLFOTable
+// ---------------------------------------------------------------------------
+// Waveform 3 (noise) was filled from rand(); OPM::LFO draws its own random
+// values for that waveform and never reads the row, so a fixed generator
+// (the C standard's sample rand, seed 1) keeps the output reproducible.
+static unsigned long noise_next = 1;
+
+static int noise_rand(void)
+{
+    noise_next = noise_next * 1103515245 + 12345;
+    return (int)((noise_next / 65536) % 32768);
+}
+
+static void gen_opm(const char *dir)
+{
+    static int amtable[4][OPM_LFOENTS];
+    static int pmtable[4][OPM_LFOENTS];
+    int type, c;
+
+    for (type = 0; type < 4; type++) {
+        int r = 0;
+        for (c = 0; c < OPM_LFOENTS; c++) {
+            int a, p;
+
+            switch (type) {
+            case 0:
+                p = (((c + 0x100) & 0x1ff) / 2) - 0x80;
+                a = 0xff - c / 2;
+                break;
+
+            case 1:
+                a = c < 0x100 ? 0xff : 0;
+                p = c < 0x100 ? 0x7f : -0x80;
+                break;
+
+            case 2:
+                p = (c + 0x80) & 0x1ff;
+                p = p < 0x100 ? p - 0x80 : 0x17f - p;
+                a = c < 0x100 ? 0xff - c : c - 0x100;
+                break;
+
+            default:
+                if (!(c & 3))
+                    r = (noise_rand() / 17) & 0xff;
+                a = r;
+                p = r - 0x80;
+                break;
+            }
+            amtable[type][c] = a;
+            pmtable[type][c] = -p-1;
+        }
+    }
+
+    open_out(dir, "fmgen/opm_tables.inc");
+
+    fputs("\n// LFO waveforms: saw, square, triangle, noise\n", out);
+    fputs("const int OPM::amtable[4][OPM_LFOENTS] =\n{\n", out);
+    for (type = 0; type < 4; type++) {
+        open_brace(1);
+        values(amtable[type], OPM_LFOENTS, 16, 2);
+        close_brace(1, ",");
+    }
+    fputs("};\n", out);
+
+    fputs("\nconst int OPM::pmtable[4][OPM_LFOENTS] =\n{\n", out);
+    for (type = 0; type < 4; type++) {
+        open_brace(1);
+        values(pmtable[type], OPM_LFOENTS, 16, 2);
+        close_brace(1, ",");
+    }
+    fputs("};\n", out);
+
+    close_out();
+}
+
+// ---------------------------------------------------------------------------
+//  x68k: adpcm.c ADPCM_InitTable
+// ---------------------------------------------------------------------------
+static void gen_adpcm(const char *dir)
+{
+    static int dif_table[49*16];
+    static const int bit[16][4] =
+    {
+        { 1, 0, 0, 0}, { 1, 0, 0, 1}, { 1, 0, 1, 0}, { 1, 0, 1, 1},
+        { 1, 1, 0, 0}, { 1, 1, 0, 1}, { 1, 1, 1, 0}, { 1, 1, 1, 1},
+        {-1, 0, 0, 0}, {-1, 0, 0, 1}, {-1, 0, 1, 0}, {-1, 0, 1, 1},
+        {-1, 1, 0, 0}, {-1, 1, 0, 1}, {-1, 1, 1, 0}, {-1, 1, 1, 1}
+    };
+    int step, n;
+    double val;
+
+    for (step = 0; step <= 48; step++) {
+        val = floor(16.0 * pow((double)1.1, (double)step));
+        for (n = 0; n < 16; n++) {
+            dif_table[step*16+n] = bit[n][0] *
+               (int)(val   * bit[n][1] +
+                     val/2 * bit[n][2] +
+                     val/4 * bit[n][3] +
+                     val/8);
+        }
+    }
+
+    open_out(dir, "x68k/adpcm_tables.inc");
+    fputs("\n// [step*16 + nibble]: signed difference, step size floor(16*1.1^step)\n", out);
+    fputs("static const int dif_table[49*16] = {\n", out);
+    values(dif_table, 49*16, 16, 1);
+    fputs("};\n", out);
+    close_out();
+}
+
+// ---------------------------------------------------------------------------
+//  x68k: tvram.c TVRAM_Init
+// ---------------------------------------------------------------------------
+static void gen_tvram(const char *dir)
+{
+    static int pattern[2048*4];
+    int i, j, bit;
+
+    for (i = 0; i < 256; i++) {
+        for (j = 0, bit = 0x80; j < 8; j++, bit >>= 1) {
+            if (i & bit) {
+                pattern[i*8+j     ] = 1;
+                pattern[i*8+j+2048] = 2;
+                pattern[i*8+j+4096] = 4;
+                pattern[i*8+j+6144] = 8;
+            }
+        }
+    }
+
+    open_out(dir, "x68k/tvram_tables.inc");
+    fputs("\n// [plane*2048 + byte*8 + dot]: the plane's colour bit where the dot is set\n", out);
+    fputs("const BYTE TextDrawPattern[2048*4] = {\n", out);
+    values(pattern, 2048*4, 16, 1);
+    fputs("};\n", out);
+    close_out();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <px68k directory>\n", argv[0]);
+        return 2;
+    }
+    gen_fmgen(argv[1]);
+    gen_opm(argv[1]);
+    gen_adpcm(argv[1]);
+    gen_tvram(argv[1]);
+    return 0;
+}